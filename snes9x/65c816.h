@@ -272,6 +272,6 @@ struct SRegisters
 #define PCl		PC.B.xPCl
 #define PB		PC.B.xPB
 
-extern struct SRegisters	Registers;
+extern CONTEXT_LOCAL struct SRegisters	Registers;
 
 #endif
@@ -117,6 +117,7 @@ public:
 	void    dsp_set_spc_snapshot_callback( void (*callback) (void) );
 	void    dsp_dump_spc_snapshot( void );
 	void    dsp_set_stereo_switch( int );
+	void    dsp_set_fast_brr( bool );
 	uint8_t dsp_reg_value( int, int );
 	int     dsp_envx_value( int );
 
@@ -124,8 +125,9 @@ public:
 
 #ifdef DEBUGGER
 	void	debug_toggle_trace( void );
+	void	debug_set_binary_trace( bool );
 	bool    debug_is_enabled( void );
-	void	debug_do_trace( int, int, int, uint8_t const *, uint8_t *, int, int, int, int );
+	void	debug_do_trace( int, int, int, uint8_t const *, uint8_t *, int, int, int, int, int );
 	void	debug_op_print( char *, int, int, int, uint8_t const *, uint8_t *, int, int, int, int );
 	void	debug_io_print( char * );
 #endif
@@ -283,6 +285,7 @@ private:
 #ifdef DEBUGGER
 	FILE *apu_trace;
 	bool debug_trace;
+	bool debug_binary;
 #endif
 };
 
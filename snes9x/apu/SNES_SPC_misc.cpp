@@ -77,6 +77,7 @@ blargg_err_t SNES_SPC::init()
 #ifdef DEBUGGER
 	apu_trace = NULL;
 	debug_trace = false;
+	debug_binary = false;
 #endif
 
 	#if SPC_LESS_ACCURATE
@@ -412,6 +413,11 @@ void SNES_SPC::dsp_set_stereo_switch( int value )
 	dsp.set_stereo_switch( value );
 }
 
+void SNES_SPC::dsp_set_fast_brr( bool enable )
+{
+	dsp.set_fast_brr( enable );
+}
+
 SNES_SPC::uint8_t SNES_SPC::dsp_reg_value( int ch, int addr )
 {
 	return dsp.reg_value( ch, addr );
@@ -428,9 +434,7 @@ int SNES_SPC::dsp_envx_value( int ch )
 
 void SNES_SPC::debug_toggle_trace( void )
 {
-	debug_trace = !debug_trace;
-
-	if (debug_trace)
+	if (!apu_trace)
 	{
 		printf("APU tracing enabled.\n");
 		ENSURE_TRACE_OPEN(apu_trace, "apu_trace.log", "wb")
@@ -441,14 +445,45 @@ void SNES_SPC::debug_toggle_trace( void )
 		fclose(apu_trace);
 		apu_trace = NULL;
 	}
+
+	debug_trace = apu_trace != NULL || debug_binary;
+}
+
+// While the binary trace runs, each instruction goes there instead of to
+// apu_trace.log, as the main CPU's do.
+void SNES_SPC::debug_set_binary_trace( bool enable )
+{
+	debug_binary = enable;
+	debug_trace = apu_trace != NULL || debug_binary;
 }
 
 bool SNES_SPC::debug_is_enabled( void ) { return debug_trace; }
 
-void SNES_SPC::debug_do_trace( int a, int x, int y, uint8_t const *pc, uint8_t *sp, int psw, int c, int nz, int dp )
+void SNES_SPC::debug_do_trace( int a, int x, int y, uint8_t const *pc, uint8_t *sp, int psw, int c, int nz, int dp, int time )
 {
 	char	msg[512];
 
+	if (debug_binary)
+	{
+		uint8_t const	*ram = RAM;
+		int				addr = pc - ram;
+		uint8_t			bytes[4];
+		int				tpsw;
+
+		for (int i = 0; i < 4; i++)
+			bytes[i] = (addr + i <= 0xffff) ? pc[i] : 0;
+
+		tpsw = psw & ~(0x80 | 0x20 | 0x02 | 0x01);
+		tpsw |= c >> 8 & 0x01;
+		tpsw |= dp >> 3 & 0x20;
+		tpsw |= ((nz >> 4) | nz) & 0x80;
+		if (!(uint8_t) nz)
+			tpsw |= 0x02;
+
+		S9xSPCTrace(addr, bytes, a, x, y, sp - 0x101 - ram, tpsw, time);
+		return;
+	}
+
 	ENSURE_TRACE_OPEN(apu_trace, "apu_trace.log", "a")
 
 	debug_op_print(msg, a, x, y, pc, sp, psw, c, nz, dp);
@@ -221,7 +221,7 @@ loop:
 
 #ifdef DEBUGGER
 	if (debug_trace)
-		debug_do_trace(a, x, y, pc, sp, psw, c, nz, dp);
+		debug_do_trace(a, x, y, pc, sp, psw, c, nz, dp, m.spc_time + rel_time);
 #endif
 
 
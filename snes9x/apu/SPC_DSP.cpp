@@ -5,6 +5,10 @@
 #include "blargg_endian.h"
 #include <string.h>
 
+#ifdef __SSE2__
+	#include <emmintrin.h>
+#endif
+
 /* Copyright (C) 2007 Shay Green. This module is free software; you
 can redistribute it and/or modify it under the terms of the GNU Lesser
 General Public License as published by the Free Software Foundation; either
@@ -90,56 +94,100 @@ void SPC_DSP::set_output( sample_t* out, int size )
 
 // Gaussian interpolation
 
-static short const gauss [512] =
+// Taps for each fractional position i between samples, in the order they are
+// applied. Read from the 512-entry gaussian curve g as g [255 - i],
+// g [511 - i], g [256 + i] and g [i], so the right half mirrors the left.
+static int const gauss_taps [256] [4] =
 {
-   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
-   1,   1,   1,   1,   1,   1,   1,   1,   1,   1,   1,   2,   2,   2,   2,   2,
-   2,   2,   3,   3,   3,   3,   3,   4,   4,   4,   4,   4,   5,   5,   5,   5,
-   6,   6,   6,   6,   7,   7,   7,   8,   8,   8,   9,   9,   9,  10,  10,  10,
-  11,  11,  11,  12,  12,  13,  13,  14,  14,  15,  15,  15,  16,  16,  17,  17,
-  18,  19,  19,  20,  20,  21,  21,  22,  23,  23,  24,  24,  25,  26,  27,  27,
-  28,  29,  29,  30,  31,  32,  32,  33,  34,  35,  36,  36,  37,  38,  39,  40,
-  41,  42,  43,  44,  45,  46,  47,  48,  49,  50,  51,  52,  53,  54,  55,  56,
-  58,  59,  60,  61,  62,  64,  65,  66,  67,  69,  70,  71,  73,  74,  76,  77,
-  78,  80,  81,  83,  84,  86,  87,  89,  90,  92,  94,  95,  97,  99, 100, 102,
- 104, 106, 107, 109, 111, 113, 115, 117, 118, 120, 122, 124, 126, 128, 130, 132,
- 134, 137, 139, 141, 143, 145, 147, 150, 152, 154, 156, 159, 161, 163, 166, 168,
- 171, 173, 175, 178, 180, 183, 186, 188, 191, 193, 196, 199, 201, 204, 207, 210,
- 212, 215, 218, 221, 224, 227, 230, 233, 236, 239, 242, 245, 248, 251, 254, 257,
- 260, 263, 267, 270, 273, 276, 280, 283, 286, 290, 293, 297, 300, 304, 307, 311,
- 314, 318, 321, 325, 328, 332, 336, 339, 343, 347, 351, 354, 358, 362, 366, 370,
- 374, 378, 381, 385, 389, 393, 397, 401, 405, 410, 414, 418, 422, 426, 430, 434,
- 439, 443, 447, 451, 456, 460, 464, 469, 473, 477, 482, 486, 491, 495, 499, 504,
- 508, 513, 517, 522, 527, 531, 536, 540, 545, 550, 554, 559, 563, 568, 573, 577,
- 582, 587, 592, 596, 601, 606, 611, 615, 620, 625, 630, 635, 640, 644, 649, 654,
- 659, 664, 669, 674, 678, 683, 688, 693, 698, 703, 708, 713, 718, 723, 728, 732,
- 737, 742, 747, 752, 757, 762, 767, 772, 777, 782, 787, 792, 797, 802, 806, 811,
- 816, 821, 826, 831, 836, 841, 846, 851, 855, 860, 865, 870, 875, 880, 884, 889,
- 894, 899, 904, 908, 913, 918, 923, 927, 932, 937, 941, 946, 951, 955, 960, 965,
- 969, 974, 978, 983, 988, 992, 997,1001,1005,1010,1014,1019,1023,1027,1032,1036,
-1040,1045,1049,1053,1057,1061,1066,1070,1074,1078,1082,1086,1090,1094,1098,1102,
-1106,1109,1113,1117,1121,1125,1128,1132,1136,1139,1143,1146,1150,1153,1157,1160,
-1164,1167,1170,1174,1177,1180,1183,1186,1190,1193,1196,1199,1202,1205,1207,1210,
-1213,1216,1219,1221,1224,1227,1229,1232,1234,1237,1239,1241,1244,1246,1248,1251,
-1253,1255,1257,1259,1261,1263,1265,1267,1269,1270,1272,1274,1275,1277,1279,1280,
-1282,1283,1284,1286,1287,1288,1290,1291,1292,1293,1294,1295,1296,1297,1297,1298,
-1299,1300,1300,1301,1302,1302,1303,1303,1303,1304,1304,1304,1304,1304,1305,1305,
+{ 370,1305, 374,   0},{ 366,1305, 378,   0},{ 362,1304, 381,   0},{ 358,1304, 385,   0},
+{ 354,1304, 389,   0},{ 351,1304, 393,   0},{ 347,1304, 397,   0},{ 343,1303, 401,   0},
+{ 339,1303, 405,   0},{ 336,1303, 410,   0},{ 332,1302, 414,   0},{ 328,1302, 418,   0},
+{ 325,1301, 422,   0},{ 321,1300, 426,   0},{ 318,1300, 430,   0},{ 314,1299, 434,   0},
+{ 311,1298, 439,   1},{ 307,1297, 443,   1},{ 304,1297, 447,   1},{ 300,1296, 451,   1},
+{ 297,1295, 456,   1},{ 293,1294, 460,   1},{ 290,1293, 464,   1},{ 286,1292, 469,   1},
+{ 283,1291, 473,   1},{ 280,1290, 477,   1},{ 276,1288, 482,   1},{ 273,1287, 486,   2},
+{ 270,1286, 491,   2},{ 267,1284, 495,   2},{ 263,1283, 499,   2},{ 260,1282, 504,   2},
+{ 257,1280, 508,   2},{ 254,1279, 513,   2},{ 251,1277, 517,   3},{ 248,1275, 522,   3},
+{ 245,1274, 527,   3},{ 242,1272, 531,   3},{ 239,1270, 536,   3},{ 236,1269, 540,   4},
+{ 233,1267, 545,   4},{ 230,1265, 550,   4},{ 227,1263, 554,   4},{ 224,1261, 559,   4},
+{ 221,1259, 563,   5},{ 218,1257, 568,   5},{ 215,1255, 573,   5},{ 212,1253, 577,   5},
+{ 210,1251, 582,   6},{ 207,1248, 587,   6},{ 204,1246, 592,   6},{ 201,1244, 596,   6},
+{ 199,1241, 601,   7},{ 196,1239, 606,   7},{ 193,1237, 611,   7},{ 191,1234, 615,   8},
+{ 188,1232, 620,   8},{ 186,1229, 625,   8},{ 183,1227, 630,   9},{ 180,1224, 635,   9},
+{ 178,1221, 640,   9},{ 175,1219, 644,  10},{ 173,1216, 649,  10},{ 171,1213, 654,  10},
+{ 168,1210, 659,  11},{ 166,1207, 664,  11},{ 163,1205, 669,  11},{ 161,1202, 674,  12},
+{ 159,1199, 678,  12},{ 156,1196, 683,  13},{ 154,1193, 688,  13},{ 152,1190, 693,  14},
+{ 150,1186, 698,  14},{ 147,1183, 703,  15},{ 145,1180, 708,  15},{ 143,1177, 713,  15},
+{ 141,1174, 718,  16},{ 139,1170, 723,  16},{ 137,1167, 728,  17},{ 134,1164, 732,  17},
+{ 132,1160, 737,  18},{ 130,1157, 742,  19},{ 128,1153, 747,  19},{ 126,1150, 752,  20},
+{ 124,1146, 757,  20},{ 122,1143, 762,  21},{ 120,1139, 767,  21},{ 118,1136, 772,  22},
+{ 117,1132, 777,  23},{ 115,1128, 782,  23},{ 113,1125, 787,  24},{ 111,1121, 792,  24},
+{ 109,1117, 797,  25},{ 107,1113, 802,  26},{ 106,1109, 806,  27},{ 104,1106, 811,  27},
+{ 102,1102, 816,  28},{ 100,1098, 821,  29},{  99,1094, 826,  29},{  97,1090, 831,  30},
+{  95,1086, 836,  31},{  94,1082, 841,  32},{  92,1078, 846,  32},{  90,1074, 851,  33},
+{  89,1070, 855,  34},{  87,1066, 860,  35},{  86,1061, 865,  36},{  84,1057, 870,  36},
+{  83,1053, 875,  37},{  81,1049, 880,  38},{  80,1045, 884,  39},{  78,1040, 889,  40},
+{  77,1036, 894,  41},{  76,1032, 899,  42},{  74,1027, 904,  43},{  73,1023, 908,  44},
+{  71,1019, 913,  45},{  70,1014, 918,  46},{  69,1010, 923,  47},{  67,1005, 927,  48},
+{  66,1001, 932,  49},{  65, 997, 937,  50},{  64, 992, 941,  51},{  62, 988, 946,  52},
+{  61, 983, 951,  53},{  60, 978, 955,  54},{  59, 974, 960,  55},{  58, 969, 965,  56},
+{  56, 965, 969,  58},{  55, 960, 974,  59},{  54, 955, 978,  60},{  53, 951, 983,  61},
+{  52, 946, 988,  62},{  51, 941, 992,  64},{  50, 937, 997,  65},{  49, 932,1001,  66},
+{  48, 927,1005,  67},{  47, 923,1010,  69},{  46, 918,1014,  70},{  45, 913,1019,  71},
+{  44, 908,1023,  73},{  43, 904,1027,  74},{  42, 899,1032,  76},{  41, 894,1036,  77},
+{  40, 889,1040,  78},{  39, 884,1045,  80},{  38, 880,1049,  81},{  37, 875,1053,  83},
+{  36, 870,1057,  84},{  36, 865,1061,  86},{  35, 860,1066,  87},{  34, 855,1070,  89},
+{  33, 851,1074,  90},{  32, 846,1078,  92},{  32, 841,1082,  94},{  31, 836,1086,  95},
+{  30, 831,1090,  97},{  29, 826,1094,  99},{  29, 821,1098, 100},{  28, 816,1102, 102},
+{  27, 811,1106, 104},{  27, 806,1109, 106},{  26, 802,1113, 107},{  25, 797,1117, 109},
+{  24, 792,1121, 111},{  24, 787,1125, 113},{  23, 782,1128, 115},{  23, 777,1132, 117},
+{  22, 772,1136, 118},{  21, 767,1139, 120},{  21, 762,1143, 122},{  20, 757,1146, 124},
+{  20, 752,1150, 126},{  19, 747,1153, 128},{  19, 742,1157, 130},{  18, 737,1160, 132},
+{  17, 732,1164, 134},{  17, 728,1167, 137},{  16, 723,1170, 139},{  16, 718,1174, 141},
+{  15, 713,1177, 143},{  15, 708,1180, 145},{  15, 703,1183, 147},{  14, 698,1186, 150},
+{  14, 693,1190, 152},{  13, 688,1193, 154},{  13, 683,1196, 156},{  12, 678,1199, 159},
+{  12, 674,1202, 161},{  11, 669,1205, 163},{  11, 664,1207, 166},{  11, 659,1210, 168},
+{  10, 654,1213, 171},{  10, 649,1216, 173},{  10, 644,1219, 175},{   9, 640,1221, 178},
+{   9, 635,1224, 180},{   9, 630,1227, 183},{   8, 625,1229, 186},{   8, 620,1232, 188},
+{   8, 615,1234, 191},{   7, 611,1237, 193},{   7, 606,1239, 196},{   7, 601,1241, 199},
+{   6, 596,1244, 201},{   6, 592,1246, 204},{   6, 587,1248, 207},{   6, 582,1251, 210},
+{   5, 577,1253, 212},{   5, 573,1255, 215},{   5, 568,1257, 218},{   5, 563,1259, 221},
+{   4, 559,1261, 224},{   4, 554,1263, 227},{   4, 550,1265, 230},{   4, 545,1267, 233},
+{   4, 540,1269, 236},{   3, 536,1270, 239},{   3, 531,1272, 242},{   3, 527,1274, 245},
+{   3, 522,1275, 248},{   3, 517,1277, 251},{   2, 513,1279, 254},{   2, 508,1280, 257},
+{   2, 504,1282, 260},{   2, 499,1283, 263},{   2, 495,1284, 267},{   2, 491,1286, 270},
+{   2, 486,1287, 273},{   1, 482,1288, 276},{   1, 477,1290, 280},{   1, 473,1291, 283},
+{   1, 469,1292, 286},{   1, 464,1293, 290},{   1, 460,1294, 293},{   1, 456,1295, 297},
+{   1, 451,1296, 300},{   1, 447,1297, 304},{   1, 443,1297, 307},{   1, 439,1298, 311},
+{   0, 434,1299, 314},{   0, 430,1300, 318},{   0, 426,1300, 321},{   0, 422,1301, 325},
+{   0, 418,1302, 328},{   0, 414,1302, 332},{   0, 410,1303, 336},{   0, 405,1303, 339},
+{   0, 401,1303, 343},{   0, 397,1304, 347},{   0, 393,1304, 351},{   0, 389,1304, 354},
+{   0, 385,1304, 358},{   0, 381,1304, 362},{   0, 378,1305, 366},{   0, 374,1305, 370},
 };
 
 inline int SPC_DSP::interpolate( voice_t const* v )
 {
-	// Make pointers into gaussian based on fractional position between samples
-	int offset = v->interp_pos >> 4 & 0xFF;
-	short const* fwd = gauss + 255 - offset;
-	short const* rev = gauss       + offset; // mirror left half of gaussian
+	// Taps for fractional position between samples
+	int const* t = gauss_taps [v->interp_pos >> 4 & 0xFF];
 	
 	int const* in = &v->buf [(v->interp_pos >> 12) + v->buf_pos];
 	int out;
-	out  = (fwd [  0] * in [0]) >> 11;
-	out += (fwd [256] * in [1]) >> 11;
-	out += (rev [256] * in [2]) >> 11;
+#ifdef __SSE2__
+	// Samples are 16-bit and taps positive 11-bit, so the high half of each
+	// 32-bit tap is zero and madd gives the four exact products
+	__m128i prod = _mm_madd_epi16( _mm_loadu_si128( (__m128i const*) in ),
+			_mm_loadu_si128( (__m128i const*) t ) );
+	int p [4];
+	_mm_storeu_si128( (__m128i*) p, _mm_srai_epi32( prod, 11 ) );
+	out = (int16_t) (p [0] + p [1] + p [2]);
+	out += p [3];
+#else
+	out  = (t [0] * in [0]) >> 11;
+	out += (t [1] * in [1]) >> 11;
+	out += (t [2] * in [2]) >> 11;
 	out = (int16_t) out;
-	out += (rev [  0] * in [3]) >> 11;
+	out += (t [3] * in [3]) >> 11;
+#endif
 	
 	CLAMP16( out );
 	out &= ~1;
@@ -285,61 +333,134 @@ inline void SPC_DSP::run_envelope( voice_t* const v )
 
 //// BRR Decoding
 
-inline void SPC_DSP::decode_brr( voice_t* v )
+// Adjusts filtered sample as stored in buffer
+static inline int brr_clamp( int s )
 {
-	// Arrange the four input nybbles in 0xABCD order for easy decoding
-	int nybbles = m.t_brr_byte * 0x100 + m.ram [(v->brr_addr + v->brr_offset + 1) & 0xFFFF];
+	CLAMP16( s );
+	return (int16_t) (s * 2);
+}
+
+// Extracts four input nybbles in 0xABCD order, sign-extends and shifts them
+// based on header. Shift is the same for all four, so it's looked at once.
+static inline void brr_unpack( int header, int nybbles, int* in )
+{
+	int const shift = header >> 4;
+	if ( shift < 0xD )
+	{
+		for ( int i = 0; i < 4; i++, nybbles <<= 4 )
+			in [i] = (((int16_t) nybbles >> 12) << shift) >> 1;
+	}
+	else // handle invalid range
+	{
+		for ( int i = 0; i < 4; i++, nybbles <<= 4 )
+			in [i] = ((int16_t) nybbles >> 15) << 11; // same as: s = (s < 0 ? -0x800 : 0)
+	}
+}
+
+// Runs IIR filter over count shifted samples, with the two previous samples
+// at out [-2] and out [-1] (8 is the most commonly used), and writes them to
+// out and copy
+template<int count>
+static inline void brr_filter( int header, int const* in, int* out, int* copy )
+{
+	int p1 = out [-1];
+	int p2 = out [-2];
+	
+	switch ( header & 0x0C )
+	{
+	case 0:
+		for ( int i = 0; i < count; i++ )
+			copy [i] = out [i] = brr_clamp( in [i] );
+		break;
 	
+	case 4: // s += p1 * 0.46875
+		for ( int i = 0; i < count; i++ )
+		{
+			int const s = in [i] + (p1 >> 1) + ((-p1) >> 5);
+			copy [i] = out [i] = p1 = brr_clamp( s );
+		}
+		break;
+	
+	case 8: // s += p1 * 0.953125 - p2 * 0.46875
+		for ( int i = 0; i < count; i++ )
+		{
+			int const h = p2 >> 1;
+			int const s = in [i] + p1 - h + (h >> 4) + ((p1 * -3) >> 6);
+			p2 = p1;
+			copy [i] = out [i] = p1 = brr_clamp( s );
+		}
+		break;
+	
+	default: // s += p1 * 0.8984375 - p2 * 0.40625
+		for ( int i = 0; i < count; i++ )
+		{
+			int const h = p2 >> 1;
+			int const s = in [i] + p1 - h + ((p1 * -13) >> 7) + ((h * 3) >> 4);
+			p2 = p1;
+			copy [i] = out [i] = p1 = brr_clamp( s );
+		}
+		break;
+	}
+}
+
+// Decodes a whole BRR block in one go as a voice starts it, for fast BRR mode.
+// Only differs from decoding as the DSP goes if the SMP rewrites the block
+// while it plays.
+inline void SPC_DSP::decode_brr_block( voice_t* v )
+{
 	int const header = m.t_brr_header;
+	int* out = &v->brr_ahead [2];
+	
+	out [-2] = v->buf [v->buf_pos + brr_buf_size - 2];
+	out [-1] = v->buf [v->buf_pos + brr_buf_size - 1];
+	
+	int in [brr_block_samples];
+	for ( int i = 0; i < brr_block_samples; i += 4 )
+	{
+		int const addr = v->brr_addr + 1 + i / 2;
+		brr_unpack( header, m.ram [addr & 0xFFFF] * 0x100 + m.ram [(addr + 1) & 0xFFFF], &in [i] );
+	}
+	brr_filter<brr_block_samples>( header, in, out, out );
+}
+
+inline void SPC_DSP::decode_brr( voice_t* v )
+{
+	// A released voice stays silent until KON, so fast mode doesn't decode
+	// for it. Only the filter history of the first block after KON differs.
+	if ( fast_brr && v->env_mode == env_release && !v->env )
+	{
+		if ( (v->buf_pos += 4) >= brr_buf_size )
+			v->buf_pos = 0;
+		v->brr_ahead_valid = false;
+		return;
+	}
+	
+	// A voice that was part way through a block when fast BRR mode was turned
+	// on or state was loaded decodes as usual until the next block
+	if ( fast_brr && v->brr_offset == 1 )
+	{
+		decode_brr_block( v );
+		v->brr_ahead_valid = true;
+	}
 	
 	// Write to next four samples in circular buffer
 	int* pos = &v->buf [v->buf_pos];
-	int* end;
 	if ( (v->buf_pos += 4) >= brr_buf_size )
 		v->buf_pos = 0;
 	
-	// Decode four samples
-	for ( end = pos + 4; pos < end; pos++, nybbles <<= 4 )
+	if ( fast_brr && v->brr_ahead_valid )
 	{
-		// Extract nybble and sign-extend
-		int s = (int16_t) nybbles >> 12;
-		
-		// Shift sample based on header
-		int const shift = header >> 4;
-		s = (s << shift) >> 1;
-		if ( shift >= 0xD ) // handle invalid range
-			s = (s >> 25) << 11; // same as: s = (s < 0 ? -0x800 : 0)
-		
-		// Apply IIR filter (8 is the most commonly used)
-		int const filter = header & 0x0C;
-		int const p1 = pos [brr_buf_size - 1];
-		int const p2 = pos [brr_buf_size - 2] >> 1;
-		if ( filter >= 8 )
-		{
-			s += p1;
-			s -= p2;
-			if ( filter == 8 ) // s += p1 * 0.953125 - p2 * 0.46875
-			{
-				s += p2 >> 4;
-				s += (p1 * -3) >> 6;
-			}
-			else // s += p1 * 0.8984375 - p2 * 0.40625
-			{
-				s += (p1 * -13) >> 7;
-				s += (p2 * 3) >> 4;
-			}
-		}
-		else if ( filter ) // s += p1 * 0.46875
-		{
-			s += p1 >> 1;
-			s += (-p1) >> 5;
-		}
-		
-		// Adjust and write sample
-		CLAMP16( s );
-		s = (int16_t) (s * 2);
-		pos [brr_buf_size] = pos [0] = s; // second copy simplifies wrap-around
+		int const* ahead = &v->brr_ahead [2 + (v->brr_offset - 1) * 2];
+		memcpy( pos, ahead, 4 * sizeof (int) );
+		memcpy( pos + brr_buf_size, ahead, 4 * sizeof (int) );
+		return;
 	}
+	
+	int in [4];
+	brr_unpack( m.t_brr_header, m.t_brr_byte * 0x100 + m.ram [(v->brr_addr + v->brr_offset + 1) & 0xFFFF], in );
+	
+	// Second copy simplifies wrap-around, and always follows the two previous samples
+	brr_filter<4>( m.t_brr_header, in, pos + brr_buf_size, pos );
 }
 
 
@@ -601,6 +722,16 @@ VOICE_CLOCK(V9_V6_V3) { voice_V9(v); voice_V6(v+1); voice_V3(v+2); }
 // Calculate FIR point for left/right channel
 #define CALC_FIR( i, ch )   ((ECHO_FIR( i + 1 ) [ch] * (int8_t) REG(fir + i * 0x10)) >> 6)
 
+#ifdef __SSE2__
+// FIR points i and i + 1 for left and right channel, as { l0, r0, l1, r1 }.
+// History is 16-bit and the coefficients have a clear high half, so madd
+// gives the four exact products.
+#define CALC_FIR2( i ) \
+	_mm_srai_epi32( _mm_madd_epi16(\
+		_mm_loadu_si128( (__m128i const*) ECHO_FIR( i + 1 ) ),\
+		_mm_loadu_si128( (__m128i const*) fir_coef [i] ) ), 6 )
+#endif
+
 #define ECHO_CLOCK( n ) inline void SPC_DSP::echo_##n()
 
 inline void SPC_DSP::echo_read( int ch )
@@ -632,8 +763,15 @@ ECHO_CLOCK( 22 )
 }
 ECHO_CLOCK( 23 )
 {
+#ifdef __SSE2__
+	int p [4];
+	_mm_storeu_si128( (__m128i*) p, CALC_FIR2( 1 ) );
+	int l = p [0] + p [2];
+	int r = p [1] + p [3];
+#else
 	int l = CALC_FIR( 1, 0 ) + CALC_FIR( 2, 0 );
 	int r = CALC_FIR( 1, 1 ) + CALC_FIR( 2, 1 );
+#endif
 	
 	m.t_echo_in [0] += l;
 	m.t_echo_in [1] += r;
@@ -642,14 +780,31 @@ ECHO_CLOCK( 23 )
 }
 ECHO_CLOCK( 24 )
 {
+#ifdef __SSE2__
+	int p [4];
+	_mm_storeu_si128( (__m128i*) p, CALC_FIR2( 3 ) );
+	int l = p [0] + p [2] + CALC_FIR( 5, 0 );
+	int r = p [1] + p [3] + CALC_FIR( 5, 1 );
+#else
 	int l = CALC_FIR( 3, 0 ) + CALC_FIR( 4, 0 ) + CALC_FIR( 5, 0 );
 	int r = CALC_FIR( 3, 1 ) + CALC_FIR( 4, 1 ) + CALC_FIR( 5, 1 );
+#endif
 	
 	m.t_echo_in [0] += l;
 	m.t_echo_in [1] += r;
 }
 ECHO_CLOCK( 25 )
 {
+#ifdef __SSE2__
+	int p [4];
+	_mm_storeu_si128( (__m128i*) p, CALC_FIR2( 6 ) );
+	
+	int l = (int16_t) (m.t_echo_in [0] + p [0]);
+	int r = (int16_t) (m.t_echo_in [1] + p [1]);
+	
+	l += (int16_t) p [2];
+	r += (int16_t) p [3];
+#else
 	int l = m.t_echo_in [0] + CALC_FIR( 6, 0 );
 	int r = m.t_echo_in [1] + CALC_FIR( 6, 1 );
 	
@@ -658,6 +813,7 @@ ECHO_CLOCK( 25 )
 	
 	l += (int16_t) CALC_FIR( 7, 0 );
 	r += (int16_t) CALC_FIR( 7, 1 );
+#endif
 	
 	CLAMP16( l );
 	CLAMP16( r );
@@ -835,6 +991,7 @@ void SPC_DSP::init( void* ram_64k )
 	reset();
 
 	stereo_switch = 0xffff;
+	fast_brr = false;
 	take_spc_snapshot = 0;
 	spc_snapshot_callback = 0;
 
@@ -892,6 +1049,8 @@ void SPC_DSP::load( uint8_t const regs [register_count] )
 	m.new_kon = REG(kon);
 	m.t_dir   = REG(dir);
 	m.t_esa   = REG(esa);
+	for ( int i = 0; i < echo_hist_size; i++ )
+		set_fir( i );
 	
 	soft_reset_common();
 }
@@ -953,6 +1112,9 @@ void SPC_DSP::copy_state( unsigned char** io, copy_func_t copy )
 	
 	// Voices
 	int i;
+	for ( i = 0; i < echo_hist_size; i++ )
+		set_fir( i );
+	
 	for ( i = 0; i < voice_count; i++ )
 	{
 		voice_t* v = &m.voices [i];
@@ -979,6 +1141,7 @@ void SPC_DSP::copy_state( unsigned char** io, copy_func_t copy )
 			v->env_mode = (enum env_mode_t) m;
 		}
 		SPC_COPY(  uint8_t, v->t_envx_out );
+		v->brr_ahead_valid = false;
 		
 		copier.extra();
 	}
@@ -1061,6 +1224,13 @@ void SPC_DSP::set_stereo_switch( int value )
 	stereo_switch = value;
 }
 
+void SPC_DSP::set_fast_brr( bool enable )
+{
+	fast_brr = enable;
+	for ( int i = 0; i < voice_count; i++ )
+		m.voices [i].brr_ahead_valid = false;
+}
+
 SPC_DSP::uint8_t SPC_DSP::reg_value( int ch, int addr )
 {
 	return m.voices[ch].regs[addr];
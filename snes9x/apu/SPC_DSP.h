@@ -68,6 +68,8 @@ public:
 // Snes9x Accessor
 
 	int     stereo_switch;
+	bool    fast_brr;      // decode each BRR block whole when a voice starts it and
+	                       // skip silent voices; misses the SMP rewriting a playing block
 	int     take_spc_snapshot;
 	int     rom_enabled;   // mirror
 	uint8_t *rom, *hi_ram; // mirror
@@ -76,6 +78,7 @@ public:
 	void    set_spc_snapshot_callback( void (*callback) (void) );
 	void    dump_spc_snapshot( void );
 	void    set_stereo_switch( int );
+	void    set_fast_brr( bool );
 	uint8_t reg_value( int, int );
 	int     envx_value( int );
 
@@ -118,6 +121,7 @@ public:
 	
 	enum env_mode_t { env_release, env_attack, env_decay, env_sustain };
 	enum { brr_buf_size = 12 };
+	enum { brr_block_samples = 16 };
 	struct voice_t
 	{
 		int buf [brr_buf_size*2];// decoded samples (twice the size to simplify wrap handling)
@@ -133,6 +137,8 @@ public:
 		int hidden_env;         // used by GAIN mode 7, very obscure quirk
 		uint8_t t_envx_out;
 		int voice_number;
+		int brr_ahead [2 + brr_block_samples]; // current BRR block after two earlier samples, in fast BRR mode
+		bool brr_ahead_valid;
 	};
 private:
 	enum { brr_block_size = 9 };
@@ -202,6 +208,11 @@ private:
 	};
 	state_t m;
 	
+	// FIR coefficients for left and right channel, in the low 16 bits with the
+	// high 16 bits clear. Kept in step with the FIR registers by set_fir().
+	int fir_coef [echo_hist_size] [2];
+	
+	void set_fir( int i );
 	void init_counter();
 	void run_counters();
 	unsigned read_counter( int rate );
@@ -209,6 +220,7 @@ private:
 	int  interpolate( voice_t const* v );
 	void run_envelope( voice_t* const v );
 	void decode_brr( voice_t* v );
+	void decode_brr_block( voice_t* v );
 
 	void misc_27();
 	void misc_28();
@@ -258,6 +270,11 @@ inline int SPC_DSP::read( int addr ) const
 	return m.regs [addr];
 }
 
+inline void SPC_DSP::set_fir( int i )
+{
+	fir_coef [i] [0] = fir_coef [i] [1] = (BOOST::uint16_t) (int8_t) m.regs [r_fir + i * 0x10];
+}
+
 inline void SPC_DSP::write( int addr, int data )
 {
 	assert( (unsigned) addr < register_count );
@@ -273,6 +290,10 @@ inline void SPC_DSP::write( int addr, int data )
 		m.outx_buf = (uint8_t) data;
 		break;
 	
+	case 0x0F:
+		set_fir( addr >> 4 );
+		break;
+	
 	case 0x0C:
 		if ( addr == r_kon )
 			m.new_kon = (uint8_t) data;
@@ -183,8 +183,12 @@
 #include "snapshot.h"
 #endif
 #include "display.h"
+#include "profile.h"
+#include "memmap.h"
+#include "context.h"
 #include "linear_resampler.h"
 #include "hermite_resampler.h"
+#include "sinc_resampler.h"
 
 #define APU_DEFAULT_INPUT_RATE		32000
 #define APU_MINIMUM_SAMPLE_COUNT	512
@@ -193,9 +197,28 @@
 #define APU_DENOMINATOR_NTSC		328125
 #define APU_NUMERATOR_PAL			34176
 #define APU_DENOMINATOR_PAL			709379
-#define APU_DEFAULT_RESAMPLER		HermiteResampler
-
-SNES_SPC	*spc_core = NULL;
+#define APU_DEFAULT_RESAMPLER		SincResampler
+
+CONTEXT_LOCAL SNES_SPC	*spc_core = NULL;
+
+// The sound state that S9xMixSamples() works on. It is kept in the machine's
+// SEmuContext so that a sound device callback running on another thread can
+// mix from it after binding that context. Such a thread has Settings of its
+// own, so the few the mixer needs are copied here by the emulation thread.
+struct SAPUContext
+{
+	Resampler	*resampler;
+	uint8		*shrink_buffer;
+	int			shrink_buffer_size;
+	int			lag_master;
+	int			lag;
+
+	bool8		mute;
+	bool8		sixteen_bit;
+	bool8		stereo;
+	bool8		reverse_stereo;
+	bool8		dynamic_rate_control;
+};
 
 static uint8 APUROM[64] =
 {
@@ -211,36 +234,36 @@ static uint8 APUROM[64] =
 
 namespace spc
 {
-	static apu_callback	sa_callback     = NULL;
-	static void			*extra_data     = NULL;
+	static CONTEXT_LOCAL apu_callback	sa_callback     = NULL;
+	static CONTEXT_LOCAL void			*extra_data     = NULL;
 
-	static bool8		sound_in_sync   = TRUE;
-	static bool8		sound_enabled   = FALSE;
+	static CONTEXT_LOCAL bool8		sound_in_sync   = TRUE;
+	static CONTEXT_LOCAL bool8		sound_enabled   = FALSE;
 
-	static int			buffer_size;
-	static int			lag_master      = 0;
-	static int			lag             = 0;
+	static CONTEXT_LOCAL int			buffer_size;
 
-	static uint8		*landing_buffer = NULL;
-	static uint8		*shrink_buffer  = NULL;
+	static CONTEXT_LOCAL uint8		*landing_buffer = NULL;
 
-	static Resampler	*resampler      = NULL;
+	static CONTEXT_LOCAL double		dynamic_rate_multiplier = 1.0;
+	static CONTEXT_LOCAL bool8		hold_samples    = FALSE;
 
-	static int32		reference_time;
-	static uint32		remainder;
+	static CONTEXT_LOCAL int32		reference_time;
+	static CONTEXT_LOCAL uint32		remainder;
 
 	static const int	timing_hack_numerator   = SNES_SPC::tempo_unit;
-	static int			timing_hack_denominator = SNES_SPC::tempo_unit;
+	static CONTEXT_LOCAL int			timing_hack_denominator = SNES_SPC::tempo_unit;
 	/* Set these to NTSC for now. Will change to PAL in S9xAPUTimingSetSpeedup
 	   if necessary on game load. */
-	static uint32		ratio_numerator = APU_NUMERATOR_NTSC;
-	static uint32		ratio_denominator = APU_DENOMINATOR_NTSC;
+	static CONTEXT_LOCAL uint32		ratio_numerator = APU_NUMERATOR_NTSC;
+	static CONTEXT_LOCAL uint32		ratio_denominator = APU_DENOMINATOR_NTSC;
 }
 
 static void EightBitize (uint8 *, int);
 static void DeStereo (uint8 *, int);
 static void ReverseStereo (uint8 *, int);
+static void UpdateMixSettings (void);
 static void UpdatePlaybackRate (void);
+static void UpdateDynamicRate (void);
 static void from_apu_to_state (uint8 **, void *, size_t);
 static void to_apu_from_state (uint8 **, void *, size_t);
 #ifdef FANCY
@@ -286,68 +309,81 @@ static void ReverseStereo (uint8 *src_buffer, int sample_count)
 
 bool8 S9xMixSamples (uint8 *buffer, int sample_count)
 {
-	static int	shrink_buffer_size = -1;
-	uint8		*dest;
+	struct SAPUContext	*apu = EmuContext->APU;
+	uint8				*dest;
 
-	if (!Settings.SixteenBitSound || !Settings.Stereo)
+	if (!apu->sixteen_bit || !apu->stereo)
 	{
 		/* We still need both stereo samples for generating the mono sample */
-		if (!Settings.Stereo)
+		if (!apu->stereo)
 			sample_count <<= 1;
 
 		/* We still have to generate 16-bit samples for bit-dropping, too */
-		if (shrink_buffer_size < (sample_count << 1))
+		if (apu->shrink_buffer_size < (sample_count << 1))
 		{
-			delete[] spc::shrink_buffer;
-			spc::shrink_buffer = new uint8[sample_count << 1];
-			shrink_buffer_size = sample_count << 1;
+			delete[] apu->shrink_buffer;
+			apu->shrink_buffer = new uint8[sample_count << 1];
+			apu->shrink_buffer_size = sample_count << 1;
 		}
 
-		dest = spc::shrink_buffer;
+		dest = apu->shrink_buffer;
 	}
 	else
 		dest = buffer;
 
-	if (Settings.Mute)
+	if (apu->mute)
 	{
 		memset(dest, 0, sample_count << 1);
-		spc::resampler->clear();
+		apu->resampler->clear();
 
 		return (FALSE);
 	}
 	else
 	{
-		if (spc::resampler->avail() >= (sample_count + spc::lag))
+		if (apu->resampler->avail() >= (sample_count + apu->lag))
+		{
+			apu->resampler->read((short *) dest, sample_count);
+			if (apu->lag == apu->lag_master)
+				apu->lag = 0;
+		}
+		else
+		if (apu->dynamic_rate_control)
 		{
-			spc::resampler->read((short *) dest, sample_count);
-			if (spc::lag == spc::lag_master)
-				spc::lag = 0;
+			// Rate control will refill the buffer, so play what there is
+			// and pad only the shortfall rather than muting the whole block.
+			int	avail = apu->resampler->avail();
+			if (avail > sample_count)
+				avail = sample_count;
+			avail &= ~1;
+
+			apu->resampler->read((short *) dest, avail);
+			memset(dest + (avail << 1), 0, (sample_count - avail) << 1);
 		}
 		else
 		{
-			memset(buffer, (Settings.SixteenBitSound ? 0 : 128), (sample_count << (Settings.SixteenBitSound ? 1 : 0)) >> (Settings.Stereo ? 0 : 1));
-			if (spc::lag == 0)
-				spc::lag = spc::lag_master;
+			memset(buffer, (apu->sixteen_bit ? 0 : 128), (sample_count << (apu->sixteen_bit ? 1 : 0)) >> (apu->stereo ? 0 : 1));
+			if (apu->lag == 0)
+				apu->lag = apu->lag_master;
 
 			return (FALSE);
 		}
 	}
 
-	if (Settings.ReverseStereo && Settings.Stereo)
+	if (apu->reverse_stereo && apu->stereo)
 		ReverseStereo(dest, sample_count);
 
-	if (!Settings.Stereo || !Settings.SixteenBitSound)
+	if (!apu->stereo || !apu->sixteen_bit)
 	{
-		if (!Settings.Stereo)
+		if (!apu->stereo)
 		{
 			DeStereo(dest, sample_count);
 			sample_count >>= 1;
 		}
 
-		if (!Settings.SixteenBitSound)
+		if (!apu->sixteen_bit)
 			EightBitize(dest, sample_count);
 
-		memcpy(buffer, dest, (sample_count << (Settings.SixteenBitSound ? 1 : 0)));
+		memcpy(buffer, dest, (sample_count << (apu->sixteen_bit ? 1 : 0)));
 	}
 
 	return (TRUE);
@@ -355,14 +391,21 @@ bool8 S9xMixSamples (uint8 *buffer, int sample_count)
 
 int S9xGetSampleCount (void)
 {
-	return (spc::resampler->avail() >> (Settings.Stereo ? 0 : 1));
+	return (EmuContext->APU->resampler->avail() >> (Settings.Stereo ? 0 : 1));
 }
 
 void S9xFinalizeSamples (void)
 {
-	if (!Settings.Mute)
+	struct SAPUContext	*apu = EmuContext->APU;
+
+	UpdateMixSettings();
+
+	if (!Settings.Mute && !spc::hold_samples)
 	{
-		if (!spc::resampler->push((short *) spc::landing_buffer, spc_core->sample_count()))
+		if (Settings.DynamicRateControl)
+			UpdateDynamicRate();
+
+		if (!apu->resampler->push((short *) spc::landing_buffer, spc_core->sample_count()))
 		{
 			/* We weren't able to process the entire buffer. Potential overrun. */
 			spc::sound_in_sync = FALSE;
@@ -375,7 +418,7 @@ void S9xFinalizeSamples (void)
 	if (!Settings.SoundSync || Settings.TurboMode || Settings.Mute)
 		spc::sound_in_sync = TRUE;
 	else
-	if (spc::resampler->space_empty() >= spc::resampler->space_filled())
+	if (apu->resampler->space_empty() >= apu->resampler->space_filled())
 		spc::sound_in_sync = TRUE;
 	else
 		spc::sound_in_sync = FALSE;
@@ -393,8 +436,18 @@ void S9xLandSamples (void)
 
 void S9xClearSamples (void)
 {
-	spc::resampler->clear();
-	spc::lag = spc::lag_master;
+	struct SAPUContext	*apu = EmuContext->APU;
+
+	apu->resampler->clear();
+	apu->lag = apu->lag_master;
+}
+
+// While held, the samples already queued for the sound device are neither
+// added to nor thrown away by resets, so that state can be rewound and
+// re-emulated without a gap or a repeat in the sound.
+void S9xHoldSamples (bool8 hold)
+{
+	spc::hold_samples = hold;
 }
 
 bool8 S9xSyncSound (void)
@@ -413,13 +466,39 @@ void S9xSetSamplesAvailableCallback (apu_callback callback, void *data)
 	spc::extra_data  = data;
 }
 
+static void UpdateMixSettings (void)
+{
+	struct SAPUContext	*apu = EmuContext->APU;
+
+	apu->mute                 = Settings.Mute;
+	apu->sixteen_bit          = Settings.SixteenBitSound;
+	apu->stereo               = Settings.Stereo;
+	apu->reverse_stereo       = Settings.ReverseStereo;
+	apu->dynamic_rate_control = Settings.DynamicRateControl;
+}
+
 static void UpdatePlaybackRate (void)
 {
 	if (Settings.SoundInputRate == 0)
 		Settings.SoundInputRate = APU_DEFAULT_INPUT_RATE;
 
 	double time_ratio = (double) Settings.SoundInputRate * spc::timing_hack_numerator / (Settings.SoundPlaybackRate * spc::timing_hack_denominator);
-	spc::resampler->time_ratio(time_ratio);
+	EmuContext->APU->resampler->time_ratio(time_ratio * spc::dynamic_rate_multiplier);
+}
+
+static void UpdateDynamicRate (void)
+{
+	// Steer the resampler buffer towards half full. A fuller buffer takes
+	// input a little faster and an emptier one a little slower, by at most
+	// DynamicRateLimit thousandths, below the pitch change most listeners notice.
+	int	filled   = EmuContext->APU->resampler->space_filled();
+	int	capacity = filled + EmuContext->APU->resampler->space_empty();
+
+	if (capacity <= 0)
+		return;
+
+	spc::dynamic_rate_multiplier = 1.0 + (Settings.DynamicRateLimit * (double) (2 * filled - capacity)) / (1000.0 * capacity);
+	UpdatePlaybackRate();
 }
 
 bool8 S9xInitSound (int buffer_ms, int lag_ms)
@@ -427,13 +506,15 @@ bool8 S9xInitSound (int buffer_ms, int lag_ms)
 	// buffer_ms : buffer size given in millisecond
 	// lag_ms    : allowable time-lag given in millisecond
 
+	struct SAPUContext	*apu = EmuContext->APU;
+
 	int	sample_count     = buffer_ms * 32000 / 1000;
 	int	lag_sample_count = lag_ms    * 32000 / 1000;
 
-	spc::lag_master = lag_sample_count;
+	apu->lag_master = lag_sample_count;
 	if (Settings.Stereo)
-		spc::lag_master <<= 1;
-	spc::lag = spc::lag_master;
+		apu->lag_master <<= 1;
+	apu->lag = apu->lag_master;
 
 	if (sample_count < APU_MINIMUM_SAMPLE_COUNT)
 		sample_count = APU_MINIMUM_SAMPLE_COUNT;
@@ -454,21 +535,24 @@ bool8 S9xInitSound (int buffer_ms, int lag_ms)
 
 	/* The resampler and spc unit use samples (16-bit short) as
 	   arguments. Use 2x in the resampler for buffer leveling with SoundSync */
-	if (!spc::resampler)
+	if (!apu->resampler)
 	{
-		spc::resampler = new APU_DEFAULT_RESAMPLER(spc::buffer_size >> (Settings.SoundSync ? 0 : 1));
-		if (!spc::resampler)
+		apu->resampler = new APU_DEFAULT_RESAMPLER(spc::buffer_size >> (Settings.SoundSync ? 0 : 1));
+		if (!apu->resampler)
 		{
 			delete[] spc::landing_buffer;
 			return (FALSE);
 		}
 	}
 	else
-		spc::resampler->resize(spc::buffer_size >> (Settings.SoundSync ? 0 : 1));
+		apu->resampler->resize(spc::buffer_size >> (Settings.SoundSync ? 0 : 1));
 
 	spc_core->set_output((SNES_SPC::sample_t *) spc::landing_buffer, spc::buffer_size >> 1);
 
+	spc::dynamic_rate_multiplier = 1.0;
 	UpdatePlaybackRate();
+	UpdateMixSettings();
+	apu->resampler->clear();
 
 	spc::sound_enabled = S9xOpenSoundDevice();
 
@@ -485,6 +569,8 @@ void S9xSetSoundMute (bool8 mute)
 	Settings.Mute = mute;
 	if (!spc::sound_enabled)
 		Settings.Mute = TRUE;
+
+	UpdateMixSettings();
 }
 
 void S9xDumpSPCSnapshot (void)
@@ -500,6 +586,14 @@ static void SPCSnapshotCallback (void)
 #endif
 bool8 S9xInitAPU (void)
 {
+	struct SEmuContext	*ctx = S9xCurrentContext();
+	if (!ctx)
+		return (FALSE);
+
+	ctx->APU = (struct SAPUContext *) calloc(1, sizeof(struct SAPUContext));
+	if (!ctx->APU)
+		return (FALSE);
+
 	spc_core = new SNES_SPC;
 	if (!spc_core)
 		return (FALSE);
@@ -508,10 +602,12 @@ bool8 S9xInitAPU (void)
 	spc_core->init_rom(APUROM);
 #ifdef FANCY
 	spc_core->dsp_set_spc_snapshot_callback(SPCSnapshotCallback);
+#endif
+#ifdef DEBUGGER
+	// a binary trace can be started before the APU exists
+	spc_core->debug_set_binary_trace(S9xBinaryTraceActive());
 #endif
 	spc::landing_buffer = NULL;
-	spc::shrink_buffer  = NULL;
-	spc::resampler      = NULL;
 
 	return (TRUE);
 }
@@ -524,22 +620,24 @@ void S9xDeinitAPU (void)
 		spc_core = NULL;
 	}
 
-	if (spc::resampler)
-	{
-		delete spc::resampler;
-		spc::resampler = NULL;
-	}
-
 	if (spc::landing_buffer)
 	{
 		delete[] spc::landing_buffer;
 		spc::landing_buffer = NULL;
 	}
 
-	if (spc::shrink_buffer)
+	if (EmuContext && EmuContext->APU)
 	{
-		delete[] spc::shrink_buffer;
-		spc::shrink_buffer = NULL;
+		struct SAPUContext	*apu = EmuContext->APU;
+
+		if (apu->resampler)
+			delete apu->resampler;
+
+		if (apu->shrink_buffer)
+			delete[] apu->shrink_buffer;
+
+		free(apu);
+		EmuContext->APU = NULL;
 	}
 }
 
@@ -572,6 +670,8 @@ void S9xAPUSetReferenceTime (int32 cpucycles)
 
 void S9xAPUExecute (void)
 {
+	S9X_PROFILE(PROFILE_APU);
+
 	/* Accumulate partial APU cycles */
 	spc_core->end_frame(S9xAPUGetClock(CPU.Cycles));
 
@@ -601,6 +701,7 @@ void S9xAPUTimingSetSpeedup (int ticks)
 	spc::ratio_denominator = spc::ratio_denominator * spc::timing_hack_denominator / spc::timing_hack_numerator;
 
 	UpdatePlaybackRate();
+	EmuContext->APU->resampler->clear();
 }
 
 void S9xAPUAllowTimeOverflow (bool allow)
@@ -617,8 +718,10 @@ void S9xResetAPU (void)
 	spc::remainder = 0;
 	spc_core->reset();
 	spc_core->set_output((SNES_SPC::sample_t *) spc::landing_buffer, spc::buffer_size >> 1);
+	spc_core->dsp_set_fast_brr(Settings.FastBRR);
 
-	spc::resampler->clear();
+	if (!spc::hold_samples)
+		EmuContext->APU->resampler->clear();
 }
 
 void S9xSoftResetAPU (void)
@@ -627,8 +730,10 @@ void S9xSoftResetAPU (void)
 	spc::remainder = 0;
 	spc_core->soft_reset();
 	spc_core->set_output((SNES_SPC::sample_t *) spc::landing_buffer, spc::buffer_size >> 1);
+	spc_core->dsp_set_fast_brr(Settings.FastBRR);
 
-	spc::resampler->clear();
+	if (!spc::hold_samples)
+		EmuContext->APU->resampler->clear();
 }
 
 static void from_apu_to_state (uint8 **buf, void *var, size_t size)
@@ -211,9 +211,10 @@ void S9xSetSoundMute (bool8);
 void S9xLandSamples (void);
 void S9xFinalizeSamples (void);
 void S9xClearSamples (void);
+void S9xHoldSamples (bool8);
 bool8 S9xMixSamples (uint8 *, int);
 void S9xSetSamplesAvailableCallback (apu_callback, void *);
 }
-extern SNES_SPC	*spc_core;
+extern CONTEXT_LOCAL SNES_SPC	*spc_core;
 
 #endif
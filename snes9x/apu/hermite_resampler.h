@@ -56,7 +56,6 @@ class HermiteResampler : public Resampler
         time_ratio (double ratio)
         {
             r_step = ratio;
-            clear ();
         }
 
         void
@@ -36,7 +36,6 @@ class LinearResampler : public Resampler
                 ratio = 1.0;
             f__r_step = (uint32) (ratio * f__one);
             f__inv_r_step = (uint32) (f__one / ratio);
-            clear ();
         }
 
         void
@@ -9,7 +9,7 @@ class Resampler : public ring_buffer
 {
     public:
         virtual void clear (void)        = 0;
-        virtual void time_ratio (double) = 0;
+        virtual void time_ratio (double) = 0; // doesn't discard buffered samples
         virtual void read (short *, int) = 0;
         virtual int  avail (void)        = 0;
 
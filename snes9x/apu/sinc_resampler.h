@@ -0,0 +1,246 @@
+/* Fixed-point polyphase windowed-sinc resampler */
+
+#ifndef __SINC_RESAMPLER_H
+#define __SINC_RESAMPLER_H
+
+#include <math.h>
+#include <string.h>
+#include "resampler.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#undef CLAMP
+#undef SHORT_CLAMP
+#define CLAMP(x, low, high) (((x) > (high)) ? (high) : (((x) < (low)) ? (low) : (x)))
+#define SHORT_CLAMP(n) ((short) CLAMP((n), -32768, 32767))
+
+class SincResampler : public Resampler
+{
+    protected:
+
+        enum
+        {
+            taps       = 16,            // input samples per output sample
+            phase_bits = 9,             // 512 fractional positions
+            phases     = 1 << phase_bits,
+            frac_bits  = 24,            // position is fixed point, 1.0 = 1 << frac_bits
+            coef_bits  = 14             // each phase sums to 1 << coef_bits
+        };
+
+        // Filter bank, one row of taps per fractional position. Kept aligned
+        // for SSE2 by rounding the pointer into a slightly larger allocation.
+        short *coefs;
+        short *coefs_alloc;
+        double cutoff;
+
+        unsigned int r_step;
+        unsigned int r_frac;
+
+        // Last input samples per channel, twice over to simplify wrap-around
+        short  h_left[taps * 2], h_right[taps * 2];
+        int    h_pos;
+
+        static double
+        bessel_i0 (double x)
+        {
+            double sum = 1.0, term = 1.0;
+
+            for (int k = 1; k < 32; k++)
+            {
+                term *= (x / (2 * k)) * (x / (2 * k));
+                sum += term;
+            }
+
+            return sum;
+        }
+
+        void
+        build (double fc)
+        {
+            // fc is the cutoff as a fraction of the input rate, at most 0.5
+            const double beta = 7.0;
+            const double i0_beta = bessel_i0 (beta);
+
+            cutoff = fc;
+
+            for (int p = 0; p < phases; p++)
+            {
+                double mu = (double) p / phases;
+                double h[taps], sum = 0.0;
+
+                for (int k = 0; k < taps; k++)
+                {
+                    // Distance from this tap to the output position, which sits
+                    // mu past the last of the older half of the taps
+                    double t = k - (taps / 2 - 1) - mu;
+                    double w = t / (taps / 2);
+                    double x = 2.0 * fc * t;
+
+                    h[k]  = (x == 0.0) ? 1.0 : sin (M_PI * x) / (M_PI * x);
+                    h[k] *= (fabs (w) < 1.0) ? bessel_i0 (beta * sqrt (1.0 - w * w)) / i0_beta : 0.0;
+                    sum  += h[k];
+                }
+
+                // Normalise so every phase has exactly unity gain at DC
+                short *c = coefs + p * taps;
+                int total = 0, peak = 0;
+
+                for (int k = 0; k < taps; k++)
+                {
+                    c[k] = (short) floor (h[k] / sum * (1 << coef_bits) + 0.5);
+                    total += c[k];
+                    if (c[k] > c[peak])
+                        peak = k;
+                }
+
+                c[peak] += (1 << coef_bits) - total;
+            }
+        }
+
+        // Applies one phase of the bank to both channels, writing a stereo pair
+        inline void
+        filter (short *out, const short *left, const short *right, const short *c)
+        {
+#ifdef __SSE2__
+            __m128i c0 = _mm_load_si128 ((const __m128i *) c);
+            __m128i c1 = _mm_load_si128 ((const __m128i *) (c + 8));
+            __m128i l = _mm_add_epi32 (_mm_madd_epi16 (_mm_loadu_si128 ((const __m128i *) left),  c0),
+                                       _mm_madd_epi16 (_mm_loadu_si128 ((const __m128i *) (left + 8)),  c1));
+            __m128i r = _mm_add_epi32 (_mm_madd_epi16 (_mm_loadu_si128 ((const __m128i *) right), c0),
+                                       _mm_madd_epi16 (_mm_loadu_si128 ((const __m128i *) (right + 8)), c1));
+
+            // Sum both sets of four partials at once, leaving left and right in the low two lanes
+            __m128i s = _mm_add_epi32 (_mm_unpacklo_epi32 (l, r), _mm_unpackhi_epi32 (l, r));
+            s = _mm_add_epi32 (s, _mm_srli_si128 (s, 8));
+            s = _mm_srai_epi32 (_mm_add_epi32 (s, _mm_set1_epi32 (1 << (coef_bits - 1))), coef_bits);
+            s = _mm_packs_epi32 (s, s);
+
+            int pair = _mm_cvtsi128_si32 (s);
+            memcpy (out, &pair, sizeof (pair));
+#else
+            int l = 0, r = 0;
+            for (int k = 0; k < taps; k++)
+            {
+                l += left[k]  * c[k];
+                r += right[k] * c[k];
+            }
+            l = (l + (1 << (coef_bits - 1))) >> coef_bits;
+            r = (r + (1 << (coef_bits - 1))) >> coef_bits;
+            out[0] = SHORT_CLAMP (l);
+            out[1] = SHORT_CLAMP (r);
+#endif
+        }
+
+    public:
+        SincResampler (int num_samples) : Resampler (num_samples)
+        {
+            coefs_alloc = new short[phases * taps + 8];
+            coefs = (short *) (((size_t) coefs_alloc + 15) & ~(size_t) 15);
+            cutoff = 0.0;
+            r_step = 1 << frac_bits;
+            clear ();
+        }
+
+        ~SincResampler ()
+        {
+            delete[] coefs_alloc;
+        }
+
+        void
+        time_ratio (double ratio)
+        {
+            if (ratio == 0.0)
+                ratio = 1.0;
+
+            r_step = (unsigned int) (ratio * (1 << frac_bits) + 0.5);
+
+            // Pass up to 90% of the narrower Nyquist band. Small ratio changes,
+            // such as those from rate control, don't warrant rebuilding the bank.
+            double fc = 0.45 * (ratio > 1.0 ? 1.0 / ratio : 1.0);
+            if (fabs (fc - cutoff) > cutoff * 0.02)
+                build (fc);
+        }
+
+        void
+        clear (void)
+        {
+            ring_buffer::clear ();
+            r_frac = 1 << frac_bits;
+            h_pos = 0;
+            memset (h_left,  0, sizeof (h_left));
+            memset (h_right, 0, sizeof (h_right));
+        }
+
+        void
+        read (short *data, int num_samples)
+        {
+            int i_position = start >> 1;
+            short *internal_buffer = (short *) buffer;
+            int o_position = 0;
+            int consumed = 0;
+            int max_samples = buffer_size >> 1;
+            const unsigned int one = 1 << frac_bits;
+
+            while (o_position < num_samples && consumed < buffer_size)
+            {
+                if (r_step == one)
+                {
+                    data[o_position]     = internal_buffer[i_position];
+                    data[o_position + 1] = internal_buffer[i_position + 1];
+
+                    o_position += 2;
+                    i_position += 2;
+                    if (i_position >= max_samples)
+                        i_position -= max_samples;
+                    consumed += 2;
+
+                    continue;
+                }
+
+                while (r_frac < one && o_position < num_samples)
+                {
+                    const short *c = coefs + (r_frac >> (frac_bits - phase_bits)) * taps;
+
+                    filter (data + o_position, h_left + h_pos, h_right + h_pos, c);
+
+                    o_position += 2;
+
+                    r_frac += r_step;
+                }
+
+                if (r_frac >= one)
+                {
+                    h_left [h_pos] = h_left [h_pos + taps] = internal_buffer[i_position];
+                    h_right[h_pos] = h_right[h_pos + taps] = internal_buffer[i_position + 1];
+                    if (++h_pos >= taps)
+                        h_pos = 0;
+
+                    r_frac -= one;
+
+                    i_position += 2;
+                    if (i_position >= max_samples)
+                        i_position -= max_samples;
+                    consumed += 2;
+                }
+            }
+
+            size -= consumed << 1;
+            start += consumed << 1;
+            if (start >= buffer_size)
+                start -= buffer_size;
+        }
+
+        inline int
+        avail (void)
+        {
+            if (r_step == (1 << frac_bits))
+                return size >> 1;
+
+            long long frames = ((long long) (size >> 2) << frac_bits) - r_frac;
+            return frames < 0 ? 0 : (int) (frames / r_step) * 2;
+        }
+};
+
+#endif /* __SINC_RESAMPLER_H */
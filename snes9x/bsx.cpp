@@ -212,7 +212,7 @@ struct SBSX_RTC
 	int	ticks;
 };
 
-static struct SBSX_RTC	BSX_RTC;
+static CONTEXT_LOCAL struct SBSX_RTC	BSX_RTC;
 
 // flash card vendor information
 static const uint8	flashcard[20] =
@@ -236,9 +236,9 @@ static const uint8	init2192[32] =	// FIXME
 	00, 00, 00, 00, 00, 00, 00, 00, 00
 };
 
-static bool8	FlashMode;
-static uint32	FlashSize;
-static uint8	*MapROM, *FlashROM;
+static CONTEXT_LOCAL bool8	FlashMode;
+static CONTEXT_LOCAL uint32	FlashSize;
+static CONTEXT_LOCAL uint8	*MapROM, *FlashROM;
 
 static void BSX_Map_SNES (void);
 static void BSX_Map_LoROM (void);
@@ -552,6 +552,9 @@ static void BSX_Map (void)
 
 	memcpy(BSX.prevMMC, BSX.MMC, sizeof(BSX.MMC));
 
+	// map_WriteProtectROM() copies Map[] into WriteMap[], traps included
+	S9xClearWatchTraps();
+
 	// Do a quick bank change
 	if (BSX.dirty2 && !BSX.dirty)
 	{
@@ -561,6 +564,7 @@ static void BSX_Map (void)
 		BSX.dirty2 = FALSE;
 
 		Memory.map_WriteProtectROM();
+		S9xUpdateWatchpoints();
 		return;
 	}
 
@@ -595,6 +599,7 @@ static void BSX_Map (void)
 	BSX.dirty2 = FALSE;
 
 	Memory.map_WriteProtectROM();
+	S9xUpdateWatchpoints();
 }
 
 static uint8 BSX_Get_Bypass_FlashIO (uint16 offset)
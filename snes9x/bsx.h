@@ -198,7 +198,7 @@ struct SBSX
 	uint8	test2192[32];
 };
 
-extern struct SBSX	BSX;
+extern CONTEXT_LOCAL struct SBSX	BSX;
 
 uint8 S9xGetBSX (uint32);
 void S9xSetBSX (uint8, uint32);
@@ -182,22 +182,22 @@
 
 #define	C4_PI	3.14159265
 
-int16	C4WFXVal;
-int16	C4WFYVal;
-int16	C4WFZVal;
-int16	C4WFX2Val;
-int16	C4WFY2Val;
-int16	C4WFDist;
-int16	C4WFScale;
-int16	C41FXVal;
-int16	C41FYVal;
-int16	C41FAngleRes;
-int16	C41FDist;
-int16	C41FDistVal;
-
-static double	tanval;
-static double	c4x, c4y, c4z;
-static double	c4x2, c4y2, c4z2;
+CONTEXT_LOCAL int16	C4WFXVal;
+CONTEXT_LOCAL int16	C4WFYVal;
+CONTEXT_LOCAL int16	C4WFZVal;
+CONTEXT_LOCAL int16	C4WFX2Val;
+CONTEXT_LOCAL int16	C4WFY2Val;
+CONTEXT_LOCAL int16	C4WFDist;
+CONTEXT_LOCAL int16	C4WFScale;
+CONTEXT_LOCAL int16	C41FXVal;
+CONTEXT_LOCAL int16	C41FYVal;
+CONTEXT_LOCAL int16	C41FAngleRes;
+CONTEXT_LOCAL int16	C41FDist;
+CONTEXT_LOCAL int16	C41FDistVal;
+
+static CONTEXT_LOCAL double	tanval;
+static CONTEXT_LOCAL double	c4x, c4y, c4z;
+static CONTEXT_LOCAL double	c4x2, c4y2, c4z2;
 
 
 void C4TransfWireFrame (void)
@@ -179,18 +179,18 @@
 #ifndef _C4_H_
 #define _C4_H_
 
-extern int16	C4WFXVal;
-extern int16	C4WFYVal;
-extern int16	C4WFZVal;
-extern int16	C4WFX2Val;
-extern int16	C4WFY2Val;
-extern int16	C4WFDist;
-extern int16	C4WFScale;
-extern int16	C41FXVal;
-extern int16	C41FYVal;
-extern int16	C41FAngleRes;
-extern int16	C41FDist;
-extern int16	C41FDistVal;
+extern CONTEXT_LOCAL int16	C4WFXVal;
+extern CONTEXT_LOCAL int16	C4WFYVal;
+extern CONTEXT_LOCAL int16	C4WFZVal;
+extern CONTEXT_LOCAL int16	C4WFX2Val;
+extern CONTEXT_LOCAL int16	C4WFY2Val;
+extern CONTEXT_LOCAL int16	C4WFDist;
+extern CONTEXT_LOCAL int16	C4WFScale;
+extern CONTEXT_LOCAL int16	C41FXVal;
+extern CONTEXT_LOCAL int16	C41FYVal;
+extern CONTEXT_LOCAL int16	C41FAngleRes;
+extern CONTEXT_LOCAL int16	C41FDist;
+extern CONTEXT_LOCAL int16	C41FDistVal;
 
 void C4TransfWireFrame (void);
 void C4TransfWireFrame2 (void);
@@ -177,6 +177,9 @@
 
 
 #include <ctype.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 #include "snes9x.h"
 #include "memmap.h"
 #include "cheats.h"
@@ -189,25 +192,22 @@
 
 #define TEST_BIT(a, v)	((a)[(v) >> 5] & (1 << ((v) & 31)))
 
-#define _S9XCHTC(c, a, b) \
-	((c) == S9X_LESS_THAN             ? (a) <  (b) : \
-	 (c) == S9X_GREATER_THAN          ? (a) >  (b) : \
-	 (c) == S9X_LESS_THAN_OR_EQUAL    ? (a) <= (b) : \
-	 (c) == S9X_GREATER_THAN_OR_EQUAL ? (a) >= (b) : \
-	 (c) == S9X_EQUAL                 ? (a) == (b) : \
-	                                    (a) != (b))
-
-#define _S9XCHTD(s, m, o) \
-	((s) == S9X_8_BITS  ? ((uint8)   (*((m) + (o)))) : \
-	 (s) == S9X_16_BITS ? ((uint16)  (*((m) + (o)) + (*((m) + (o) + 1) << 8))) : \
-	 (s) == S9X_24_BITS ? ((uint32)  (*((m) + (o)) + (*((m) + (o) + 1) << 8) + (*((m) + (o) + 2) << 16))) : \
-	                      ((uint32)  (*((m) + (o)) + (*((m) + (o) + 1) << 8) + (*((m) + (o) + 2) << 16) + (*((m) + (o) + 3) << 24))))
-
-#define _S9XCHTDS(s, m, o) \
-	((s) == S9X_8_BITS  ?  ((int8)   (*((m) + (o)))) : \
-	 (s) == S9X_16_BITS ?  ((int16)  (*((m) + (o)) + (*((m) + (o) + 1) << 8))) : \
-	 (s) == S9X_24_BITS ? (((int32) ((*((m) + (o)) + (*((m) + (o) + 1) << 8) + (*((m) + (o) + 2) << 16)) << 8)) >> 8): \
-                           ((int32)  (*((m) + (o)) + (*((m) + (o) + 1) << 8) + (*((m) + (o) + 2) << 16) + (*((m) + (o) + 3) << 24))))
+enum
+{
+	CHEAT_SEARCH_CHANGE,
+	CHEAT_SEARCH_VALUE,
+	CHEAT_SEARCH_ADDRESS
+};
+
+struct SCheatSearch
+{
+	int		mode;
+	uint32	pass;
+	uint32	sign;
+	int64	value;
+	bool8	update;
+	bool8	simd;
+};
 
 static bool8 S9xAllHex (const char *, int);
 
@@ -318,193 +318,290 @@ void S9xStartCheatSearch (SCheatData *d)
 	memmove(d->CSRAM, d->SRAM, 0x10000);
 	memmove(d->CIRAM, &d->FillRAM[0x3000], 0x2000);
 	memset((char *) d->ALL_BITS, 0xff, 0x32000 >> 3);
+	d->num_candidates = 0;
+	d->sparse = FALSE;
 }
 
-void S9xSearchForChange (SCheatData *d, S9xCheatComparisonType cmp, S9xCheatDataSize size, bool8 is_signed, bool8 update)
+// Every search goes through S9xCheatSearch(). Values are widened to int64,
+// which compares signed and unsigned values of any size to the search value
+// exactly as the C comparison operators did, and the comparison type is
+// turned into a mask of the outcomes (less, equal, greater) that pass, so
+// testing an address doesn't branch on the search options.
+
+static uint32 S9xCheatBitCount (uint32 x)
 {
-	int	l, i;
+	x = x - ((x >> 1) & 0x55555555);
+	x = (x & 0x33333333) + ((x >> 2) & 0x33333333);
+	return ((((x + (x >> 4)) & 0x0f0f0f0f) * 0x01010101) >> 24);
+}
 
-	switch (size)
+static inline uint32 S9xCheatTest (uint32 pass, int64 a, int64 b)
+{
+	return ((pass >> ((a > b) + (a >= b))) & 1);
+}
+
+template <int L>
+static inline int64 S9xCheatRead (const uint8 *m, uint32 sign)
+{
+	uint32	v = m[0];
+
+	if (L > 0)
+		v |= m[1] << 8;
+	if (L > 1)
+		v |= m[2] << 16;
+	if (L > 2)
+		v |= (uint32) m[3] << 24;
+
+	return ((int64) (v ^ sign) - sign);
+}
+
+#ifdef __SSE2__
+// 8-bit searches compare 16 bytes at a time, with signed values biased into
+// unsigned ones.
+
+static inline uint32 S9xCheatMatch16 (const SCheatSearch &s, const uint8 *cur, const uint8 *old)
+{
+	__m128i	flip = _mm_set1_epi8(s.sign ? (char) 0x80 : 0);
+	__m128i	a = _mm_xor_si128(_mm_loadu_si128((const __m128i *) cur), flip);
+	__m128i	b;
+
+	if (s.mode == CHEAT_SEARCH_CHANGE)
+		b = _mm_xor_si128(_mm_loadu_si128((const __m128i *) old), flip);
+	else
+		b = _mm_xor_si128(_mm_set1_epi8((char) s.value), flip);
+
+	uint32	eq = _mm_movemask_epi8(_mm_cmpeq_epi8(a, b));
+	uint32	le = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_min_epu8(a, b), a));
+	uint32	ge = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(a, b), a));
+
+	return ((-(s.pass & 1) & le & ~eq) | (-((s.pass >> 1) & 1) & eq) | (-((s.pass >> 2) & 1) & ge & ~eq));
+}
+
+// Wider searches compare the 48 bytes under a word's 32 start addresses
+// against each byte of the reference, as masks of bytes below and above it.
+// A value's outcome is then its most significant byte's, unless that byte
+// is equal, and so on down: the masks for byte j are shifted right by j to
+// line them up with the start address. Only the top byte is signed.
+
+static inline void S9xCheatCompare48 (const __m128i *a, const __m128i *b, __m128i flip, uint64 &lt, uint64 &gt)
+{
+	lt = gt = 0;
+
+	for (int c = 0; c < 3; c++)
 	{
-		case S9X_8_BITS:	l = 0; break;
-		case S9X_16_BITS:	l = 1; break;
-		case S9X_24_BITS:	l = 2; break;
-		default:
-		case S9X_32_BITS:	l = 3; break;
+		__m128i	x = _mm_xor_si128(a[c], flip);
+		__m128i	y = _mm_xor_si128(b[c], flip);
+		uint64	eq = _mm_movemask_epi8(_mm_cmpeq_epi8(x, y));
+		uint64	le = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_min_epu8(x, y), x));
+
+		lt |= (le & ~eq) << (c * 16);
+		gt |= (~le & 0xffff) << (c * 16);
 	}
+}
 
-	if (is_signed)
+template <int L>
+static inline uint32 S9xCheatMatchWide (const SCheatSearch &s, const uint8 *cur, const uint8 *old)
+{
+	__m128i	zero = _mm_setzero_si128();
+	__m128i	flip = _mm_set1_epi8(s.sign ? (char) 0x80 : 0);
+	__m128i	a[3], b[3];
+	uint64	lt, gt, l, g;
+
+	for (int c = 0; c < 3; c++)
+		a[c] = _mm_loadu_si128((const __m128i *) (cur + c * 16));
+
+	if (s.mode == CHEAT_SEARCH_CHANGE)
 	{
-		for (i = 0; i < 0x20000 - l; i++)
-		{
-			if (TEST_BIT(d->WRAM_BITS, i) && _S9XCHTC(cmp, _S9XCHTDS(size, d->RAM, i), _S9XCHTDS(size, d->CWRAM, i)))
-			{
-				if (update)
-					d->CWRAM[i] = d->RAM[i];
-			}
-			else
-				BIT_CLEAR(d->WRAM_BITS, i);
-		}
+		for (int c = 0; c < 3; c++)
+			b[c] = _mm_loadu_si128((const __m128i *) (old + c * 16));
 
-		for (i = 0; i < 0x10000 - l; i++)
+		S9xCheatCompare48(a, b, zero, lt, gt);
+		if (s.sign)
+			S9xCheatCompare48(a, b, flip, l, g);
+		else
 		{
-			if (TEST_BIT(d->SRAM_BITS, i) && _S9XCHTC(cmp, _S9XCHTDS(size, d->SRAM, i), _S9XCHTDS(size, d->CSRAM, i)))
-			{
-				if (update)
-					d->CSRAM[i] = d->SRAM[i];
-			}
-			else
-				BIT_CLEAR(d->SRAM_BITS, i);
+			l = lt;
+			g = gt;
 		}
 
-		for (i = 0; i < 0x2000 - l; i++)
+		l >>= L;
+		g >>= L;
+
+		for (int j = L - 1; j >= 0; j--)
 		{
-			if (TEST_BIT(d->IRAM_BITS, i) && _S9XCHTC(cmp, _S9XCHTDS(size, d->FillRAM + 0x3000, i), _S9XCHTDS(size, d->CIRAM, i)))
-			{
-				if (update)
-					d->CIRAM[i] = d->FillRAM[i + 0x3000];
-			}
-			else
-				BIT_CLEAR(d->IRAM_BITS, i);
+			uint64	e = ~(l | g);
+			l |= e & (lt >> j);
+			g |= e & (gt >> j);
 		}
 	}
 	else
 	{
-		for (i = 0; i < 0x20000 - l; i++)
-		{
-			if (TEST_BIT(d->WRAM_BITS, i) && _S9XCHTC(cmp, _S9XCHTD(size, d->RAM, i), _S9XCHTD(size, d->CWRAM, i)))
-			{
-				if (update)
-					d->CWRAM[i] = d->RAM[i];
-			}
-			else
-				BIT_CLEAR(d->WRAM_BITS, i);
-		}
+		b[0] = b[1] = b[2] = _mm_set1_epi8((char) (s.value >> (L * 8)));
+		S9xCheatCompare48(a, b, flip, l, g);
+		l >>= L;
+		g >>= L;
 
-		for (i = 0; i < 0x10000 - l; i++)
+		for (int j = L - 1; j >= 0; j--)
 		{
-			if (TEST_BIT(d->SRAM_BITS, i) && _S9XCHTC(cmp, _S9XCHTD(size, d->SRAM, i), _S9XCHTD(size, d->CSRAM, i)))
-			{
-				if (update)
-					d->CSRAM[i] = d->SRAM[i];
-			}
-			else
-				BIT_CLEAR(d->SRAM_BITS, i);
-		}
+			uint64	e = ~(l | g);
 
-		for (i = 0; i < 0x2000 - l; i++)
-		{
-			if (TEST_BIT(d->IRAM_BITS, i) && _S9XCHTC(cmp, _S9XCHTD(size, d->FillRAM + 0x3000, i), _S9XCHTD(size, d->CIRAM, i)))
-			{
-				if (update)
-					d->CIRAM[i] = d->FillRAM[i + 0x3000];
-			}
-			else
-				BIT_CLEAR(d->IRAM_BITS, i);
+			b[0] = b[1] = b[2] = _mm_set1_epi8((char) (s.value >> (j * 8)));
+			S9xCheatCompare48(a, b, zero, lt, gt);
+			l |= e & (lt >> j);
+			g |= e & (gt >> j);
 		}
 	}
 
-	for (i = 0x20000 - l; i < 0x20000; i++)
-		BIT_CLEAR(d->WRAM_BITS, i);
+	uint32	lo = (uint32) l, gr = (uint32) g;
 
-	for (i = 0x10000 - l; i < 0x10000; i++)
-		BIT_CLEAR(d->SRAM_BITS, i);
+	return ((-(s.pass & 1) & lo) | (-((s.pass >> 1) & 1) & ~(lo | gr)) | (-((s.pass >> 2) & 1) & gr));
 }
+#endif
 
-void S9xSearchForValue (SCheatData *d, S9xCheatComparisonType cmp, S9xCheatDataSize size, uint32 value, bool8 is_signed, bool8 update)
+template <int L>
+static uint32 S9xCheatSearchDense (const SCheatSearch &s, uint32 *bits, uint8 *cur, uint8 *old, uint32 base, uint32 size)
 {
-	int l, i;
+	uint32	count = 0;
+	uint32	end = size - L; // no whole value starts past here
 
-	switch (size)
+	for (uint32 w = 0; w < (size >> 5); w++)
 	{
-		case S9X_8_BITS:	l = 0; break;
-		case S9X_16_BITS:	l = 1; break;
-		case S9X_24_BITS:	l = 2; break;
-		default:
-		case S9X_32_BITS:	l = 3; break;
-	}
+		uint32	b = bits[w];
+		uint32	i = w << 5;
 
-	if (is_signed)
-	{
-		for (i = 0; i < 0x20000 - l; i++)
-		{
-			if (TEST_BIT(d->WRAM_BITS, i) && _S9XCHTC(cmp, _S9XCHTDS(size, d->RAM, i), (int32) value))
-			{
-				if (update)
-					d->CWRAM[i] = d->RAM[i];
-			}
-			else
-				BIT_CLEAR(d->WRAM_BITS, i);
-		}
+		if (!b)
+			continue;
 
-		for (i = 0; i < 0x10000 - l; i++)
+	#ifdef __SSE2__
+		if (L == 0 && s.simd)
+			b &= S9xCheatMatch16(s, cur + i, old + i) | (S9xCheatMatch16(s, cur + i + 16, old + i + 16) << 16);
+		else
+		if (L > 0 && s.simd && i + 48 <= size)
+			b &= S9xCheatMatchWide<L>(s, cur + i, old + i);
+		else
+	#endif
 		{
-			if (TEST_BIT(d->SRAM_BITS, i) && _S9XCHTC(cmp, _S9XCHTDS(size, d->SRAM, i), (int32) value))
+			uint32	m = 0;
+			uint32	n = end > i + 32 ? 32 : end > i ? end - i : 0;
+
+			for (uint32 k = 0; k < n; k++)
 			{
-				if (update)
-					d->CSRAM[i] = d->SRAM[i];
+				int64	a, v;
+
+				if (s.mode == CHEAT_SEARCH_ADDRESS)
+				{
+					a = base + i + k;
+					v = s.value;
+				}
+				else
+				{
+					a = S9xCheatRead<L>(cur + i + k, s.sign);
+					v = s.mode == CHEAT_SEARCH_CHANGE ? S9xCheatRead<L>(old + i + k, s.sign) : s.value;
+				}
+
+				m |= S9xCheatTest(s.pass, a, v) << k;
 			}
-			else
-				BIT_CLEAR(d->SRAM_BITS, i);
+
+			b &= m;
 		}
 
-		for (i = 0; i < 0x2000 - l; i++)
+		if (s.update)
 		{
-			if (TEST_BIT(d->IRAM_BITS, i) && _S9XCHTC(cmp, _S9XCHTDS(size, d->FillRAM + 0x3000, i), (int32) value))
-			{
-				if (update)
-					d->CIRAM[i] = d->FillRAM[i + 0x3000];
-			}
-			else
-				BIT_CLEAR(d->IRAM_BITS, i);
+			for (uint32 t = b, k = 0; t; t >>= 1, k++)
+				if (t & 1)
+					old[i + k] = cur[i + k];
 		}
+
+		bits[w] = b;
+		count += S9xCheatBitCount(b);
 	}
-	else
+
+	return (count);
+}
+
+template <int L>
+static void S9xCheatSearchSparse (SCheatData *d, const SCheatSearch &s)
+{
+	uint32	n = 0;
+
+	for (uint32 c = 0; c < d->num_candidates; c++)
 	{
-		for (i = 0; i < 0x20000 - l; i++)
+		uint32	p = d->candidates[c];
+		uint32	base, size;
+		uint8	*cur, *old;
+
+		if (p < 0x20000)
 		{
-			if (TEST_BIT(d->WRAM_BITS, i) && _S9XCHTC(cmp, _S9XCHTD(size, d->RAM, i), value))
-			{
-				if (update)
-					d->CWRAM[i] = d->RAM[i];
-			}
-			else
-				BIT_CLEAR(d->WRAM_BITS, i);
+			base = 0;		size = 0x20000;	cur = d->RAM;				old = d->CWRAM;
+		}
+		else
+		if (p < 0x30000)
+		{
+			base = 0x20000;	size = 0x10000;	cur = d->SRAM;				old = d->CSRAM;
+		}
+		else
+		{
+			base = 0x30000;	size = 0x2000;	cur = d->FillRAM + 0x3000;	old = d->CIRAM;
 		}
 
-		for (i = 0; i < 0x10000 - l; i++)
+		uint32	i = p - base;
+		int64	a = p, v = s.value;
+
+		if (i < size - L && s.mode != CHEAT_SEARCH_ADDRESS)
 		{
-			if (TEST_BIT(d->SRAM_BITS, i) && _S9XCHTC(cmp, _S9XCHTD(size, d->SRAM, i), value))
-			{
-				if (update)
-					d->CSRAM[i] = d->SRAM[i];
-			}
-			else
-				BIT_CLEAR(d->SRAM_BITS, i);
+			a = S9xCheatRead<L>(cur + i, s.sign);
+			if (s.mode == CHEAT_SEARCH_CHANGE)
+				v = S9xCheatRead<L>(old + i, s.sign);
 		}
 
-		for (i = 0; i < 0x2000 - l; i++)
+		if (i < size - L && S9xCheatTest(s.pass, a, v))
 		{
-			if (TEST_BIT(d->IRAM_BITS, i) && _S9XCHTC(cmp, _S9XCHTD(size, d->FillRAM + 0x3000, i), value))
-			{
-				if (update)
-					d->CIRAM[i] = d->FillRAM[i + 0x3000];
-			}
-			else
-				BIT_CLEAR(d->IRAM_BITS, i);
+			if (s.update)
+				old[i] = cur[i];
+
+			d->candidates[n++] = p;
 		}
+		else
+			BIT_CLEAR(d->ALL_BITS, p);
+	}
+
+	d->num_candidates = n;
+}
+
+template <int L>
+static void S9xCheatSearchAll (SCheatData *d, const SCheatSearch &s)
+{
+	if (d->sparse)
+	{
+		S9xCheatSearchSparse<L>(d, s);
+		return;
 	}
 
-	for (i = 0x20000 - l; i < 0x20000; i++)
-		BIT_CLEAR(d->WRAM_BITS, i);
+	uint32	count = 0;
 
-	for (i = 0x10000 - l; i < 0x10000; i++)
-		BIT_CLEAR(d->SRAM_BITS, i);
+	count += S9xCheatSearchDense<L>(s, d->WRAM_BITS, d->RAM, d->CWRAM, 0, 0x20000);
+	count += S9xCheatSearchDense<L>(s, d->SRAM_BITS, d->SRAM, d->CSRAM, 0x20000, 0x10000);
+	count += S9xCheatSearchDense<L>(s, d->IRAM_BITS, d->FillRAM + 0x3000, d->CIRAM, 0x30000, 0x2000);
+
+	if (count > MAX_CHEAT_CANDIDATES)
+		return;
+
+	d->num_candidates = 0;
+	d->sparse = TRUE;
+
+	for (uint32 w = 0; w < (0x32000 >> 5); w++)
+		for (uint32 t = d->ALL_BITS[w], k = 0; t; t >>= 1, k++)
+			if (t & 1)
+				d->candidates[d->num_candidates++] = (w << 5) + k;
 }
 
-void S9xSearchForAddress (SCheatData *d, S9xCheatComparisonType cmp, S9xCheatDataSize size, uint32 value, bool8 update)
+static void S9xCheatSearch (SCheatData *d, int mode, S9xCheatComparisonType cmp, S9xCheatDataSize size, uint32 value, bool8 is_signed, bool8 update)
 {
-	int	l, i;
+	// outcomes that pass, as bits for less than, equal and greater than
+	static const uint8	pass[6] = { 1, 4, 3, 6, 2, 5 };
+
+	SCheatSearch	s;
+	int				l;
 
 	switch (size)
 	{
@@ -515,44 +612,39 @@ void S9xSearchForAddress (SCheatData *d, S9xCheatComparisonType cmp, S9xCheatDat
 		case S9X_32_BITS:	l = 3; break;
 	}
 
-	for (i = 0; i < 0x20000 - l; i++)
+	s.mode   = mode;
+	s.pass   = pass[cmp];
+	s.sign   = is_signed ? 1u << (l * 8 + 7) : 0;
+	s.value  = is_signed || mode == CHEAT_SEARCH_ADDRESS ? (int64) (int32) value : (int64) value;
+	s.update = update;
+	// the vector compares need a search value that fits in the search size
+	int64	lo = is_signed ? -((int64) 1 << (l * 8 + 7)) : 0;
+	int64	hi = is_signed ? ((int64) 1 << (l * 8 + 7)) - 1 : ((int64) 1 << (l * 8 + 8)) - 1;
+	s.simd   = mode == CHEAT_SEARCH_CHANGE ||
+			   (mode == CHEAT_SEARCH_VALUE && s.value >= lo && s.value <= hi);
+
+	switch (l)
 	{
-		if (TEST_BIT(d->WRAM_BITS, i) && _S9XCHTC(cmp, i, (int32) value))
-		{
-			if (update)
-				d->CWRAM[i] = d->RAM[i];
-		}
-		else
-			BIT_CLEAR(d->WRAM_BITS, i);
-	}
-
-	for (i = 0; i < 0x10000 - l; i++)
-	{
-		if (TEST_BIT(d->SRAM_BITS, i) && _S9XCHTC(cmp, i + 0x20000, (int32) value))
-		{
-			if (update)
-				d->CSRAM[i] = d->SRAM[i];
-		}
-		else
-			BIT_CLEAR(d->SRAM_BITS, i);
+		case 0:	S9xCheatSearchAll<0>(d, s); break;
+		case 1:	S9xCheatSearchAll<1>(d, s); break;
+		case 2:	S9xCheatSearchAll<2>(d, s); break;
+		case 3:	S9xCheatSearchAll<3>(d, s); break;
 	}
+}
 
-	for (i = 0; i < 0x2000 - l; i++)
-	{
-		if (TEST_BIT(d->IRAM_BITS, i) && _S9XCHTC(cmp, i + 0x30000, (int32) value))
-		{
-			if (update)
-				d->CIRAM[i] = d->FillRAM[i + 0x3000];
-		}
-		else
-			BIT_CLEAR(d->IRAM_BITS, i);
-	}
+void S9xSearchForChange (SCheatData *d, S9xCheatComparisonType cmp, S9xCheatDataSize size, bool8 is_signed, bool8 update)
+{
+	S9xCheatSearch(d, CHEAT_SEARCH_CHANGE, cmp, size, 0, is_signed, update);
+}
 
-	for (i = 0x20000 - l; i < 0x20000; i++)
-		BIT_CLEAR(d->WRAM_BITS, i);
+void S9xSearchForValue (SCheatData *d, S9xCheatComparisonType cmp, S9xCheatDataSize size, uint32 value, bool8 is_signed, bool8 update)
+{
+	S9xCheatSearch(d, CHEAT_SEARCH_VALUE, cmp, size, value, is_signed, update);
+}
 
-	for (i = 0x10000 - l; i < 0x10000; i++)
-		BIT_CLEAR(d->SRAM_BITS, i);
+void S9xSearchForAddress (SCheatData *d, S9xCheatComparisonType cmp, S9xCheatDataSize size, uint32 value, bool8 update)
+{
+	S9xCheatSearch(d, CHEAT_SEARCH_ADDRESS, cmp, size, value, FALSE, update);
 }
 
 void S9xOutputCheatSearchResults (SCheatData *d)
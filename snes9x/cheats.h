@@ -180,6 +180,7 @@
 #define _CHEATS_H_
 
 #define MAX_CHEATS	150
+#define MAX_CHEAT_CANDIDATES	0x1000
 
 struct SCheat
 {
@@ -191,18 +192,44 @@ struct SCheat
 	char	name[22];
 };
 
+// An enabled cheat, compiled against the Map[] entry of its block. The entry
+// is kept to notice remapping, which makes the cheats compile again.
+struct SCheatPatch
+{
+	uint8	*base;
+	uint32	block;
+	uint32	offset;
+	uint8	byte;
+};
+
 struct SCheatData
 {
 	struct SCheat c[MAX_CHEATS];
 	uint32	num_cheats;
-	uint8	CWRAM[0x20000];
-	uint8	CSRAM[0x10000];
-	uint8	CIRAM[0x2000];
+	// The search copies and bitmap are kept in the bound SEmuContext.
+	uint8	*CWRAM;
+	uint8	*CSRAM;
+	uint8	*CIRAM;
 	uint8	*RAM;
 	uint8	*FillRAM;
 	uint8	*SRAM;
-	uint32	ALL_BITS[0x32000 >> 5];
-	uint8	CWatchRAM[0x32000];
+	uint32	*ALL_BITS;
+	uint8	*CWatchRAM;
+	// Once few addresses are left, searches walk this list of their
+	// ALL_BITS indices instead of the whole bitmap.
+	uint32	candidates[MAX_CHEAT_CANDIDATES];
+	uint32	num_candidates;
+	bool8	sparse;
+	// The enabled cheats compiled by block, rebuilt when the list changes
+	// or any of their blocks is remapped. ROM cheats are written once when
+	// compiling, RAM and I/O ones every frame.
+	struct SCheatPatch	ram_patch[MAX_CHEATS];
+	uint32	num_ram_patches;
+	struct SCheatPatch	io_patch[MAX_CHEATS];
+	uint32	num_io_patches;
+	struct SCheatPatch	rom_patch[MAX_CHEATS];
+	uint32	num_rom_patches;
+	bool8	compiled;
 };
 
 struct Watch
@@ -233,8 +260,8 @@ typedef enum
 	S9X_32_BITS
 }	S9xCheatDataSize;
 
-extern SCheatData	Cheat;
-extern Watch		watches[16];
+extern CONTEXT_LOCAL SCheatData	Cheat;
+extern CONTEXT_LOCAL Watch		watches[16];
 
 void S9xApplyCheat (uint32);
 void S9xApplyCheats (void);
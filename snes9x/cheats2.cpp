@@ -179,9 +179,11 @@
 #include "snes9x.h"
 #include "memmap.h"
 #include "cheats.h"
+#include "context.h"
 
 static uint8 S9xGetByteFree (uint32);
 static void S9xSetByteFree (uint8, uint32);
+static void S9xCompileCheats (void);
 
 
 static uint8 S9xGetByteFree (uint32 address)
@@ -212,9 +214,17 @@ void S9xInitWatchedAddress (void)
 
 void S9xInitCheatData (void)
 {
+	struct SEmuContext	*ctx = S9xCurrentContext();
+
+	Cheat.CWRAM = ctx->CheatWRAM;
+	Cheat.CSRAM = ctx->CheatSRAM;
+	Cheat.CIRAM = ctx->CheatIRAM;
+	Cheat.ALL_BITS = ctx->CheatBits;
+	Cheat.CWatchRAM = ctx->CheatWatchRAM;
 	Cheat.RAM = Memory.RAM;
 	Cheat.SRAM = Memory.SRAM;
 	Cheat.FillRAM = Memory.FillRAM;
+	Cheat.compiled = FALSE;
 }
 
 void S9xAddCheat (bool8 enable, bool8 save_current_value, uint32 address, uint8 byte)
@@ -232,6 +242,7 @@ void S9xAddCheat (bool8 enable, bool8 save_current_value, uint32 address, uint8
 		}
 
 		Cheat.num_cheats++;
+		Cheat.compiled = FALSE;
 	}
 }
 
@@ -245,6 +256,7 @@ void S9xDeleteCheat (uint32 which1)
 		memmove(&Cheat.c[which1], &Cheat.c[which1 + 1], sizeof(Cheat.c[0]) * (Cheat.num_cheats - which1 - 1));
 
 		Cheat.num_cheats--;
+		Cheat.compiled = FALSE;
 	}
 }
 
@@ -256,6 +268,8 @@ void S9xDeleteCheats (void)
 
 void S9xRemoveCheat (uint32 which1)
 {
+	Cheat.compiled = FALSE;
+
 	if (Cheat.c[which1].saved)
 	{
 		uint32	address = Cheat.c[which1].address;
@@ -282,6 +296,7 @@ void S9xEnableCheat (uint32 which1)
 	if (which1 < Cheat.num_cheats && !Cheat.c[which1].enabled)
 	{
 		Cheat.c[which1].enabled = TRUE;
+		Cheat.compiled = FALSE;
 		S9xApplyCheat(which1);
 	}
 }
@@ -314,13 +329,87 @@ void S9xApplyCheat (uint32 which1)
 		S9xSetByteFree(Cheat.c[which1].byte, address);
 }
 
+// Applies every enabled cheat once and sorts them by block: RAM ones are
+// written again each frame straight to memory, ones on blocks with handlers
+// through S9xSetByteFree(), and ROM ones stay applied.
+
+static void S9xCompileCheats (void)
+{
+	Cheat.num_ram_patches = 0;
+	Cheat.num_io_patches = 0;
+	Cheat.num_rom_patches = 0;
+
+	for (uint32 i = 0; i < Cheat.num_cheats; i++)
+	{
+		if (!Cheat.c[i].enabled)
+			continue;
+
+		S9xApplyCheat(i);
+
+		uint32		address = Cheat.c[i].address & 0xffffff;
+		uint32		block = address >> MEMMAP_SHIFT;
+		uint8		*ptr = Memory.Map[block];
+		SCheatPatch	*p;
+
+		if (ptr < (uint8 *) CMemory::MAP_LAST)
+			p = &Cheat.io_patch[Cheat.num_io_patches++];
+		else
+		if (Memory.BlockIsROM[block])
+			p = &Cheat.rom_patch[Cheat.num_rom_patches++];
+		else
+		{
+			uint32	n = Cheat.num_ram_patches++;
+
+			for (; n > 0 && Cheat.ram_patch[n - 1].block > block; n--)
+				Cheat.ram_patch[n] = Cheat.ram_patch[n - 1];
+
+			p = &Cheat.ram_patch[n];
+		}
+
+		p->base = ptr;
+		p->block = block;
+		p->offset = address & 0xffff;
+		p->byte = Cheat.c[i].byte;
+	}
+
+	Cheat.compiled = TRUE;
+}
+
+static bool8 S9xCheatPatchesMapped (const SCheatPatch *p, uint32 n)
+{
+	for (uint32 i = 0; i < n; i++)
+		if (Memory.Map[p[i].block] != p[i].base)
+			return (FALSE);
+
+	return (TRUE);
+}
+
 void S9xApplyCheats (void)
 {
-	if (Settings.ApplyCheats)
+	if (!Settings.ApplyCheats)
+		return;
+
+	// Compile again if the list has changed or any block has been remapped
+	// since the patches were built.
+	if (!Cheat.compiled ||
+		!S9xCheatPatchesMapped(Cheat.ram_patch, Cheat.num_ram_patches) ||
+		!S9xCheatPatchesMapped(Cheat.io_patch, Cheat.num_io_patches) ||
+		!S9xCheatPatchesMapped(Cheat.rom_patch, Cheat.num_rom_patches))
+	{
+		S9xCompileCheats();
+		return;
+	}
+
+	for (uint32 i = 0; i < Cheat.num_ram_patches; i++)
+	{
+		SCheatPatch	*p = &Cheat.ram_patch[i];
+		p->base[p->offset] = p->byte;
+	}
+
+	for (uint32 i = 0; i < Cheat.num_io_patches; i++)
 	{
-		for (uint32 i = 0; i < Cheat.num_cheats; i++)
-			if (Cheat.c[i].enabled)
-				S9xApplyCheat(i);
+		SCheatPatch	*p = &Cheat.io_patch[i];
+		S9xSetByteFree(p->byte, (p->block << MEMMAP_SHIFT) | (p->offset & MEMMAP_MASK));
 	}
 }
 
@@ -330,6 +419,7 @@ bool8 S9xLoadCheatFile (const char *filename)
 	uint8	data[28];
 
 	Cheat.num_cheats = 0;
+	Cheat.compiled = FALSE;
 
 	fs = fopen(filename, "rb");
 	if (!fs)
@@ -224,6 +224,7 @@ static void S9xSoftResetCPU (void)
 	CPU.MemSpeed = SLOW_ONE_CYCLE;
 	CPU.MemSpeedx2 = SLOW_ONE_CYCLE * 2;
 	CPU.FastROMSpeed = SLOW_ONE_CYCLE;
+	Memory.UpdateSpeedMap();
 	CPU.InDMA = FALSE;
 	CPU.InHDMA = FALSE;
 	CPU.InDMAorHDMA = FALSE;
@@ -256,6 +257,7 @@ static void S9xSoftResetCPU (void)
 	Timings.H_Max = Timings.H_Max_Master;
 	Timings.V_Max = Timings.V_Max_Master;
 	Timings.NMITriggerPos = 0xffff;
+	Timings.NextIRQTimer = 0x0fffffff;
 	if (Model->_5A22 == 2)
 		Timings.WRAMRefreshPos = SNES_WRAM_REFRESH_HC_v2;
 	else
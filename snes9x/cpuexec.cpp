@@ -179,6 +179,7 @@
 #include "snes9x.h"
 #include "memmap.h"
 #include "cpuops.h"
+#include "profile.h"
 #include "dma.h"
 #include "apu/apu.h"
 #include "fxemu.h"
@@ -187,12 +188,17 @@
 #include "debug.h"
 #include "missing.h"
 #endif
+#ifdef NETPLAY_SUPPORT
+#include "netplay.h"
+#endif
 
 static inline void S9xReschedule (void);
 
 
 void S9xMainLoop (void)
 {
+	S9X_PROFILE(PROFILE_MAIN_LOOP);
+
     // debugging variable?
     // static int loop_times=0;
     // int loops2=0;
@@ -218,7 +224,9 @@ void S9xMainLoop (void)
 			}
 		}
 
-		if (CPU.IRQTransition || CPU.IRQExternal)
+		S9xCheckInterrupts();
+
+		if (CPU.IRQLine || CPU.IRQExternal)
 		{
             //printf("case 2\n");
 			if (CPU.IRQPending)
@@ -279,11 +287,9 @@ void S9xMainLoop (void)
 		{
 			Op = CPU.PCBase[Registers.PCw];
 
-			CPU.PrevCycles = CPU.Cycles;
 			CPU.Cycles += CPU.MemSpeed;
-			S9xCheckInterrupts();
 			Opcodes = ICPU.S9xOpcodes;
-            //printf("case 3 %x %x %d %d\n", Registers.PCw, Op, CPU.PrevCycles, CPU.Cycles);
+            //printf("case 3 %x %x %d\n", Registers.PCw, Op, CPU.Cycles);
 		}
 		else
 		{
@@ -318,6 +324,12 @@ void S9xMainLoop (void)
 	if (CPU.Flags & SCAN_KEYS_FLAG)
 	{
         //printf("case 7\n");
+	#ifdef NETPLAY_SUPPORT
+		// frames re-emulated by a netplay rollback are neither timed nor drawn
+		if (NetPlay.Resimulating)
+			IPPU.RenderThisFrame = FALSE;
+		else
+	#endif
 	#ifdef DEBUGGER
 		if (!(CPU.Flags & FRAME_ADVANCE_FLAG))
 	#endif
@@ -365,6 +377,8 @@ static inline void S9xReschedule (void)
 
 void S9xDoHEventProcessing (void)
 {
+	S9X_PROFILE(PROFILE_HEVENT);
+
 #ifdef DEBUGGER
 	static char	eventname[7][32] =
 	{
@@ -411,9 +425,11 @@ void S9xDoHEventProcessing (void)
 				SuperFX.oneLineDone = FALSE;
 			}
 
+			// A timer IRQ due before the line ends, e.g. during a DMA, still goes out.
+			S9xCheckInterrupts();
+
 			S9xAPUEndScanline();
 			CPU.Cycles -= Timings.H_Max;
-			CPU.PrevCycles -= Timings.H_Max;
 			S9xAPUSetReferenceTime(CPU.Cycles);
 
 			if ((Timings.NMITriggerPos != 0xffff) && (Timings.NMITriggerPos >= Timings.H_Max))
@@ -523,6 +539,8 @@ void S9xDoHEventProcessing (void)
 			if (CPU.V_Counter == FIRST_VISIBLE_LINE)	// V=1
 				S9xStartScreenRefresh();
 
+			S9xUpdateIRQPositions(TRUE);
+
 			S9xReschedule();
 
 			break;
@@ -553,9 +571,7 @@ void S9xDoHEventProcessing (void)
 			S9xTraceFormattedMessage("*** WRAM Refresh  HC:%04d", CPU.Cycles);
 		#endif
 
-			CPU.PrevCycles = CPU.Cycles;
 			CPU.Cycles += SNES_WRAM_REFRESH_CYCLES;
-			S9xCheckInterrupts();
 
 			S9xReschedule();
 
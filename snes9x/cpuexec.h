@@ -201,7 +201,7 @@ struct SICPU
 	uint32	FrameAdvanceCount;
 };
 
-extern struct SICPU		ICPU;
+extern CONTEXT_LOCAL struct SICPU		ICPU;
 
 extern Opcode	S9xOpcodesE1[256];
 extern Opcode	S9xOpcodesM1X1[256];
@@ -274,43 +274,21 @@ static inline void S9xFixCycles (void)
 	}
 }
 
+// The H/V timers only ever raise /IRQ at Timings.NextIRQTimer, which
+// S9xUpdateIRQPositions() works out when the timer registers change and at
+// the start of each scanline.
 static inline void S9xCheckInterrupts (void)
 {
-	bool8	thisIRQ = PPU.HTimerEnabled || PPU.VTimerEnabled;
-
-	if (CPU.IRQLine && thisIRQ)
-		CPU.IRQTransition = TRUE;
-
-	if (PPU.HTimerEnabled)
+	if (CPU.Cycles >= Timings.NextIRQTimer)
 	{
-		int32	htimepos = PPU.HTimerPosition;
-		if (CPU.Cycles >= Timings.H_Max)
-			htimepos += Timings.H_Max;
-
-		if (CPU.PrevCycles >= htimepos || CPU.Cycles < htimepos)
-			thisIRQ = FALSE;
-	}
-
-	if (PPU.VTimerEnabled)
-	{
-		int32	vcounter = CPU.V_Counter;
-		if (CPU.Cycles >= Timings.H_Max)
-			vcounter++;
-
-		if (vcounter != PPU.VTimerPosition)
-			thisIRQ = FALSE;
-	}
-
-	if (!CPU.IRQLastState && thisIRQ)
-	{
-#ifdef DEBUGGER
-		S9xTraceFormattedMessage("--- /IRQ High->Low  prev HC:%04d  curr HC:%04d  HTimer:%d Pos:%04d  VTimer:%d Pos:%03d",
-			CPU.PrevCycles, CPU.Cycles, PPU.HTimerEnabled, PPU.HTimerPosition, PPU.VTimerEnabled, PPU.VTimerPosition);
-#endif
+	#ifdef DEBUGGER
+		S9xTraceFormattedMessage("--- /IRQ High->Low  HC:%04d  HTimer:%d Pos:%04d  VTimer:%d Pos:%03d",
+			CPU.Cycles, PPU.HTimerEnabled, PPU.HTimerPosition, PPU.VTimerEnabled, PPU.VTimerPosition);
+	#endif
 		CPU.IRQLine = TRUE;
+		CPU.IRQLastState = !PPU.HTimerEnabled;
+		Timings.NextIRQTimer = 0x0fffffff;
 	}
-
-	CPU.IRQLastState = thisIRQ;
 }
 
 #endif
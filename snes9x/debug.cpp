@@ -188,10 +188,17 @@
 #include "debug.h"
 #include "missing.h"
 
-extern SDMA	DMA[8];
+extern CONTEXT_LOCAL SDMA	DMA[8];
 extern FILE	*apu_trace;
 FILE		*trace = NULL, *trace2 = NULL;
 
+// Binary trace records are gathered here and written out a block at a time
+#define TRACE_BUFFER_RECORDS	32768
+
+static FILE					*trace_bin = NULL;
+static struct STraceRecord	trace_records[TRACE_BUFFER_RECORDS];
+static uint32				trace_record_count = 0;
+
 struct SBreakPoint	S9xBreakpoint[6];
 
 struct SDebug
@@ -222,6 +229,7 @@ static const char	*HelpMessage[] =
 	"s                      - Skip to next instruction    [skip]",
 	"T                      - Toggle CPU instruction tracing to trace.log",
 	"TS                     - Toggle SA-1 instruction tracing to trace_sa1.log",
+	"TB                     - Toggle binary CPU, SA-1 and SPC700 tracing to trace.bin",
 	"E                      - Toggle HC-based event tracing to trace.log",
 	"V                      - Toggle non-DMA V-RAM read/write tracing to stdout",
 	"D                      - Toggle on-screen DMA tracing",
@@ -239,6 +247,12 @@ static const char	*HelpMessage[] =
 	"c                      - Dump SNES colour palette",
 	"W                      - Show what SNES hardware features the ROM is using",
 	"                         which might not be implemented yet",
+	"Wv                     - View watchpoints",
+	"Wr [Address] [Number]  - Stop on reads of [Number] bytes (1) at [Address]",
+	"Ww [Address] [Number]  - Stop on writes of [Number] bytes (1) at [Address]",
+	"Wa [Address] [Number]  - Stop on reads and writes of [Number] bytes (1) at [Address]",
+	"                         [example: Ww $7E:0010 #2]",
+	"Wd [Number]            - Delete watchpoint [Number]",
 	"w                      - Show some SNES hardware features used so far in this frame",
 	"R                      - Reset SNES",
 	"q                      - Quit emulation",
@@ -328,10 +342,12 @@ static void debug_line_print (const char *);
 static int debug_get_number (char *, uint16 *);
 static short debug_get_start_address (char *, uint8 *, uint32 *);
 static void debug_process_command (char *);
+static void debug_trace_flush (void);
 static void debug_print_window (uint8 *);
 static const char * debug_clip_fn (int);
 static void debug_whats_used (void);
 static void debug_whats_missing (void);
+static void debug_watchpoint_hit (uint32, uint8, uint8);
 
 
 static uint8 S9xDebugGetByte (uint32 Address)
@@ -340,6 +356,10 @@ static uint8 S9xDebugGetByte (uint32 Address)
 	uint8	*GetAddress = Memory.Map[block];
 	uint8	byte = 0;
 
+	// looking doesn't set off watchpoints
+	if (GetAddress == (uint8 *) CMemory::MAP_WATCH)
+		GetAddress = Memory.WatchMap[block];
+
 	if (GetAddress >= (uint8 *) CMemory::MAP_LAST)
 	{
 		byte = *(GetAddress + (Address & 0xffff));
@@ -1526,6 +1546,21 @@ static void debug_process_command (char *Line)
 
 	if (*Line == 'T')
 	{
+		if (Line[1] == 'B')
+		{
+			if (!trace_bin)
+			{
+				S9xStartBinaryTrace();
+				if (trace_bin)
+					printf("Binary instruction tracing enabled.\n");
+			}
+			else
+			{
+				S9xStopBinaryTrace();
+				printf("Binary instruction tracing disabled.\n");
+			}
+		}
+		else
 		if (Line[1] == 'S')
 		{
 			SA1.Flags ^= TRACE_FLAG;
@@ -1875,7 +1910,59 @@ static void debug_process_command (char *Line)
 		S9xExit();
 
 	if (*Line == 'W')
-		debug_whats_missing();
+	{
+		if (Line[1] == 'r' || Line[1] == 'w' || Line[1] == 'a')
+		{
+			uint8	type = Line[1] == 'r' ? WATCH_READ : Line[1] == 'w' ? WATCH_WRITE : (WATCH_READ | WATCH_WRITE);
+			uint32	a, b;
+			int		size = 1;
+
+			if (sscanf(Line + 2, " $%x:%x #%d", &b, &a, &size) < 2)
+				debug_line_print("Usage: Wr/Ww/Wa $Bank:Address [#Size]");
+			else
+			{
+				int	n = S9xAddWatchpoint((b << 16) | (a & 0xffff), size > 0 ? size : 1, type);
+
+				if (n < 0)
+					debug_line_print("No free watchpoints.");
+				else
+				{
+					if (!S9xWatchpointHook)
+						S9xWatchpointHook = debug_watchpoint_hit;
+
+					sprintf(string, "Watchpoint %d @ $%02X:%04X", n, b & 0xff, a & 0xffff);
+					debug_line_print(string);
+				}
+			}
+		}
+		else
+		if (Line[1] == 'd')
+		{
+			if (debug_get_number(Line + 2, &Number) == -1 || Number >= MAX_WATCHPOINTS)
+				debug_line_print("Usage: Wd #Number");
+			else
+				S9xRemoveWatchpoint(Number);
+		}
+		else
+		if (Line[1] == 'v')
+		{
+			debug_line_print("Watchpoints:");
+
+			for (int i = 0; i < MAX_WATCHPOINTS; i++)
+			{
+				SWatchpoint	*wp = &Watchpoints[i];
+
+				if (!wp->type)
+					continue;
+
+				sprintf(string, "%i @ $%02X:%04X +%u %c%c, %u hits", i, wp->address >> 16, wp->address & 0xffff, wp->size,
+					(wp->type & WATCH_READ) ? 'R' : '-', (wp->type & WATCH_WRITE) ? 'W' : '-', wp->hits);
+				debug_line_print(string);
+			}
+		}
+		else
+			debug_whats_missing();
+	}
 
 	if (*Line == 'w')
 		debug_whats_used();
@@ -2327,6 +2414,13 @@ static void debug_whats_used (void)
 	printf("Fixed colour: %02x%02x%02x, \n", PPU.FixedColourRed, PPU.FixedColourGreen, PPU.FixedColourBlue);
 }
 
+static void debug_watchpoint_hit (uint32 address, uint8 byte, uint8 type)
+{
+	printf("Watchpoint: %s $%02X:%04X = $%02X\n", type == WATCH_READ ? "read" : "write", address >> 16, address & 0xffff, byte);
+
+	CPU.Flags |= DEBUG_MODE_FLAG;
+}
+
 static void debug_whats_missing (void)
 {
 	printf("Processor: ");
@@ -2560,10 +2654,106 @@ void S9xDoDebug (void)
 		S9xGraphicsMode();
 }
 
+static void debug_trace_flush (void)
+{
+	if (trace_bin && trace_record_count)
+		fwrite(trace_records, sizeof(struct STraceRecord), trace_record_count, trace_bin);
+
+	trace_record_count = 0;
+}
+
+static inline struct STraceRecord * debug_trace_next (void)
+{
+	if (trace_record_count == TRACE_BUFFER_RECORDS)
+		debug_trace_flush();
+
+	return (&trace_records[trace_record_count++]);
+}
+
+static void debug_trace_atexit (void)
+{
+	S9xStopBinaryTrace();
+}
+
+void S9xStartBinaryTrace (void)
+{
+	static bool8	atexit_set = FALSE;
+
+	ENSURE_TRACE_OPEN(trace_bin, "trace.bin", "wb")
+
+	if (!trace_bin)
+		return;
+
+	// Ports exit in their own ways, so the last records are written out
+	// however the process ends, as long as it calls exit().
+	if (!atexit_set)
+		atexit_set = atexit(debug_trace_atexit) == 0;
+
+	uint32	header[2] = { TRACE_BINARY_VERSION, sizeof(struct STraceRecord) };
+
+	fwrite("S9XTRACE", 1, 8, trace_bin);
+	fwrite(header, sizeof(uint32), 2, trace_bin);
+	trace_record_count = 0;
+
+	CPU.Flags |= TRACE_FLAG;
+	SA1.Flags |= TRACE_FLAG;
+	if (spc_core)
+		spc_core->debug_set_binary_trace(true);
+}
+
+void S9xStopBinaryTrace (void)
+{
+	if (!trace_bin)
+		return;
+
+	debug_trace_flush();
+	fclose(trace_bin);
+	trace_bin = NULL;
+
+	if (!trace)
+		CPU.Flags &= ~TRACE_FLAG;
+	if (!trace2)
+		SA1.Flags &= ~TRACE_FLAG;
+	if (spc_core)
+		spc_core->debug_set_binary_trace(false);
+}
+
+bool8 S9xBinaryTraceActive (void)
+{
+	return (trace_bin != NULL);
+}
+
 void S9xTrace (void)
 {
 	char	msg[512];
 
+	if (trace_bin)
+	{
+		struct STraceRecord	*r = debug_trace_next();
+		uint32				pc = Registers.PBPC & 0xffffff;
+
+		r->Source = TRACE_SOURCE_CPU;
+		r->Bank = Registers.PB;
+		r->Address = Registers.PCw;
+		r->Bytes[0] = S9xDebugGetByte(pc);
+		r->Bytes[1] = S9xDebugGetByte(pc + 1);
+		r->Bytes[2] = S9xDebugGetByte(pc + 2);
+		r->Bytes[3] = S9xDebugGetByte(pc + 3);
+		r->RegA = Registers.A.W;
+		r->RegX = Registers.X.W;
+		r->RegY = Registers.Y.W;
+		r->RegD = Registers.D.W;
+		r->RegS = Registers.S.W;
+		r->RegP = (Registers.P.W & ~(Zero | Negative | Carry | Overflow)) |
+			ICPU._Carry | ((ICPU._Zero == 0) << 1) | (ICPU._Negative & 0x80) | (ICPU._Overflow << 6);
+		r->RegDB = Registers.DB;
+		r->IRQLines = (CPU.IRQExternal ? 0x04 : 0) | (PPU.HTimerEnabled ? 0x02 : 0) | (PPU.VTimerEnabled ? 0x01 : 0);
+		r->VCounter = CPU.V_Counter;
+		r->Cycles = CPU.Cycles;
+		r->Frame = IPPU.TotalEmulatedFrames;
+		return;
+	}
+
 	ENSURE_TRACE_OPEN(trace, "trace.log", "a")
 
 	debug_cpu_op_print(msg, Registers.PB, Registers.PCw);
@@ -2574,12 +2764,63 @@ void S9xSA1Trace (void)
 {
 	char	msg[512];
 
+	if (trace_bin)
+	{
+		struct STraceRecord	*r = debug_trace_next();
+		uint32				pc = SA1Registers.PBPC & 0xffffff;
+
+		r->Source = TRACE_SOURCE_SA1;
+		r->Bank = SA1Registers.PB;
+		r->Address = SA1Registers.PCw;
+		r->Bytes[0] = S9xDebugSA1GetByte(pc);
+		r->Bytes[1] = S9xDebugSA1GetByte(pc + 1);
+		r->Bytes[2] = S9xDebugSA1GetByte(pc + 2);
+		r->Bytes[3] = S9xDebugSA1GetByte(pc + 3);
+		r->RegA = SA1Registers.A.W;
+		r->RegX = SA1Registers.X.W;
+		r->RegY = SA1Registers.Y.W;
+		r->RegD = SA1Registers.D.W;
+		r->RegS = SA1Registers.S.W;
+		r->RegP = (SA1Registers.P.W & ~(Zero | Negative | Carry | Overflow)) |
+			SA1._Carry | ((SA1._Zero == 0) << 1) | (SA1._Negative & 0x80) | (SA1._Overflow << 6);
+		r->RegDB = SA1Registers.DB;
+		r->IRQLines = 0;
+		r->VCounter = CPU.V_Counter;
+		r->Cycles = SA1.Cycles;
+		r->Frame = IPPU.TotalEmulatedFrames;
+		return;
+	}
+
 	ENSURE_TRACE_OPEN(trace2, "trace_sa1.log", "a")
 
 	debug_sa1_op_print(msg, SA1Registers.PB, SA1Registers.PCw);
 	fprintf(trace2, "%s\n", msg);
 }
 
+void S9xSPCTrace (uint16 pc, const uint8 *bytes, uint8 a, uint8 x, uint8 y, uint8 s, uint8 psw, int32 cycles)
+{
+	if (!trace_bin)
+		return;
+
+	struct STraceRecord	*r = debug_trace_next();
+
+	r->Source = TRACE_SOURCE_SPC;
+	r->Bank = 0;
+	r->Address = pc;
+	memcpy(r->Bytes, bytes, 4);
+	r->RegA = a;
+	r->RegX = x;
+	r->RegY = y;
+	r->RegD = (psw & 0x20) ? 0x100 : 0;
+	r->RegS = 0x100 | s;
+	r->RegP = psw;
+	r->RegDB = 0;
+	r->IRQLines = 0;
+	r->VCounter = CPU.V_Counter;
+	r->Cycles = cycles;
+	r->Frame = IPPU.TotalEmulatedFrames;
+}
+
 void S9xTraceMessage (const char *s)
 {
 	if (s)
@@ -198,11 +198,50 @@ struct SBreakPoint
 		fp = fopen(fn.c_str(), mode); \
 	}
 
+// Binary trace file (trace.bin): the 8 bytes "S9XTRACE", a uint32 version
+// and a uint32 record size, then one STraceRecord per instruction executed,
+// all in host byte order. tracedump.py disassembles and filters it.
+// Cycles is the counter of the processor the record is for: CPU.Cycles,
+// SA1.Cycles, or SPC700 clocks since the APU last caught up. SPC700 records
+// keep the 8-bit registers in the low bytes, P's direct page in RegD and the
+// stack page in RegS. The SuperFX isn't traced.
+#define TRACE_BINARY_VERSION	2
+
+enum
+{
+	TRACE_SOURCE_CPU = 0,
+	TRACE_SOURCE_SA1,
+	TRACE_SOURCE_SPC
+};
+
+struct STraceRecord
+{
+	uint8	Source;
+	uint8	Bank;
+	uint16	Address;
+	uint8	Bytes[4];	// opcode and the three bytes after it
+	uint16	RegA;
+	uint16	RegX;
+	uint16	RegY;
+	uint16	RegD;
+	uint16	RegS;
+	uint16	RegP;		// including the emulation bit
+	uint8	RegDB;
+	uint8	IRQLines;	// 0x04 external, 0x02 H timer, 0x01 V timer
+	uint16	VCounter;
+	int32	Cycles;
+	uint32	Frame;
+};
+
 extern struct SBreakPoint	S9xBreakpoint[6];
 
 void S9xDoDebug (void);
 void S9xTrace (void);
 void S9xSA1Trace (void);
+void S9xSPCTrace (uint16, const uint8 *, uint8, uint8, uint8, uint8, uint8, int32);
+void S9xStartBinaryTrace (void);
+void S9xStopBinaryTrace (void);
+bool8 S9xBinaryTraceActive (void);
 void S9xTraceMessage (const char *);
 void S9xTraceFormattedMessage (const char *, ...);
 void S9xPrintHVPosition (char *);
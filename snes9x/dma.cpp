@@ -182,17 +182,17 @@
 #include "apu/apu.h"
 #include "sdd1emu.h"
 #include "spc7110emu.h"
+#include "profile.h"
+#include "context.h"
 #ifdef DEBUGGER
 #include "missing.h"
 #endif
 
-#define ADD_CYCLES(n)	{ CPU.PrevCycles = CPU.Cycles; CPU.Cycles += (n); S9xCheckInterrupts(); }
+#define ADD_CYCLES(n)	{ CPU.Cycles += (n); }
 
-extern uint8	*HDMAMemPointers[8];
+extern CONTEXT_LOCAL uint8	*HDMAMemPointers[8];
 extern int		HDMA_ModeByteCounts[8];
-extern SPC7110	s7emu;
-
-static uint8	sdd1_decode_buffer[0x10000];
+extern CONTEXT_LOCAL_CLASS SPC7110	s7emu;
 
 static inline bool8 addCyclesInDMA (uint8);
 static inline bool8 HDMAReadLineCount (int);
@@ -223,6 +223,8 @@ static inline bool8 addCyclesInDMA (uint8 dma_channel)
 
 bool8 S9xDoDMA (uint8 Channel)
 {
+	S9X_PROFILE(PROFILE_DMA);
+
 	CPU.InDMA = TRUE;
     CPU.InDMAorHDMA = TRUE;
 	CPU.CurrentDMAorHDMAChannel = Channel;
@@ -313,7 +315,7 @@ bool8 S9xDoDMA (uint8 Channel)
 			if (in_ptr)
 			{
 				in_ptr += d->AAddress;
-				SDD1_decompress(sdd1_decode_buffer, in_ptr, d->TransferBytes);
+				SDD1_decompress(EmuContext->SDD1DecodeBuffer, in_ptr, d->TransferBytes);
 			}
 		#ifdef DEBUGGER
 			else
@@ -323,7 +325,7 @@ bool8 S9xDoDMA (uint8 Channel)
 			}
 		#endif
 
-			in_sdd1_dma = sdd1_decode_buffer;
+			in_sdd1_dma = EmuContext->SDD1DecodeBuffer;
 		}
 
 		Memory.FillRAM[0x4801] = 0;
@@ -1409,6 +1411,8 @@ void S9xStartHDMA (void)
 
 uint8 S9xDoHDMA (uint8 byte)
 {
+	S9X_PROFILE(PROFILE_HDMA);
+
 	struct SDMA	*p = &DMA[0];
 
 	uint32	ShiftedIBank;
@@ -178,16 +178,19 @@
 
 #include "snes9x.h"
 #include "memmap.h"
+#include "context.h"
 #ifdef DEBUGGER
 #include "missing.h"
 #endif
 
-uint8	(*GetDSP) (uint16)        = NULL;
-void	(*SetDSP) (uint8, uint16) = NULL;
+CONTEXT_LOCAL uint8	(*GetDSP) (uint16)        = NULL;
+CONTEXT_LOCAL void	(*SetDSP) (uint8, uint16) = NULL;
 
 
 void S9xResetDSP (void)
 {
+	struct SEmuContext	*ctx = S9xCurrentContext();
+
 	memset(&DSP1, 0, sizeof(DSP1));
 	DSP1.waiting4command = TRUE;
 	DSP1.first_parameter = TRUE;
@@ -196,6 +199,12 @@ void S9xResetDSP (void)
 	DSP2.waiting4command = TRUE;
 
 	memset(&DSP3, 0, sizeof(DSP3));
+	memset(ctx->DSP3Terrain, 0, sizeof(ctx->DSP3Terrain));
+	memset(ctx->DSP3Cost, 0, sizeof(ctx->DSP3Cost));
+	memset(ctx->DSP3Weight, 0, sizeof(ctx->DSP3Weight));
+	DSP3.op1e_terrain = ctx->DSP3Terrain;
+	DSP3.op1e_cost    = ctx->DSP3Cost;
+	DSP3.op1e_weight  = ctx->DSP3Weight;
 	DSP3_Reset();
 
 	memset(&DSP4, 0, sizeof(DSP4));
@@ -491,9 +491,9 @@ struct SDSP3
 	int16	op3e_x;
 	int16	op3e_y;
 
-	int16	op1e_terrain[0x2000];
-	int16	op1e_cost[0x2000];
-	int16	op1e_weight[0x2000];
+	int16	*op1e_terrain;	// 0x2000 entries each, kept in the bound SEmuContext
+	int16	*op1e_cost;
+	int16	*op1e_weight;
 
 	int16	op1e_cell;
 	int16	op1e_turn;
@@ -594,11 +594,11 @@ struct SDSP4
 	int16	OAM_Row[32];		// current number of tiles per row
 };
 
-extern struct SDSP0	DSP0;
-extern struct SDSP1	DSP1;
-extern struct SDSP2	DSP2;
-extern struct SDSP3	DSP3;
-extern struct SDSP4	DSP4;
+extern CONTEXT_LOCAL struct SDSP0	DSP0;
+extern CONTEXT_LOCAL struct SDSP1	DSP1;
+extern CONTEXT_LOCAL struct SDSP2	DSP2;
+extern CONTEXT_LOCAL struct SDSP3	DSP3;
+extern CONTEXT_LOCAL struct SDSP4	DSP4;
 
 uint8 S9xGetDSP (uint16);
 void S9xSetDSP (uint8, uint16);
@@ -613,7 +613,7 @@ uint8 DSP4GetByte (uint16);
 void DSP4SetByte (uint8, uint16);
 void DSP3_Reset (void);
 
-extern uint8 (*GetDSP) (uint16);
-extern void (*SetDSP) (uint8, uint16);
+extern CONTEXT_LOCAL uint8 (*GetDSP) (uint16);
+extern CONTEXT_LOCAL void (*SetDSP) (uint8, uint16);
 
 #endif
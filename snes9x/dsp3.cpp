@@ -179,7 +179,7 @@
 #include "snes9x.h"
 #include "memmap.h"
 
-static void (*SetDSP3) (void);
+static CONTEXT_LOCAL void (*SetDSP3) (void);
 
 static const uint16	DSP3_DataROM[1024] =
 {
@@ -177,7 +177,23 @@
 
 
 #include "snes9x.h"
+#include "gfx.h"
 #include "blit.h"
+#include "workers.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#if !defined(__SSE2__) && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+#define FILTER_NEON
+#include <arm_neon.h>
+#endif
+
+#if !defined(__SSE2__) && !defined(FILTER_NEON) && defined(__wasm_simd128__)
+#define FILTER_WASM_SIMD
+#include <wasm_simd128.h>
+#endif
 
 #define ALL_COLOR_MASK	(FIRST_COLOR_MASK | SECOND_COLOR_MASK | THIRD_COLOR_MASK)
 
@@ -197,12 +213,15 @@ static uint8		*XDelta = NULL;
 
 bool8 S9xBlitFilterInit (void)
 {
-	XDelta = new uint8[SNES_WIDTH * SNES_HEIGHT_EXTENDED * 4];
+	XDelta = new uint8[BLIT_DELTA_SIZE];
 	if (!XDelta)
 		return (FALSE);
 
 	S9xBlitClearDelta();
 
+	// Filters fall back to running on this thread if no workers could start.
+	S9xFilterWorkersInit(0);
+
 #ifdef GFX_MULTI_FORMAT
 	lowPixelMask  = RGB_LOW_BITS_MASK;
 	qlowPixelMask = (RGB_HI_BITS_MASK >> 3) | TWO_LOW_BITS_MASK;
@@ -215,6 +234,8 @@ bool8 S9xBlitFilterInit (void)
 
 void S9xBlitFilterDeinit (void)
 {
+	S9xFilterWorkersDeinit();
+
 	if (XDelta)
 	{
 		delete[] XDelta;
@@ -231,6 +252,42 @@ void S9xBlitClearDelta (void)
 			*d++ = 0x80008000;
 }
 
+// Finds the next run of source lines, starting at *y, whose filtered output
+// can differ from what the destination already holds. A line is redrawn if it
+// or any line within 'context' lines of it is flagged in GFX.LineChanged.
+// Returns the length of the run, or 0 once the frame is done.
+// Only used when GFX.TrackLineChanges is set, which the filter pipeline clears
+// for the runs that have to redraw the whole frame.
+static int NextChangedLines (int *y, int height, int context)
+{
+	int	first, last;
+
+	if (*y >= height)
+		return (0);
+
+	if (!GFX.TrackLineChanges || height > MAX_SNES_HEIGHT)
+		return (height - *y);
+
+	for (first = *y, last = *y; last < height; last++)
+	{
+		bool8	changed = FALSE;
+
+		for (int i = last - context; i <= last + context; i++)
+			if (i >= 0 && i < height && GFX.LineChanged[i])
+				changed = TRUE;
+
+		if (!changed)
+		{
+			if (last > first)
+				break;
+			first = last + 1;
+		}
+	}
+
+	*y = first;
+	return (last - first);
+}
+
 bool8 S9xBlitNTSCFilterInit (void)
 {
 	ntsc = (snes_ntsc_t *) malloc(sizeof(snes_ntsc_t));
@@ -578,9 +635,9 @@ void S9xBlitPixMixedTV1x2 (uint8 *srcPtr, int srcRowBytes, uint8 *dstPtr, int ds
 	}
 }
 
-void S9xBlitPixSmooth2x2 (uint8 *srcPtr, int srcRowBytes, uint8 *dstPtr, int dstRowBytes, int width, int height)
+static void Smooth2x2Lines (uint8 *srcPtr, int srcRowBytes, uint8 *deltaPtr, uint8 *dstPtr, int dstRowBytes, int width, int height)
 {
-	uint8	*dstPtr2 = dstPtr + dstRowBytes, *deltaPtr = XDelta;
+	uint8	*dstPtr2 = dstPtr + dstRowBytes;
 	uint32	lastLinePix[SNES_WIDTH << 1];
 	uint8	lastLineChg[SNES_WIDTH >> 1];
 	int		lineBytes = width << 1;
@@ -667,19 +724,30 @@ void S9xBlitPixSmooth2x2 (uint8 *srcPtr, int srcRowBytes, uint8 *dstPtr, int dst
 	}
 }
 
+// Each run starts with a clean previous line, so the zeroed line history
+// Smooth2x2Lines begins with matches what a full pass would have left.
+void S9xBlitPixSmooth2x2 (uint8 *srcPtr, int srcRowBytes, uint8 *dstPtr, int dstRowBytes, int width, int height)
+{
+	for (int y = 0, n; (n = NextChangedLines(&y, height, 1)) != 0; y += n)
+		Smooth2x2Lines(srcPtr + y * srcRowBytes, srcRowBytes, XDelta + y * srcRowBytes, dstPtr + y * 2 * dstRowBytes, dstRowBytes, width, n);
+}
+
 void S9xBlitPixSuper2xSaI16 (uint8 *srcPtr, int srcRowBytes, uint8 *dstPtr, int dstRowBytes, int width, int height)
 {
-	Super2xSaI(srcPtr, srcRowBytes, dstPtr, dstRowBytes, width, height);
+	for (int y = 0, n; (n = NextChangedLines(&y, height, 2)) != 0; y += n)
+		Super2xSaI(srcPtr + y * srcRowBytes, srcRowBytes, dstPtr + y * 2 * dstRowBytes, dstRowBytes, width, n);
 }
 
 void S9xBlitPix2xSaI16 (uint8 *srcPtr, int srcRowBytes, uint8 *dstPtr, int dstRowBytes, int width, int height)
 {
-	_2xSaI(srcPtr, srcRowBytes, dstPtr, dstRowBytes, width, height);
+	for (int y = 0, n; (n = NextChangedLines(&y, height, 2)) != 0; y += n)
+		_2xSaI(srcPtr + y * srcRowBytes, srcRowBytes, dstPtr + y * 2 * dstRowBytes, dstRowBytes, width, n);
 }
 
 void S9xBlitPixSuperEagle16 (uint8 *srcPtr, int srcRowBytes, uint8 *dstPtr, int dstRowBytes, int width, int height)
 {
-	SuperEagle(srcPtr, srcRowBytes, dstPtr, dstRowBytes, width, height);
+	for (int y = 0, n; (n = NextChangedLines(&y, height, 2)) != 0; y += n)
+		SuperEagle(srcPtr + y * srcRowBytes, srcRowBytes, dstPtr + y * 2 * dstRowBytes, dstRowBytes, width, n);
 }
 
 void S9xBlitPixEPX16 (uint8 *srcPtr, int srcRowBytes, uint8 *dstPtr, int dstRowBytes, int width, int height)
@@ -689,25 +757,293 @@ void S9xBlitPixEPX16 (uint8 *srcPtr, int srcRowBytes, uint8 *dstPtr, int dstRowB
 
 void S9xBlitPixHQ2x16 (uint8 *srcPtr, int srcRowBytes, uint8 *dstPtr, int dstRowBytes, int width, int height)
 {
-	HQ2X_16(srcPtr, srcRowBytes, dstPtr, dstRowBytes, width, height);
+	for (int y = 0, n; (n = NextChangedLines(&y, height, 1)) != 0; y += n)
+		HQ2X_16(srcPtr + y * srcRowBytes, srcRowBytes, dstPtr + y * 2 * dstRowBytes, dstRowBytes, width, n);
 }
 
 void S9xBlitPixHQ3x16 (uint8 *srcPtr, int srcRowBytes, uint8 *dstPtr, int dstRowBytes, int width, int height)
 {
-	HQ3X_16(srcPtr, srcRowBytes, dstPtr, dstRowBytes, width, height);
+	for (int y = 0, n; (n = NextChangedLines(&y, height, 1)) != 0; y += n)
+		HQ3X_16(srcPtr + y * srcRowBytes, srcRowBytes, dstPtr + y * 3 * dstRowBytes, dstRowBytes, width, n);
 }
 
 void S9xBlitPixHQ4x16 (uint8 *srcPtr, int srcRowBytes, uint8 *dstPtr, int dstRowBytes, int width, int height)
 {
-	HQ4X_16(srcPtr, srcRowBytes, dstPtr, dstRowBytes, width, height);
+	for (int y = 0, n; (n = NextChangedLines(&y, height, 1)) != 0; y += n)
+		HQ4X_16(srcPtr + y * srcRowBytes, srcRowBytes, dstPtr + y * 4 * dstRowBytes, dstRowBytes, width, n);
+}
+
+struct SNTSCJob
+{
+	uint8	*src;
+	int		srcRowBytes;
+	uint8	*dst;
+	int		dstRowBytes;
+	int		width;
+	bool8	hires;
+};
+
+#if (defined(__SSE2__) || defined(FILTER_NEON) || defined(FILTER_WASM_SIMD)) && (SNES_NTSC_OUT_DEPTH == 15 || SNES_NTSC_OUT_DEPTH == 16)
+#define NTSC_SIMD
+
+#if SNES_NTSC_OUT_DEPTH == 16
+#define NTSC_R_SHIFT	13
+#define NTSC_R_MASK		0xF800
+#define NTSC_G_SHIFT	8
+#define NTSC_G_MASK		0x07E0
+#else
+#define NTSC_R_SHIFT	14
+#define NTSC_R_MASK		0x7C00
+#define NTSC_G_SHIFT	9
+#define NTSC_G_MASK		0x03E0
+#endif
+#define NTSC_B_SHIFT	4
+#define NTSC_B_MASK		0x001F
+
+#define NTSC_KERNEL(n)		SNES_NTSC_IN_FORMAT(ktable, (n))
+#define NTSC_MAX_CHUNKS		(MAX_SNES_WIDTH / snes_ntsc_in_chunk)
+
+// Each input pixel adds 14 consecutive entries of its kernel to 14 consecutive
+// output samples; which 14 depends only on its position within the chunk. That
+// makes a row a plain sum of shifted kernels, which is done 4 samples at a time
+// and gives exactly the same (wrapping) sums as snes_ntsc_blit.
+#if defined(__SSE2__)
+static inline void NTSCAddKernel (uint32 *acc, const snes_ntsc_rgb_t *k)
+{
+	__m128i	a0 = _mm_add_epi32(_mm_loadu_si128((const __m128i *) (acc + 0)), _mm_loadu_si128((const __m128i *) (k + 0)));
+	__m128i	a1 = _mm_add_epi32(_mm_loadu_si128((const __m128i *) (acc + 4)), _mm_loadu_si128((const __m128i *) (k + 4)));
+	__m128i	a2 = _mm_add_epi32(_mm_loadu_si128((const __m128i *) (acc + 8)), _mm_loadu_si128((const __m128i *) (k + 8)));
+	__m128i	a3 = _mm_add_epi32(_mm_loadl_epi64((const __m128i *) (acc + 12)), _mm_loadl_epi64((const __m128i *) (k + 12)));
+
+	_mm_storeu_si128((__m128i *) (acc + 0), a0);
+	_mm_storeu_si128((__m128i *) (acc + 4), a1);
+	_mm_storeu_si128((__m128i *) (acc + 8), a2);
+	_mm_storel_epi64((__m128i *) (acc + 12), a3);
+}
+
+static inline __m128i NTSCClampPack4 (const uint32 *acc, __m128i shift)
+{
+	__m128i	raw   = _mm_loadu_si128((const __m128i *) acc);
+	__m128i	sub   = _mm_and_si128(_mm_srl_epi32(raw, _mm_sub_epi32(_mm_cvtsi32_si128(9), shift)), _mm_set1_epi32(snes_ntsc_clamp_mask));
+	__m128i	clamp = _mm_sub_epi32(_mm_set1_epi32(snes_ntsc_clamp_add), sub);
+	__m128i	r, g, b;
+
+	raw   = _mm_or_si128(raw, clamp);
+	clamp = _mm_sub_epi32(clamp, sub);
+	raw   = _mm_and_si128(raw, clamp);
+
+	r = _mm_and_si128(_mm_srl_epi32(raw, _mm_sub_epi32(_mm_cvtsi32_si128(NTSC_R_SHIFT), shift)), _mm_set1_epi32(NTSC_R_MASK));
+	g = _mm_and_si128(_mm_srl_epi32(raw, _mm_sub_epi32(_mm_cvtsi32_si128(NTSC_G_SHIFT), shift)), _mm_set1_epi32(NTSC_G_MASK));
+	b = _mm_and_si128(_mm_srl_epi32(raw, _mm_sub_epi32(_mm_cvtsi32_si128(NTSC_B_SHIFT), shift)), _mm_set1_epi32(NTSC_B_MASK));
+
+	// Sign-extend the 16-bit results so the saturating pack keeps them intact.
+	return (_mm_srai_epi32(_mm_slli_epi32(_mm_or_si128(_mm_or_si128(r, g), b), 16), 16));
+}
+
+static inline void NTSCPack8 (uint16 *out, const uint32 *acc, int shift)
+{
+	__m128i	s = _mm_cvtsi32_si128(shift);
+
+	_mm_storeu_si128((__m128i *) out, _mm_packs_epi32(NTSCClampPack4(acc, s), NTSCClampPack4(acc + 4, s)));
+}
+#elif defined(FILTER_NEON)
+static inline void NTSCAddKernel (uint32 *acc, const snes_ntsc_rgb_t *k)
+{
+	vst1q_u32(acc + 0, vaddq_u32(vld1q_u32(acc + 0), vld1q_u32(k + 0)));
+	vst1q_u32(acc + 4, vaddq_u32(vld1q_u32(acc + 4), vld1q_u32(k + 4)));
+	vst1q_u32(acc + 8, vaddq_u32(vld1q_u32(acc + 8), vld1q_u32(k + 8)));
+	vst1_u32(acc + 12, vadd_u32(vld1_u32(acc + 12), vld1_u32(k + 12)));
+}
+
+// NEON only shifts right by a variable amount as a left shift by a negative one.
+static inline uint16x4_t NTSCClampPack4 (const uint32 *acc, int shift)
+{
+	uint32x4_t	raw   = vld1q_u32(acc);
+	uint32x4_t	sub   = vandq_u32(vshlq_u32(raw, vdupq_n_s32(shift - 9)), vdupq_n_u32(snes_ntsc_clamp_mask));
+	uint32x4_t	clamp = vsubq_u32(vdupq_n_u32(snes_ntsc_clamp_add), sub);
+	uint32x4_t	r, g, b;
+
+	raw   = vorrq_u32(raw, clamp);
+	clamp = vsubq_u32(clamp, sub);
+	raw   = vandq_u32(raw, clamp);
+
+	r = vandq_u32(vshlq_u32(raw, vdupq_n_s32(shift - NTSC_R_SHIFT)), vdupq_n_u32(NTSC_R_MASK));
+	g = vandq_u32(vshlq_u32(raw, vdupq_n_s32(shift - NTSC_G_SHIFT)), vdupq_n_u32(NTSC_G_MASK));
+	b = vandq_u32(vshlq_u32(raw, vdupq_n_s32(shift - NTSC_B_SHIFT)), vdupq_n_u32(NTSC_B_MASK));
+
+	return (vmovn_u32(vorrq_u32(vorrq_u32(r, g), b)));
+}
+
+static inline void NTSCPack8 (uint16 *out, const uint32 *acc, int shift)
+{
+	vst1q_u16(out, vcombine_u16(NTSCClampPack4(acc, shift), NTSCClampPack4(acc + 4, shift)));
+}
+#else
+static inline void NTSCAddKernel (uint32 *acc, const snes_ntsc_rgb_t *k)
+{
+	wasm_v128_store(acc + 0, wasm_i32x4_add(wasm_v128_load(acc + 0), wasm_v128_load(k + 0)));
+	wasm_v128_store(acc + 4, wasm_i32x4_add(wasm_v128_load(acc + 4), wasm_v128_load(k + 4)));
+	wasm_v128_store(acc + 8, wasm_i32x4_add(wasm_v128_load(acc + 8), wasm_v128_load(k + 8)));
+	acc[12] += k[12];
+	acc[13] += k[13];
+}
+
+static inline v128_t NTSCClampPack4 (const uint32 *acc, int shift)
+{
+	v128_t	raw   = wasm_v128_load(acc);
+	v128_t	sub   = wasm_v128_and(wasm_u32x4_shr(raw, 9 - shift), wasm_i32x4_splat(snes_ntsc_clamp_mask));
+	v128_t	clamp = wasm_i32x4_sub(wasm_i32x4_splat(snes_ntsc_clamp_add), sub);
+	v128_t	r, g, b;
+
+	raw   = wasm_v128_or(raw, clamp);
+	clamp = wasm_i32x4_sub(clamp, sub);
+	raw   = wasm_v128_and(raw, clamp);
+
+	r = wasm_v128_and(wasm_u32x4_shr(raw, NTSC_R_SHIFT - shift), wasm_i32x4_splat(NTSC_R_MASK));
+	g = wasm_v128_and(wasm_u32x4_shr(raw, NTSC_G_SHIFT - shift), wasm_i32x4_splat(NTSC_G_MASK));
+	b = wasm_v128_and(wasm_u32x4_shr(raw, NTSC_B_SHIFT - shift), wasm_i32x4_splat(NTSC_B_MASK));
+
+	return (wasm_v128_or(wasm_v128_or(r, g), b));
+}
+
+// The results fit in 16 bits, so the low halves are taken as they are.
+static inline void NTSCPack8 (uint16 *out, const uint32 *acc, int shift)
+{
+	wasm_v128_store(out, wasm_i16x8_shuffle(NTSCClampPack4(acc, shift), NTSCClampPack4(acc + 4, shift), 0, 2, 4, 6, 8, 10, 12, 14));
+}
+#endif
+
+static void NTSCRow (const uint16 *in, int width, uint16 *out, int burst, bool8 hires)
+{
+	uint32		acc[(NTSC_MAX_CHUNKS + 6) * snes_ntsc_out_chunk];
+	const char	*ktable = (const char *) ntsc->table + burst * (snes_ntsc_burst_size * sizeof(snes_ntsc_rgb_t));
+	const snes_ntsc_rgb_t	*black = NTSC_KERNEL(snes_ntsc_black);
+	int			chunks, count, shift, i;
+	uint32		*a;
+
+	if (hires)
+		chunks = (width - 2) / (snes_ntsc_in_chunk * 2);
+	else
+		chunks = (width - 1) / snes_ntsc_in_chunk;
+
+	count = (chunks + 1) * snes_ntsc_out_chunk;
+	memset(acc, 0, (count + snes_ntsc_out_chunk * 5) * sizeof(uint32));
+
+	// acc[0] is the first sample of chunk -2. Chunks -2 and -1 hold the black
+	// border plus the first one (two) input pixels, chunk "chunks" the black
+	// pixels that finish the row.
+	a = acc;
+
+	if (hires)
+	{
+		for (i = 0; i < 6; i++)
+			NTSCAddKernel(a + i, black + (i >> 1) * 14);
+		a += snes_ntsc_out_chunk;
+
+		for (i = 0; i < 4; i++)
+			NTSCAddKernel(a + i, black + (i >> 1) * 14);
+		NTSCAddKernel(a + 4, NTSC_KERNEL(in[0]) + 28);
+		NTSCAddKernel(a + 5, NTSC_KERNEL(in[1]) + 28);
+		a += snes_ntsc_out_chunk;
+		in += 2;
+
+		for (int c = 0; c < chunks; c++, in += 6, a += snes_ntsc_out_chunk)
+		{
+			NTSCAddKernel(a + 0, NTSC_KERNEL(in[0]));
+			NTSCAddKernel(a + 1, NTSC_KERNEL(in[1]));
+			NTSCAddKernel(a + 2, NTSC_KERNEL(in[2]) + 14);
+			NTSCAddKernel(a + 3, NTSC_KERNEL(in[3]) + 14);
+			NTSCAddKernel(a + 4, NTSC_KERNEL(in[4]) + 28);
+			NTSCAddKernel(a + 5, NTSC_KERNEL(in[5]) + 28);
+		}
+
+		for (i = 0; i < 6; i++)
+			NTSCAddKernel(a + i, black + (i >> 1) * 14);
+
+		shift = 0;
+	}
+	else
+	{
+		for (i = 0; i < 3; i++)
+			NTSCAddKernel(a + i * 2, black + i * 14);
+		a += snes_ntsc_out_chunk;
+
+		NTSCAddKernel(a + 0, black);
+		NTSCAddKernel(a + 2, black + 14);
+		NTSCAddKernel(a + 4, NTSC_KERNEL(in[0]) + 28);
+		a += snes_ntsc_out_chunk;
+		in += 1;
+
+		for (int c = 0; c < chunks; c++, in += 3, a += snes_ntsc_out_chunk)
+		{
+			NTSCAddKernel(a + 0, NTSC_KERNEL(in[0]));
+			NTSCAddKernel(a + 2, NTSC_KERNEL(in[1]) + 14);
+			NTSCAddKernel(a + 4, NTSC_KERNEL(in[2]) + 28);
+		}
+
+		for (i = 0; i < 3; i++)
+			NTSCAddKernel(a + i * 2, black + i * 14);
+
+		shift = 1;
+	}
+
+	a = acc + snes_ntsc_out_chunk * 2;
+
+	for (i = 0; i + 8 <= count; i += 8)
+		NTSCPack8(out + i, a + i, shift);
+
+	for (; i < count; i++)
+	{
+		snes_ntsc_rgb_t	raw_ = a[i];
+		SNES_NTSC_CLAMP_(raw_, shift);
+		out[i] = (uint16) ((raw_ >> (NTSC_R_SHIFT - shift) & NTSC_R_MASK) | (raw_ >> (NTSC_G_SHIFT - shift) & NTSC_G_MASK) | (raw_ >> (NTSC_B_SHIFT - shift) & NTSC_B_MASK));
+	}
+}
+#endif
+
+// Rows only depend on their burst phase, which cycles with the row number, so
+// strips can be filtered independently.
+static void NTSCStrip (void *data, int first, int count)
+{
+	SNTSCJob	*job = (SNTSCJob *) data;
+	uint8		*src = job->src + first * job->srcRowBytes;
+	uint8		*dst = job->dst + first * job->dstRowBytes;
+
+#ifdef NTSC_SIMD
+	for (int y = first; y < first + count; y++)
+	{
+		NTSCRow((const uint16 *) src, job->width, (uint16 *) dst, y % snes_ntsc_burst_count, job->hires);
+		src += job->srcRowBytes;
+		dst += job->dstRowBytes;
+	}
+#else
+	if (job->hires)
+		snes_ntsc_blit_hires(ntsc, (SNES_NTSC_IN_T const *) src, job->srcRowBytes >> 1, first % snes_ntsc_burst_count, job->width, count, dst, job->dstRowBytes);
+	else
+		snes_ntsc_blit(ntsc, (SNES_NTSC_IN_T const *) src, job->srcRowBytes >> 1, first % snes_ntsc_burst_count, job->width, count, dst, job->dstRowBytes);
+#endif
+}
+
+static void NTSCRun (uint8 *srcPtr, int srcRowBytes, uint8 *dstPtr, int dstRowBytes, int width, int height, bool8 hires)
+{
+	SNTSCJob	job;
+
+	job.src         = srcPtr;
+	job.srcRowBytes = srcRowBytes;
+	job.dst         = dstPtr;
+	job.dstRowBytes = dstRowBytes;
+	job.width       = width;
+	job.hires       = hires;
+
+	S9xFilterWorkersRun(NTSCStrip, &job, height);
 }
 
 void S9xBlitPixNTSC16 (uint8 *srcPtr, int srcRowBytes, uint8 *dstPtr, int dstRowBytes, int width, int height)
 {
-	snes_ntsc_blit(ntsc, (SNES_NTSC_IN_T const *) srcPtr, srcRowBytes >> 1, 0, width, height, dstPtr, dstRowBytes);
+	NTSCRun(srcPtr, srcRowBytes, dstPtr, dstRowBytes, width, height, FALSE);
 }
 
 void S9xBlitPixHiResNTSC16 (uint8 *srcPtr, int srcRowBytes, uint8 *dstPtr, int dstRowBytes, int width, int height)
 {
-	snes_ntsc_blit_hires(ntsc, (SNES_NTSC_IN_T const *) srcPtr, srcRowBytes >> 1, 0, width, height, dstPtr, dstRowBytes);
+	NTSCRun(srcPtr, srcRowBytes, dstPtr, dstRowBytes, width, height, TRUE);
 }
@@ -184,6 +184,10 @@
 #include "hq2x.h"
 #include "snes_ntsc.h"
 
+// Size of the pixel history kept by the Simple2x2, TV2x2 and Smooth2x2
+// filters, which caps srcRowBytes * height for them.
+#define BLIT_DELTA_SIZE	(SNES_WIDTH * SNES_HEIGHT_EXTENDED * 4)
+
 bool8 S9xBlitFilterInit (void);
 void S9xBlitFilterDeinit (void);
 void S9xBlitClearDelta (void);
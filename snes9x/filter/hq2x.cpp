@@ -179,6 +179,21 @@
 #include "snes9x.h"
 #include "gfx.h"
 #include "hq2x.h"
+#include "workers.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#if !defined(__SSE2__) && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+#define FILTER_NEON
+#include <arm_neon.h>
+#endif
+
+#if !defined(__SSE2__) && !defined(FILTER_NEON) && defined(__wasm_simd128__)
+#define FILTER_WASM_SIMD
+#include <wasm_simd128.h>
+#endif
 
 #define	Ymask	0xFF0000
 #define	Umask	0x00FF00
@@ -507,6 +522,9 @@ static int	*RGBtoYUV = NULL;
 
 static void InitLUTs (void);
 static inline bool Diff (int, int);
+static void HQ2XRows (uint8 *, uint32, uint8 *, uint32, int, int);
+static void HQ3XRows (uint8 *, uint32, uint8 *, uint32, int, int);
+static void HQ4XRows (uint8 *, uint32, uint8 *, uint32, int, int);
 
 
 bool8 S9xBlitHQ2xFilterInit (void)
@@ -573,7 +591,242 @@ static inline bool Diff (int c1, int c2)
 	return (false);
 }
 
+// YUV values of the rows above, at and below the current one (with one pixel
+// of border on each side) and the difference patterns of the current row.
+// Frames are never wider than MAX_SNES_WIDTH.
+struct SHQRows
+{
+	int		yuv[3][MAX_SNES_WIDTH + 2];
+	int		*up, *mid, *dn;
+	uint8	pattern[MAX_SNES_WIDTH];
+};
+
+struct SHQJob
+{
+	void	(*kernel) (uint8 *, uint32, uint8 *, uint32, int, int);
+	uint8	*src;
+	uint32	srcPitch;
+	uint8	*dst;
+	uint32	dstPitch;
+	int		width;
+	int		scale;
+};
+
+static inline void ConvertRow (int *yuv, const uint16 *sp, int width)
+{
+	sp--;
+	for (int x = -1; x <= width; x++)
+		*yuv++ = RGBtoYUV[*sp++];
+}
+
+#ifdef __SSE2__
+static inline __m128i Diff4 (__m128i c1, __m128i c2)
+{
+	__m128i	d, r;
+
+	d = _mm_sub_epi32(_mm_and_si128(c1, _mm_set1_epi32(Ymask)), _mm_and_si128(c2, _mm_set1_epi32(Ymask)));
+	r = _mm_or_si128(_mm_cmpgt_epi32(d, _mm_set1_epi32(trY)), _mm_cmplt_epi32(d, _mm_set1_epi32(-trY)));
+
+	d = _mm_sub_epi32(_mm_and_si128(c1, _mm_set1_epi32(Umask)), _mm_and_si128(c2, _mm_set1_epi32(Umask)));
+	r = _mm_or_si128(r, _mm_or_si128(_mm_cmpgt_epi32(d, _mm_set1_epi32(trU)), _mm_cmplt_epi32(d, _mm_set1_epi32(-trU))));
+
+	d = _mm_sub_epi32(_mm_and_si128(c1, _mm_set1_epi32(Vmask)), _mm_and_si128(c2, _mm_set1_epi32(Vmask)));
+	r = _mm_or_si128(r, _mm_or_si128(_mm_cmpgt_epi32(d, _mm_set1_epi32(trV)), _mm_cmplt_epi32(d, _mm_set1_epi32(-trV))));
+
+	return (r);
+}
+
+#define PATTERN4(n, bit) \
+	p = _mm_or_si128(p, _mm_and_si128(Diff4(c, _mm_loadu_si128((const __m128i *) (n))), _mm_set1_epi32(1 << (bit))))
+#endif
+
+// The channel differences stay within +-0xFF0000, so |d| can't overflow.
+#ifdef FILTER_NEON
+static inline uint32x4_t Diff4 (int32x4_t c1, int32x4_t c2)
+{
+	int32x4_t	d;
+	uint32x4_t	r;
+
+	d = vsubq_s32(vandq_s32(c1, vdupq_n_s32(Ymask)), vandq_s32(c2, vdupq_n_s32(Ymask)));
+	r = vcgtq_s32(vabsq_s32(d), vdupq_n_s32(trY));
+
+	d = vsubq_s32(vandq_s32(c1, vdupq_n_s32(Umask)), vandq_s32(c2, vdupq_n_s32(Umask)));
+	r = vorrq_u32(r, vcgtq_s32(vabsq_s32(d), vdupq_n_s32(trU)));
+
+	d = vsubq_s32(vandq_s32(c1, vdupq_n_s32(Vmask)), vandq_s32(c2, vdupq_n_s32(Vmask)));
+	r = vorrq_u32(r, vcgtq_s32(vabsq_s32(d), vdupq_n_s32(trV)));
+
+	return (r);
+}
+
+#define PATTERN4(n, bit) \
+	p = vorrq_u32(p, vandq_u32(Diff4(c, vld1q_s32(n)), vdupq_n_u32(1 << (bit))))
+#endif
+
+#ifdef FILTER_WASM_SIMD
+static inline v128_t Diff4 (v128_t c1, v128_t c2)
+{
+	v128_t	d, r;
+
+	d = wasm_i32x4_sub(wasm_v128_and(c1, wasm_i32x4_splat(Ymask)), wasm_v128_and(c2, wasm_i32x4_splat(Ymask)));
+	r = wasm_i32x4_gt(wasm_i32x4_abs(d), wasm_i32x4_splat(trY));
+
+	d = wasm_i32x4_sub(wasm_v128_and(c1, wasm_i32x4_splat(Umask)), wasm_v128_and(c2, wasm_i32x4_splat(Umask)));
+	r = wasm_v128_or(r, wasm_i32x4_gt(wasm_i32x4_abs(d), wasm_i32x4_splat(trU)));
+
+	d = wasm_i32x4_sub(wasm_v128_and(c1, wasm_i32x4_splat(Vmask)), wasm_v128_and(c2, wasm_i32x4_splat(Vmask)));
+	r = wasm_v128_or(r, wasm_i32x4_gt(wasm_i32x4_abs(d), wasm_i32x4_splat(trV)));
+
+	return (r);
+}
+
+#define PATTERN4(n, bit) \
+	p = wasm_v128_or(p, wasm_v128_and(Diff4(c, wasm_v128_load(n)), wasm_i32x4_splat(1 << (bit))))
+#endif
+
+// Equivalent to testing each of the eight neighbours of w5 with Diff(), in the
+// order w1, w2, w3, w4, w6, w7, w8, w9. Identical colours have identical YUV
+// values, so the (wN != w5) shortcut of the scalar test is not needed.
+static void ComputePatterns (SHQRows *rows, int width)
+{
+	const int	*up = rows->up, *mid = rows->mid, *dn = rows->dn;
+	uint8		*pattern = rows->pattern;
+	int			x = 0;
+
+#ifdef __SSE2__
+	for (; x + 4 <= width; x += 4)
+	{
+		__m128i	c = _mm_loadu_si128((const __m128i *) (mid + x + 1));
+		__m128i	p = _mm_setzero_si128();
+
+		PATTERN4(up  + x,     0);
+		PATTERN4(up  + x + 1, 1);
+		PATTERN4(up  + x + 2, 2);
+		PATTERN4(mid + x,     3);
+		PATTERN4(mid + x + 2, 4);
+		PATTERN4(dn  + x,     5);
+		PATTERN4(dn  + x + 1, 6);
+		PATTERN4(dn  + x + 2, 7);
+
+		p = _mm_packs_epi32(p, p);
+		p = _mm_packus_epi16(p, p);
+		*(uint32 *) (pattern + x) = _mm_cvtsi128_si32(p);
+	}
+#elif defined(FILTER_NEON)
+	for (; x + 4 <= width; x += 4)
+	{
+		int32x4_t	c = vld1q_s32(mid + x + 1);
+		uint32x4_t	p = vdupq_n_u32(0);
+		uint16x4_t	p16;
+
+		PATTERN4(up  + x,     0);
+		PATTERN4(up  + x + 1, 1);
+		PATTERN4(up  + x + 2, 2);
+		PATTERN4(mid + x,     3);
+		PATTERN4(mid + x + 2, 4);
+		PATTERN4(dn  + x,     5);
+		PATTERN4(dn  + x + 1, 6);
+		PATTERN4(dn  + x + 2, 7);
+
+		p16 = vmovn_u32(p);
+		vst1_lane_u32((uint32_t *) (pattern + x), vreinterpret_u32_u8(vmovn_u16(vcombine_u16(p16, p16))), 0);
+	}
+#elif defined(FILTER_WASM_SIMD)
+	for (; x + 4 <= width; x += 4)
+	{
+		v128_t	c = wasm_v128_load(mid + x + 1);
+		v128_t	p = wasm_i32x4_splat(0);
+
+		PATTERN4(up  + x,     0);
+		PATTERN4(up  + x + 1, 1);
+		PATTERN4(up  + x + 2, 2);
+		PATTERN4(mid + x,     3);
+		PATTERN4(mid + x + 2, 4);
+		PATTERN4(dn  + x,     5);
+		PATTERN4(dn  + x + 1, 6);
+		PATTERN4(dn  + x + 2, 7);
+
+		*(uint32 *) (pattern + x) = wasm_i32x4_extract_lane(wasm_i8x16_shuffle(p, p, 0, 4, 8, 12, 0, 4, 8, 12, 0, 4, 8, 12, 0, 4, 8, 12), 0);
+	}
+#endif
+
+	for (; x < width; x++)
+	{
+		int	c = mid[x + 1];
+
+		pattern[x] = (Diff(c, up[x])      << 0) | (Diff(c, up[x + 1]) << 1) | (Diff(c, up[x + 2]) << 2) |
+		             (Diff(c, mid[x])     << 3) | (Diff(c, mid[x + 2]) << 4) |
+		             (Diff(c, dn[x])      << 5) | (Diff(c, dn[x + 1]) << 6) | (Diff(c, dn[x + 2]) << 7);
+	}
+}
+
+static void BeginRows (SHQRows *rows, const uint16 *sp, uint32 src1line, int width)
+{
+	rows->up  = rows->yuv[0];
+	rows->mid = rows->yuv[1];
+	rows->dn  = rows->yuv[2];
+
+	ConvertRow(rows->up,  sp - src1line, width);
+	ConvertRow(rows->mid, sp,            width);
+}
+
+// Converts the row below sp, computes the patterns of the row at sp and
+// advances the window by one row.
+static uint8 * NextRow (SHQRows *rows, const uint16 *sp, uint32 src1line, int width)
+{
+	int	*t;
+
+	ConvertRow(rows->dn, sp + src1line, width);
+	ComputePatterns(rows, width);
+
+	t = rows->up;
+	rows->up  = rows->mid;
+	rows->mid = rows->dn;
+	rows->dn  = t;
+
+	return (rows->pattern);
+}
+
+static void HQStrip (void *data, int first, int count)
+{
+	SHQJob	*job = (SHQJob *) data;
+
+	job->kernel(job->src + first * job->srcPitch, job->srcPitch,
+	            job->dst + first * job->scale * job->dstPitch, job->dstPitch, job->width, count);
+}
+
+static void HQRun (void (*kernel) (uint8 *, uint32, uint8 *, uint32, int, int), int scale,
+                   uint8 *srcPtr, uint32 srcPitch, uint8 *dstPtr, uint32 dstPitch, int width, int height)
+{
+	SHQJob	job;
+
+	job.kernel   = kernel;
+	job.src      = srcPtr;
+	job.srcPitch = srcPitch;
+	job.dst      = dstPtr;
+	job.dstPitch = dstPitch;
+	job.width    = width;
+	job.scale    = scale;
+
+	S9xFilterWorkersRun(HQStrip, &job, height);
+}
+
 void HQ2X_16 (uint8 *srcPtr, uint32 srcPitch, uint8 *dstPtr, uint32 dstPitch, int width, int height)
+{
+	HQRun(HQ2XRows, 2, srcPtr, srcPitch, dstPtr, dstPitch, width, height);
+}
+
+void HQ3X_16 (uint8 *srcPtr, uint32 srcPitch, uint8 *dstPtr, uint32 dstPitch, int width, int height)
+{
+	HQRun(HQ3XRows, 3, srcPtr, srcPitch, dstPtr, dstPitch, width, height);
+}
+
+void HQ4X_16 (uint8 *srcPtr, uint32 srcPitch, uint8 *dstPtr, uint32 dstPitch, int width, int height)
+{
+	HQRun(HQ4XRows, 4, srcPtr, srcPitch, dstPtr, dstPitch, width, height);
+}
+
+static void HQ2XRows (uint8 *srcPtr, uint32 srcPitch, uint8 *dstPtr, uint32 dstPitch, int width, int height)
 {
 	int	w1, w2, w3, w4, w5, w6, w7, w8, w9;
 	uint32	src1line = srcPitch >> 1;
@@ -582,10 +835,17 @@ void HQ2X_16 (uint8 *srcPtr, uint32 srcPitch, uint8 *dstPtr, uint32 dstPitch, in
 	uint16	*dp = (uint16 *) dstPtr;
 
 	uint32  pattern;
-	int		l, y;
+	int		l;
+
+	SHQRows	rows;
+	uint8	*pp;
+
+	BeginRows(&rows, sp, src1line, width);
 
 	while (height--)
 	{
+		pp = NextRow(&rows, sp, src1line, width);
+
 		sp--;
 
 		w1 = *(sp - src1line);
@@ -606,17 +866,7 @@ void HQ2X_16 (uint8 *srcPtr, uint32 srcPitch, uint8 *dstPtr, uint32 dstPitch, in
 			w6 = *(sp);
 			w9 = *(sp + src1line);
 
-			y = RGBtoYUV[w5];
-			pattern = 0;
-
-			if ((w1 != w5) && (Diff(y, RGBtoYUV[w1]))) pattern |= (1 << 0);
-			if ((w2 != w5) && (Diff(y, RGBtoYUV[w2]))) pattern |= (1 << 1);
-			if ((w3 != w5) && (Diff(y, RGBtoYUV[w3]))) pattern |= (1 << 2);
-			if ((w4 != w5) && (Diff(y, RGBtoYUV[w4]))) pattern |= (1 << 3);
-			if ((w6 != w5) && (Diff(y, RGBtoYUV[w6]))) pattern |= (1 << 4);
-			if ((w7 != w5) && (Diff(y, RGBtoYUV[w7]))) pattern |= (1 << 5);
-			if ((w8 != w5) && (Diff(y, RGBtoYUV[w8]))) pattern |= (1 << 6);
-			if ((w9 != w5) && (Diff(y, RGBtoYUV[w9]))) pattern |= (1 << 7);
+			pattern = *pp++;
 
 			switch (pattern)
 			{
@@ -3272,7 +3522,7 @@ void HQ2X_16 (uint8 *srcPtr, uint32 srcPitch, uint8 *dstPtr, uint32 dstPitch, in
 	}
 }
 
-void HQ3X_16 (uint8 *srcPtr, uint32 srcPitch, uint8 *dstPtr, uint32 dstPitch, int width, int height)
+static void HQ3XRows (uint8 *srcPtr, uint32 srcPitch, uint8 *dstPtr, uint32 dstPitch, int width, int height)
 {
 	int	w1, w2, w3, w4, w5, w6, w7, w8, w9;
 	uint32	src1line = srcPitch >> 1;
@@ -3281,10 +3531,17 @@ void HQ3X_16 (uint8 *srcPtr, uint32 srcPitch, uint8 *dstPtr, uint32 dstPitch, in
 	uint16	*dp = (uint16 *) dstPtr;
 
 	uint32  pattern;
-	int		l, y;
+	int		l;
+
+	SHQRows	rows;
+	uint8	*pp;
+
+	BeginRows(&rows, sp, src1line, width);
 
 	while (height--)
 	{
+		pp = NextRow(&rows, sp, src1line, width);
+
 		sp--;
 
 		w1 = *(sp - src1line);
@@ -3305,17 +3562,7 @@ void HQ3X_16 (uint8 *srcPtr, uint32 srcPitch, uint8 *dstPtr, uint32 dstPitch, in
 			w6 = *(sp);
 			w9 = *(sp + src1line);
 
-			y = RGBtoYUV[w5];
-			pattern = 0;
-
-			if ((w1 != w5) && (Diff(y, RGBtoYUV[w1]))) pattern |= (1 << 0);
-			if ((w2 != w5) && (Diff(y, RGBtoYUV[w2]))) pattern |= (1 << 1);
-			if ((w3 != w5) && (Diff(y, RGBtoYUV[w3]))) pattern |= (1 << 2);
-			if ((w4 != w5) && (Diff(y, RGBtoYUV[w4]))) pattern |= (1 << 3);
-			if ((w6 != w5) && (Diff(y, RGBtoYUV[w6]))) pattern |= (1 << 4);
-			if ((w7 != w5) && (Diff(y, RGBtoYUV[w7]))) pattern |= (1 << 5);
-			if ((w8 != w5) && (Diff(y, RGBtoYUV[w8]))) pattern |= (1 << 6);
-			if ((w9 != w5) && (Diff(y, RGBtoYUV[w9]))) pattern |= (1 << 7);
+			pattern = *pp++;
 
 			switch (pattern)
 			{
@@ -6944,7 +7191,7 @@ void HQ3X_16 (uint8 *srcPtr, uint32 srcPitch, uint8 *dstPtr, uint32 dstPitch, in
 	}
 }
 
-void HQ4X_16 (uint8 *srcPtr, uint32 srcPitch, uint8 *dstPtr, uint32 dstPitch, int width, int height)
+static void HQ4XRows (uint8 *srcPtr, uint32 srcPitch, uint8 *dstPtr, uint32 dstPitch, int width, int height)
 {
 	int	w1, w2, w3, w4, w5, w6, w7, w8, w9;
 	uint32	src1line = srcPitch >> 1;
@@ -6953,10 +7200,17 @@ void HQ4X_16 (uint8 *srcPtr, uint32 srcPitch, uint8 *dstPtr, uint32 dstPitch, in
 	uint16	*dp = (uint16 *) dstPtr;
 
 	uint32  pattern;
-	int		l, y;
+	int		l;
+
+	SHQRows	rows;
+	uint8	*pp;
+
+	BeginRows(&rows, sp, src1line, width);
 
 	while (height--)
 	{
+		pp = NextRow(&rows, sp, src1line, width);
+
 		sp--;
 
 		w1 = *(sp - src1line);
@@ -6977,17 +7231,7 @@ void HQ4X_16 (uint8 *srcPtr, uint32 srcPitch, uint8 *dstPtr, uint32 dstPitch, in
 			w6 = *(sp);
 			w9 = *(sp + src1line);
 
-			y = RGBtoYUV[w5];
-			pattern = 0;
-
-			if ((w1 != w5) && (Diff(y, RGBtoYUV[w1]))) pattern |= (1 << 0);
-			if ((w2 != w5) && (Diff(y, RGBtoYUV[w2]))) pattern |= (1 << 1);
-			if ((w3 != w5) && (Diff(y, RGBtoYUV[w3]))) pattern |= (1 << 2);
-			if ((w4 != w5) && (Diff(y, RGBtoYUV[w4]))) pattern |= (1 << 3);
-			if ((w6 != w5) && (Diff(y, RGBtoYUV[w6]))) pattern |= (1 << 4);
-			if ((w7 != w5) && (Diff(y, RGBtoYUV[w7]))) pattern |= (1 << 5);
-			if ((w8 != w5) && (Diff(y, RGBtoYUV[w8]))) pattern |= (1 << 6);
-			if ((w9 != w5) && (Diff(y, RGBtoYUV[w9]))) pattern |= (1 << 7);
+			pattern = *pp++;
 
 			switch (pattern)
 			{
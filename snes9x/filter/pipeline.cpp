@@ -0,0 +1,813 @@
+/***********************************************************************************
+  Snes9x - Portable Super Nintendo Entertainment System (TM) emulator.
+
+  (c) Copyright 1996 - 2002  Gary Henderson (gary.henderson@ntlworld.com),
+                             Jerremy Koot (jkoot@snes9x.com)
+
+  (c) Copyright 2002 - 2004  Matthew Kendora
+
+  (c) Copyright 2002 - 2005  Peter Bortas (peter@bortas.org)
+
+  (c) Copyright 2004 - 2005  Joel Yliluoma (http://iki.fi/bisqwit/)
+
+  (c) Copyright 2001 - 2006  John Weidman (jweidman@slip.net)
+
+  (c) Copyright 2002 - 2006  funkyass (funkyass@spam.shaw.ca),
+                             Kris Bleakley (codeviolation@hotmail.com)
+
+  (c) Copyright 2002 - 2010  Brad Jorsch (anomie@users.sourceforge.net),
+                             Nach (n-a-c-h@users.sourceforge.net),
+
+  (c) Copyright 2002 - 2011  zones (kasumitokoduck@yahoo.com)
+
+  (c) Copyright 2006 - 2007  nitsuja
+
+  (c) Copyright 2009 - 2011  BearOso,
+                             OV2
+
+
+  BS-X C emulator code
+  (c) Copyright 2005 - 2006  Dreamer Nom,
+                             zones
+
+  C4 x86 assembler and some C emulation code
+  (c) Copyright 2000 - 2003  _Demo_ (_demo_@zsnes.com),
+                             Nach,
+                             zsKnight (zsknight@zsnes.com)
+
+  C4 C++ code
+  (c) Copyright 2003 - 2006  Brad Jorsch,
+                             Nach
+
+  DSP-1 emulator code
+  (c) Copyright 1998 - 2006  _Demo_,
+                             Andreas Naive (andreasnaive@gmail.com),
+                             Gary Henderson,
+                             Ivar (ivar@snes9x.com),
+                             John Weidman,
+                             Kris Bleakley,
+                             Matthew Kendora,
+                             Nach,
+                             neviksti (neviksti@hotmail.com)
+
+  DSP-2 emulator code
+  (c) Copyright 2003         John Weidman,
+                             Kris Bleakley,
+                             Lord Nightmare (lord_nightmare@users.sourceforge.net),
+                             Matthew Kendora,
+                             neviksti
+
+  DSP-3 emulator code
+  (c) Copyright 2003 - 2006  John Weidman,
+                             Kris Bleakley,
+                             Lancer,
+                             z80 gaiden
+
+  DSP-4 emulator code
+  (c) Copyright 2004 - 2006  Dreamer Nom,
+                             John Weidman,
+                             Kris Bleakley,
+                             Nach,
+                             z80 gaiden
+
+  OBC1 emulator code
+  (c) Copyright 2001 - 2004  zsKnight,
+                             pagefault (pagefault@zsnes.com),
+                             Kris Bleakley
+                             Ported from x86 assembler to C by sanmaiwashi
+
+  SPC7110 and RTC C++ emulator code used in 1.39-1.51
+  (c) Copyright 2002         Matthew Kendora with research by
+                             zsKnight,
+                             John Weidman,
+                             Dark Force
+
+  SPC7110 and RTC C++ emulator code used in 1.52+
+  (c) Copyright 2009         byuu,
+                             neviksti
+
+  S-DD1 C emulator code
+  (c) Copyright 2003         Brad Jorsch with research by
+                             Andreas Naive,
+                             John Weidman
+
+  S-RTC C emulator code
+  (c) Copyright 2001 - 2006  byuu,
+                             John Weidman
+
+  ST010 C++ emulator code
+  (c) Copyright 2003         Feather,
+                             John Weidman,
+                             Kris Bleakley,
+                             Matthew Kendora
+
+  Super FX x86 assembler emulator code
+  (c) Copyright 1998 - 2003  _Demo_,
+                             pagefault,
+                             zsKnight
+
+  Super FX C emulator code
+  (c) Copyright 1997 - 1999  Ivar,
+                             Gary Henderson,
+                             John Weidman
+
+  Sound emulator code used in 1.5-1.51
+  (c) Copyright 1998 - 2003  Brad Martin
+  (c) Copyright 1998 - 2006  Charles Bilyue'
+
+  Sound emulator code used in 1.52+
+  (c) Copyright 2004 - 2007  Shay Green (gblargg@gmail.com)
+
+  SH assembler code partly based on x86 assembler code
+  (c) Copyright 2002 - 2004  Marcus Comstedt (marcus@mc.pp.se)
+
+  2xSaI filter
+  (c) Copyright 1999 - 2001  Derek Liauw Kie Fa
+
+  HQ2x, HQ3x, HQ4x filters
+  (c) Copyright 2003         Maxim Stepin (maxim@hiend3d.com)
+
+  NTSC filter
+  (c) Copyright 2006 - 2007  Shay Green
+
+  GTK+ GUI code
+  (c) Copyright 2004 - 2011  BearOso
+
+  Win32 GUI code
+  (c) Copyright 2003 - 2006  blip,
+                             funkyass,
+                             Matthew Kendora,
+                             Nach,
+                             nitsuja
+  (c) Copyright 2009 - 2011  OV2
+
+  Mac OS GUI code
+  (c) Copyright 1998 - 2001  John Stiles
+  (c) Copyright 2001 - 2011  zones
+
+
+  Specific ports contains the works of other authors. See headers in
+  individual files.
+
+
+  Snes9x homepage: http://www.snes9x.com/
+
+  Permission to use, copy, modify and/or distribute Snes9x in both binary
+  and source form, for non-commercial purposes, is hereby granted without
+  fee, providing that this license information and copyright notice appear
+  with all copies and any derived work.
+
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event shall the authors be held liable for any damages
+  arising from the use of this software or it's derivatives.
+
+  Snes9x is freeware for PERSONAL USE only. Commercial users should
+  seek permission of the copyright holders first. Commercial use includes,
+  but is not limited to, charging money for Snes9x or software derived from
+  Snes9x, including Snes9x or derivatives in commercial game bundles, and/or
+  using Snes9x as a promotion for your commercial product.
+
+  The copyright holders request that bug fixes and improvements to the code
+  should be forwarded to them so everyone can benefit from the modifications
+  in future versions.
+
+  Super NES and Super Nintendo Entertainment System are trademarks of
+  Nintendo Co., Limited and its subsidiary companies.
+ ***********************************************************************************/
+
+
+#include <sys/time.h>
+#include "snes9x.h"
+#include "gfx.h"
+#include "display.h"
+#include "blit.h"
+#include "workers.h"
+#include "pipeline.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#if (defined(__x86_64__) || defined(__i386__)) && (__GNUC__ >= 5 || defined(__clang__))
+#define FILTER_AVX2
+#include <immintrin.h>
+#endif
+
+#if !defined(__SSE2__) && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+#define FILTER_NEON
+#include <arm_neon.h>
+#endif
+
+#if !defined(__SSE2__) && !defined(FILTER_NEON) && defined(__wasm_simd128__)
+#define FILTER_WASM_SIMD
+#include <wasm_simd128.h>
+#endif
+
+// What the HQ and NTSC inner loops were built with; they pick the same
+// instruction set as the tests above.
+#if defined(__SSE2__)
+#define FILTER_SIMD_BUILD	FILTER_SIMD_SSE2
+#elif defined(FILTER_NEON)
+#define FILTER_SIMD_BUILD	FILTER_SIMD_NEON
+#elif defined(FILTER_WASM_SIMD)
+#define FILTER_SIMD_BUILD	FILTER_SIMD_WASM
+#else
+#define FILTER_SIMD_BUILD	FILTER_SIMD_NONE
+#endif
+
+#define FILTER_DELTA		0x01	// keeps pixel history in the shared XDelta buffer
+#define FILTER_NTSC_WIDTH	0x02	// output width comes from SNES_NTSC_OUT_WIDTH
+#define FILTER_HIRES		0x04	// two input pixels per NTSC input sample
+#define FILTER_OUT32		0x08	// writes 32-bit pixels
+
+#define BUFFER_MARGIN_ROWS	2		// 2xSaI and friends read a line above and two below
+#define BUFFER_PAD_PIXELS	8
+
+struct SFilterInfo
+{
+	const char	*name;
+	void		(*blit) (uint8 *, int, uint8 *, int, int, int);
+	int			xscale, yscale;
+	int			maxWidth;			// widest input the filter has room for, 0 if unlimited
+	uint32		flags;
+};
+
+struct SConvertJob
+{
+	const uint32	*table;
+	uint8			*src;
+	int				srcRowBytes;
+	uint8			*dst;
+	int				dstRowBytes;
+	int				width;
+};
+
+static const SFilterInfo	filters[NUM_FILTERS] =
+{
+	{ "Simple1x1",   S9xBlitPixSimple1x1,    1, 1, 0,              0                                },
+	{ "Simple1x2",   S9xBlitPixSimple1x2,    1, 2, 0,              0                                },
+	{ "Simple2x1",   S9xBlitPixSimple2x1,    2, 1, 0,              0                                },
+	{ "Simple2x2",   S9xBlitPixSimple2x2,    2, 2, 0,              FILTER_DELTA                     },
+	{ "Blend1x1",    S9xBlitPixBlend1x1,     1, 1, 0,              0                                },
+	{ "Blend2x1",    S9xBlitPixBlend2x1,     2, 1, 0,              0                                },
+	{ "TV1x2",       S9xBlitPixTV1x2,        1, 2, 0,              0                                },
+	{ "TV2x2",       S9xBlitPixTV2x2,        2, 2, 0,              FILTER_DELTA                     },
+	{ "MixedTV1x2",  S9xBlitPixMixedTV1x2,   1, 2, 0,              0                                },
+	{ "Smooth2x2",   S9xBlitPixSmooth2x2,    2, 2, SNES_WIDTH,     FILTER_DELTA                     },
+	{ "SuperEagle",  S9xBlitPixSuperEagle16, 2, 2, 0,              0                                },
+	{ "2xSaI",       S9xBlitPix2xSaI16,      2, 2, 0,              0                                },
+	{ "Super2xSaI",  S9xBlitPixSuper2xSaI16, 2, 2, 0,              0                                },
+	{ "EPX",         S9xBlitPixEPX16,        2, 2, 0,              0                                },
+	{ "HQ2x",        S9xBlitPixHQ2x16,       2, 2, MAX_SNES_WIDTH, 0                                },
+	{ "HQ3x",        S9xBlitPixHQ3x16,       3, 3, MAX_SNES_WIDTH, 0                                },
+	{ "HQ4x",        S9xBlitPixHQ4x16,       4, 4, MAX_SNES_WIDTH, 0                                },
+	{ "NTSC",        S9xBlitPixNTSC16,       1, 1, MAX_SNES_WIDTH, FILTER_NTSC_WIDTH                },
+	{ "HiResNTSC",   S9xBlitPixHiResNTSC16,  1, 1, MAX_SNES_WIDTH, FILTER_NTSC_WIDTH | FILTER_HIRES },
+	{ "RGB32",       NULL,                   1, 1, 0,              FILTER_OUT32                     }
+};
+
+static const char	*simdNames[] = { "none", "SSE2", "AVX2", "NEON", "wasm-simd" };
+
+static void (*ConvertRow565) (const uint16 *, uint32 *, int) = NULL;
+
+static inline uint32 ExpandPixel (uint32 r, uint32 g, uint32 b)
+{
+	return (((r << 3 | r >> 2) << 16) | ((g << 3 | g >> 2) << 8) | (b << 3 | b >> 2));
+}
+
+static void ConvertRow565Scalar (const uint16 *src, uint32 *dst, int width)
+{
+	for (int x = 0; x < width; x++)
+	{
+		uint32	p = src[x];
+
+		dst[x] = ExpandPixel(p >> 11, (p >> 6) & 0x1f, p & 0x1f);
+	}
+}
+
+#ifdef __SSE2__
+static void ConvertRow565SSE2 (const uint16 *src, uint32 *dst, int width)
+{
+	const __m128i	mask = _mm_set1_epi16(0x1f);
+	int				x;
+
+	for (x = 0; x + 8 <= width; x += 8)
+	{
+		__m128i	p  = _mm_loadu_si128((const __m128i *) (src + x));
+		__m128i	r  = _mm_srli_epi16(p, 11);
+		__m128i	g  = _mm_and_si128(_mm_srli_epi16(p, 6), mask);
+		__m128i	b  = _mm_and_si128(p, mask);
+		__m128i	gb;
+
+		r  = _mm_or_si128(_mm_slli_epi16(r, 3), _mm_srli_epi16(r, 2));
+		g  = _mm_or_si128(_mm_slli_epi16(g, 3), _mm_srli_epi16(g, 2));
+		b  = _mm_or_si128(_mm_slli_epi16(b, 3), _mm_srli_epi16(b, 2));
+		gb = _mm_or_si128(_mm_slli_epi16(g, 8), b);
+
+		_mm_storeu_si128((__m128i *) (dst + x),     _mm_unpacklo_epi16(gb, r));
+		_mm_storeu_si128((__m128i *) (dst + x + 4), _mm_unpackhi_epi16(gb, r));
+	}
+
+	ConvertRow565Scalar(src + x, dst + x, width - x);
+}
+#endif
+
+#ifdef FILTER_NEON
+static void ConvertRow565NEON (const uint16 *src, uint32 *dst, int width)
+{
+	const uint16x8_t	mask = vdupq_n_u16(0x1f);
+	int					x;
+
+	for (x = 0; x + 8 <= width; x += 8)
+	{
+		uint16x8_t		p = vld1q_u16(src + x);
+		uint16x8_t		r = vshrq_n_u16(p, 11);
+		uint16x8_t		g = vandq_u16(vshrq_n_u16(p, 6), mask);
+		uint16x8_t		b = vandq_u16(p, mask);
+		uint16x8x2_t	out;
+
+		r = vorrq_u16(vshlq_n_u16(r, 3), vshrq_n_u16(r, 2));
+		g = vorrq_u16(vshlq_n_u16(g, 3), vshrq_n_u16(g, 2));
+		b = vorrq_u16(vshlq_n_u16(b, 3), vshrq_n_u16(b, 2));
+
+		// Interleaving GB and R halfwords gives 0x00RRGGBB on little-endian.
+		out.val[0] = vorrq_u16(vshlq_n_u16(g, 8), b);
+		out.val[1] = r;
+		vst2q_u16((uint16_t *) (dst + x), out);
+	}
+
+	ConvertRow565Scalar(src + x, dst + x, width - x);
+}
+#endif
+
+#ifdef FILTER_WASM_SIMD
+static void ConvertRow565WASM (const uint16 *src, uint32 *dst, int width)
+{
+	const v128_t	mask = wasm_i16x8_splat(0x1f);
+	int				x;
+
+	for (x = 0; x + 8 <= width; x += 8)
+	{
+		v128_t	p  = wasm_v128_load(src + x);
+		v128_t	r  = wasm_u16x8_shr(p, 11);
+		v128_t	g  = wasm_v128_and(wasm_u16x8_shr(p, 6), mask);
+		v128_t	b  = wasm_v128_and(p, mask);
+		v128_t	gb;
+
+		r  = wasm_v128_or(wasm_i16x8_shl(r, 3), wasm_u16x8_shr(r, 2));
+		g  = wasm_v128_or(wasm_i16x8_shl(g, 3), wasm_u16x8_shr(g, 2));
+		b  = wasm_v128_or(wasm_i16x8_shl(b, 3), wasm_u16x8_shr(b, 2));
+		gb = wasm_v128_or(wasm_i16x8_shl(g, 8), b);
+
+		wasm_v128_store(dst + x,     wasm_i16x8_shuffle(gb, r, 0, 8, 1, 9, 2, 10, 3, 11));
+		wasm_v128_store(dst + x + 4, wasm_i16x8_shuffle(gb, r, 4, 12, 5, 13, 6, 14, 7, 15));
+	}
+
+	ConvertRow565Scalar(src + x, dst + x, width - x);
+}
+#endif
+
+#ifdef FILTER_AVX2
+__attribute__ ((target ("avx2")))
+static void ConvertRow565AVX2 (const uint16 *src, uint32 *dst, int width)
+{
+	const __m256i	mask = _mm256_set1_epi16(0x1f);
+	int				x;
+
+	for (x = 0; x + 16 <= width; x += 16)
+	{
+		__m256i	p  = _mm256_loadu_si256((const __m256i *) (src + x));
+		__m256i	r  = _mm256_srli_epi16(p, 11);
+		__m256i	g  = _mm256_and_si256(_mm256_srli_epi16(p, 6), mask);
+		__m256i	b  = _mm256_and_si256(p, mask);
+		__m256i	gb, lo, hi;
+
+		r  = _mm256_or_si256(_mm256_slli_epi16(r, 3), _mm256_srli_epi16(r, 2));
+		g  = _mm256_or_si256(_mm256_slli_epi16(g, 3), _mm256_srli_epi16(g, 2));
+		b  = _mm256_or_si256(_mm256_slli_epi16(b, 3), _mm256_srli_epi16(b, 2));
+		gb = _mm256_or_si256(_mm256_slli_epi16(g, 8), b);
+
+		// The unpacks work within 128-bit lanes: lo holds pixels 0-3 and 8-11.
+		lo = _mm256_unpacklo_epi16(gb, r);
+		hi = _mm256_unpackhi_epi16(gb, r);
+
+		_mm256_storeu_si256((__m256i *) (dst + x),     _mm256_permute2x128_si256(lo, hi, 0x20));
+		_mm256_storeu_si256((__m256i *) (dst + x + 8), _mm256_permute2x128_si256(lo, hi, 0x31));
+	}
+
+	ConvertRow565Scalar(src + x, dst + x, width - x);
+}
+#endif
+
+static void ConvertStrip (void *data, int first, int count)
+{
+	SConvertJob	*job = (SConvertJob *) data;
+	uint8		*src = job->src + first * job->srcRowBytes;
+	uint8		*dst = job->dst + first * job->dstRowBytes;
+
+	for (; count; count--)
+	{
+		if (job->table)
+		{
+			const uint16	*s = (const uint16 *) src;
+			uint32			*d = (uint32 *) dst;
+
+			for (int x = 0; x < job->width; x++)
+				d[x] = job->table[s[x]];
+		}
+		else
+			ConvertRow565((const uint16 *) src, (uint32 *) dst, job->width);
+
+		src += job->srcRowBytes;
+		dst += job->dstRowBytes;
+	}
+}
+
+static void ConvertFrame (const uint32 *table, uint8 *srcPtr, int srcRowBytes, uint8 *dstPtr, int dstRowBytes, int width, int height)
+{
+	SConvertJob	job;
+
+	job.table       = table;
+	job.src         = srcPtr;
+	job.srcRowBytes = srcRowBytes;
+	job.dst         = dstPtr;
+	job.dstRowBytes = dstRowBytes;
+	job.width       = width;
+
+	S9xFilterWorkersRun(ConvertStrip, &job, height);
+}
+
+// Reports the widest instruction set that 'filter' has hand-written kernels
+// for on this build and CPU. The RGB32 conversion, the HQ pattern search and
+// the NTSC row sums have SSE2, NEON and wasm-simd versions, and the RGB32
+// conversion an AVX2 one; the rest of the filters are plain C.
+int S9xFilterSIMD (int filter)
+{
+	switch (filter)
+	{
+		case FILTER_RGB32:
+		#ifdef FILTER_AVX2
+			__builtin_cpu_init();
+			if (__builtin_cpu_supports("avx2"))
+				return (FILTER_SIMD_AVX2);
+		#endif
+			return (FILTER_SIMD_BUILD);
+
+		case FILTER_HQ2X:
+		case FILTER_HQ3X:
+		case FILTER_HQ4X:
+			return (FILTER_SIMD_BUILD);
+
+		case FILTER_NTSC:
+		case FILTER_HIRESNTSC:
+		#if SNES_NTSC_OUT_DEPTH == 15 || SNES_NTSC_OUT_DEPTH == 16
+			return (FILTER_SIMD_BUILD);
+		#else
+			return (FILTER_SIMD_NONE);
+		#endif
+
+		default:
+			return (FILTER_SIMD_NONE);
+	}
+}
+
+const char * S9xFilterSIMDName (int simd)
+{
+	if (simd < 0 || simd > FILTER_SIMD_WASM)
+		return ("unknown");
+
+	return (simdNames[simd]);
+}
+
+const char * S9xFilterName (int filter)
+{
+	if (filter < 0 || filter >= NUM_FILTERS)
+		return ("unknown");
+
+	return (filters[filter].name);
+}
+
+static void SelectKernels (void)
+{
+	if (ConvertRow565)
+		return;
+
+	switch (S9xFilterSIMD(FILTER_RGB32))
+	{
+	#ifdef FILTER_AVX2
+		case FILTER_SIMD_AVX2:
+			ConvertRow565 = ConvertRow565AVX2;
+			break;
+	#endif
+	#ifdef __SSE2__
+		case FILTER_SIMD_SSE2:
+			ConvertRow565 = ConvertRow565SSE2;
+			break;
+	#endif
+	#ifdef FILTER_NEON
+		case FILTER_SIMD_NEON:
+			ConvertRow565 = ConvertRow565NEON;
+			break;
+	#endif
+	#ifdef FILTER_WASM_SIMD
+		case FILTER_SIMD_WASM:
+			ConvertRow565 = ConvertRow565WASM;
+			break;
+	#endif
+		default:
+			ConvertRow565 = ConvertRow565Scalar;
+			break;
+	}
+}
+
+// Builds the 16 to 32-bit table for the current pixel format, or leaves it out
+// if the format is RGB565, which the SIMD kernels convert arithmetically.
+static bool8 BuildColourTable (struct SFilterPipeline *p)
+{
+	bool8	rgb565 = TRUE;
+
+	p->colourTable = (uint32 *) malloc(0x10000 * sizeof(uint32));
+	if (!p->colourTable)
+		return (FALSE);
+
+	for (uint32 i = 0; i < 0x10000; i++)
+	{
+		uint32	r, g, b;
+
+		DECOMPOSE_PIXEL(i, r, g, b);
+		p->colourTable[i] = ExpandPixel(r, g, b);
+
+		if (p->colourTable[i] != ExpandPixel(i >> 11, (i >> 6) & 0x1f, i & 0x1f))
+			rgb565 = FALSE;
+	}
+
+	if (rgb565)
+	{
+		free(p->colourTable);
+		p->colourTable = NULL;
+	}
+
+	return (TRUE);
+}
+
+bool8 S9xFilterPipelineInit (struct SFilterPipeline *p, const int *stages, int count)
+{
+	int	delta = 0;
+
+	memset(p, 0, sizeof(struct SFilterPipeline));
+
+	if (count < 1 || count > FILTER_MAX_STAGES)
+		return (FALSE);
+
+	for (int i = 0; i < count; i++)
+	{
+		if (stages[i] < 0 || stages[i] >= NUM_FILTERS)
+			return (FALSE);
+
+		// Only one stage can own XDelta, and nothing reads 32-bit pixels.
+		if ((filters[stages[i]].flags & FILTER_DELTA) && ++delta > 1)
+			return (FALSE);
+		if ((filters[stages[i]].flags & FILTER_OUT32) && i != count - 1)
+			return (FALSE);
+
+		p->stage[i] = stages[i];
+	}
+
+	p->stages = count;
+	p->redrawAll = TRUE;
+
+	SelectKernels();
+
+	if ((filters[p->stage[count - 1]].flags & FILTER_OUT32) && !BuildColourTable(p))
+		return (FALSE);
+
+	return (TRUE);
+}
+
+void S9xFilterPipelineDeinit (struct SFilterPipeline *p)
+{
+	for (int i = 0; i < 2; i++)
+	{
+		free(p->buffer[i]);
+		p->buffer[i] = NULL;
+		p->bufferSize[i] = 0;
+		p->bufferPitch[i] = 0;
+	}
+
+	free(p->colourTable);
+	p->colourTable = NULL;
+	p->stages = 0;
+}
+
+static void StageOutputSize (const SFilterInfo *f, int width, int height, int *outWidth, int *outHeight)
+{
+	if (f->flags & FILTER_NTSC_WIDTH)
+		*outWidth = SNES_NTSC_OUT_WIDTH((f->flags & FILTER_HIRES) ? width >> 1 : width);
+	else
+		*outWidth = width * f->xscale;
+
+	*outHeight = height * f->yscale;
+}
+
+void S9xFilterPipelineOutputSize (const struct SFilterPipeline *p, int width, int height, int *outWidth, int *outHeight)
+{
+	for (int i = 0; i < p->stages; i++)
+		StageOutputSize(&filters[p->stage[i]], width, height, &width, &height);
+
+	*outWidth  = width;
+	*outHeight = height;
+}
+
+// Returns the first line of intermediate buffer n, with room above and below
+// for the filters that read past the frame edges. The buffer is only replaced
+// when it has to grow or its pitch changes, since the delta-aware filters rely
+// on it still holding last frame's output.
+static uint8 * StageBuffer (struct SFilterPipeline *p, int n, int width, int height, int *rowBytes)
+{
+	int	pitch = (((width + BUFFER_PAD_PIXELS) << 1) + 15) & ~15;
+	int	size  = pitch * (height + BUFFER_MARGIN_ROWS * 2);
+
+	if (size > p->bufferSize[n])
+	{
+		free(p->buffer[n]);
+		p->buffer[n] = (uint8 *) calloc(size, 1);
+		p->bufferSize[n] = p->buffer[n] ? size : 0;
+	}
+
+	if (!p->buffer[n])
+		return (NULL);
+
+	if (pitch != p->bufferPitch[n])
+	{
+		p->bufferPitch[n] = pitch;
+		S9xFilterPipelineRedraw(p);
+	}
+
+	*rowBytes = pitch;
+	return (p->buffer[n] + pitch * BUFFER_MARGIN_ROWS);
+}
+
+bool8 S9xFilterPipelineRun (struct SFilterPipeline *p, uint8 *srcPtr, int srcRowBytes, int width, int height, uint8 *dstPtr, int dstRowBytes)
+{
+	bool8	track = GFX.TrackLineChanges, ok = TRUE;
+	int		in = -1;	// intermediate buffer holding srcPtr, -1 for the caller's frame
+
+	for (int i = 0; i < p->stages && ok; i++)
+	{
+		const SFilterInfo	*f = &filters[p->stage[i]];
+		uint8				*out;
+		int					outRowBytes, outWidth, outHeight;
+
+		if ((f->maxWidth && width > f->maxWidth) ||
+			((f->flags & FILTER_DELTA) && srcRowBytes * height > BLIT_DELTA_SIZE))
+		{
+			ok = FALSE;
+			break;
+		}
+
+		StageOutputSize(f, width, height, &outWidth, &outHeight);
+
+		if (i == p->stages - 1)
+		{
+			out = dstPtr;
+			outRowBytes = dstRowBytes;
+		}
+		else
+		{
+			// Write to whichever buffer this stage isn't reading from.
+			in = (in == 0) ? 1 : 0;
+
+			if (!(out = StageBuffer(p, in, outWidth, outHeight, &outRowBytes)))
+			{
+				ok = FALSE;
+				break;
+			}
+		}
+
+		// GFX.LineChanged describes GFX.Screen, so later stages redraw in full.
+		GFX.TrackLineChanges = (i == 0 && !p->redrawAll) ? track : FALSE;
+
+		if (f->flags & FILTER_OUT32)
+			ConvertFrame(p->colourTable, srcPtr, srcRowBytes, out, outRowBytes, width, height);
+		else
+			f->blit(srcPtr, srcRowBytes, out, outRowBytes, width, height);
+
+		srcPtr      = out;
+		srcRowBytes = outRowBytes;
+		width       = outWidth;
+		height      = outHeight;
+	}
+
+	GFX.TrackLineChanges = track;
+
+	if (ok)
+		p->redrawAll = FALSE;
+
+	return (ok);
+}
+
+// Makes the next run redraw the whole frame instead of only the lines flagged
+// in GFX.LineChanged.
+void S9xFilterPipelineRedraw (struct SFilterPipeline *p)
+{
+	p->redrawAll = TRUE;
+
+	for (int i = 0; i < p->stages; i++)
+		if (filters[p->stage[i]].flags & FILTER_DELTA)
+			S9xBlitClearDelta();
+}
+
+static double Microseconds (void)
+{
+	struct timeval	tv;
+
+	gettimeofday(&tv, NULL);
+	return (tv.tv_sec * 1000000.0 + tv.tv_usec);
+}
+
+// Times every filter on its own over 'frames' frames and reports the output
+// rate through S9xMessage. Two alternating test frames that differ in every
+// pixel keep the delta-based filters from skipping work. Needs the same filter
+// init calls as the pipeline itself.
+void S9xFilterBenchmark (int frames)
+{
+	const uint32	colours = FIRST_COLOR_MASK | SECOND_COLOR_MASK | THIRD_COLOR_MASK;
+	const uint32	flip = RED_LOW_BIT_MASK | GREEN_LOW_BIT_MASK | BLUE_LOW_BIT_MASK;
+	const int		srcRowBytes = MAX_SNES_WIDTH << 1, height = SNES_HEIGHT;
+	bool8			track = GFX.TrackLineChanges;
+	uint8			*frame[2], *dst;
+	char			line[128];
+
+	if (frames < 1)
+		return;
+
+	frame[0] = (uint8 *) calloc(srcRowBytes * (height + BUFFER_MARGIN_ROWS * 2), 1);
+	frame[1] = (uint8 *) calloc(srcRowBytes * (height + BUFFER_MARGIN_ROWS * 2), 1);
+	dst      = (uint8 *) malloc((MAX_SNES_WIDTH * 4 + BUFFER_PAD_PIXELS) * 2 * height * 4);
+	if (!frame[0] || !frame[1] || !dst)
+	{
+		free(frame[0]);
+		free(frame[1]);
+		free(dst);
+		return;
+	}
+
+	// 4x4 blocks of pseudo-random colours give the edge-detecting filters a
+	// mix of flat areas and edges.
+	for (int y = 0; y < height; y++)
+	{
+		uint16	*a = (uint16 *) (frame[0] + srcRowBytes * (y + BUFFER_MARGIN_ROWS));
+		uint16	*b = (uint16 *) (frame[1] + srcRowBytes * (y + BUFFER_MARGIN_ROWS));
+
+		for (int x = 0; x < MAX_SNES_WIDTH; x++)
+		{
+			uint32	h = ((x >> 2) * 0x9e3779b1) ^ ((y >> 2) * 0x85ebca6b);
+
+			a[x] = (uint16) ((h ^ (h >> 15)) & colours);
+			b[x] = (uint16) (a[x] ^ flip);
+		}
+	}
+
+	GFX.TrackLineChanges = FALSE;
+
+	sprintf(line, "Filter benchmark: %d worker threads, %d frames", S9xFilterWorkersCount(), frames);
+	S9xMessage(S9X_INFO, S9X_FILTER_BENCHMARK, line);
+
+	for (int f = 0; f < NUM_FILTERS; f++)
+	{
+		struct SFilterPipeline	p;
+		int		width = (filters[f].flags & FILTER_HIRES) ? MAX_SNES_WIDTH : SNES_WIDTH;
+		int		outWidth, outHeight, dstRowBytes;
+		double	start, elapsed;
+
+		if (!S9xFilterPipelineInit(&p, &f, 1))
+			continue;
+
+		S9xFilterPipelineOutputSize(&p, width, height, &outWidth, &outHeight);
+		dstRowBytes = (outWidth + BUFFER_PAD_PIXELS) * ((filters[f].flags & FILTER_OUT32) ? 4 : 2);
+
+		S9xBlitClearDelta();
+		S9xFilterPipelineRun(&p, frame[1] + srcRowBytes * BUFFER_MARGIN_ROWS, srcRowBytes, width, height, dst, dstRowBytes);
+
+		start = Microseconds();
+		for (int i = 0; i < frames; i++)
+			S9xFilterPipelineRun(&p, frame[i & 1] + srcRowBytes * BUFFER_MARGIN_ROWS, srcRowBytes, width, height, dst, dstRowBytes);
+		elapsed = Microseconds() - start;
+
+		if (elapsed < 1.0)
+			elapsed = 1.0;
+
+		sprintf(line, "%-11s %-4s %4dx%-3d -> %4dx%-3d %8.3f ms/frame %9.1f Mpixel/s", filters[f].name, S9xFilterSIMDName(S9xFilterSIMD(f)),
+			width, height, outWidth, outHeight, elapsed / frames / 1000.0, (double) outWidth * outHeight * frames / elapsed);
+		S9xMessage(S9X_INFO, S9X_FILTER_BENCHMARK, line);
+
+		S9xFilterPipelineDeinit(&p);
+	}
+
+	S9xBlitClearDelta();
+	GFX.TrackLineChanges = track;
+
+	free(frame[0]);
+	free(frame[1]);
+	free(dst);
+}
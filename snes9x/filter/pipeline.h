@@ -0,0 +1,247 @@
+/***********************************************************************************
+  Snes9x - Portable Super Nintendo Entertainment System (TM) emulator.
+
+  (c) Copyright 1996 - 2002  Gary Henderson (gary.henderson@ntlworld.com),
+                             Jerremy Koot (jkoot@snes9x.com)
+
+  (c) Copyright 2002 - 2004  Matthew Kendora
+
+  (c) Copyright 2002 - 2005  Peter Bortas (peter@bortas.org)
+
+  (c) Copyright 2004 - 2005  Joel Yliluoma (http://iki.fi/bisqwit/)
+
+  (c) Copyright 2001 - 2006  John Weidman (jweidman@slip.net)
+
+  (c) Copyright 2002 - 2006  funkyass (funkyass@spam.shaw.ca),
+                             Kris Bleakley (codeviolation@hotmail.com)
+
+  (c) Copyright 2002 - 2010  Brad Jorsch (anomie@users.sourceforge.net),
+                             Nach (n-a-c-h@users.sourceforge.net),
+
+  (c) Copyright 2002 - 2011  zones (kasumitokoduck@yahoo.com)
+
+  (c) Copyright 2006 - 2007  nitsuja
+
+  (c) Copyright 2009 - 2011  BearOso,
+                             OV2
+
+
+  BS-X C emulator code
+  (c) Copyright 2005 - 2006  Dreamer Nom,
+                             zones
+
+  C4 x86 assembler and some C emulation code
+  (c) Copyright 2000 - 2003  _Demo_ (_demo_@zsnes.com),
+                             Nach,
+                             zsKnight (zsknight@zsnes.com)
+
+  C4 C++ code
+  (c) Copyright 2003 - 2006  Brad Jorsch,
+                             Nach
+
+  DSP-1 emulator code
+  (c) Copyright 1998 - 2006  _Demo_,
+                             Andreas Naive (andreasnaive@gmail.com),
+                             Gary Henderson,
+                             Ivar (ivar@snes9x.com),
+                             John Weidman,
+                             Kris Bleakley,
+                             Matthew Kendora,
+                             Nach,
+                             neviksti (neviksti@hotmail.com)
+
+  DSP-2 emulator code
+  (c) Copyright 2003         John Weidman,
+                             Kris Bleakley,
+                             Lord Nightmare (lord_nightmare@users.sourceforge.net),
+                             Matthew Kendora,
+                             neviksti
+
+  DSP-3 emulator code
+  (c) Copyright 2003 - 2006  John Weidman,
+                             Kris Bleakley,
+                             Lancer,
+                             z80 gaiden
+
+  DSP-4 emulator code
+  (c) Copyright 2004 - 2006  Dreamer Nom,
+                             John Weidman,
+                             Kris Bleakley,
+                             Nach,
+                             z80 gaiden
+
+  OBC1 emulator code
+  (c) Copyright 2001 - 2004  zsKnight,
+                             pagefault (pagefault@zsnes.com),
+                             Kris Bleakley
+                             Ported from x86 assembler to C by sanmaiwashi
+
+  SPC7110 and RTC C++ emulator code used in 1.39-1.51
+  (c) Copyright 2002         Matthew Kendora with research by
+                             zsKnight,
+                             John Weidman,
+                             Dark Force
+
+  SPC7110 and RTC C++ emulator code used in 1.52+
+  (c) Copyright 2009         byuu,
+                             neviksti
+
+  S-DD1 C emulator code
+  (c) Copyright 2003         Brad Jorsch with research by
+                             Andreas Naive,
+                             John Weidman
+
+  S-RTC C emulator code
+  (c) Copyright 2001 - 2006  byuu,
+                             John Weidman
+
+  ST010 C++ emulator code
+  (c) Copyright 2003         Feather,
+                             John Weidman,
+                             Kris Bleakley,
+                             Matthew Kendora
+
+  Super FX x86 assembler emulator code
+  (c) Copyright 1998 - 2003  _Demo_,
+                             pagefault,
+                             zsKnight
+
+  Super FX C emulator code
+  (c) Copyright 1997 - 1999  Ivar,
+                             Gary Henderson,
+                             John Weidman
+
+  Sound emulator code used in 1.5-1.51
+  (c) Copyright 1998 - 2003  Brad Martin
+  (c) Copyright 1998 - 2006  Charles Bilyue'
+
+  Sound emulator code used in 1.52+
+  (c) Copyright 2004 - 2007  Shay Green (gblargg@gmail.com)
+
+  SH assembler code partly based on x86 assembler code
+  (c) Copyright 2002 - 2004  Marcus Comstedt (marcus@mc.pp.se)
+
+  2xSaI filter
+  (c) Copyright 1999 - 2001  Derek Liauw Kie Fa
+
+  HQ2x, HQ3x, HQ4x filters
+  (c) Copyright 2003         Maxim Stepin (maxim@hiend3d.com)
+
+  NTSC filter
+  (c) Copyright 2006 - 2007  Shay Green
+
+  GTK+ GUI code
+  (c) Copyright 2004 - 2011  BearOso
+
+  Win32 GUI code
+  (c) Copyright 2003 - 2006  blip,
+                             funkyass,
+                             Matthew Kendora,
+                             Nach,
+                             nitsuja
+  (c) Copyright 2009 - 2011  OV2
+
+  Mac OS GUI code
+  (c) Copyright 1998 - 2001  John Stiles
+  (c) Copyright 2001 - 2011  zones
+
+
+  Specific ports contains the works of other authors. See headers in
+  individual files.
+
+
+  Snes9x homepage: http://www.snes9x.com/
+
+  Permission to use, copy, modify and/or distribute Snes9x in both binary
+  and source form, for non-commercial purposes, is hereby granted without
+  fee, providing that this license information and copyright notice appear
+  with all copies and any derived work.
+
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event shall the authors be held liable for any damages
+  arising from the use of this software or it's derivatives.
+
+  Snes9x is freeware for PERSONAL USE only. Commercial users should
+  seek permission of the copyright holders first. Commercial use includes,
+  but is not limited to, charging money for Snes9x or software derived from
+  Snes9x, including Snes9x or derivatives in commercial game bundles, and/or
+  using Snes9x as a promotion for your commercial product.
+
+  The copyright holders request that bug fixes and improvements to the code
+  should be forwarded to them so everyone can benefit from the modifications
+  in future versions.
+
+  Super NES and Super Nintendo Entertainment System are trademarks of
+  Nintendo Co., Limited and its subsidiary companies.
+ ***********************************************************************************/
+
+
+#ifndef _pipeline_h_
+#define _pipeline_h_
+
+// Stages a pipeline can chain. All of them take 16-bit pixels in the current
+// render pixel format; FILTER_RGB32 converts them to 32-bit 0x00RRGGBB and has
+// to be the last stage.
+enum
+{
+	FILTER_SIMPLE1X1,
+	FILTER_SIMPLE1X2,
+	FILTER_SIMPLE2X1,
+	FILTER_SIMPLE2X2,
+	FILTER_BLEND1X1,
+	FILTER_BLEND2X1,
+	FILTER_TV1X2,
+	FILTER_TV2X2,
+	FILTER_MIXEDTV1X2,
+	FILTER_SMOOTH2X2,
+	FILTER_SUPEREAGLE,
+	FILTER_2XSAI,
+	FILTER_SUPER2XSAI,
+	FILTER_EPX,
+	FILTER_HQ2X,
+	FILTER_HQ3X,
+	FILTER_HQ4X,
+	FILTER_NTSC,
+	FILTER_HIRESNTSC,
+	FILTER_RGB32,
+	NUM_FILTERS
+};
+
+enum
+{
+	FILTER_SIMD_NONE,
+	FILTER_SIMD_SSE2,
+	FILTER_SIMD_AVX2,
+	FILTER_SIMD_NEON,
+	FILTER_SIMD_WASM
+};
+
+#define FILTER_MAX_STAGES	4
+
+struct SFilterPipeline
+{
+	int		stages;
+	int		stage[FILTER_MAX_STAGES];
+	uint8	*buffer[2];				// intermediate frames, kept between runs
+	int		bufferSize[2];
+	int		bufferPitch[2];
+	uint32	*colourTable;			// FILTER_RGB32 lookup, NULL when the pixel format is RGB565
+	bool8	redrawAll;				// next run ignores GFX.LineChanged
+};
+
+// The port calls S9xFilterPipelineRun from S9xDeinitUpdate with GFX.Screen as
+// the source. The filters' own init functions (S9xBlitFilterInit,
+// S9xBlitHQ2xFilterInit, S9xBlitNTSCFilterInit) still have to be called for
+// the stages in use. S9xFilterPipelineRedraw has to be called whenever the
+// destination's contents are lost or something else has drawn into it.
+bool8 S9xFilterPipelineInit (struct SFilterPipeline *, const int *, int);
+void S9xFilterPipelineDeinit (struct SFilterPipeline *);
+void S9xFilterPipelineOutputSize (const struct SFilterPipeline *, int, int, int *, int *);
+bool8 S9xFilterPipelineRun (struct SFilterPipeline *, uint8 *, int, int, int, uint8 *, int);
+void S9xFilterPipelineRedraw (struct SFilterPipeline *);
+const char * S9xFilterName (int);
+int S9xFilterSIMD (int);
+const char * S9xFilterSIMDName (int);
+void S9xFilterBenchmark (int);
+
+#endif
@@ -133,7 +133,9 @@ statement in a block (unless you're using C++). */
 /* private */
 enum { snes_ntsc_entry_size = 128 };
 enum { snes_ntsc_palette_size = 0x2000 };
-typedef unsigned long snes_ntsc_rgb_t;
+/* Packed values only ever use the low 32 bits; a 32-bit type halves the table
+on LP64 hosts and lets the blitter add four entries at once. */
+typedef unsigned int snes_ntsc_rgb_t;
 struct snes_ntsc_t {
 	snes_ntsc_rgb_t table [snes_ntsc_palette_size] [snes_ntsc_entry_size];
 };
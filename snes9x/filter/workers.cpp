@@ -0,0 +1,349 @@
+/***********************************************************************************
+  Snes9x - Portable Super Nintendo Entertainment System (TM) emulator.
+
+  (c) Copyright 1996 - 2002  Gary Henderson (gary.henderson@ntlworld.com),
+                             Jerremy Koot (jkoot@snes9x.com)
+
+  (c) Copyright 2002 - 2004  Matthew Kendora
+
+  (c) Copyright 2002 - 2005  Peter Bortas (peter@bortas.org)
+
+  (c) Copyright 2004 - 2005  Joel Yliluoma (http://iki.fi/bisqwit/)
+
+  (c) Copyright 2001 - 2006  John Weidman (jweidman@slip.net)
+
+  (c) Copyright 2002 - 2006  funkyass (funkyass@spam.shaw.ca),
+                             Kris Bleakley (codeviolation@hotmail.com)
+
+  (c) Copyright 2002 - 2010  Brad Jorsch (anomie@users.sourceforge.net),
+                             Nach (n-a-c-h@users.sourceforge.net),
+
+  (c) Copyright 2002 - 2011  zones (kasumitokoduck@yahoo.com)
+
+  (c) Copyright 2006 - 2007  nitsuja
+
+  (c) Copyright 2009 - 2011  BearOso,
+                             OV2
+
+
+  BS-X C emulator code
+  (c) Copyright 2005 - 2006  Dreamer Nom,
+                             zones
+
+  C4 x86 assembler and some C emulation code
+  (c) Copyright 2000 - 2003  _Demo_ (_demo_@zsnes.com),
+                             Nach,
+                             zsKnight (zsknight@zsnes.com)
+
+  C4 C++ code
+  (c) Copyright 2003 - 2006  Brad Jorsch,
+                             Nach
+
+  DSP-1 emulator code
+  (c) Copyright 1998 - 2006  _Demo_,
+                             Andreas Naive (andreasnaive@gmail.com),
+                             Gary Henderson,
+                             Ivar (ivar@snes9x.com),
+                             John Weidman,
+                             Kris Bleakley,
+                             Matthew Kendora,
+                             Nach,
+                             neviksti (neviksti@hotmail.com)
+
+  DSP-2 emulator code
+  (c) Copyright 2003         John Weidman,
+                             Kris Bleakley,
+                             Lord Nightmare (lord_nightmare@users.sourceforge.net),
+                             Matthew Kendora,
+                             neviksti
+
+  DSP-3 emulator code
+  (c) Copyright 2003 - 2006  John Weidman,
+                             Kris Bleakley,
+                             Lancer,
+                             z80 gaiden
+
+  DSP-4 emulator code
+  (c) Copyright 2004 - 2006  Dreamer Nom,
+                             John Weidman,
+                             Kris Bleakley,
+                             Nach,
+                             z80 gaiden
+
+  OBC1 emulator code
+  (c) Copyright 2001 - 2004  zsKnight,
+                             pagefault (pagefault@zsnes.com),
+                             Kris Bleakley
+                             Ported from x86 assembler to C by sanmaiwashi
+
+  SPC7110 and RTC C++ emulator code used in 1.39-1.51
+  (c) Copyright 2002         Matthew Kendora with research by
+                             zsKnight,
+                             John Weidman,
+                             Dark Force
+
+  SPC7110 and RTC C++ emulator code used in 1.52+
+  (c) Copyright 2009         byuu,
+                             neviksti
+
+  S-DD1 C emulator code
+  (c) Copyright 2003         Brad Jorsch with research by
+                             Andreas Naive,
+                             John Weidman
+
+  S-RTC C emulator code
+  (c) Copyright 2001 - 2006  byuu,
+                             John Weidman
+
+  ST010 C++ emulator code
+  (c) Copyright 2003         Feather,
+                             John Weidman,
+                             Kris Bleakley,
+                             Matthew Kendora
+
+  Super FX x86 assembler emulator code
+  (c) Copyright 1998 - 2003  _Demo_,
+                             pagefault,
+                             zsKnight
+
+  Super FX C emulator code
+  (c) Copyright 1997 - 1999  Ivar,
+                             Gary Henderson,
+                             John Weidman
+
+  Sound emulator code used in 1.5-1.51
+  (c) Copyright 1998 - 2003  Brad Martin
+  (c) Copyright 1998 - 2006  Charles Bilyue'
+
+  Sound emulator code used in 1.52+
+  (c) Copyright 2004 - 2007  Shay Green (gblargg@gmail.com)
+
+  SH assembler code partly based on x86 assembler code
+  (c) Copyright 2002 - 2004  Marcus Comstedt (marcus@mc.pp.se)
+
+  2xSaI filter
+  (c) Copyright 1999 - 2001  Derek Liauw Kie Fa
+
+  HQ2x, HQ3x, HQ4x filters
+  (c) Copyright 2003         Maxim Stepin (maxim@hiend3d.com)
+
+  NTSC filter
+  (c) Copyright 2006 - 2007  Shay Green
+
+  GTK+ GUI code
+  (c) Copyright 2004 - 2011  BearOso
+
+  Win32 GUI code
+  (c) Copyright 2003 - 2006  blip,
+                             funkyass,
+                             Matthew Kendora,
+                             Nach,
+                             nitsuja
+  (c) Copyright 2009 - 2011  OV2
+
+  Mac OS GUI code
+  (c) Copyright 1998 - 2001  John Stiles
+  (c) Copyright 2001 - 2011  zones
+
+
+  Specific ports contains the works of other authors. See headers in
+  individual files.
+
+
+  Snes9x homepage: http://www.snes9x.com/
+
+  Permission to use, copy, modify and/or distribute Snes9x in both binary
+  and source form, for non-commercial purposes, is hereby granted without
+  fee, providing that this license information and copyright notice appear
+  with all copies and any derived work.
+
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event shall the authors be held liable for any damages
+  arising from the use of this software or it's derivatives.
+
+  Snes9x is freeware for PERSONAL USE only. Commercial users should
+  seek permission of the copyright holders first. Commercial use includes,
+  but is not limited to, charging money for Snes9x or software derived from
+  Snes9x, including Snes9x or derivatives in commercial game bundles, and/or
+  using Snes9x as a promotion for your commercial product.
+
+  The copyright holders request that bug fixes and improvements to the code
+  should be forwarded to them so everyone can benefit from the modifications
+  in future versions.
+
+  Super NES and Super Nintendo Entertainment System are trademarks of
+  Nintendo Co., Limited and its subsidiary companies.
+ ***********************************************************************************/
+
+
+#include "snes9x.h"
+#include "workers.h"
+
+#ifdef USE_THREADS
+#include <pthread.h>
+#include <unistd.h>
+
+#define MAX_WORKERS			16
+#define MIN_STRIP_ROWS		16
+
+static pthread_t		threads[MAX_WORKERS];
+static int				num_threads = 0;
+static pthread_mutex_t	job_lock  = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t	job_start = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t	job_done  = PTHREAD_COND_INITIALIZER;
+
+static struct
+{
+	S9xStripJob	func;
+	void		*data;
+	int			rows;
+	int			strip_rows;
+	int			strips;
+	int			next;
+	int			finished;
+	uint32		generation;
+	bool8		quit;
+}	job;
+
+// Called and returns with job_lock held.
+static void RunStrips (void)
+{
+	while (job.next < job.strips)
+	{
+		int	first = job.next++ * job.strip_rows;
+		int	count = job.rows - first;
+		if (count > job.strip_rows)
+			count = job.strip_rows;
+
+		pthread_mutex_unlock(&job_lock);
+		job.func(job.data, first, count);
+		pthread_mutex_lock(&job_lock);
+
+		if (++job.finished == job.strips)
+			pthread_cond_signal(&job_done);
+	}
+}
+
+static void * WorkerThread (void *)
+{
+	uint32	seen = 0;
+
+	pthread_mutex_lock(&job_lock);
+
+	for (;;)
+	{
+		while (job.generation == seen && !job.quit)
+			pthread_cond_wait(&job_start, &job_lock);
+
+		if (job.quit)
+			break;
+
+		seen = job.generation;
+		RunStrips();
+	}
+
+	pthread_mutex_unlock(&job_lock);
+
+	return (NULL);
+}
+
+bool8 S9xFilterWorkersInit (int count)
+{
+	if (num_threads)
+		return (TRUE);
+
+	// The calling thread always takes strips too, so it is not counted.
+	if (count <= 0)
+		count = (int) sysconf(_SC_NPROCESSORS_ONLN) - 1;
+	if (count > MAX_WORKERS)
+		count = MAX_WORKERS;
+
+	job.quit = FALSE;
+
+	for (int i = 0; i < count; i++)
+	{
+		if (pthread_create(&threads[i], NULL, WorkerThread, NULL) != 0)
+			break;
+		num_threads++;
+	}
+
+	return (num_threads == count);
+}
+
+void S9xFilterWorkersDeinit (void)
+{
+	if (!num_threads)
+		return;
+
+	pthread_mutex_lock(&job_lock);
+	job.quit = TRUE;
+	pthread_cond_broadcast(&job_start);
+	pthread_mutex_unlock(&job_lock);
+
+	for (int i = 0; i < num_threads; i++)
+		pthread_join(threads[i], NULL);
+
+	num_threads = 0;
+}
+
+int S9xFilterWorkersCount (void)
+{
+	return (num_threads + 1);
+}
+
+void S9xFilterWorkersRun (S9xStripJob func, void *data, int rows)
+{
+	int	strips = num_threads + 1;
+	if (strips > rows / MIN_STRIP_ROWS)
+		strips = rows / MIN_STRIP_ROWS;
+
+	if (strips <= 1)
+	{
+		func(data, 0, rows);
+		return;
+	}
+
+	pthread_mutex_lock(&job_lock);
+
+	job.func       = func;
+	job.data       = data;
+	job.rows       = rows;
+	job.strips     = strips;
+	job.strip_rows = (rows + strips - 1) / strips;
+	job.strips     = (rows + job.strip_rows - 1) / job.strip_rows;
+	job.next       = 0;
+	job.finished   = 0;
+	job.generation++;
+
+	pthread_cond_broadcast(&job_start);
+	RunStrips();
+
+	while (job.finished < job.strips)
+		pthread_cond_wait(&job_done, &job_lock);
+
+	pthread_mutex_unlock(&job_lock);
+}
+
+#else
+
+bool8 S9xFilterWorkersInit (int count)
+{
+	return (TRUE);
+}
+
+void S9xFilterWorkersDeinit (void)
+{
+	return;
+}
+
+int S9xFilterWorkersCount (void)
+{
+	return (1);
+}
+
+void S9xFilterWorkersRun (S9xStripJob func, void *data, int rows)
+{
+	func(data, 0, rows);
+}
+
+#endif
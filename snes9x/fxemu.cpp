@@ -180,6 +180,7 @@
 #include "memmap.h"
 #include "fxinst.h"
 #include "fxemu.h"
+#include "profile.h"
 
 static void FxReset (struct FxInfo_s *);
 static void fx_readRegisterSpace (void);
@@ -547,6 +548,8 @@ static bool8 fx_checkStartAddress (void)
 // Execute until the next stop instruction
 static uint32 FxEmulate (uint32 nInstructions)
 {
+	S9X_PROFILE(PROFILE_SUPERFX);
+
 	uint32	vCount;
 
 	// Read registers and initialize GSU session
@@ -195,7 +195,7 @@ struct FxInfo_s
 	bool8	oneLineDone;
 };
 
-extern struct FxInfo_s	SuperFX;
+extern CONTEXT_LOCAL struct FxInfo_s	SuperFX;
 
 void S9xInitSuperFX (void);
 void S9xResetSuperFX (void);
@@ -374,7 +374,7 @@ struct FxRegs_s
 	uint8	*avRegAddr;					// To reference avReg in snapshot.cpp
 };
 
-extern struct FxRegs_s	GSU;
+extern CONTEXT_LOCAL struct FxRegs_s	GSU;
 
 // GSU registers
 #define GSU_R0			0x000
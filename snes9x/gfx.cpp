@@ -188,10 +188,11 @@
 #endif
 #include "font.h"
 #include "display.h"
+#include "profile.h"
 
-extern struct SCheatData		Cheat;
-extern struct SLineData			LineData[240];
-extern struct SLineMatrixData	LineMatrixData[240];
+extern CONTEXT_LOCAL struct SCheatData		Cheat;
+extern CONTEXT_LOCAL struct SLineData			LineData[240];
+extern CONTEXT_LOCAL struct SLineMatrixData	LineMatrixData[240];
 
 void S9xComputeClipWindows (void);
 
@@ -199,6 +200,7 @@ static int	font_width = 8, font_height = 9;
 
 static void SetupOBJ (void);
 static void DrawOBJS (int);
+static void HashRenderedLines (uint32, uint32);
 static void DisplayFrameRate (void);
 #ifdef fancy
 static void DisplayPressedKeys (void);
@@ -408,6 +410,61 @@ void S9xStartScreenRefresh (void)
 	IPPU.TotalEmulatedFrames++;
 }
 
+// Line change tracking for ports that set GFX.TrackLineChanges. Each output
+// line is hashed as S9xUpdateScreen finishes drawing it and flagged when it
+// differs from what was drawn there before; code that draws over the image
+// afterwards flags its lines with S9xMarkLinesChanged. The flags build up
+// over both fields of an interlaced frame and are only cleared once the
+// whole frame has been handed to S9xDeinitUpdate.
+static void HashRenderedLines (uint32 first, uint32 last)
+{
+	int		width = IPPU.RenderedScreenWidth;
+	uint64	seed = ((uint64) width << 32) | IPPU.RenderedScreenHeight;
+
+	for (uint32 l = first; l <= last; l++)
+	{
+		uint16	*s = GFX.Screen + l * GFX.PPL;
+		if (GFX.DoInterlace && GFX.InterlaceFrame)
+			s += GFX.RealPPL;
+
+		int	y = (s - GFX.Screen) / GFX.RealPPL;
+		if (y >= MAX_SNES_HEIGHT)
+			break;
+
+		uint32	*p = (uint32 *) s;
+		uint64	h = seed;
+
+		for (int x = 0; x < (width >> 1); x++)
+			h = (h ^ p[x]) * 0x100000001b3ULL;
+
+		if (h != GFX.LineHash[y])
+		{
+			GFX.LineChanged[y] = TRUE;
+			GFX.LineHash[y] = h;
+		}
+	}
+}
+
+void S9xMarkLinesChanged (int first, int count)
+{
+	if (first < 0)
+	{
+		count += first;
+		first = 0;
+	}
+
+	if (first + count > MAX_SNES_HEIGHT)
+		count = MAX_SNES_HEIGHT - first;
+
+	// A zero hash can't match the next render of these lines, so whatever
+	// was drawn over them is also cleared from the port's copy next frame.
+	for (int y = first; y < first + count; y++)
+	{
+		GFX.LineChanged[y] = TRUE;
+		GFX.LineHash[y] = 0;
+	}
+}
+
 void S9xEndScreenRefresh (void)
 {
 	if (IPPU.RenderThisFrame)
@@ -438,6 +495,9 @@ void S9xEndScreenRefresh (void)
 				S9xDisplayMessages(GFX.Screen, GFX.RealPPL, IPPU.RenderedScreenWidth, IPPU.RenderedScreenHeight, 1);
 
 			S9xDeinitUpdate(IPPU.RenderedScreenWidth, IPPU.RenderedScreenHeight);
+
+			if (GFX.TrackLineChanges)
+				memset(GFX.LineChanged, 0, sizeof(GFX.LineChanged));
 		}
 	}
 	else
@@ -523,6 +583,8 @@ void RenderLine (uint8 C)
 
 static inline void RenderScreen (bool8 sub)
 {
+	S9X_PROFILE(PROFILE_RENDER);
+
 	uint8	BGActive;
 	int		D;
 
@@ -711,6 +773,7 @@ void S9xUpdateScreen (void)
 
 				IPPU.DoubleWidthPixels = TRUE;
 				IPPU.RenderedScreenWidth = 512;
+				S9xMarkLinesChanged(0, MAX_SNES_HEIGHT);
 			}
 
 			if (!IPPU.DoubleHeightPixels && IPPU.Interlace && (PPU.BGMode == 5 || PPU.BGMode == 6))
@@ -722,6 +785,8 @@ void S9xUpdateScreen (void)
 
 				for (int32 y = (int32) GFX.StartY - 1; y >= 0; y--)
 					memmove(GFX.Screen + y * GFX.PPL, GFX.Screen + y * GFX.RealPPL, IPPU.RenderedScreenWidth * sizeof(uint16));
+
+				S9xMarkLinesChanged(0, MAX_SNES_HEIGHT);
 			}
 		}
 
@@ -749,6 +814,9 @@ void S9xUpdateScreen (void)
 				GFX.S[x] = black;
 	}
 
+	if (GFX.TrackLineChanges)
+		HashRenderedLines(GFX.StartY, GFX.EndY);
+
 	IPPU.PreviousLine = IPPU.CurrentLine;
 }
 
@@ -1987,6 +2055,8 @@ static void DisplayStringFromBottom (const char *string, int linesFromBottom, in
 
 	uint16	*dst = GFX.Screen + (IPPU.RenderedScreenHeight - font_height * linesFromBottom) * GFX.RealPPL + pixelsFromLeft;
 
+	S9xMarkLinesChanged(IPPU.RenderedScreenHeight - font_height * linesFromBottom, font_height * linesFromBottom);
+
 	int	len = strlen(string);
 	int	max_chars = IPPU.RenderedScreenWidth / (font_width - 1);
 	int	char_count = 0;
@@ -2016,8 +2086,8 @@ static void DisplayStringFromBottom (const char *string, int linesFromBottom, in
 static void DisplayFrameRate (void)
 {
 	char	string[10];
-	static uint32 lastFrameCount = 0, calcFps = 0;
-	static time_t lastTime = time(NULL);
+	static CONTEXT_LOCAL uint32 lastFrameCount = 0, calcFps = 0;
+	static CONTEXT_LOCAL time_t lastTime = 0;
 
 	time_t currTime = time(NULL);
 	if (lastTime != currTime) {
@@ -2248,6 +2318,8 @@ void S9xDrawCrosshair (const char *crosshair, uint8 fgcolor, uint8 bgcolor, int1
 
 	uint16	*s = GFX.Screen + y * (int32)GFX.RealPPL + x;
 
+	S9xMarkLinesChanged(y, 15 * rx);
+
 	for (r = 0; r < 15 * rx; r++, s += GFX.RealPPL - 15 * cx)
 	{
 		if (y + r < 0)
@@ -221,6 +221,10 @@ struct SGFX
 		}	OBJ[32];
 	}	OBJLines[SNES_HEIGHT_EXTENDED];
 
+	bool8	TrackLineChanges;				// set by the port to have LineChanged filled in
+	bool8	LineChanged[MAX_SNES_HEIGHT];	// line redrawn with new contents since the last S9xDeinitUpdate
+	uint64	LineHash[MAX_SNES_HEIGHT];		// hash of what the renderer last drew on each line
+
 #ifdef GFX_MULTI_FORMAT
 	uint32	PixelFormat;
 	uint32	(*BuildPixel) (uint32, uint32, uint32);
@@ -294,11 +298,11 @@ struct SLineMatrixData
 	short	M7VOFS;
 };
 
-extern uint16		BlackColourMap[256];
-extern uint16		DirectColourMaps[8][256];
+extern CONTEXT_LOCAL uint16		BlackColourMap[256];
+extern CONTEXT_LOCAL uint16		DirectColourMaps[8][256];
 extern uint8		mul_brightness[16][32];
-extern struct SBG	BG;
-extern struct SGFX	GFX;
+extern CONTEXT_LOCAL struct SBG	BG;
+extern CONTEXT_LOCAL struct SGFX	GFX;
 
 #define H_FLIP		0x4000
 #define V_FLIP		0x8000
@@ -345,6 +349,7 @@ void S9xBuildDirectColourMaps (void);
 void RenderLine (uint8);
 void S9xComputeClipWindows (void);
 void S9xDisplayChar (uint16 *, uint8);
+void S9xMarkLinesChanged (int, int);
 // called automatically unless Settings.AutoDisplayMessages is false
 void S9xDisplayMessages (uint16 *, int, int, int, int);
 #ifdef GFX_MULTI_FORMAT
@@ -192,80 +192,82 @@
 #include "missing.h"
 #endif
 
-struct SCPUState		CPU;
-struct SICPU			ICPU;
-struct SRegisters		Registers;
-struct SPPU				PPU;
-struct InternalPPU		IPPU;
-struct SDMA				DMA[8];
-struct STimings			Timings;
-struct SGFX				GFX;
-struct SBG				BG;
-struct SLineData		LineData[240];
-struct SLineMatrixData	LineMatrixData[240];
-struct SDSP0			DSP0;
-struct SDSP1			DSP1;
-struct SDSP2			DSP2;
-struct SDSP3			DSP3;
-struct SDSP4			DSP4;
-struct SSA1				SA1;
-struct SSA1Registers	SA1Registers;
-struct FxRegs_s			GSU;
-struct FxInfo_s			SuperFX;
-struct SST010			ST010;
-struct SST011			ST011;
-struct SST018			ST018;
-struct SOBC1			OBC1;
-struct SSPC7110Snapshot	s7snap;
-struct SSRTCSnapshot	srtcsnap;
-struct SRTCData			RTCData;
-struct SBSX				BSX;
-struct SMulti			Multi;
-struct SSettings		Settings;
-struct SSNESGameFixes	SNESGameFixes;
+CONTEXT_LOCAL struct SCPUState		CPU;
+CONTEXT_LOCAL struct SICPU			ICPU;
+CONTEXT_LOCAL struct SRegisters		Registers;
+CONTEXT_LOCAL struct SPPU				PPU;
+CONTEXT_LOCAL struct InternalPPU		IPPU;
+CONTEXT_LOCAL struct SDMA				DMA[8];
+CONTEXT_LOCAL struct STimings			Timings;
+CONTEXT_LOCAL struct SGFX				GFX;
+CONTEXT_LOCAL struct SBG				BG;
+CONTEXT_LOCAL struct SLineData		LineData[240];
+CONTEXT_LOCAL struct SLineMatrixData	LineMatrixData[240];
+CONTEXT_LOCAL struct SDSP0			DSP0;
+CONTEXT_LOCAL struct SDSP1			DSP1;
+CONTEXT_LOCAL struct SDSP2			DSP2;
+CONTEXT_LOCAL struct SDSP3			DSP3;
+CONTEXT_LOCAL struct SDSP4			DSP4;
+CONTEXT_LOCAL struct SSA1				SA1;
+CONTEXT_LOCAL struct SSA1Registers	SA1Registers;
+CONTEXT_LOCAL struct FxRegs_s			GSU;
+CONTEXT_LOCAL struct FxInfo_s			SuperFX;
+CONTEXT_LOCAL struct SST010			ST010;
+CONTEXT_LOCAL struct SST011			ST011;
+CONTEXT_LOCAL struct SST018			ST018;
+CONTEXT_LOCAL struct SOBC1			OBC1;
+CONTEXT_LOCAL struct SSPC7110Snapshot	s7snap;
+CONTEXT_LOCAL struct SSRTCSnapshot	srtcsnap;
+CONTEXT_LOCAL struct SRTCData			RTCData;
+CONTEXT_LOCAL struct SBSX				BSX;
+CONTEXT_LOCAL struct SMulti			Multi;
+CONTEXT_LOCAL struct SSettings		Settings;
+CONTEXT_LOCAL struct SSNESGameFixes	SNESGameFixes;
 #ifdef NETPLAY_SUPPORT
 struct SNetPlay			NetPlay;
 #endif
 #ifdef DEBUGGER
-struct Missing			missing;
+CONTEXT_LOCAL struct Missing			missing;
 #endif
-struct SCheatData		Cheat;
-struct Watch			watches[16];
-CMemory					Memory;
-
-char	String[513];
-uint8	OpenBus = 0;
-uint8	*HDMAMemPointers[8];
-uint16	BlackColourMap[256];
-uint16	DirectColourMaps[8][256];
+CONTEXT_LOCAL struct SCheatData		Cheat;
+CONTEXT_LOCAL struct Watch			watches[16];
+CONTEXT_LOCAL struct SWatchpoint		Watchpoints[MAX_WATCHPOINTS];
+CONTEXT_LOCAL void					(*S9xWatchpointHook) (uint32, uint8, uint8) = NULL;
+CONTEXT_LOCAL CMemory					Memory;
+
+CONTEXT_LOCAL char	String[513];
+CONTEXT_LOCAL uint8	OpenBus = 0;
+CONTEXT_LOCAL uint8	*HDMAMemPointers[8];
+CONTEXT_LOCAL uint16	BlackColourMap[256];
+CONTEXT_LOCAL uint16	DirectColourMaps[8][256];
 
 SnesModel	M1SNES = { 1, 3, 2 };
 SnesModel	M2SNES = { 2, 4, 3 };
-SnesModel	*Model = &M1SNES;
+CONTEXT_LOCAL SnesModel	*Model = &M1SNES;
 
 #ifdef GFX_MULTI_FORMAT
-uint32	RED_LOW_BIT_MASK           = RED_LOW_BIT_MASK_RGB565;
-uint32	GREEN_LOW_BIT_MASK         = GREEN_LOW_BIT_MASK_RGB565;
-uint32	BLUE_LOW_BIT_MASK          = BLUE_LOW_BIT_MASK_RGB565;
-uint32	RED_HI_BIT_MASK            = RED_HI_BIT_MASK_RGB565;
-uint32	GREEN_HI_BIT_MASK          = GREEN_HI_BIT_MASK_RGB565;
-uint32	BLUE_HI_BIT_MASK           = BLUE_HI_BIT_MASK_RGB565;
-uint32	MAX_RED                    = MAX_RED_RGB565;
-uint32	MAX_GREEN                  = MAX_GREEN_RGB565;
-uint32	MAX_BLUE                   = MAX_BLUE_RGB565;
-uint32	SPARE_RGB_BIT_MASK         = SPARE_RGB_BIT_MASK_RGB565;
-uint32	GREEN_HI_BIT               = (MAX_GREEN_RGB565 + 1) >> 1;
-uint32	RGB_LOW_BITS_MASK          = (RED_LOW_BIT_MASK_RGB565 | GREEN_LOW_BIT_MASK_RGB565 | BLUE_LOW_BIT_MASK_RGB565);
-uint32	RGB_HI_BITS_MASK           = (RED_HI_BIT_MASK_RGB565  | GREEN_HI_BIT_MASK_RGB565  | BLUE_HI_BIT_MASK_RGB565);
-uint32	RGB_HI_BITS_MASKx2         = (RED_HI_BIT_MASK_RGB565  | GREEN_HI_BIT_MASK_RGB565  | BLUE_HI_BIT_MASK_RGB565) << 1;
-uint32	RGB_REMOVE_LOW_BITS_MASK   = ~RGB_LOW_BITS_MASK;
-uint32	FIRST_COLOR_MASK           = FIRST_COLOR_MASK_RGB565;
-uint32	SECOND_COLOR_MASK          = SECOND_COLOR_MASK_RGB565;
-uint32	THIRD_COLOR_MASK           = THIRD_COLOR_MASK_RGB565;
-uint32	ALPHA_BITS_MASK            = ALPHA_BITS_MASK_RGB565;
-uint32	FIRST_THIRD_COLOR_MASK     = 0;
-uint32	TWO_LOW_BITS_MASK          = 0;
-uint32	HIGH_BITS_SHIFTED_TWO_MASK = 0;
+CONTEXT_LOCAL uint32	RED_LOW_BIT_MASK           = RED_LOW_BIT_MASK_RGB565;
+CONTEXT_LOCAL uint32	GREEN_LOW_BIT_MASK         = GREEN_LOW_BIT_MASK_RGB565;
+CONTEXT_LOCAL uint32	BLUE_LOW_BIT_MASK          = BLUE_LOW_BIT_MASK_RGB565;
+CONTEXT_LOCAL uint32	RED_HI_BIT_MASK            = RED_HI_BIT_MASK_RGB565;
+CONTEXT_LOCAL uint32	GREEN_HI_BIT_MASK          = GREEN_HI_BIT_MASK_RGB565;
+CONTEXT_LOCAL uint32	BLUE_HI_BIT_MASK           = BLUE_HI_BIT_MASK_RGB565;
+CONTEXT_LOCAL uint32	MAX_RED                    = MAX_RED_RGB565;
+CONTEXT_LOCAL uint32	MAX_GREEN                  = MAX_GREEN_RGB565;
+CONTEXT_LOCAL uint32	MAX_BLUE                   = MAX_BLUE_RGB565;
+CONTEXT_LOCAL uint32	SPARE_RGB_BIT_MASK         = SPARE_RGB_BIT_MASK_RGB565;
+CONTEXT_LOCAL uint32	GREEN_HI_BIT               = (MAX_GREEN_RGB565 + 1) >> 1;
+CONTEXT_LOCAL uint32	RGB_LOW_BITS_MASK          = (RED_LOW_BIT_MASK_RGB565 | GREEN_LOW_BIT_MASK_RGB565 | BLUE_LOW_BIT_MASK_RGB565);
+CONTEXT_LOCAL uint32	RGB_HI_BITS_MASK           = (RED_HI_BIT_MASK_RGB565  | GREEN_HI_BIT_MASK_RGB565  | BLUE_HI_BIT_MASK_RGB565);
+CONTEXT_LOCAL uint32	RGB_HI_BITS_MASKx2         = (RED_HI_BIT_MASK_RGB565  | GREEN_HI_BIT_MASK_RGB565  | BLUE_HI_BIT_MASK_RGB565) << 1;
+CONTEXT_LOCAL uint32	RGB_REMOVE_LOW_BITS_MASK   = ~(RED_LOW_BIT_MASK_RGB565 | GREEN_LOW_BIT_MASK_RGB565 | BLUE_LOW_BIT_MASK_RGB565);
+CONTEXT_LOCAL uint32	FIRST_COLOR_MASK           = FIRST_COLOR_MASK_RGB565;
+CONTEXT_LOCAL uint32	SECOND_COLOR_MASK          = SECOND_COLOR_MASK_RGB565;
+CONTEXT_LOCAL uint32	THIRD_COLOR_MASK           = THIRD_COLOR_MASK_RGB565;
+CONTEXT_LOCAL uint32	ALPHA_BITS_MASK            = ALPHA_BITS_MASK_RGB565;
+CONTEXT_LOCAL uint32	FIRST_THIRD_COLOR_MASK     = 0;
+CONTEXT_LOCAL uint32	TWO_LOW_BITS_MASK          = 0;
+CONTEXT_LOCAL uint32	HIGH_BITS_SHIFTED_TWO_MASK = 0;
 #endif
 
 uint16 SignExtend[2] =
@@ -200,6 +200,7 @@ bool8 LoadZip (const char *zipname, int32 *TotalFileSize, int32 *headers, uint8
 	int		port = unzGoToFirstFile(file);
 
 	unz_file_info	info;
+	unz_file_pos	pos;
 
 	while (port == UNZ_OK)
 	{
@@ -216,6 +217,7 @@ bool8 LoadZip (const char *zipname, int32 *TotalFileSize, int32 *headers, uint8
 		{
 			strcpy(filename, name);
 			filesize = info.uncompressed_size;
+			unzGetFilePos(file, &pos);
 		}
 
 		int	len = strlen(name);
@@ -223,6 +225,7 @@ bool8 LoadZip (const char *zipname, int32 *TotalFileSize, int32 *headers, uint8
 		{
 			strcpy(filename, name);
 			filesize = info.uncompressed_size;
+			unzGetFilePos(file, &pos);
 			break;
 		}
 
@@ -246,7 +249,8 @@ bool8 LoadZip (const char *zipname, int32 *TotalFileSize, int32 *headers, uint8
 	uint8	*ptr = buffer;
 	bool8	more = FALSE;
 
-	unzLocateFile(file, filename, 1);
+	// go back to the file found above instead of searching the directory again
+	unzGoToFilePos(file, &pos);
 	unzGetCurrentFileInfo(file, &info, filename, 128, NULL, 0, NULL, 0);
 
 	if (unzOpenCurrentFile(file) != UNZ_OK)
@@ -260,7 +264,29 @@ bool8 LoadZip (const char *zipname, int32 *TotalFileSize, int32 *headers, uint8
 		assert(info.uncompressed_size <= CMemory::MAX_ROM_SIZE + 512);
 
 		int	FileSize = info.uncompressed_size;
-		int	l = unzReadCurrentFile(file, ptr, FileSize);
+		int	head = FileSize < 512 ? FileSize : 512;
+		int	l = unzReadCurrentFile(file, ptr, head);
+
+		// A copier header is dropped by decompressing the rest of the file
+		// over it, rather than moving the whole image down afterwards.
+		if (l == 512 && Memory.HeaderCheck((uint32) FileSize, ptr))
+		{
+			(*headers)++;
+			FileSize -= 512;
+			l = 0;
+		}
+
+		// Decompress straight into place in chunks small enough to still be
+		// in the cache when the CRC32 of the image is taken.
+		while (l >= 0 && l < FileSize)
+		{
+			int	n = unzReadCurrentFile(file, ptr + l, FileSize - l < 0x10000 ? FileSize - l : 0x10000);
+			if (n <= 0)
+				break;
+
+			l += n;
+			Memory.StreamCRC(buffer, ptr + l - buffer);
+		}
 
 		if (unzCloseCurrentFile(file) == UNZ_CRCERROR)
 		{
@@ -274,7 +300,6 @@ bool8 LoadZip (const char *zipname, int32 *TotalFileSize, int32 *headers, uint8
 			return (FALSE);
 		}
 
-		FileSize = (int) Memory.HeaderRemove((uint32) FileSize, *headers, ptr);
 		ptr += FileSize;
 		*TotalFileSize += FileSize;
 
@@ -181,10 +181,24 @@
 #include <assert.h>
 #include <errno.h>
 
+#if !defined(__WIN32__) && !defined(HTML)
+#define MMAP_SUPPORT
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
 #ifdef UNZIP_SUPPORT
 #include "unzip/unzip.h"
 #endif
 
+#ifdef __ARM_FEATURE_CRC32
+#include <arm_acle.h>
+#elif defined(ZLIB)
+#include <zlib.h>
+#endif
+
 #ifdef JMA_SUPPORT
 #include "jma/s9x-jma.h"
 #endif
@@ -196,6 +210,7 @@
 #include "sdd1.h"
 #include "srtc.h"
 #include "controls.h"
+#include "context.h"
 #include "emscripten.h"
 #ifdef FANCY
 #include "cheats.h"
@@ -216,8 +231,11 @@
 #define min(a, b) (((a) < (b)) ? (a) : (b))
 #endif
 
+// FillRAM, then the ROM image with room for a copier header after it.
+#define ROM_BUFFER_SIZE	(0x8000 + MAX_ROM_SIZE + 0x200)
+
 // static bool8	stopMovie = TRUE;
-static char		LastRomFilename[PATH_MAX + 1] = "";
+static CONTEXT_LOCAL char		LastRomFilename[PATH_MAX + 1] = "";
 
 // from NSRT
 static const char	*nintendo_licensees[] =
@@ -1065,10 +1083,34 @@ static void S9xDeinterleaveGD24 (int size, uint8 *base)
 
 bool8 CMemory::Init (void)
 {
+#ifdef EMU_CONTEXTS
+	struct SEmuContext	*ctx = S9xCurrentContext();
+	if (!ctx)
+		return (FALSE);
+
+	Map           = ctx->Map;
+	WriteMap      = ctx->WriteMap;
+	SpeedMap      = ctx->SpeedMap;
+	WatchMap      = ctx->WatchMap;
+	WatchWriteMap = ctx->WatchWriteMap;
+	BlockIsRAM    = ctx->BlockIsRAM;
+	BlockIsROM    = ctx->BlockIsROM;
+	SA1.Map       = ctx->SA1Map;
+	SA1.WriteMap  = ctx->SA1WriteMap;
+#endif
+
     RAM	 = (uint8 *) malloc(0x20000);
     SRAM = (uint8 *) malloc(0x20000);
     VRAM = (uint8 *) malloc(0x10000);
-    ROM  = (uint8 *) malloc(MAX_ROM_SIZE + 0x200 + 0x8000);
+#ifdef MMAP_SUPPORT
+	// Anonymous pages start out zeroed and aren't resident until touched,
+	// and a ROM file can later be mapped over part of them.
+	ROM  = (uint8 *) mmap(NULL, ROM_BUFFER_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (ROM == (uint8 *) MAP_FAILED)
+		ROM = NULL;
+#else
+    ROM  = (uint8 *) malloc(ROM_BUFFER_SIZE);
+#endif
 
 	IPPU.TileCache[TILE_2BIT]       = (uint8 *) malloc(MAX_2BIT_TILES * 64);
 	IPPU.TileCache[TILE_4BIT]       = (uint8 *) malloc(MAX_4BIT_TILES * 64);
@@ -1109,7 +1151,9 @@ bool8 CMemory::Init (void)
 	ZeroMemory(RAM,  0x20000);
 	ZeroMemory(SRAM, 0x20000);
 	ZeroMemory(VRAM, 0x10000);
-	ZeroMemory(ROM,  MAX_ROM_SIZE + 0x200 + 0x8000);
+#ifndef MMAP_SUPPORT
+	ZeroMemory(ROM,  ROM_BUFFER_SIZE);
+#endif
 
 	ZeroMemory(IPPU.TileCache[TILE_2BIT],       MAX_2BIT_TILES * 64);
 	ZeroMemory(IPPU.TileCache[TILE_4BIT],       MAX_4BIT_TILES * 64);
@@ -1135,21 +1179,17 @@ bool8 CMemory::Init (void)
 	// Add 0x8000 to ROM image pointer to stop SuperFX code accessing
 	// unallocated memory (can cause crash on some ports).
 
-	ROM += 0x8000;
-
-	C4RAM   = ROM + 0x400000 + 8192 * 8; // C4
-	OBC1RAM = ROM + 0x400000; // OBC1
-	BIOSROM = ROM + 0x300000; // BS
-	BSRAM   = ROM + 0x400000; // BS
+	SetROMBase(0);
 
 	SuperFX.pvRegisters = FillRAM + 0x3000;
 	SuperFX.nRamBanks   = 2; // Most only use 1.  1=64KB=512Mb, 2=128KB=1024Mb
 	SuperFX.pvRam       = SRAM;
 	SuperFX.nRomBanks   = (2 * 1024 * 1024) / (32 * 1024);
-	SuperFX.pvRom       = (uint8 *) ROM;
 
 	PostRomInitFunc = NULL;
 
+	UpdateSpeedMap();
+
 	return (TRUE);
 }
 
@@ -1175,9 +1215,13 @@ void CMemory::Deinit (void)
 
 	if (ROM)
 	{
-		ROM -= 0x8000;
-		free(ROM);
+	#ifdef MMAP_SUPPORT
+		munmap(FillRAM, ROM_BUFFER_SIZE);
+	#else
+		free(FillRAM);
+	#endif
 		ROM = NULL;
+		FillRAM = NULL;
 	}
 
 	for (int t = 0; t < 7; t++)
@@ -1357,7 +1401,94 @@ int CMemory::ScoreLoROM (bool8 skip_header, int32 romoff)
 	return (score);
 }
 
-uint32 CMemory::HeaderRemove (uint32 size, int32 &headerCount, uint8 *buf)
+// The ROM image normally starts 0x8000 into the buffer, after FillRAM. A
+// mapped ROM file that has a copier header starts 0x200 further on instead.
+
+// Access speed only depends on the block and, for the FastROM area, on
+// CPU.FastROMSpeed, so this is called again whenever that changes. The one
+// block that isn't a single speed, $4000-$4FFF of the system banks, is all
+// registers and so goes by address in the slow access path.
+
+void CMemory::UpdateSpeedMap (void)
+{
+	for (int b = 0; b < MEMMAP_NUM_BLOCKS; b++)
+		SpeedMap[b] = (uint8) memory_speed(b << MEMMAP_SHIFT);
+}
+
+void CMemory::SetROMBase (uint32 offset)
+{
+	ROM = FillRAM + 0x8000 + offset;
+
+	C4RAM   = ROM + 0x400000 + 8192 * 8; // C4
+	OBC1RAM = ROM + 0x400000; // OBC1
+	BIOSROM = ROM + 0x300000; // BS
+	BSRAM   = ROM + 0x400000; // BS
+
+	SuperFX.pvRom = (uint8 *) ROM;
+}
+
+void CMemory::ClearROM (void)
+{
+#ifdef MMAP_SUPPORT
+	// Replacing the pages also drops any mapped ROM file and the copies made
+	// of the pages that were written to.
+	if (mmap(FillRAM + 0x8000, MAX_ROM_SIZE + 0x200, PROT_READ | PROT_WRITE,
+			 MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0) == MAP_FAILED)
+#endif
+		ZeroMemory(FillRAM + 0x8000, MAX_ROM_SIZE + 0x200);
+
+	SetROMBase(0);
+}
+
+// Maps an uncompressed ROM file straight into the ROM buffer. The mapping
+// is private, so the pages are shared with the page cache, and with any
+// other process that has the same file open, until patches or ROM fixes
+// write to them. Compressed, JMA and multi-file images, and anything the
+// maps and checksums are derived from, are still built per context. Returns
+// the ROM size without header, or 0 if the file has to be read the normal way.
+
+uint32 CMemory::MapROMFile (const char *filename, int32 maxsize)
+{
+#ifdef MMAP_SUPPORT
+	struct stat	st;
+	uint8		magic[2];
+	int			fd;
+
+	if (ROM != FillRAM + 0x8000 || (fd = open(filename, O_RDONLY)) < 0)
+		return (0);
+
+	// Leave gzip'd files to the stream reader.
+	if (fstat(fd, &st) != 0 || st.st_size < 0x2000 || st.st_size > maxsize + 0x200 ||
+		pread(fd, magic, 2, 0) != 2 || (magic[0] == 0x1f && magic[1] == 0x8b))
+	{
+		close(fd);
+		return (0);
+	}
+
+	void	*p = mmap(ROM, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0);
+	close(fd);
+	if (p == MAP_FAILED)
+	{
+		ClearROM();
+		return (0);
+	}
+
+	uint32	size = st.st_size;
+
+	if (HeaderCheck(size, ROM))
+	{
+		SetROMBase(0x200);
+		HeaderCount++;
+		size -= 512;
+	}
+
+	return (size);
+#else
+	return (0);
+#endif
+}
+
+bool8 CMemory::HeaderCheck (uint32 size, uint8 *buf)
 {
 	uint32	calc_size = (size / 0x2000) * 0x2000;
 
@@ -1377,7 +1508,17 @@ uint32 CMemory::HeaderRemove (uint32 size, int32 &headerCount, uint8 *buf)
 			}
 		}
 
-		memmove(buf, buf + 512, calc_size);
+		return (TRUE);
+	}
+
+	return (FALSE);
+}
+
+uint32 CMemory::HeaderRemove (uint32 size, int32 &headerCount, uint8 *buf)
+{
+	if (HeaderCheck(size, buf))
+	{
+		memmove(buf, buf + 512, (size / 0x2000) * 0x2000);
 		headerCount++;
 		size -= 512;
 	}
@@ -1385,7 +1526,23 @@ uint32 CMemory::HeaderRemove (uint32 size, int32 &headerCount, uint8 *buf)
 	return (size);
 }
 
-uint32 CMemory::FileLoader (uint8 *buffer, const char *filename, int32 maxsize)
+// Called by loaders that fill the ROM buffer a piece at a time, with the
+// number of bytes now in place. Whole 0x2000 byte blocks are added to the
+// image CRC32 while they are still in the cache, and InitROM() uses the
+// result if the image isn't changed before then.
+
+void CMemory::StreamCRC (uint8 *buffer, uint32 loaded)
+{
+	uint32	end = loaded & ~0x1fff;
+
+	if (buffer != ROM || end <= LoadCRCSize)
+		return;
+
+	LoadCRC32 = caCRC32(ROM + LoadCRCSize, end - LoadCRCSize, ~LoadCRC32);
+	LoadCRCSize = end;
+}
+
+uint32 CMemory::FileLoader (uint8 *buffer, const char *filename, int32 maxsize, bool8 allow_map)
 {
 	// <- ROM size without header
 	// ** Memory.HeaderCount
@@ -1404,6 +1561,8 @@ uint32 CMemory::FileLoader (uint8 *buffer, const char *filename, int32 maxsize)
 
 	memset(NSRTHeader, 0, sizeof(NSRTHeader));
 	HeaderCount = 0;
+	LoadCRC32 = 0;
+	LoadCRCSize = 0;
 
 	_splitpath(filename, drive, dir, name, exts);
 	_makepath(fname, drive, dir, name, exts);
@@ -1457,13 +1616,24 @@ uint32 CMemory::FileLoader (uint8 *buffer, const char *filename, int32 maxsize)
 		case FILE_DEFAULT:
 		default:
 		{
+			// Split ROMs are read part by part into the buffer.
+			int	len = strlen(name);
+
+			if (allow_map && buffer == ROM &&
+				!(isdigit(ext[0]) && ext[1] == 0) &&
+				!((len == 7 || len == 8) && strncasecmp(name, "sf", 2) == 0) &&
+				(totalSize = MapROMFile(fname, maxsize)) != 0)
+			{
+				strcpy(ROMFilename, fname);
+				break;
+			}
+
 			STREAM	fp = OPEN_STREAM(fname, "rb");
 			if (!fp)
 				return (0);
 
 			strcpy(ROMFilename, fname);
 
-			int 	len  = 0;
 			uint32	size = 0;
 			bool8	more = FALSE;
 			uint8	*ptr = buffer;
@@ -1524,10 +1694,11 @@ bool8 CMemory::LoadROM (const char *filename)
 	if (!filename || !*filename)
 		return (FALSE);
 
-	ZeroMemory(ROM, MAX_ROM_SIZE);
 	ZeroMemory(&Multi, sizeof(Multi));
 
 again:
+	ClearROM();
+
 	Settings.DisplayColor = BUILD_PIXEL(31, 31, 31);
 	SET_UI_COLOR(255, 255, 255);
 
@@ -1536,7 +1707,7 @@ again:
 
 	int32 totalFileSize;
 
-	totalFileSize = FileLoader(ROM, filename, MAX_ROM_SIZE);
+	totalFileSize = FileLoader(ROM, filename, MAX_ROM_SIZE, TRUE);
 	if (!totalFileSize)
 		return (FALSE);
 
@@ -1552,8 +1723,11 @@ again:
 		((hi_score >  lo_score && ScoreHiROM(TRUE) > hi_score) ||
 		 (hi_score <= lo_score && ScoreLoROM(TRUE) > lo_score)))
 	{
-		memmove(ROM, ROM + 512, totalFileSize - 512);
+		// There is always room for a header after the ROM image, so skip
+		// it rather than moving the whole image down.
+		SetROMBase(ROM - FillRAM - 0x8000 + 512);
 		totalFileSize -= 512;
+		LoadCRCSize = 0;
 		S9xMessage(S9X_INFO, S9X_HEADER_WARNING, "Try 'force no-header' option if the game doesn't work");
 		// modifying ROM, so we need to rescore
 		hi_score = ScoreHiROM(FALSE);
@@ -1577,7 +1751,10 @@ again:
 		((ROM[0xfffc] + (ROM[0xfffd] << 8)) < 0x8000))
 	{
 		if (!Settings.ForceInterleaved && !Settings.ForceNotInterleaved)
+		{
 			S9xDeinterleaveType1(totalFileSize, ROM);
+			LoadCRCSize = 0;
+		}
 	}
 
 	// CalculatedSize is now set, so rescore
@@ -1663,6 +1840,7 @@ again:
 	if (!Settings.ForceNotInterleaved && interleaved)
 	{
 		S9xMessage(S9X_INFO, S9X_ROM_INTERLEAVED_INFO, "ROM image is in interleaved format - converting...");
+		LoadCRCSize = 0;
 
 		if (tales)
 		{
@@ -1725,6 +1903,7 @@ again:
 		if (tmp)
 		{
 			S9xMessage(S9X_INFO, S9X_ROM_INTERLEAVED_INFO, "Fixing swapped ExHiROM...");
+			LoadCRCSize = 0;
 			memmove(tmp, ROM, CalculatedSize - 0x400000);
 			memmove(ROM, ROM + CalculatedSize - 0x400000, 0x400000);
 			memmove(ROM + 0x400000, tmp, CalculatedSize - 0x400000);
@@ -1757,7 +1936,7 @@ bool8 CMemory::LoadMultiCart (const char *cartA, const char *cartB)
 {
 	bool8	r = TRUE;
 
-	ZeroMemory(ROM, MAX_ROM_SIZE);
+	ClearROM();
 	ZeroMemory(&Multi, sizeof(Multi));
 
 	Settings.DisplayColor = BUILD_PIXEL(31, 31, 31);
@@ -1819,6 +1998,9 @@ bool8 CMemory::LoadMultiCart (const char *cartA, const char *cartB)
 		return (FALSE);
 	}
 
+	// the carts have been moved into place, so the CRC32 taken while loading is no use
+	LoadCRCSize = 0;
+
 	ZeroMemory(&SNESGameFixes, sizeof(SNESGameFixes));
 	SNESGameFixes.SRAMInitialValue = 0x60;
 #ifdef FANCY
@@ -2195,16 +2377,36 @@ bool8 CMemory::SaveSRAM (const char *filename)
 
 static uint32 caCRC32 (uint8 *array, uint32 size, uint32 crc32)
 {
+#if defined(__ARM_FEATURE_CRC32)
+	// The ARMv8 CRC32 instructions use the same polynomial as crc32Table.
+	uint32	i = 0;
+
+	for (; i + 8 <= size; i += 8)
+	{
+		uint64	d;
+		memcpy(&d, array + i, 8);
+		crc32 = __crc32d(crc32, d);
+	}
+
+	for (; i < size; i++)
+		crc32 = __crc32b(crc32, array[i]);
+
+	return (~crc32);
+#elif defined(ZLIB)
+	// zlib has a much faster implementation of the same CRC
+	return ((uint32) ::crc32(~crc32, array, size));
+#else
 	for (uint32 i = 0; i < size; i++)
 		crc32 = ((crc32 >> 8) & 0x00FFFFFF) ^ crc32Table[(crc32 ^ array[i]) & 0xFF];
 
 	return (~crc32);
+#endif
 }
 
 char * CMemory::Safe (const char *s)
 {
-	static char	*safe = NULL;
-	static int	safe_len = 0;
+	static CONTEXT_LOCAL char	*safe = NULL;
+	static CONTEXT_LOCAL int	safe_len = 0;
 
 	if (s == NULL)
 	{
@@ -2242,8 +2444,8 @@ char * CMemory::Safe (const char *s)
 
 char * CMemory::SafeANK (const char *s)
 {
-	static char	*safe = NULL;
-	static int	safe_len = 0;
+	static CONTEXT_LOCAL char	*safe = NULL;
+	static CONTEXT_LOCAL int	safe_len = 0;
 
 	if (s == NULL)
 	{
@@ -2590,18 +2792,22 @@ void CMemory::InitROM (void)
 			Map_LoROMMap();
     }
 
-	Checksum_Calculate();
+	S9xUpdateWatchpoints();
 
-	bool8 isChecksumOK = (ROMChecksum + ROMComplementChecksum == 0xffff) &
-						 (ROMChecksum == CalculatedChecksum);
+	// Checksum and CRC32, from one pass over the image
+	if (!Settings.BS || Settings.BSXItself) // Not BS Dump
+	{
+		bool8	loaded = (LoadCRCSize == CalculatedSize && CalculatedSize);
 
-	//// Build more ROM information
+		ScanROM(!loaded);
+		if (loaded)
+			ROMCRC32 = LoadCRC32; // taken while the image was being loaded
 
-	// CRC32
-	if (!Settings.BS || Settings.BSXItself) // Not BS Dump
-		ROMCRC32 = caCRC32(ROM, CalculatedSize);
+		Checksum_Calculate();
+	}
 	else // Convert to correct format before scan
 	{
+		// The BS checksum leaves out the header, so it is the same either way.
 		int offset = HiROM ? 0xffc0 : 0x7fc0;
 		// Backup
 		uint8 BSMagic0 = ROM[offset + 22],
@@ -2610,12 +2816,20 @@ void CMemory::InitROM (void)
 		ROM[offset + 22] = 0x42;
 		ROM[offset + 23] = 0x00;
 		// Calc
-		ROMCRC32 = caCRC32(ROM, CalculatedSize);
+		ScanROM(TRUE);
+		Checksum_Calculate();
 		// Convert back
 		ROM[offset + 22] = BSMagic0;
 		ROM[offset + 23] = BSMagic1;
 	}
 
+	ScannedSize = 0;
+
+	bool8 isChecksumOK = (ROMChecksum + ROMComplementChecksum == 0xffff) &
+						 (ROMChecksum == CalculatedChecksum);
+
+	//// Build more ROM information
+
 	// NTSC/PAL
 	if (Settings.ForceNTSC)
 		Settings.PAL = FALSE;
@@ -2956,7 +3170,7 @@ void CMemory::map_SetaDSP (void)
 
 void CMemory::map_WriteProtectROM (void)
 {
-	memmove((void *) WriteMap, (void *) Map, sizeof(Map));
+	memmove((void *) WriteMap, (void *) Map, MEMMAP_NUM_BLOCKS * sizeof(uint8 *));
 
 	for (int c = 0; c < 0x1000; c++)
 	{
@@ -3217,8 +3431,8 @@ void CMemory::Map_SA1LoROMMap (void)
 	map_WriteProtectROM();
 
 	// Now copy the map and correct it for the SA1 CPU.
-	memmove((void *) SA1.Map, (void *) Map, sizeof(Map));
-	memmove((void *) SA1.WriteMap, (void *) WriteMap, sizeof(WriteMap));
+	memmove((void *) SA1.Map, (void *) Map, MEMMAP_NUM_BLOCKS * sizeof(uint8 *));
+	memmove((void *) SA1.WriteMap, (void *) WriteMap, MEMMAP_NUM_BLOCKS * sizeof(uint8 *));
 
 	// SA-1 Banks 00->3f and 80->bf
 	for (int c = 0x000; c < 0x400; c += 0x10)
@@ -3262,8 +3476,8 @@ void CMemory::Map_GNEXTSA1LoROMMap (void)
 	map_WriteProtectROM();
 
 	// Now copy the map and correct it for the SA1 CPU.
-	memmove((void *) SA1.Map, (void *) Map, sizeof(Map));
-	memmove((void *) SA1.WriteMap, (void *) WriteMap, sizeof(WriteMap));
+	memmove((void *) SA1.Map, (void *) Map, MEMMAP_NUM_BLOCKS * sizeof(uint8 *));
+	memmove((void *) SA1.WriteMap, (void *) WriteMap, MEMMAP_NUM_BLOCKS * sizeof(uint8 *));
 
 	// SA-1 Banks 00->3f and 80->bf
 	for (int c = 0x000; c < 0x400; c += 0x10)
@@ -3354,12 +3568,805 @@ void CMemory::Map_SPC7110HiROMMap (void)
 	map_WriteProtectROM();
 }
 
+// memory access handlers
+
+// These do the access for one MAP_ type of block, without counting cycles.
+// The word handlers are for blocks that are read or written as a whole
+// word; the others take two byte accesses.
+
+static uint8 S9xReadCPU (uint32 Address)
+{
+	return (S9xGetCPU(Address & 0xffff));
+}
+
+static uint8 S9xReadPPU (uint32 Address)
+{
+	return (S9xGetPPU(Address & 0xffff));
+}
+
+static uint8 S9xReadLoROMSRAM (uint32 Address)
+{
+	// Address & 0x7fff   : offset into bank
+	// Address & 0xff0000 : bank
+	// bank >> 1 | offset : SRAM address, unbound
+	// unbound & SRAMMask : SRAM offset
+	return (*(Memory.SRAM + ((((Address & 0xff0000) >> 1) | (Address & 0x7fff)) & Memory.SRAMMask)));
+}
+
+static uint8 S9xReadLoROMSRAMB (uint32 Address)
+{
+	return (*(Multi.sramB + ((((Address & 0xff0000) >> 1) | (Address & 0x7fff)) & Multi.sramMaskB)));
+}
+
+static uint8 S9xReadHiROMSRAM (uint32 Address)
+{
+	return (*(Memory.SRAM + (((Address & 0x7fff) - 0x6000 + ((Address & 0xf0000) >> 3)) & Memory.SRAMMask)));
+}
+
+static uint8 S9xReadBWRAM (uint32 Address)
+{
+	return (*(Memory.BWRAM + ((Address & 0x7fff) - 0x6000)));
+}
+
+static uint8 S9xReadDSP (uint32 Address)
+{
+	return (S9xGetDSP(Address & 0xffff));
+}
+
+static uint8 S9xReadSPC7110ROM (uint32 Address)
+{
+	return (S9xGetSPC7110Byte(Address));
+}
+
+static uint8 S9xReadSPC7110DRAM (uint32)
+{
+	return (S9xGetSPC7110(0x4800));
+}
+
+static uint8 S9xReadC4 (uint32 Address)
+{
+	return (S9xGetC4(Address & 0xffff));
+}
+
+static uint8 S9xReadOBC1 (uint32 Address)
+{
+	return (S9xGetOBC1(Address & 0xffff));
+}
+
+static uint8 S9xReadSetaDSP (uint32 Address)
+{
+	return (S9xGetSetaDSP(Address));
+}
+
+static uint8 S9xReadST018 (uint32 Address)
+{
+	return (S9xGetST018(Address));
+}
+
+static uint8 S9xReadBSX (uint32 Address)
+{
+	return (S9xGetBSX(Address));
+}
+
+static uint8 S9xReadNone (uint32)
+{
+	return (OpenBus);
+}
+
+static uint16 S9xReadWordLoROMSRAM (uint32 Address)
+{
+	if (Memory.SRAMMask >= MEMMAP_MASK)
+		return (READ_WORD(Memory.SRAM + ((((Address & 0xff0000) >> 1) | (Address & 0x7fff)) & Memory.SRAMMask)));
+
+	return (S9xReadLoROMSRAM(Address) | (S9xReadLoROMSRAM(Address + 1) << 8));
+}
+
+static uint16 S9xReadWordLoROMSRAMB (uint32 Address)
+{
+	if (Multi.sramMaskB >= MEMMAP_MASK)
+		return (READ_WORD(Multi.sramB + ((((Address & 0xff0000) >> 1) | (Address & 0x7fff)) & Multi.sramMaskB)));
+
+	return (S9xReadLoROMSRAMB(Address) | (S9xReadLoROMSRAMB(Address + 1) << 8));
+}
+
+static uint16 S9xReadWordHiROMSRAM (uint32 Address)
+{
+	if (Memory.SRAMMask >= MEMMAP_MASK)
+		return (READ_WORD(Memory.SRAM + (((Address & 0x7fff) - 0x6000 + ((Address & 0xf0000) >> 3)) & Memory.SRAMMask)));
+
+	return (S9xReadHiROMSRAM(Address) | (S9xReadHiROMSRAM(Address + 1) << 8));
+}
+
+static uint16 S9xReadWordBWRAM (uint32 Address)
+{
+	return (READ_WORD(Memory.BWRAM + ((Address & 0x7fff) - 0x6000)));
+}
+
+static uint16 S9xReadWordNone (uint32)
+{
+	return (OpenBus | (OpenBus << 8));
+}
+
+static void S9xWriteCPU (uint8 Byte, uint32 Address)
+{
+	S9xSetCPU(Byte, Address & 0xffff);
+}
+
+static void S9xWritePPU (uint8 Byte, uint32 Address)
+{
+	S9xSetPPU(Byte, Address & 0xffff);
+}
+
+static void S9xWriteLoROMSRAM (uint8 Byte, uint32 Address)
+{
+	if (Memory.SRAMMask)
+	{
+		*(Memory.SRAM + ((((Address & 0xff0000) >> 1) | (Address & 0x7fff)) & Memory.SRAMMask)) = Byte;
+		CPU.SRAMModified = TRUE;
+	}
+}
+
+static void S9xWriteLoROMSRAMB (uint8 Byte, uint32 Address)
+{
+	if (Multi.sramMaskB)
+	{
+		*(Multi.sramB + ((((Address & 0xff0000) >> 1) | (Address & 0x7fff)) & Multi.sramMaskB)) = Byte;
+		CPU.SRAMModified = TRUE;
+	}
+}
+
+static void S9xWriteHiROMSRAM (uint8 Byte, uint32 Address)
+{
+	if (Memory.SRAMMask)
+	{
+		*(Memory.SRAM + (((Address & 0x7fff) - 0x6000 + ((Address & 0xf0000) >> 3)) & Memory.SRAMMask)) = Byte;
+		CPU.SRAMModified = TRUE;
+	}
+}
+
+static void S9xWriteBWRAM (uint8 Byte, uint32 Address)
+{
+	*(Memory.BWRAM + ((Address & 0x7fff) - 0x6000)) = Byte;
+	CPU.SRAMModified = TRUE;
+}
+
+static void S9xWriteSA1RAM (uint8 Byte, uint32 Address)
+{
+	*(Memory.SRAM + (Address & 0xffff)) = Byte;
+}
+
+static void S9xWriteDSP (uint8 Byte, uint32 Address)
+{
+	S9xSetDSP(Byte, Address & 0xffff);
+}
+
+static void S9xWriteC4 (uint8 Byte, uint32 Address)
+{
+	S9xSetC4(Byte, Address & 0xffff);
+}
+
+static void S9xWriteOBC1 (uint8 Byte, uint32 Address)
+{
+	S9xSetOBC1(Byte, Address & 0xffff);
+}
+
+static void S9xWriteSetaDSP (uint8 Byte, uint32 Address)
+{
+	S9xSetSetaDSP(Byte, Address);
+}
+
+static void S9xWriteST018 (uint8 Byte, uint32 Address)
+{
+	S9xSetST018(Byte, Address);
+}
+
+static void S9xWriteBSX (uint8 Byte, uint32 Address)
+{
+	S9xSetBSX(Byte, Address);
+}
+
+static void S9xWriteNone (uint8, uint32)
+{
+	return;
+}
+
+static void S9xWriteWordLoROMSRAM (uint16 Word, uint32 Address)
+{
+	if (Memory.SRAMMask >= MEMMAP_MASK)
+	{
+		WRITE_WORD(Memory.SRAM + ((((Address & 0xff0000) >> 1) | (Address & 0x7fff)) & Memory.SRAMMask), Word);
+		CPU.SRAMModified = TRUE;
+	}
+	else
+	{
+		S9xWriteLoROMSRAM((uint8) Word, Address);
+		S9xWriteLoROMSRAM(Word >> 8, Address + 1);
+	}
+}
+
+static void S9xWriteWordLoROMSRAMB (uint16 Word, uint32 Address)
+{
+	if (Multi.sramMaskB >= MEMMAP_MASK)
+	{
+		WRITE_WORD(Multi.sramB + ((((Address & 0xff0000) >> 1) | (Address & 0x7fff)) & Multi.sramMaskB), Word);
+		CPU.SRAMModified = TRUE;
+	}
+	else
+	{
+		S9xWriteLoROMSRAMB((uint8) Word, Address);
+		S9xWriteLoROMSRAMB(Word >> 8, Address + 1);
+	}
+}
+
+static void S9xWriteWordHiROMSRAM (uint16 Word, uint32 Address)
+{
+	if (Memory.SRAMMask >= MEMMAP_MASK)
+	{
+		WRITE_WORD(Memory.SRAM + (((Address & 0x7fff) - 0x6000 + ((Address & 0xf0000) >> 3)) & Memory.SRAMMask), Word);
+		CPU.SRAMModified = TRUE;
+	}
+	else
+	{
+		S9xWriteHiROMSRAM((uint8) Word, Address);
+		S9xWriteHiROMSRAM(Word >> 8, Address + 1);
+	}
+}
+
+static void S9xWriteWordBWRAM (uint16 Word, uint32 Address)
+{
+	WRITE_WORD(Memory.BWRAM + ((Address & 0x7fff) - 0x6000), Word);
+	CPU.SRAMModified = TRUE;
+}
+
+static void S9xWriteWordSA1RAM (uint16 Word, uint32 Address)
+{
+	WRITE_WORD(Memory.SRAM + (Address & 0xffff), Word);
+}
+
+static void S9xWriteWordNone (uint16, uint32)
+{
+	return;
+}
+
+// Indexed by MAP_ type, in the order of the enum in CMemory. MAP_WATCH is
+// dealt with before the tables are used.
+
+static uint8 (* const S9xByteReaders[CMemory::MAP_LAST]) (uint32) =
+{
+	S9xReadCPU,				// MAP_CPU
+	S9xReadPPU,				// MAP_PPU
+	S9xReadLoROMSRAM,		// MAP_LOROM_SRAM
+	S9xReadLoROMSRAMB,		// MAP_LOROM_SRAM_B
+	S9xReadHiROMSRAM,		// MAP_HIROM_SRAM
+	S9xReadDSP,				// MAP_DSP
+	S9xReadLoROMSRAM,		// MAP_SA1RAM
+	S9xReadBWRAM,			// MAP_BWRAM
+	S9xReadNone,			// MAP_BWRAM_BITMAP
+	S9xReadNone,			// MAP_BWRAM_BITMAP2
+	S9xReadSPC7110ROM,		// MAP_SPC7110_ROM
+	S9xReadSPC7110DRAM,		// MAP_SPC7110_DRAM
+	S9xReadHiROMSRAM,		// MAP_RONLY_SRAM
+	S9xReadC4,				// MAP_C4
+	S9xReadOBC1,			// MAP_OBC_RAM
+	S9xReadSetaDSP,			// MAP_SETA_DSP
+	S9xReadST018,			// MAP_SETA_RISC
+	S9xReadBSX,				// MAP_BSX
+	S9xReadNone,			// MAP_WATCH
+	S9xReadNone				// MAP_NONE
+};
+
+static uint16 (* const S9xWordReaders[CMemory::MAP_LAST]) (uint32) =
+{
+	NULL,					// MAP_CPU
+	NULL,					// MAP_PPU
+	S9xReadWordLoROMSRAM,	// MAP_LOROM_SRAM
+	S9xReadWordLoROMSRAMB,	// MAP_LOROM_SRAM_B
+	S9xReadWordHiROMSRAM,	// MAP_HIROM_SRAM
+	NULL,					// MAP_DSP
+	S9xReadWordLoROMSRAM,	// MAP_SA1RAM
+	S9xReadWordBWRAM,		// MAP_BWRAM
+	S9xReadWordNone,		// MAP_BWRAM_BITMAP
+	S9xReadWordNone,		// MAP_BWRAM_BITMAP2
+	NULL,					// MAP_SPC7110_ROM
+	NULL,					// MAP_SPC7110_DRAM
+	S9xReadWordHiROMSRAM,	// MAP_RONLY_SRAM
+	NULL,					// MAP_C4
+	NULL,					// MAP_OBC_RAM
+	NULL,					// MAP_SETA_DSP
+	NULL,					// MAP_SETA_RISC
+	NULL,					// MAP_BSX
+	S9xReadWordNone,		// MAP_WATCH
+	S9xReadWordNone			// MAP_NONE
+};
+
+static void (* const S9xByteWriters[CMemory::MAP_LAST]) (uint8, uint32) =
+{
+	S9xWriteCPU,			// MAP_CPU
+	S9xWritePPU,			// MAP_PPU
+	S9xWriteLoROMSRAM,		// MAP_LOROM_SRAM
+	S9xWriteLoROMSRAMB,		// MAP_LOROM_SRAM_B
+	S9xWriteHiROMSRAM,		// MAP_HIROM_SRAM
+	S9xWriteDSP,			// MAP_DSP
+	S9xWriteSA1RAM,			// MAP_SA1RAM
+	S9xWriteBWRAM,			// MAP_BWRAM
+	S9xWriteNone,			// MAP_BWRAM_BITMAP
+	S9xWriteNone,			// MAP_BWRAM_BITMAP2
+	S9xWriteNone,			// MAP_SPC7110_ROM
+	S9xWriteNone,			// MAP_SPC7110_DRAM
+	S9xWriteNone,			// MAP_RONLY_SRAM
+	S9xWriteC4,				// MAP_C4
+	S9xWriteOBC1,			// MAP_OBC_RAM
+	S9xWriteSetaDSP,		// MAP_SETA_DSP
+	S9xWriteST018,			// MAP_SETA_RISC
+	S9xWriteBSX,			// MAP_BSX
+	S9xWriteNone,			// MAP_WATCH
+	S9xWriteNone			// MAP_NONE
+};
+
+static void (* const S9xWordWriters[CMemory::MAP_LAST]) (uint16, uint32) =
+{
+	NULL,					// MAP_CPU
+	NULL,					// MAP_PPU
+	S9xWriteWordLoROMSRAM,	// MAP_LOROM_SRAM
+	S9xWriteWordLoROMSRAMB,	// MAP_LOROM_SRAM_B
+	S9xWriteWordHiROMSRAM,	// MAP_HIROM_SRAM
+	NULL,					// MAP_DSP
+	S9xWriteWordSA1RAM,		// MAP_SA1RAM
+	S9xWriteWordBWRAM,		// MAP_BWRAM
+	S9xWriteWordNone,		// MAP_BWRAM_BITMAP
+	S9xWriteWordNone,		// MAP_BWRAM_BITMAP2
+	S9xWriteWordNone,		// MAP_SPC7110_ROM
+	S9xWriteWordNone,		// MAP_SPC7110_DRAM
+	S9xWriteWordNone,		// MAP_RONLY_SRAM
+	NULL,					// MAP_C4
+	NULL,					// MAP_OBC_RAM
+	NULL,					// MAP_SETA_DSP
+	NULL,					// MAP_SETA_RISC
+	NULL,					// MAP_BSX
+	S9xWriteWordNone,		// MAP_WATCH
+	S9xWriteWordNone		// MAP_NONE
+};
+
+uint8 S9xGetByteSlow (uint32 Address)
+{
+	int		block = (Address & 0xffffff) >> MEMMAP_SHIFT;
+	uint8	*GetAddress = Memory.Map[block];
+	int32	speed = memory_speed(Address);
+	uint8	byte;
+
+	if (GetAddress >= (uint8 *) CMemory::MAP_LAST)
+		byte = *(GetAddress + (Address & 0xffff));
+	else
+	if (GetAddress == (uint8 *) CMemory::MAP_WATCH)
+		return (S9xGetByteWatched(Address));
+	else
+	if (GetAddress == (uint8 *) CMemory::MAP_PPU && CPU.InDMAorHDMA && (Address & 0xff00) == 0x2100)
+		return (OpenBus);
+	else
+		byte = S9xByteReaders[(pint) GetAddress](Address);
+
+	addCyclesInMemoryAccess;
+	return (byte);
+}
+
+uint16 S9xGetWordSlow (uint32 Address, enum s9xwrap_t w)
+{
+	uint32	mask = MEMMAP_MASK & (w == WRAP_PAGE ? 0xff : (w == WRAP_BANK ? 0xffff : 0xffffff));
+	if ((Address & mask) == mask)
+	{
+		PC_t	a;
+
+		OpenBus = S9xGetByte(Address);
+
+		switch (w)
+		{
+			case WRAP_PAGE:
+				a.xPBPC = Address;
+				a.B.xPCl++;
+				return (OpenBus | (S9xGetByte(a.xPBPC) << 8));
+
+			case WRAP_BANK:
+				a.xPBPC = Address;
+				a.W.xPC++;
+				return (OpenBus | (S9xGetByte(a.xPBPC) << 8));
+
+			case WRAP_NONE:
+			default:
+				return (OpenBus | (S9xGetByte(Address + 1) << 8));
+		}
+	}
+
+	int		block = (Address & 0xffffff) >> MEMMAP_SHIFT;
+	uint8	*GetAddress = Memory.Map[block];
+	int32	speed = memory_speed(Address);
+	uint16	word;
+
+	if (GetAddress >= (uint8 *) CMemory::MAP_LAST)
+	{
+		word = READ_WORD(GetAddress + (Address & 0xffff));
+		addCyclesInMemoryAccess_x2;
+		return (word);
+	}
+
+	if (GetAddress == (uint8 *) CMemory::MAP_WATCH)
+		return (S9xGetWordWatched(Address, w));
+
+	if (GetAddress == (uint8 *) CMemory::MAP_PPU && CPU.InDMAorHDMA)
+	{
+		OpenBus = S9xGetByte(Address);
+		return (OpenBus | (S9xGetByte(Address + 1) << 8));
+	}
+
+	if (S9xWordReaders[(pint) GetAddress])
+	{
+		word = S9xWordReaders[(pint) GetAddress](Address);
+		addCyclesInMemoryAccess_x2;
+		return (word);
+	}
+
+	word  = S9xByteReaders[(pint) GetAddress](Address);
+	addCyclesInMemoryAccess;
+	word |= S9xByteReaders[(pint) GetAddress](Address + 1) << 8;
+	addCyclesInMemoryAccess;
+	return (word);
+}
+
+void S9xSetByteSlow (uint8 Byte, uint32 Address)
+{
+	int		block = (Address & 0xffffff) >> MEMMAP_SHIFT;
+	uint8	*SetAddress = Memory.WriteMap[block];
+	int32	speed = memory_speed(Address);
+
+	if (SetAddress >= (uint8 *) CMemory::MAP_LAST)
+		*(SetAddress + (Address & 0xffff)) = Byte;
+	else
+	if (SetAddress == (uint8 *) CMemory::MAP_WATCH)
+	{
+		S9xSetByteWatched(Byte, Address);
+		return;
+	}
+	else
+	if (SetAddress == (uint8 *) CMemory::MAP_PPU && CPU.InDMAorHDMA && (Address & 0xff00) == 0x2100)
+		return;
+	else
+		S9xByteWriters[(pint) SetAddress](Byte, Address);
+
+	addCyclesInMemoryAccess;
+}
+
+void S9xSetWordSlow (uint16 Word, uint32 Address, enum s9xwrap_t w, enum s9xwriteorder_t o)
+{
+	uint32	mask = MEMMAP_MASK & (w == WRAP_PAGE ? 0xff : (w == WRAP_BANK ? 0xffff : 0xffffff));
+	if ((Address & mask) == mask)
+	{
+		PC_t	a;
+
+		if (!o)
+			S9xSetByte((uint8) Word, Address);
+
+		switch (w)
+		{
+			case WRAP_PAGE:
+				a.xPBPC = Address;
+				a.B.xPCl++;
+				S9xSetByte(Word >> 8, a.xPBPC);
+				break;
+
+			case WRAP_BANK:
+				a.xPBPC = Address;
+				a.W.xPC++;
+				S9xSetByte(Word >> 8, a.xPBPC);
+				break;
+
+			case WRAP_NONE:
+			default:
+				S9xSetByte(Word >> 8, Address + 1);
+				break;
+		}
+
+		if (o)
+			S9xSetByte((uint8) Word, Address);
+
+		return;
+	}
+
+	int		block = (Address & 0xffffff) >> MEMMAP_SHIFT;
+	uint8	*SetAddress = Memory.WriteMap[block];
+	int32	speed = memory_speed(Address);
+
+	if (SetAddress >= (uint8 *) CMemory::MAP_LAST)
+	{
+		WRITE_WORD(SetAddress + (Address & 0xffff), Word);
+		addCyclesInMemoryAccess_x2;
+		return;
+	}
+
+	if (SetAddress == (uint8 *) CMemory::MAP_WATCH)
+	{
+		S9xSetWordWatched(Word, Address, w, o);
+		return;
+	}
+
+	if (SetAddress == (uint8 *) CMemory::MAP_PPU && CPU.InDMAorHDMA)
+	{
+		if ((Address & 0xff00) != 0x2100)
+			S9xSetPPU((uint8) Word, Address & 0xffff);
+		if (((Address + 1) & 0xff00) != 0x2100)
+			S9xSetPPU(Word >> 8, (Address + 1) & 0xffff);
+		return;
+	}
+
+	if (S9xWordWriters[(pint) SetAddress])
+	{
+		S9xWordWriters[(pint) SetAddress](Word, Address);
+		addCyclesInMemoryAccess_x2;
+		return;
+	}
+
+	if (o)
+	{
+		S9xByteWriters[(pint) SetAddress](Word >> 8, Address + 1);
+		addCyclesInMemoryAccess;
+		S9xByteWriters[(pint) SetAddress]((uint8) Word, Address);
+		addCyclesInMemoryAccess;
+	}
+	else
+	{
+		S9xByteWriters[(pint) SetAddress]((uint8) Word, Address);
+		addCyclesInMemoryAccess;
+		S9xByteWriters[(pint) SetAddress](Word >> 8, Address + 1);
+		addCyclesInMemoryAccess;
+	}
+}
+
+// watchpoints
+
+// Set while any block may be trapped, so that remapping costs nothing when
+// no watchpoint is armed.
+static CONTEXT_LOCAL bool8	WatchTrapsSet = FALSE;
+
+static bool8 S9xWatchCovers (SWatchpoint *wp, int block, uint8 *ptr)
+{
+	if (wp->host)
+	{
+		// a block of RAM or ROM, which may be a mirror of the watched one
+		if (ptr < (uint8 *) CMemory::MAP_LAST)
+			return (FALSE);
+
+		uint8	*start = ptr + ((block << MEMMAP_SHIFT) & 0xffff);
+
+		return (start < wp->host + wp->size && wp->host < start + MEMMAP_BLOCK_SIZE);
+	}
+
+	uint32	start = block << MEMMAP_SHIFT;
+
+	return (start < wp->address + wp->size && wp->address < start + MEMMAP_BLOCK_SIZE);
+}
+
+static void S9xWatchCheck (uint32 address, uint8 *ptr, uint8 byte, uint8 type)
+{
+	// Set while the hook runs, so that memory it reads or writes goes
+	// through unwatched instead of calling the hook again.
+	static CONTEXT_LOCAL bool8	in_hook = FALSE;
+
+	if (in_hook)
+		return;
+
+	address &= 0xffffff;
+
+	for (int i = 0; i < MAX_WATCHPOINTS; i++)
+	{
+		SWatchpoint	*wp = &Watchpoints[i];
+
+		if (!(wp->type & type))
+			continue;
+
+		if (wp->host ? (ptr >= (uint8 *) CMemory::MAP_LAST && (uint32) (ptr + (address & 0xffff) - wp->host) < wp->size)
+					 : (address - wp->address) < wp->size)
+		{
+			wp->hits++;
+			if (S9xWatchpointHook)
+			{
+				in_hook = TRUE;
+				S9xWatchpointHook(address, byte, type);
+				in_hook = FALSE;
+			}
+		}
+	}
+}
+
+// Puts the real entries back in the trapped blocks, for code about to copy
+// Map[] or rebuild it in part.
+
+void S9xClearWatchTraps (void)
+{
+	if (!WatchTrapsSet)
+		return;
+
+	for (int b = 0; b < MEMMAP_NUM_BLOCKS; b++)
+	{
+		if (Memory.Map[b] == (uint8 *) CMemory::MAP_WATCH)
+			Memory.Map[b] = Memory.WatchMap[b];
+		if (Memory.WriteMap[b] == (uint8 *) CMemory::MAP_WATCH)
+			Memory.WriteMap[b] = Memory.WatchWriteMap[b];
+	}
+
+	WatchTrapsSet = FALSE;
+}
+
+// Called whenever the memory map is rebuilt or remapped, and when
+// watchpoints change.
+
+void S9xUpdateWatchpoints (void)
+{
+	S9xClearWatchTraps();
+
+	for (int i = 0; i < MAX_WATCHPOINTS; i++)
+	{
+		SWatchpoint	*wp = &Watchpoints[i];
+
+		if (!wp->type)
+			continue;
+
+		WatchTrapsSet = TRUE;
+
+		for (int b = 0; b < MEMMAP_NUM_BLOCKS; b++)
+		{
+			if ((wp->type & WATCH_READ) && Memory.Map[b] != (uint8 *) CMemory::MAP_WATCH && S9xWatchCovers(wp, b, Memory.Map[b]))
+			{
+				Memory.WatchMap[b] = Memory.Map[b];
+				Memory.Map[b] = (uint8 *) CMemory::MAP_WATCH;
+			}
+
+			if ((wp->type & WATCH_WRITE) && Memory.WriteMap[b] != (uint8 *) CMemory::MAP_WATCH && S9xWatchCovers(wp, b, Memory.WriteMap[b]))
+			{
+				Memory.WatchWriteMap[b] = Memory.WriteMap[b];
+				Memory.WriteMap[b] = (uint8 *) CMemory::MAP_WATCH;
+			}
+		}
+	}
+}
+
+int S9xAddWatchpoint (uint32 address, uint32 size, uint8 type)
+{
+	for (int i = 0; i < MAX_WATCHPOINTS; i++)
+	{
+		SWatchpoint	*wp = &Watchpoints[i];
+
+		if (wp->type)
+			continue;
+
+		int		block = (address & 0xffffff) >> MEMMAP_SHIFT;
+		uint8	*ptr = Memory.Map[block] == (uint8 *) CMemory::MAP_WATCH ? Memory.WatchMap[block] : Memory.Map[block];
+
+		wp->address = address & 0xffffff;
+		wp->size = size ? size : 1;
+		wp->type = type & (WATCH_READ | WATCH_WRITE);
+		wp->host = ptr >= (uint8 *) CMemory::MAP_LAST ? ptr + (address & 0xffff) : NULL;
+		wp->hits = 0;
+
+		S9xUpdateWatchpoints();
+		// the CPU may be running from a block that is now trapped
+		S9xSetPCBase(Registers.PBPC);
+
+		return (i);
+	}
+
+	return (-1);
+}
+
+void S9xRemoveWatchpoint (int which)
+{
+	if (which >= 0 && which < MAX_WATCHPOINTS)
+	{
+		Watchpoints[which].type = 0;
+		S9xUpdateWatchpoints();
+		S9xSetPCBase(Registers.PBPC);
+	}
+}
+
+// Accesses to a trapped block put the real map entry back for the duration
+// of the normal access, then report it.
+
+uint8 S9xGetByteWatched (uint32 Address)
+{
+	int		block = (Address & 0xffffff) >> MEMMAP_SHIFT;
+	uint8	*ptr = Memory.WatchMap[block];
+
+	Memory.Map[block] = ptr;
+	uint8	byte = S9xGetByte(Address);
+	Memory.Map[block] = (uint8 *) CMemory::MAP_WATCH;
+
+	S9xWatchCheck(Address, ptr, byte, WATCH_READ);
+
+	return (byte);
+}
+
+uint16 S9xGetWordWatched (uint32 Address, enum s9xwrap_t w)
+{
+	int		block = (Address & 0xffffff) >> MEMMAP_SHIFT;
+	uint8	*ptr = Memory.WatchMap[block];
+
+	Memory.Map[block] = ptr;
+	uint16	word = S9xGetWord(Address, w);
+	Memory.Map[block] = (uint8 *) CMemory::MAP_WATCH;
+
+	// S9xGetWord() has already split accesses that leave the block
+	S9xWatchCheck(Address, ptr, (uint8) word, WATCH_READ);
+	S9xWatchCheck(Address + 1, ptr, word >> 8, WATCH_READ);
+
+	return (word);
+}
+
+void S9xSetByteWatched (uint8 Byte, uint32 Address)
+{
+	int		block = (Address & 0xffffff) >> MEMMAP_SHIFT;
+	uint8	*ptr = Memory.WatchWriteMap[block];
+
+	Memory.WriteMap[block] = ptr;
+	S9xSetByte(Byte, Address);
+	Memory.WriteMap[block] = (uint8 *) CMemory::MAP_WATCH;
+
+	S9xWatchCheck(Address, ptr, Byte, WATCH_WRITE);
+}
+
+void S9xSetWordWatched (uint16 Word, uint32 Address, enum s9xwrap_t w, enum s9xwriteorder_t o)
+{
+	int		block = (Address & 0xffffff) >> MEMMAP_SHIFT;
+	uint8	*ptr = Memory.WatchWriteMap[block];
+
+	Memory.WriteMap[block] = ptr;
+	S9xSetWord(Word, Address, w, o);
+	Memory.WriteMap[block] = (uint8 *) CMemory::MAP_WATCH;
+
+	S9xWatchCheck(Address, ptr, (uint8) Word, WATCH_WRITE);
+	S9xWatchCheck(Address + 1, ptr, Word >> 8, WATCH_WRITE);
+}
+
 // checksum
 
+// Walks the image once, adding up each 0x2000 byte block into BlockSum[]
+// and, if asked, taking the CRC32 of the block while it is in the cache.
+// checksum_calc_sum() then only has to add up block sums.
+
+void CMemory::ScanROM (bool8 crc)
+{
+	uint32	crc32 = 0;
+
+	ScannedSize = CalculatedSize & ~0x1fff;
+
+	for (uint32 b = 0; b < ScannedSize; b += 0x2000)
+	{
+		uint8	*block = ROM + b;
+		uint32	sum = 0;
+
+		for (uint32 i = 0; i < 0x2000; i++)
+			sum += block[i];
+
+		BlockSum[b >> 13] = (uint16) sum;
+
+		if (crc)
+			crc32 = caCRC32(block, 0x2000, ~crc32);
+	}
+
+	if (crc)
+		ROMCRC32 = caCRC32(ROM + ScannedSize, CalculatedSize - ScannedSize, ~crc32);
+}
+
 uint16 CMemory::checksum_calc_sum (uint8 *data, uint32 length)
 {
 	uint16	sum = 0;
 
+	if (data >= ROM && !((data - ROM) & 0x1fff))
+	{
+		uint32	b = data - ROM;
+
+		for (; length >= 0x2000 && b + 0x2000 <= ScannedSize; b += 0x2000, length -= 0x2000)
+			sum += BlockSum[b >> 13];
+
+		data = ROM + b;
+	}
+
 	for (uint32 i = 0; i < length; i++)
 		sum += data[i];
 
@@ -3429,7 +4436,7 @@ const char * CMemory::MapType (void)
 
 const char * CMemory::StaticRAMSize (void)
 {
-	static char	str[20];
+	static CONTEXT_LOCAL char	str[20];
 
 	if (SRAMSize > 16)
 		strcpy(str, "Corrupt");
@@ -3441,7 +4448,7 @@ const char * CMemory::StaticRAMSize (void)
 
 const char * CMemory::Size (void)
 {
-	static char	str[20];
+	static CONTEXT_LOCAL char	str[20];
 
 	if (Multi.cartType == 4)
 		strcpy(str, "N/A");
@@ -3456,7 +4463,7 @@ const char * CMemory::Size (void)
 
 const char * CMemory::Revision (void)
 {
-	static char	str[20];
+	static CONTEXT_LOCAL char	str[20];
 
 	sprintf(str, "1.%d", HiROM ? ((ExtendedFormat != NOPE) ? ROM[0x40ffdb] : ROM[0xffdb]) : ROM[0x7fdb]);
 
@@ -3465,7 +4472,7 @@ const char * CMemory::Revision (void)
 
 const char * CMemory::KartContents (void)
 {
-	static char			str[64];
+	static CONTEXT_LOCAL char			str[64];
 	static const char	*contents[3] = { "ROM", "ROM+RAM", "ROM+RAM+BAT" };
 
 	char	chip[16];
@@ -3801,6 +4808,8 @@ static uint32 XPSdecode (const uint8 *data, unsigned &addr, unsigned size)
 
 static bool8 ReadUPSPatch (Reader *r, long, int32 &rom_size)
 {
+	Memory.LoadCRCSize = 0;
+
 	//Reader lacks size() and rewind(), so we need to read in the file to get its size
 	uint8 *data = new uint8[8 * 1024 * 1024];  //allocate a lot of memory, better safe than sorry ...
 	uint32 size = 0;
@@ -3883,6 +4892,8 @@ static bool8 ReadUPSPatch (Reader *r, long, int32 &rom_size)
 //
 static bool8 ReadBPSPatch (Reader *r, long, int32 &rom_size)
 {
+	Memory.LoadCRCSize = 0;
+
 	uint8 *data = new uint8[8 * 1024 * 1024];  //allocate a lot of memory, better safe than sorry ...
 	uint32 size = 0;
 	while(true) {
@@ -3996,6 +5007,8 @@ static bool8 ReadIPSPatch (Reader *r, long offset, int32 &rom_size)
 	int32		ofs;
 	char		fname[6];
 
+	Memory.LoadCRCSize = 0;
+
 	fname[5] = 0;
 	for (int i = 0; i < 5; i++)
 	{
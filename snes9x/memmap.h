@@ -218,6 +218,7 @@ struct CMemory
 		MAP_SETA_DSP,
 		MAP_SETA_RISC,
 		MAP_BSX,
+		MAP_WATCH,
 		MAP_NONE,
 		MAP_LAST
 	};
@@ -236,10 +237,24 @@ struct CMemory
 	uint8	*BSRAM;
 	uint8	*BIOSROM;
 
+#ifdef EMU_CONTEXTS
+	// MEMMAP_NUM_BLOCKS entries each, kept in the bound SEmuContext.
+	uint8	**Map;
+	uint8	**WriteMap;
+	uint8	*SpeedMap;		// master cycles per access
+	uint8	**WatchMap;
+	uint8	**WatchWriteMap;
+	uint8	*BlockIsRAM;
+	uint8	*BlockIsROM;
+#else
 	uint8	*Map[MEMMAP_NUM_BLOCKS];
 	uint8	*WriteMap[MEMMAP_NUM_BLOCKS];
+	uint8	SpeedMap[MEMMAP_NUM_BLOCKS];	// master cycles per access
+	uint8	*WatchMap[MEMMAP_NUM_BLOCKS];
+	uint8	*WatchWriteMap[MEMMAP_NUM_BLOCKS];
 	uint8	BlockIsRAM[MEMMAP_NUM_BLOCKS];
 	uint8	BlockIsROM[MEMMAP_NUM_BLOCKS];
+#endif
 	uint8	ExtendedFormat;
 
 	char	ROMFilename[PATH_MAX + 1];
@@ -262,6 +277,10 @@ struct CMemory
 	uint32	SRAMMask;
 	uint32	CalculatedSize;
 	uint32	CalculatedChecksum;
+	uint32	LoadCRC32;
+	uint32	LoadCRCSize;
+	uint32	ScannedSize;
+	uint16	BlockSum[MAX_ROM_SIZE / 0x2000];
 
 	// ports can assign this to perform some custom action upon loading a ROM (such as adjusting controls)
 	void	(*PostRomInitFunc) (void);
@@ -271,8 +290,14 @@ struct CMemory
 
 	int		ScoreHiROM (bool8, int32 romoff = 0);
 	int		ScoreLoROM (bool8, int32 romoff = 0);
+	void	UpdateSpeedMap (void);
+	void	SetROMBase (uint32);
+	void	ClearROM (void);
+	uint32	MapROMFile (const char *, int32);
+	bool8	HeaderCheck (uint32, uint8 *);
 	uint32	HeaderRemove (uint32, int32 &, uint8 *);
-	uint32	FileLoader (uint8 *, const char *, int32);
+	void	StreamCRC (uint8 *, uint32);
+	uint32	FileLoader (uint8 *, const char *, int32, bool8 allow_map = FALSE);
 	bool8	LoadROM (const char *);
 	bool8	LoadMultiCart (const char *, const char *);
 	bool8	LoadSufamiTurbo (const char *, const char *);
@@ -324,6 +349,7 @@ struct CMemory
 	void	Map_SameGameHiROMMap (void);
 	void	Map_SPC7110HiROMMap (void);
 
+	void	ScanROM (bool8);
 	uint16	checksum_calc_sum (uint8 *, uint32);
 	uint16	checksum_mirror_sum (uint8 *, uint32 &, uint32 mask = 0x800000);
 	void	Checksum_Calculate (void);
@@ -357,8 +383,8 @@ struct SMulti
 	char	fileNameA[PATH_MAX + 1], fileNameB[PATH_MAX + 1];
 };
 
-extern CMemory	Memory;
-extern SMulti	Multi;
+extern CONTEXT_LOCAL CMemory	Memory;
+extern CONTEXT_LOCAL SMulti	Multi;
 
 extern "C" void S9xAutoSaveSRAM (void);
 bool8 LoadZip(const char *, int32 *, int32 *, uint8 *);
@@ -376,6 +402,37 @@ enum s9xwriteorder_t
 	WRITE_10
 };
 
+// Watchpoints trap the 4 KB blocks they touch by swapping the Map/WriteMap
+// entries for MAP_WATCH, so other blocks keep their direct pointers. A
+// watchpoint on RAM or ROM also covers every mirror of it. Code that remaps
+// blocks while running calls S9xUpdateWatchpoints() afterwards to trap them
+// again, and S9xClearWatchTraps() first if it copies Map[] wholesale.
+
+#define MAX_WATCHPOINTS		16
+#define WATCH_READ			1
+#define WATCH_WRITE			2
+
+struct SWatchpoint
+{
+	uint32	address;
+	uint32	size;
+	uint8	type;	// 0 if the slot is free
+	uint8	*host;	// the watched memory, or NULL for registers
+	uint32	hits;
+};
+
+extern CONTEXT_LOCAL SWatchpoint	Watchpoints[MAX_WATCHPOINTS];
+extern CONTEXT_LOCAL void			(*S9xWatchpointHook) (uint32, uint8, uint8);
+
+int S9xAddWatchpoint (uint32, uint32, uint8);
+void S9xRemoveWatchpoint (int);
+void S9xUpdateWatchpoints (void);
+void S9xClearWatchTraps (void);
+uint8 S9xGetByteWatched (uint32);
+uint16 S9xGetWordWatched (uint32, enum s9xwrap_t);
+void S9xSetByteWatched (uint8, uint32);
+void S9xSetWordWatched (uint16, uint32, enum s9xwrap_t, enum s9xwriteorder_t);
+
 #include "getset.h"
 
 #endif
@@ -223,7 +223,8 @@ enum
 	S9X_WRONG_MOVIE_SNAPSHOT,
 	S9X_NOT_A_MOVIE_SNAPSHOT,
 	S9X_SNAPSHOT_INCONSISTENT,
-	S9X_AVI_INFO
+	S9X_AVI_INFO,
+	S9X_FILTER_BENCHMARK
 };
 
 #endif
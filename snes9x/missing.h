@@ -250,7 +250,7 @@ struct Missing
 	uint16	unknowndsp_write;
 };
 
-extern struct Missing	missing;
+extern CONTEXT_LOCAL struct Missing	missing;
 
 #endif
 
@@ -227,6 +227,9 @@
 #include "netplay.h"
 #include "snapshot.h"
 #include "display.h"
+#include "cpuexec.h"
+#include "movie.h"
+#include "apu/apu.h"
 
 void S9xNPClientLoop (void *);
 bool8 S9xNPLoadROM (uint32 len);
@@ -263,6 +266,7 @@ bool8 S9xNPConnectToServer (const char *hostname, int port,
     NetPlay.ROMName = strdup (rom_name);
     NetPlay.Port = port;
     NetPlay.PendingWait4Sync = FALSE;
+    memset (NetPlay.LastJoypads, 0, sizeof (NetPlay.LastJoypads));
 
 #ifdef __WIN32__
     if (GUI.ClientSemaphore == NULL)
@@ -367,7 +371,11 @@ on the remote machine on this port?");
 
     *ptr++ = NP_CLNT_MAGIC;
     *ptr++ = NetPlay.MySequenceNum++;
+#ifdef ZLIB
+    *ptr++ = NP_CLNT_HELLO | NP_CLNT_HELLO_ZLIB;
+#else
     *ptr++ = NP_CLNT_HELLO;
+#endif
     WRITE_LONG (ptr, len);
     ptr += 4;
 #ifdef __WIN32__
@@ -448,6 +456,12 @@ version of the protocol. Disconnecting.");
     NetPlay.Player = data [1];
     delete data;
 
+    if (Settings.NetPlayRollback && !S9xNPRollbackInit (Settings.NetPlayRollback))
+    {
+        S9xNPDisconnect ();
+        return (FALSE);
+    }
+
     NetPlay.PendingWait4Sync = TRUE;
     Settings.NetPlay = TRUE;
     S9xNPResetJoypadReadPos ();
@@ -589,9 +603,11 @@ bool8 S9xNPWaitForHeartBeatDelay (uint32 time_msec)
     return TRUE;
 }
 
+static void S9xNPRollbackConfirm ();
+
 bool8 S9xNPWaitForHeartBeat ()
 {
-    uint8 header [3 + 4 + 4 * 5];
+    uint8 header [3 + 4 + 4 * NP_MAX_CLIENTS];
 
     while (S9xNPGetData (NetPlay.Socket, header, 3 + 4))
     {
@@ -613,12 +629,25 @@ bool8 S9xNPWaitForHeartBeat ()
 
         if ((header [2] & 0x1f) == NP_SERV_JOYPAD)
         {
-            // Top 2 bits + 1 of opcode is joypad data count.
-            int num = (header [2] >> 6) + 1;
+            // Joypad count, then a mask of the joypads that follow; the
+            // rest are as they were in the last heart-beat.
+            uint8 counts [2];
+            int changed = 0;
+            int i;
+
+            if (!S9xNPGetData (NetPlay.Socket, counts, 2) ||
+                counts [0] > NP_MAX_CLIENTS || (counts [1] >> counts [0]))
+            {
+                S9xNPSetError ("Error while receiving 'JOYPAD' message.");
+                S9xNPDisconnect ();
+                return (FALSE);
+            }
+            for (i = 0; i < counts [0]; i++)
+                changed += (counts [1] >> i) & 1;
 
-            if (num)
+            if (changed)
             {
-                if (!S9xNPGetData (NetPlay.Socket, header + 3 + 4, num * 4))
+                if (!S9xNPGetData (NetPlay.Socket, header + 3 + 4, changed * 4))
                 {
                     S9xNPSetError ("Error while receiving 'JOYPAD' message.");
                     S9xNPDisconnect ();
@@ -627,10 +656,21 @@ bool8 S9xNPWaitForHeartBeat ()
             }
             NetPlay.Frame [NetPlay.JoypadWriteInd] = READ_LONG (&header [3]);
 
-			int i;
+            uint8 *ptr = header + 3 + 4;
 
-			for (i = 0; i < num; i++)
-                NetPlay.Joypads [NetPlay.JoypadWriteInd][i] = READ_LONG (&header [3 + 4 + i * sizeof (uint32)]);
+			for (i = 0; i < counts [0]; i++)
+			{
+				if (counts [1] & (1 << i))
+				{
+					NetPlay.LastJoypads [i] = READ_LONG (ptr);
+					ptr += 4;
+				}
+			}
+			for (; i < NP_MAX_CLIENTS; i++)
+				NetPlay.LastJoypads [i] = 0;
+
+			for (i = 0; i < NP_MAX_CLIENTS; i++)
+				NetPlay.Joypads [NetPlay.JoypadWriteInd][i] = NetPlay.LastJoypads [i];
 
 			for (i = 0; i < NP_MAX_CLIENTS; i++)
 				NetPlay.JoypadsReady [NetPlay.JoypadWriteInd][i] = TRUE;
@@ -639,6 +679,11 @@ bool8 S9xNPWaitForHeartBeat ()
 
             NetPlay.JoypadWriteInd = (NetPlay.JoypadWriteInd + 1) % NP_JOYPAD_HIST_SIZE;
 
+            // Note any misprediction as soon as its heart-beat arrives; the
+            // next S9xNPRollbackRunFrame re-emulates from there.
+            if (NetPlay.Rollback)
+                S9xNPRollbackConfirm ();
+
             if (NetPlay.JoypadWriteInd != (NetPlay.JoypadReadInd + 1) % NP_JOYPAD_HIST_SIZE)
             {
                 //printf ("(%d)", (NetPlay.JoypadWriteInd - NetPlay.JoypadReadInd) % NP_JOYPAD_HIST_SIZE); fflush (stdout);
@@ -656,7 +701,9 @@ bool8 S9xNPWaitForHeartBeat ()
                 printf ("CLIENT: RESET received @%ld\n", S9xGetMilliTime () - START);
 #endif
                 S9xNPDiscardHeartbeats ();
+                S9xHoldSamples (TRUE);
 		S9xReset ();
+                S9xHoldSamples (FALSE);
                 NetPlay.FrameCount = READ_LONG (&header [3]);
                 S9xNPResetJoypadReadPos ();
                 S9xNPSendReady ();
@@ -784,8 +831,7 @@ bool8 S9xNPGetROMImage (uint32 len)
 #ifdef NP_DEBUG
     printf ("CLIENT: Hi-ROM: %s, Size: %04x\n", rom_info [0] ? "Y" : "N", CalculatedSize);
 #endif
-    if (CalculatedSize + 5 >= len ||
-        CalculatedSize >= CMemory::MAX_ROM_SIZE)
+    if (CalculatedSize >= CMemory::MAX_ROM_SIZE)
     {
         S9xNPSetError ("Size error in ROM image data received from server.");
         S9xNPDisconnect ();
@@ -802,7 +848,9 @@ bool8 S9xNPGetROMImage (uint32 len)
     printf ("CLIENT: Receiving ROM image @%ld...\n", S9xGetMilliTime () - START);
 #endif
     S9xNPSetAction ("Receiving ROM image...");
-    if (!S9xNPGetData (NetPlay.Socket, Memory.ROM, Memory.CalculatedSize))
+    uint32 packed_len;
+    if (!S9xNPGetChunks (NetPlay.Socket, Memory.ROM, Memory.CalculatedSize, packed_len) ||
+        packed_len + 5 >= len)
     {
         S9xNPSetError ("Error while receiving ROM image from server.");
         Settings.StopEmulation = TRUE;
@@ -813,7 +861,7 @@ bool8 S9xNPGetROMImage (uint32 len)
     printf ("CLIENT: Receiving ROM filename @%ld...\n", S9xGetMilliTime () - START);
 #endif
     S9xNPSetAction ("Receiving ROM filename...");
-    uint32 filename_len = len - Memory.CalculatedSize - 5;
+    uint32 filename_len = len - packed_len - 5;
     if (filename_len > PATH_MAX ||
         !S9xNPGetData (NetPlay.Socket, (uint8 *) Memory.ROMFilename, filename_len))
     {
@@ -823,7 +871,9 @@ bool8 S9xNPGetROMImage (uint32 len)
         return (FALSE);
     }
     Memory.InitROM ();
+    S9xHoldSamples (TRUE);
     S9xReset ();
+    S9xHoldSamples (FALSE);
     S9xNPResetJoypadReadPos ();
     Settings.StopEmulation = FALSE;
 
@@ -836,14 +886,26 @@ bool8 S9xNPGetROMImage (uint32 len)
 
 void S9xNPGetSRAMData (uint32 len)
 {
-    if (len > 0x10000)
+    uint8 sram_size [4];
+    uint32 size, packed_len = 0;
+
+    S9xNPSetAction ("Receiving S-RAM data...");
+    if (len < 4 || !S9xNPGetData (NetPlay.Socket, sram_size, 4))
+    {
+        S9xNPSetError ("Error while receiving S-RAM data from server.");
+        S9xNPDisconnect ();
+        return;
+    }
+    size = READ_LONG (sram_size);
+    if (size > 0x10000)
     {
         S9xNPSetError ("Length error in S-RAM data received from server.");
         S9xNPDisconnect ();
         return;
     }
-    S9xNPSetAction ("Receiving S-RAM data...");
-    if (len > 0 && !S9xNPGetData (NetPlay.Socket, Memory.SRAM, len))
+    if (size > 0 &&
+        (!S9xNPGetChunks (NetPlay.Socket, Memory.SRAM, size, packed_len) ||
+         packed_len != len - 4))
     {
         S9xNPSetError ("Error while receiving S-RAM data from server.");
         S9xNPDisconnect ();
@@ -853,26 +915,36 @@ void S9xNPGetSRAMData (uint32 len)
 
 void S9xNPGetFreezeFile (uint32 len)
 {
-    uint8 frame_count [4];
+    uint8 frame_count [4 + 4];
+    uint32 packed_len;
 
 #ifdef NP_DEBUG
     printf ("CLIENT: Receiving freeze file information @%ld...\n", S9xGetMilliTime () - START);
 #endif
     S9xNPSetAction ("Receiving freeze file information...");
-    if (!S9xNPGetData (NetPlay.Socket, frame_count, 4))
+    if (len < 8 || !S9xNPGetData (NetPlay.Socket, frame_count, 8))
     {
         S9xNPSetError ("Error while receiving freeze file information from server.");
         S9xNPDisconnect ();
         return;
     }
     NetPlay.FrameCount = READ_LONG (frame_count);
+    packed_len = len - 8;
+    len = READ_LONG (frame_count + 4);
+    if (len > CMemory::MAX_ROM_SIZE)
+    {
+        S9xNPSetError ("Size error in freeze file received from server.");
+        S9xNPDisconnect ();
+        return;
+    }
 
 #ifdef NP_DEBUG
     printf ("CLIENT: Receiving freeze file @%ld...\n", S9xGetMilliTime () - START);
 #endif
     S9xNPSetAction ("Receiving freeze file...");
     uint8 *data = new uint8 [len];
-    if (!S9xNPGetData (NetPlay.Socket, data, len - 4))
+    uint32 got_len;
+    if (!S9xNPGetChunks (NetPlay.Socket, data, len, got_len) || got_len != packed_len)
     {
         S9xNPSetError ("Error while receiving freeze file from server.");
         S9xNPDisconnect ();
@@ -965,6 +1037,8 @@ void S9xNPStepJoypadHistory ()
 }
 
 
+static void S9xNPRollbackReset ();
+
 void S9xNPResetJoypadReadPos ()
 {
 #ifdef NP_DEBUG
@@ -976,6 +1050,20 @@ void S9xNPResetJoypadReadPos ()
         memset ((void *) &NetPlay.Joypads [h], 0, sizeof (NetPlay.Joypads [0]));
     for (int h = 0; h < NP_JOYPAD_HIST_SIZE; h++)
         memset ((void *) &NetPlay.JoypadsReady [h], 0, sizeof (NetPlay.JoypadsReady [0]));
+    NetPlay.JoypadSent = FALSE;
+    S9xNPRollbackReset ();
+}
+
+// The server keeps using the last joypad state it got from us, so nothing is
+// sent while it stays the same.
+static bool8 S9xNPJoypadUnchanged (uint32 joypad)
+{
+    if (NetPlay.JoypadSent && NetPlay.SentJoypad == joypad)
+        return (TRUE);
+
+    NetPlay.JoypadSent = TRUE;
+    NetPlay.SentJoypad = joypad;
+    return (FALSE);
 }
 
 bool8 S9xNPSendJoypadUpdate (uint32 joypad)
@@ -983,6 +1071,9 @@ bool8 S9xNPSendJoypadUpdate (uint32 joypad)
     uint8 data [7];
     uint8 *ptr = data;
 
+    if (S9xNPJoypadUnchanged (joypad))
+        return (TRUE);
+
     *ptr++ = NP_CLNT_MAGIC;
     *ptr++ = NetPlay.MySequenceNum++;
     *ptr++ = NP_CLNT_JOYPAD;
@@ -999,6 +1090,279 @@ bool8 S9xNPSendJoypadUpdate (uint32 joypad)
     return (TRUE);
 }
 
+bool8 S9xNPSendJoypadFrameUpdate (uint32 joypad, uint32 frame)
+{
+    uint8 data [11];
+    uint8 *ptr = data;
+
+    if (S9xNPJoypadUnchanged (joypad))
+        return (TRUE);
+
+    *ptr++ = NP_CLNT_MAGIC;
+    *ptr++ = NetPlay.MySequenceNum++;
+    *ptr++ = NP_CLNT_JOYPAD_FRAME;
+
+    joypad |= 0x80000000;
+
+    WRITE_LONG (ptr, joypad);
+    ptr += 4;
+    WRITE_LONG (ptr, frame);
+    if (!S9xNPSendData (NetPlay.Socket, data, 11))
+    {
+        S9xNPSetError ("Error while sending joypad data server.");
+	S9xNPDisconnect ();
+	return (FALSE);
+    }
+    return (TRUE);
+}
+
+/*
+ * Rollback mode
+ *
+ * Rather than waiting for the server's heart-beat before each frame, the
+ * client runs ahead of it, predicting that every remote joypad keeps the
+ * state it had in the last heart-beat received. The state at the start of
+ * each frame is kept in a ring of in-memory snapshots, along with the input
+ * the frame was run with. When a heart-beat shows a prediction was wrong,
+ * the snapshot for that frame is restored and the frames up to the present
+ * are emulated again, without rendering, using the corrected input. A
+ * client that gets RollbackFrames ahead of the server waits for it.
+ */
+
+static uint8 *S9xNPRollbackSlot (uint32 frame)
+{
+    return (NetPlay.RollbackState + (frame % NetPlay.RollbackFrames) * NetPlay.RollbackSize);
+}
+
+static void S9xNPRollbackReset ()
+{
+    if (!NetPlay.Rollback)
+        return;
+
+    uint32 size = S9xFreezeSize ();
+
+    if (size != NetPlay.RollbackSize)
+    {
+        delete [] NetPlay.RollbackState;
+        NetPlay.RollbackState = new uint8 [NetPlay.RollbackFrames * size];
+        NetPlay.RollbackSize = size;
+    }
+
+    for (int f = 0; f < NP_ROLLBACK_FRAMES; f++)
+        NetPlay.RollbackFrame [f] = ~0;
+
+    NetPlay.RollbackFrom = 0;
+    NetPlay.ConfirmedFrame = NetPlay.FrameCount;
+    memset (NetPlay.ConfirmedJoypads, 0, sizeof (NetPlay.ConfirmedJoypads));
+}
+
+bool8 S9xNPRollbackInit (uint32 frames)
+{
+    S9xNPRollbackDeinit ();
+
+    if (frames < 2 || frames > NP_ROLLBACK_FRAMES)
+    {
+        sprintf (NetPlay.ErrorMsg, "Rollback window must be between 2 and %d frames.", NP_ROLLBACK_FRAMES);
+        S9xNPSetError (NetPlay.ErrorMsg);
+        return (FALSE);
+    }
+
+    NetPlay.RollbackFrames = frames;
+    NetPlay.RollbackCount = 0;
+    NetPlay.Resimulating = FALSE;
+    NetPlay.Rollback = TRUE;
+    S9xNPRollbackReset ();
+
+    return (TRUE);
+}
+
+void S9xNPRollbackDeinit ()
+{
+    delete [] NetPlay.RollbackState;
+    NetPlay.RollbackState = NULL;
+    NetPlay.RollbackSize = 0;
+    NetPlay.Rollback = FALSE;
+}
+
+static void S9xNPRollbackSave (uint32 frame)
+{
+    uint32 slot = frame % NetPlay.RollbackFrames;
+
+    if (S9xFreezeGameMem (S9xNPRollbackSlot (frame), NetPlay.RollbackSize))
+        NetPlay.RollbackFrame [slot] = frame;
+    else
+    {
+        NetPlay.RollbackFrame [slot] = ~0;
+        S9xNPSetWarning ("CLIENT: Rollback snapshot didn't fit its buffer.");
+    }
+}
+
+// Consumes the heart-beats received for frames already emulated and for the
+// one about to be, noting the earliest frame whose input was mispredicted.
+static void S9xNPRollbackConfirm ()
+{
+    while ((NetPlay.JoypadReadInd + 1) % NP_JOYPAD_HIST_SIZE != NetPlay.JoypadWriteInd)
+    {
+        uint32 ind = (NetPlay.JoypadReadInd + 1) % NP_JOYPAD_HIST_SIZE;
+        uint32 frame = NetPlay.Frame [ind];
+        uint32 slot = frame % NetPlay.RollbackFrames;
+
+        if (frame > NetPlay.FrameCount + 1)
+            break;
+
+        NetPlay.JoypadReadInd = ind;
+
+        if (frame != NetPlay.ConfirmedFrame + 1)
+        {
+            S9xNPSetWarning ("This Snes9X session may be out of sync with the server.");
+#ifdef NP_DEBUG
+            printf ("*** CLIENT: heart-beat out of order (%d, %d) @%ld\n", NetPlay.ConfirmedFrame + 1, frame, S9xGetMilliTime () - START);
+#endif
+        }
+
+        NetPlay.ConfirmedFrame = frame;
+        memcpy (NetPlay.ConfirmedJoypads, NetPlay.Joypads [ind], sizeof (NetPlay.ConfirmedJoypads));
+
+        if (frame <= NetPlay.FrameCount && NetPlay.RollbackFrame [slot] == frame &&
+            memcmp (NetPlay.RollbackInput [slot], NetPlay.ConfirmedJoypads, sizeof (NetPlay.ConfirmedJoypads)) != 0)
+        {
+            memcpy (NetPlay.RollbackInput [slot], NetPlay.ConfirmedJoypads, sizeof (NetPlay.ConfirmedJoypads));
+            if (!NetPlay.RollbackFrom || frame < NetPlay.RollbackFrom)
+                NetPlay.RollbackFrom = frame;
+        }
+    }
+}
+
+static void S9xNPRollbackSetInput (uint32 frame)
+{
+    uint32 slot = frame % NetPlay.RollbackFrames;
+    uint32 *pads = NetPlay.RollbackInput [slot];
+
+    // Frames before the last confirmed one already hold the server's input.
+    if (frame >= NetPlay.ConfirmedFrame)
+    {
+        memcpy (pads, NetPlay.ConfirmedJoypads, sizeof (NetPlay.ConfirmedJoypads));
+        if (frame > NetPlay.ConfirmedFrame && NetPlay.Player >= 1 && NetPlay.Player <= NP_MAX_CLIENTS)
+            pads [NetPlay.Player - 1] = NetPlay.RollbackLocal [slot];
+    }
+
+    for (int i = 0; i < NP_MAX_CLIENTS; i++)
+        MovieSetJoypad (i, pads [i] & 0xffff);
+}
+
+// The sound for the re-emulated frames has already been queued, so it is left
+// as it is rather than being cleared by the restore and queued a second time.
+static void S9xNPRollbackResimulate ()
+{
+    uint32 from = NetPlay.RollbackFrom;
+    int result;
+
+    NetPlay.RollbackFrom = 0;
+
+    S9xHoldSamples (TRUE);
+    result = S9xUnfreezeGameMem (S9xNPRollbackSlot (from), NetPlay.RollbackSize);
+    if (result != SUCCESS)
+    {
+        S9xHoldSamples (FALSE);
+        S9xNPSetWarning ("CLIENT: Failed to restore rollback snapshot.");
+        return;
+    }
+
+#if defined(NP_DEBUG) && NP_DEBUG >= 2
+    printf ("CLIENT: Rolling back %d frames @%ld\n", NetPlay.FrameCount + 1 - from, S9xGetMilliTime () - START);
+#endif
+    NetPlay.RollbackCount++;
+    NetPlay.Resimulating = TRUE;
+
+    for (uint32 frame = from; frame <= NetPlay.FrameCount; frame++)
+    {
+        if (frame != from)
+            S9xNPRollbackSave (frame);
+        S9xNPRollbackSetInput (frame);
+        IPPU.RenderThisFrame = FALSE;
+        S9xMainLoop ();
+    }
+
+    NetPlay.Resimulating = FALSE;
+    S9xHoldSamples (FALSE);
+}
+
+static bool8 S9xNPRollbackAdvance (uint32 joypad)
+{
+    uint32 frame = NetPlay.FrameCount + 1;
+
+    joypad |= 0x80000000;
+
+    if (!S9xNPSendJoypadFrameUpdate (joypad, frame))
+        return (FALSE);
+
+    NetPlay.FrameCount = frame;
+    NetPlay.RollbackLocal [frame % NetPlay.RollbackFrames] = joypad;
+    S9xNPRollbackSave (frame);
+    S9xNPRollbackSetInput (frame);
+    S9xMainLoop ();
+
+    return (TRUE);
+}
+
+// Emulates one frame in rollback mode; used in place of S9xMainLoop () while
+// connected. Returns FALSE if no frame could be emulated. Of the frames run,
+// only the last is drawn, and only if frame skipping would have drawn it.
+bool8 S9xNPRollbackRunFrame ()
+{
+    uint16 joypads [NP_MAX_CLIENTS];
+    bool8 render = IPPU.RenderThisFrame;
+    bool8 ok;
+    int i;
+
+    while (NetPlay.Connected && S9xNPCheckForHeartBeat (0))
+    {
+        if (!S9xNPWaitForHeartBeat ())
+            return (FALSE);
+    }
+
+    if (!NetPlay.Connected || NetPlay.Paused)
+        return (FALSE);
+
+    S9xNPRollbackConfirm ();
+
+    if (NetPlay.FrameCount + 1 - NetPlay.ConfirmedFrame >= NetPlay.RollbackFrames)
+    {
+        // Too far ahead of the server, wait for it to catch up.
+        S9xNPWaitForHeartBeatDelay (Settings.FrameTime / 1000);
+        return (FALSE);
+    }
+
+    for (i = 0; i < NP_MAX_CLIENTS; i++)
+        joypads [i] = MovieGetJoypad (i);
+
+    if (NetPlay.RollbackFrom)
+        S9xNPRollbackResimulate ();
+
+    // Behind the server, emulate an extra frame without drawing it.
+    if ((NetPlay.JoypadReadInd + 1) % NP_JOYPAD_HIST_SIZE != NetPlay.JoypadWriteInd)
+    {
+        NetPlay.Resimulating = TRUE;
+        IPPU.RenderThisFrame = FALSE;
+        ok = S9xNPRollbackAdvance (joypads [0]);
+        NetPlay.Resimulating = FALSE;
+        if (ok)
+            S9xNPRollbackConfirm ();
+    }
+    else
+        ok = TRUE;
+
+    IPPU.RenderThisFrame = render;
+
+    if (ok)
+        ok = S9xNPRollbackAdvance (joypads [0]);
+
+    for (i = 0; i < NP_MAX_CLIENTS; i++)
+        MovieSetJoypad (i, joypads [i]);
+
+    return (ok);
+}
+
 void S9xNPDisconnect ()
 {
     close (NetPlay.Socket);
@@ -1135,6 +1499,93 @@ bool8 S9xNPGetData (int socket, uint8 *data, int length)
     return (TRUE);
 }
 
+// Packs 'len' bytes into chunks as described in netplay.h, compressing them
+// only if 'compress' is set. 'packed' must have room for NP_PACKED_BOUND (len)
+// bytes. Returns the packed length.
+uint32 S9xNPPackChunks (const uint8 *data, uint32 len, uint8 *packed, bool8 compress)
+{
+    uint8 *ptr = packed;
+
+    for (uint32 pos = 0; pos < len; pos += NP_CHUNK_SIZE)
+    {
+        uint32 raw = len - pos < NP_CHUNK_SIZE ? len - pos : NP_CHUNK_SIZE;
+        uint32 size = raw;
+
+#ifdef ZLIB
+        uLongf dest_len = raw;
+
+        // Z_BUF_ERROR just means it wouldn't get any smaller.
+        if (compress &&
+            compress2 (ptr + 8, &dest_len, data + pos, raw, Z_BEST_SPEED) == Z_OK &&
+            dest_len < raw)
+            size = dest_len;
+        else
+#endif
+            memcpy (ptr + 8, data + pos, raw);
+
+        WRITE_LONG (ptr, raw);
+        WRITE_LONG (ptr + 4, size);
+        ptr += 8 + size;
+    }
+
+    return (ptr - packed);
+}
+
+// Receives exactly 'len' bytes sent by S9xNPPackChunks, returning how many
+// bytes they took on the wire in 'packed_len'.
+bool8 S9xNPGetChunks (int fd, uint8 *data, uint32 len, uint32 &packed_len)
+{
+    uint8 *buffer = NULL;
+    uint32 pos = 0;
+    bool8 ok = TRUE;
+
+    packed_len = 0;
+    while (ok && pos < len)
+    {
+        uint8 chunk [8];
+
+        if (!S9xNPGetData (fd, chunk, 8))
+        {
+            ok = FALSE;
+            break;
+        }
+
+        uint32 raw = READ_LONG (chunk);
+        uint32 size = READ_LONG (chunk + 4);
+
+        if (raw == 0 || raw > NP_CHUNK_SIZE || raw > len - pos || size > raw)
+        {
+            ok = FALSE;
+            break;
+        }
+
+        if (size == raw)
+            ok = S9xNPGetData (fd, data + pos, raw);
+        else
+        {
+#ifdef ZLIB
+            uLongf dest_len = raw;
+
+            if (!buffer)
+                buffer = new uint8 [NP_CHUNK_SIZE];
+            ok = S9xNPGetData (fd, buffer, size) &&
+                 uncompress (data + pos, &dest_len, buffer, size) == Z_OK &&
+                 dest_len == raw;
+#else
+            // We didn't say we could take compressed data in our HELLO.
+            ok = FALSE;
+#endif
+        }
+
+        pos += raw;
+        packed_len += 8 + size;
+        NetPlay.PercentageComplete = (uint8) (((uint64) pos * 100) / len);
+    }
+
+    delete [] buffer;
+    return (ok);
+}
+
 bool8 S9xNPInitialise ()
 {
 #ifdef __WIN32__
@@ -187,6 +187,13 @@
  * opcode       1
  * joypad data  4
  *
+ * Client to server frame-tagged joypad update (rollback clients)
+ * magic        1
+ * sequence_no  1
+ * opcode       1
+ * joypad data  4
+ * frame        4
+ *
  * Server to client joypad update
  * magic        1
  * sequence_no  1
@@ -196,11 +203,18 @@
 
 //#define NP_DEBUG 1
 
-#define NP_VERSION 10
+#define NP_VERSION 12
 #define NP_JOYPAD_HIST_SIZE 120
+#define NP_ROLLBACK_FRAMES 16
 #define NP_DEFAULT_PORT 6096
 
 #define NP_MAX_CLIENTS 8
+// Session 0 is the game hosted by this emulator, the others are relay rooms
+// that only pass input between clients, each on its own port.
+#define NP_MAX_SESSIONS 16
+#define NP_MAX_SEND_QUEUE (32 * 1024 * 1024)
+#define NP_CHUNK_SIZE 0x10000
+#define NP_PACKED_BOUND(l) ((l) + ((l) / NP_CHUNK_SIZE + 1) * 8)
 
 #define NP_SERV_MAGIC 'S'
 #define NP_CLNT_MAGIC 'C'
@@ -217,6 +231,10 @@
 #define NP_CLNT_LOADED_ROM 9
 #define NP_CLNT_RECEIVED_ROM_IMAGE 10
 #define NP_CLNT_WAITING_FOR_ROM_IMAGE 11
+#define NP_CLNT_JOYPAD_FRAME 12
+
+// Set in the HELLO opcode by clients that can take compressed chunks.
+#define NP_CLNT_HELLO_ZLIB 0x40
 
 #define NP_SERV_HELLO 0
 #define NP_SERV_JOYPAD 1
@@ -240,6 +258,15 @@ struct SNPClient
     char *ROMName;
     char *HostName;
     char *Who;
+    uint8 *SendQueue;
+    uint32 SendHead;
+    uint32 SendTail;
+    uint32 SendSize;
+    bool8 WantWrite;
+    uint8 *RecvBuffer;
+    uint32 RecvLen;
+    uint32 RecvSize;
+    bool8 Compress;
 };
 
 enum {
@@ -273,10 +300,17 @@ struct SNPServer
     uint32 FrameCount;
     char   ROMName [30];
     uint32 Joypads [NP_MAX_CLIENTS];
+    uint32 PendingJoypads [NP_MAX_CLIENTS][NP_ROLLBACK_FRAMES];
+    uint32 PendingFrame [NP_MAX_CLIENTS][NP_ROLLBACK_FRAMES];
+    uint32 SentJoypads [NP_MAX_CLIENTS];
+    uint8  HeartBeatClients;
     bool8  ClientPaused;
     uint32 Paused;
     bool8  SendROMImageOnConnect;
     bool8  SyncByReset;
+    bool8  Active;
+    bool8  Relay;
+    int64  NextFrame;
 };
 
 #define NP_MAX_ACTION_LEN 200
@@ -310,6 +344,21 @@ struct SNetPlay
     uint32 MaxFrameSkip;
     uint32 MaxBehindFrameCount;
     bool8 JoypadsReady [NP_JOYPAD_HIST_SIZE][NP_MAX_CLIENTS];
+    uint32 LastJoypads [NP_MAX_CLIENTS];
+    uint32 SentJoypad;
+    bool8  JoypadSent;
+    bool8  Rollback;
+    bool8  Resimulating;
+    uint32 RollbackFrames;
+    uint32 RollbackSize;
+    uint8 *RollbackState;
+    uint32 RollbackFrame [NP_ROLLBACK_FRAMES];
+    uint32 RollbackInput [NP_ROLLBACK_FRAMES][NP_MAX_CLIENTS];
+    uint32 RollbackLocal [NP_ROLLBACK_FRAMES];
+    uint32 RollbackFrom;
+    uint32 RollbackCount;
+    uint32 ConfirmedFrame;
+    uint32 ConfirmedJoypads [NP_MAX_CLIENTS];
     char   ActionMsg [NP_MAX_ACTION_LEN];
     char   ErrorMsg [NP_MAX_ACTION_LEN];
     char   WarningMsg [NP_MAX_ACTION_LEN];
@@ -322,6 +371,18 @@ extern "C" struct SNetPlay NetPlay;
 // header
 // frame_time (4)
 // ROMName (variable)
+//
+// NETPLAY_SERVER_JOYPAD message format:
+// header (frame number in the length field, bit 5 of the opcode is paused)
+// joypad count (1)
+// mask of the joypads that changed since the last heart-beat (1)
+// joypad (4) for each bit set in the mask
+//
+// ROM images, S-RAM and freeze files are sent as a run of chunks of at most
+// NP_CHUNK_SIZE bytes each, zlib-compressed when that makes them smaller:
+// unpacked length (4)
+// packed length (4), equal to the unpacked length if stored as-is
+// data (packed length)
 
 #define WRITE_LONG(p, v) { \
 *((p) + 0) = (uint8) ((v) >> 24); \
@@ -343,10 +404,16 @@ bool8 S9xNPWaitForHeartBeatDelay (uint32 time_msec = 0);
 bool8 S9xNPCheckForHeartBeat (uint32 time_msec = 0);
 uint32 S9xNPGetJoypad (int which1);
 bool8 S9xNPSendJoypadUpdate (uint32 joypad);
+bool8 S9xNPSendJoypadFrameUpdate (uint32 joypad, uint32 frame);
+bool8 S9xNPRollbackInit (uint32 frames);
+void S9xNPRollbackDeinit ();
+bool8 S9xNPRollbackRunFrame ();
 void S9xNPDisconnect ();
 bool8 S9xNPInitialise ();
 bool8 S9xNPSendData (int fd, const uint8 *data, int len);
 bool8 S9xNPGetData (int fd, uint8 *data, int len);
+uint32 S9xNPPackChunks (const uint8 *data, uint32 len, uint8 *packed, bool8 compress);
+bool8 S9xNPGetChunks (int fd, uint8 *data, uint32 len, uint32 &packed_len);
 
 void S9xNPSyncClients ();
 void S9xNPStepJoypadHistory ();
@@ -367,6 +434,7 @@ void S9xNPServerQueueSendingLoadROMRequest (const char *filename);
 void S9xNPServerAddTask (uint32 task, void *data);
 
 bool8 S9xNPStartServer (int port);
+bool8 S9xNPAddRelaySession (int port);
 void S9xNPStopServer ();
 #ifdef __WIN32__
 #define S9xGetMilliTime timeGetTime
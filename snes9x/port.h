@@ -280,6 +280,23 @@ typedef unsigned long long	uint64;
 #define START_EXTERN_C	extern "C" {
 #define END_EXTERN_C	}
 
+// Building with EMU_CONTEXTS makes the emulated machine's state thread-local,
+// so that each thread can initialise and run a SNES of its own in the same
+// process. CONTEXT_LOCAL_CLASS is for the few objects with constructors.
+// Large tables, and the sound state a mixing thread needs, are kept out of
+// thread-local storage in the SEmuContext the thread binds (see context.h).
+#ifdef EMU_CONTEXTS
+#ifdef _MSC_VER
+#define CONTEXT_LOCAL		__declspec(thread)
+#else
+#define CONTEXT_LOCAL		__thread
+#endif
+#define CONTEXT_LOCAL_CLASS	thread_local
+#else
+#define CONTEXT_LOCAL
+#define CONTEXT_LOCAL_CLASS
+#endif
+
 #ifndef __WIN32__
 #ifndef PATH_MAX
 #define PATH_MAX	1024
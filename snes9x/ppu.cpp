@@ -194,7 +194,7 @@
 #include "missing.h"
 #endif
 
-extern uint8	*HDMAMemPointers[8];
+extern CONTEXT_LOCAL uint8	*HDMAMemPointers[8];
 
 
 static inline void S9xLatchCounters (bool force)
@@ -281,6 +281,37 @@ void S9xUpdateHVTimerPosition (void)
 	S9xTraceFormattedMessage("--- IRQ Timer set  HTimer:%d Pos:%04d  VTimer:%d Pos:%03d",
 		PPU.HTimerEnabled, PPU.HTimerPosition, PPU.VTimerEnabled, PPU.VTimerPosition);
 #endif
+
+	S9xUpdateIRQPositions(FALSE);
+}
+
+// Sets Timings.NextIRQTimer to the cycle on the current scanline at which the
+// H/V timer raises /IRQ. Only this scanline is looked at; the deadline is
+// worked out again at the start of every line.
+void S9xUpdateIRQPositions (bool8 linestart)
+{
+	if (linestart)
+		CPU.IRQLastState = FALSE;
+
+	Timings.NextIRQTimer = 0x0fffffff;
+
+	if (PPU.VTimerEnabled && CPU.V_Counter != PPU.VTimerPosition)
+		return;
+
+	if (PPU.HTimerEnabled)
+	{
+		// The H timer fires when the counter passes HTimerPosition,
+		// so a position already behind us waits for the next line.
+		if (PPU.HTimerPosition < Timings.H_Max && (linestart || CPU.Cycles < PPU.HTimerPosition))
+			Timings.NextIRQTimer = PPU.HTimerPosition;
+	}
+	else
+	if (PPU.VTimerEnabled)
+	{
+		// The V timer alone fires once, as the line begins.
+		if (!CPU.IRQLastState)
+			Timings.NextIRQTimer = linestart ? 0 : CPU.Cycles;
+	}
 }
 
 void S9xFixColourBrightness (void)
@@ -1488,6 +1519,8 @@ void S9xSetCPU (uint8 Byte, uint16 Address)
 					CPU.IRQTransition = FALSE;
 				}
 
+				S9xUpdateIRQPositions(FALSE);
+
 				// NMI can trigger immediately during VBlank as long as NMI_read ($4210) wasn't cleard.
 				if ((Byte & 0x80) && !(Memory.FillRAM[0x4200] & 0x80) &&
 					(CPU.V_Counter >= PPU.ScreenHeight + FIRST_VISIBLE_LINE) && (Memory.FillRAM[0x4210] & 0x80))
@@ -1629,6 +1662,8 @@ void S9xSetCPU (uint8 Byte, uint16 Address)
 					}
 					else
 						CPU.FastROMSpeed = SLOW_ONE_CYCLE;
+
+					Memory.UpdateSpeedMap();
 				}
 
 				break;
@@ -1669,7 +1704,7 @@ uint8 S9xGetCPU (uint16 Address)
 	if (Address < 0x4200)
 	{
 	#ifdef SNES_JOY_READ_CALLBACKS
-		extern bool8 pad_read;
+		extern CONTEXT_LOCAL bool8 pad_read;
 		if (Address == 0x4016 || Address == 0x4017)
 		{
 			S9xOnSNESPadRead();
@@ -1755,6 +1790,9 @@ uint8 S9xGetCPU (uint16 Address)
 				return ((byte & 0x80) | (OpenBus & 0x70) | Model->_5A22);
 
 			case 0x4211: // TIMEUP
+				// The timer IRQ is only raised between instructions, so one
+				// due earlier in this instruction has to be taken first.
+				S9xCheckInterrupts();
 				byte = CPU.IRQLine ? 0x80 : 0;
 				CPU.IRQLine = FALSE;
 				CPU.IRQTransition = FALSE;
@@ -1781,7 +1819,7 @@ uint8 S9xGetCPU (uint16 Address)
 			case 0x421e: // JOY4L
 			case 0x421f: // JOY4H
 			#ifdef SNES_JOY_READ_CALLBACKS
-				extern bool8 pad_read;
+				extern CONTEXT_LOCAL bool8 pad_read;
 				if (Memory.FillRAM[0x4200] & 1)
 				{
 					S9xOnSNESPadRead();
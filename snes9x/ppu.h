@@ -367,8 +367,8 @@ struct SPPU
 };
 
 extern uint16				SignExtend[2];
-extern struct SPPU			PPU;
-extern struct InternalPPU	IPPU;
+extern CONTEXT_LOCAL struct SPPU			PPU;
+extern CONTEXT_LOCAL struct InternalPPU	IPPU;
 
 void S9xResetPPU (void);
 void S9xSoftResetPPU (void);
@@ -377,6 +377,7 @@ uint8 S9xGetPPU (uint16);
 void S9xSetCPU (uint8, uint16);
 uint8 S9xGetCPU (uint16);
 void S9xUpdateHVTimerPosition (void);
+void S9xUpdateIRQPositions (bool8);
 void S9xFixColourBrightness (void);
 void S9xDoAutoJoypad (void);
 
@@ -390,7 +391,7 @@ typedef struct
 	uint8	_5A22;
 }	SnesModel;
 
-extern SnesModel	*Model;
+extern CONTEXT_LOCAL SnesModel	*Model;
 extern SnesModel	M1SNES;
 extern SnesModel	M2SNES;
 
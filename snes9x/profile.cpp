@@ -0,0 +1,281 @@
+/***********************************************************************************
+  Snes9x - Portable Super Nintendo Entertainment System (TM) emulator.
+
+  (c) Copyright 1996 - 2002  Gary Henderson (gary.henderson@ntlworld.com),
+                             Jerremy Koot (jkoot@snes9x.com)
+
+  (c) Copyright 2002 - 2004  Matthew Kendora
+
+  (c) Copyright 2002 - 2005  Peter Bortas (peter@bortas.org)
+
+  (c) Copyright 2004 - 2005  Joel Yliluoma (http://iki.fi/bisqwit/)
+
+  (c) Copyright 2001 - 2006  John Weidman (jweidman@slip.net)
+
+  (c) Copyright 2002 - 2006  funkyass (funkyass@spam.shaw.ca),
+                             Kris Bleakley (codeviolation@hotmail.com)
+
+  (c) Copyright 2002 - 2010  Brad Jorsch (anomie@users.sourceforge.net),
+                             Nach (n-a-c-h@users.sourceforge.net),
+
+  (c) Copyright 2002 - 2011  zones (kasumitokoduck@yahoo.com)
+
+  (c) Copyright 2006 - 2007  nitsuja
+
+  (c) Copyright 2009 - 2011  BearOso,
+                             OV2
+
+
+  BS-X C emulator code
+  (c) Copyright 2005 - 2006  Dreamer Nom,
+                             zones
+
+  C4 x86 assembler and some C emulation code
+  (c) Copyright 2000 - 2003  _Demo_ (_demo_@zsnes.com),
+                             Nach,
+                             zsKnight (zsknight@zsnes.com)
+
+  C4 C++ code
+  (c) Copyright 2003 - 2006  Brad Jorsch,
+                             Nach
+
+  DSP-1 emulator code
+  (c) Copyright 1998 - 2006  _Demo_,
+                             Andreas Naive (andreasnaive@gmail.com),
+                             Gary Henderson,
+                             Ivar (ivar@snes9x.com),
+                             John Weidman,
+                             Kris Bleakley,
+                             Matthew Kendora,
+                             Nach,
+                             neviksti (neviksti@hotmail.com)
+
+  DSP-2 emulator code
+  (c) Copyright 2003         John Weidman,
+                             Kris Bleakley,
+                             Lord Nightmare (lord_nightmare@users.sourceforge.net),
+                             Matthew Kendora,
+                             neviksti
+
+  DSP-3 emulator code
+  (c) Copyright 2003 - 2006  John Weidman,
+                             Kris Bleakley,
+                             Lancer,
+                             z80 gaiden
+
+  DSP-4 emulator code
+  (c) Copyright 2004 - 2006  Dreamer Nom,
+                             John Weidman,
+                             Kris Bleakley,
+                             Nach,
+                             z80 gaiden
+
+  OBC1 emulator code
+  (c) Copyright 2001 - 2004  zsKnight,
+                             pagefault (pagefault@zsnes.com),
+                             Kris Bleakley
+                             Ported from x86 assembler to C by sanmaiwashi
+
+  SPC7110 and RTC C++ emulator code used in 1.39-1.51
+  (c) Copyright 2002         Matthew Kendora with research by
+                             zsKnight,
+                             John Weidman,
+                             Dark Force
+
+  SPC7110 and RTC C++ emulator code used in 1.52+
+  (c) Copyright 2009         byuu,
+                             neviksti
+
+  S-DD1 C emulator code
+  (c) Copyright 2003         Brad Jorsch with research by
+                             Andreas Naive,
+                             John Weidman
+
+  S-RTC C emulator code
+  (c) Copyright 2001 - 2006  byuu,
+                             John Weidman
+
+  ST010 C++ emulator code
+  (c) Copyright 2003         Feather,
+                             John Weidman,
+                             Kris Bleakley,
+                             Matthew Kendora
+
+  Super FX x86 assembler emulator code
+  (c) Copyright 1998 - 2003  _Demo_,
+                             pagefault,
+                             zsKnight
+
+  Super FX C emulator code
+  (c) Copyright 1997 - 1999  Ivar,
+                             Gary Henderson,
+                             John Weidman
+
+  Sound emulator code used in 1.5-1.51
+  (c) Copyright 1998 - 2003  Brad Martin
+  (c) Copyright 1998 - 2006  Charles Bilyue'
+
+  Sound emulator code used in 1.52+
+  (c) Copyright 2004 - 2007  Shay Green (gblargg@gmail.com)
+
+  SH assembler code partly based on x86 assembler code
+  (c) Copyright 2002 - 2004  Marcus Comstedt (marcus@mc.pp.se)
+
+  2xSaI filter
+  (c) Copyright 1999 - 2001  Derek Liauw Kie Fa
+
+  HQ2x, HQ3x, HQ4x filters
+  (c) Copyright 2003         Maxim Stepin (maxim@hiend3d.com)
+
+  NTSC filter
+  (c) Copyright 2006 - 2007  Shay Green
+
+  GTK+ GUI code
+  (c) Copyright 2004 - 2011  BearOso
+
+  Win32 GUI code
+  (c) Copyright 2003 - 2006  blip,
+                             funkyass,
+                             Matthew Kendora,
+                             Nach,
+                             nitsuja
+  (c) Copyright 2009 - 2011  OV2
+
+  Mac OS GUI code
+  (c) Copyright 1998 - 2001  John Stiles
+  (c) Copyright 2001 - 2011  zones
+
+
+  Specific ports contains the works of other authors. See headers in
+  individual files.
+
+
+  Snes9x homepage: http://www.snes9x.com/
+
+  Permission to use, copy, modify and/or distribute Snes9x in both binary
+  and source form, for non-commercial purposes, is hereby granted without
+  fee, providing that this license information and copyright notice appear
+  with all copies and any derived work.
+
+  This software is provided 'as-is', without any express or implied
+  warranty. In no event shall the authors be held liable for any damages
+  arising from the use of this software or it's derivatives.
+
+  Snes9x is freeware for PERSONAL USE only. Commercial users should
+  seek permission of the copyright holders first. Commercial use includes,
+  but is not limited to, charging money for Snes9x or software derived from
+  Snes9x, including Snes9x or derivatives in commercial game bundles, and/or
+  using Snes9x as a promotion for your commercial product.
+
+  The copyright holders request that bug fixes and improvements to the code
+  should be forwarded to them so everyone can benefit from the modifications
+  in future versions.
+
+  Super NES and Super Nintendo Entertainment System are trademarks of
+  Nintendo Co., Limited and its subsidiary companies.
+ ***********************************************************************************/
+
+
+#ifdef PROFILER
+
+#include "snes9x.h"
+#include "profile.h"
+
+CONTEXT_LOCAL struct SProfiler	Profiler;
+
+const char	*S9xProfileZoneNames[PROFILE_ZONE_COUNT] =
+{
+	"S9xMainLoop",
+	"S9xDoHEventProcessing",
+	"RenderScreen",
+	"S9xDoDMA",
+	"S9xDoHDMA",
+	"S9xAPUExecute",
+	"FxEmulate",
+	"S9xSA1MainLoop"
+};
+
+
+void S9xResetProfiler (void)
+{
+	if (!Profiler.Ring)
+		Profiler.Ring = (struct SProfileEvent *) malloc(PROFILE_RING_SIZE * sizeof(struct SProfileEvent));
+
+	if (Profiler.Ring)
+		memset(Profiler.Ring, 0, PROFILE_RING_SIZE * sizeof(struct SProfileEvent));
+
+	memset(Profiler.Zones, 0, sizeof(Profiler.Zones));
+	Profiler.Head = 0;
+}
+
+void S9xDeinitProfiler (void)
+{
+	struct SProfileEvent	*ring = Profiler.Ring;
+
+	// Zones recorded from here on only update the totals.
+	Profiler.Ring = NULL;
+	Profiler.Head = 0;
+
+	if (ring)
+		free(ring);
+}
+
+void S9xProfilerSummary (void)
+{
+	printf("%-24s %10s %12s %10s\n", "zone", "calls", "total ms", "avg us");
+
+	for (int i = 0; i < PROFILE_ZONE_COUNT; i++)
+	{
+		struct SProfileZone	*z = &Profiler.Zones[i];
+
+		if (!z->Calls)
+			continue;
+
+		printf("%-24s %10u %12.3f %10.3f\n", S9xProfileZoneNames[i], z->Calls,
+			z->Time / 1000000.0, z->Time / 1000.0 / z->Calls);
+	}
+}
+
+// Writes the ring out as Chrome trace JSON (chrome://tracing, Perfetto).
+// Each event becomes a complete ("X") event; zone totals go in otherData.
+bool8 S9xExportProfile (const char *filename)
+{
+	FILE	*fp = fopen(filename, "w");
+	if (!fp)
+		return (FALSE);
+
+	uint32	head = Profiler.Head;
+	uint32	count = !Profiler.Ring ? 0 : head < PROFILE_RING_SIZE ? head : PROFILE_RING_SIZE;
+	uint64	base = 0;
+
+	for (uint32 i = head - count; i != head; i++)
+	{
+		uint64	start = Profiler.Ring[i & (PROFILE_RING_SIZE - 1)].Start;
+		if (!base || start < base)
+			base = start;
+	}
+
+	fprintf(fp, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+
+	for (uint32 i = head - count; i != head; i++)
+	{
+		struct SProfileEvent	*e = &Profiler.Ring[i & (PROFILE_RING_SIZE - 1)];
+
+		fprintf(fp, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f}",
+			i == head - count ? "" : ",\n", S9xProfileZoneNames[e->Zone],
+			(e->Start - base) / 1000.0, e->Duration / 1000.0);
+	}
+
+	fprintf(fp, "\n],\"otherData\":{");
+
+	for (int i = 0; i < PROFILE_ZONE_COUNT; i++)
+		fprintf(fp, "%s\"%s\":\"%u calls, %.3f ms\"", i ? "," : "", S9xProfileZoneNames[i],
+			Profiler.Zones[i].Calls, Profiler.Zones[i].Time / 1000000.0);
+
+	fprintf(fp, "}}\n");
+	fclose(fp);
+
+	return (TRUE);
+}
+
+#endif
@@ -179,7 +179,7 @@
 #include "snes9x.h"
 #include "memmap.h"
 
-uint8	SA1OpenBus;
+CONTEXT_LOCAL uint8	SA1OpenBus;
 
 static void S9xSA1SetBWRAMMemMap (uint8);
 static void S9xSetSA1MemMap (uint32, uint8);
@@ -192,7 +192,7 @@ void S9xSA1Init (void)
 {
 	SA1.Cycles = 0;
 	SA1.PrevCycles = 0;
-	SA1.Flags = 0;
+	SA1.Flags = SA1.Flags & TRACE_FLAG;
 	SA1.WaitingForInterrupt = FALSE;
 
 	memset(&Memory.FillRAM[0x2200], 0, 0x200);
@@ -312,6 +312,8 @@ static void S9xSetSA1MemMap (uint32 which1, uint8 map)
 		for (int i = c + 8; i < c + 16; i++)
 			Memory.Map[start2 + i] = SA1.Map[start2 + i] = block;
 	}
+
+	S9xUpdateWatchpoints();
 }
 
 uint8 S9xGetSA1 (uint32 address)
@@ -208,8 +208,13 @@ struct SSA1
 	uint8	*PCBase;
 	bool8	WaitingForInterrupt;
 
+#ifdef EMU_CONTEXTS
+	uint8	**Map;			// kept in the bound SEmuContext
+	uint8	**WriteMap;
+#else
 	uint8	*Map[MEMMAP_NUM_BLOCKS];
 	uint8	*WriteMap[MEMMAP_NUM_BLOCKS];
+#endif
 	uint8	*BWRAM;
 
 	bool8	in_char_dma;
@@ -244,9 +249,9 @@ struct SSA1
 #define SA1ClearFlags(f)	(SA1Registers.P.W &= ~(f))
 #define SA1CheckFlag(f)		(SA1Registers.PL & (f))
 
-extern struct SSA1Registers	SA1Registers;
-extern struct SSA1			SA1;
-extern uint8				SA1OpenBus;
+extern CONTEXT_LOCAL struct SSA1Registers	SA1Registers;
+extern CONTEXT_LOCAL struct SSA1			SA1;
+extern CONTEXT_LOCAL uint8				SA1OpenBus;
 extern Opcode		S9xSA1OpcodesM1X1[256];
 extern Opcode		S9xSA1OpcodesM1X0[256];
 extern Opcode		S9xSA1OpcodesM0X1[256];
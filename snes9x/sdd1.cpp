@@ -193,6 +193,8 @@ void S9xSetSDD1MemoryMap (uint32 bank, uint32 value)
 		for (int i = c; i < c + 16; i++)
 			Memory.Map[i + bank] = block;
 	}
+
+	S9xUpdateWatchpoints();
 }
 
 void S9xResetSDD1 (void)
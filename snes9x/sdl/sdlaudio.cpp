@@ -58,6 +58,7 @@
 #include "logger.h"
 #include "display.h"
 #include "conffile.h"
+#include "context.h"
 
 #ifdef DEBUGGER
 #include "debug.h"
@@ -88,8 +89,12 @@ void S9xToggleSoundChannel (int c)
 static void
 sdl_audio_callback (void *userdata, Uint8 *stream, int len)
 {   
+    /* SDL may call this from a thread of its own, which has to mix from the
+       context of the emulation that opened the device. */
+    S9xBindContext ((struct SEmuContext *) userdata);
+
     SDL_LockAudio ();
-    S9xMixSamples (stream, len >> (Settings.SixteenBitSound ? 1 : 0));
+    S9xMixSamples (stream, len >> (audiospec->format == AUDIO_U8 ? 0 : 1));
     SDL_UnlockAudio ();
 
     return;
@@ -122,6 +127,7 @@ bool8 S9xOpenSoundDevice (void)
 	audiospec->samples = (sound_buffer_size * audiospec->freq / 1000) >> 1;
 #endif
 	audiospec->callback = sdl_audio_callback;
+	audiospec->userdata = S9xCurrentContext ();
 	
 	printf ("SDL sound driver initializing...\n");
 	printf ("    --> (Frequency: %dhz, Latency: %dms)...",
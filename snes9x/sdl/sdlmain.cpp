@@ -60,6 +60,19 @@
 #include "conffile.h"
 #endif
 #include "display.h"
+#ifdef NETPLAY_SUPPORT
+#include "movie.h"
+#include "netplay.h"
+#ifdef USE_THREADS
+#include <pthread.h>
+#endif
+#endif
+#ifdef PROFILER
+#include "profile.h"
+#endif
+#ifdef DEBUGGER
+#include "debug.h"
+#endif
 
 #ifdef HTML
 #include <emscripten.h>
@@ -67,6 +80,25 @@
 
 
 static const char	*s9x_base_dir        = NULL;
+static const char	*rom_filename        = NULL;
+
+// -watchread and -watchwrite, armed once a ROM is loaded
+static struct
+{
+	uint32	address;
+	uint32	size;
+	uint8	type;
+}					watch_args[MAX_WATCHPOINTS];
+static int			num_watch_args       = 0;
+
+#ifdef NETPLAY_SUPPORT
+// Lock-step netplay plays the server's joypads, keeping the local ones to send.
+static uint32		joypads[8], old_joypads[8];
+#ifdef USE_THREADS
+static int			relay_port           = 0;
+static bool8		relay_running        = FALSE;
+#endif
+#endif
 
 extern uint32           sound_buffer_size; // used in sdlaudio
 
@@ -173,6 +205,17 @@ void S9xExtraUsage (void) // domaemon: ExtraUsage -> ExtraDisplayUsage
 	S9xMessage(S9X_INFO, S9X_USAGE, "                                frames (use with -dumpstreams)");
 	S9xMessage(S9X_INFO, S9X_USAGE, "");
 
+	S9xMessage(S9X_INFO, S9X_USAGE, "-watchread <addr>[:<len>]       Report reads of <len> bytes at hex address");
+	S9xMessage(S9X_INFO, S9X_USAGE, "                                <addr>, like 7E0DBF (default <len> is 1)");
+	S9xMessage(S9X_INFO, S9X_USAGE, "-watchwrite <addr>[:<len>]      Report writes of <len> bytes at <addr>");
+	S9xMessage(S9X_INFO, S9X_USAGE, "");
+
+#if defined(NETPLAY_SUPPORT) && defined(USE_THREADS)
+	S9xMessage(S9X_INFO, S9X_USAGE, "-netrelay <num>                 Relay netplay input between clients on port");
+	S9xMessage(S9X_INFO, S9X_USAGE, "                                <num>, in the background");
+	S9xMessage(S9X_INFO, S9X_USAGE, "");
+#endif
+
 	S9xExtraDisplayUsage();
 }
 
@@ -460,6 +503,46 @@ void S9xAutoSaveSRAM (void)
 }
 void S9xSyncSpeed (void)
 {
+#ifdef NETPLAY_SUPPORT
+	// Rollback clients get their heart-beats in S9xNPRollbackRunFrame instead.
+	if (Settings.NetPlay && NetPlay.Connected && !NetPlay.Rollback)
+	{
+		S9xNPSendJoypadUpdate(old_joypads[0]);
+		for (int J = 0; J < 8; J++)
+			joypads[J] = S9xNPGetJoypad(J);
+
+		if (!S9xNPCheckForHeartBeat())
+		{
+			NetPlay.PendingWait4Sync = !S9xNPWaitForHeartBeatDelay(100);
+			IPPU.RenderThisFrame = TRUE;
+			IPPU.SkippedFrames = 0;
+		}
+		else
+		{
+			NetPlay.PendingWait4Sync = !S9xNPWaitForHeartBeatDelay(200);
+
+			if (IPPU.SkippedFrames < NetPlay.MaxFrameSkip)
+			{
+				IPPU.RenderThisFrame = FALSE;
+				IPPU.SkippedFrames++;
+			}
+			else
+			{
+				IPPU.RenderThisFrame = TRUE;
+				IPPU.SkippedFrames = 0;
+			}
+		}
+
+		if (!NetPlay.PendingWait4Sync)
+		{
+			NetPlay.FrameCount++;
+			S9xNPStepJoypadHistory();
+		}
+
+		return;
+	}
+#endif
+
 #ifdef HTML
 	IPPU.RenderThisFrame = (++IPPU.SkippedFrames >= Settings.SkipFrames) ? TRUE : FALSE;
         if (IPPU.RenderThisFrame)
@@ -535,16 +618,31 @@ void S9xExit (void)
 #ifdef NETPLAY_SUPPORT
 	if (Settings.NetPlay)
 		S9xNPDisconnect();
+#ifdef USE_THREADS
+	if (relay_running)
+		S9xNPStopServer();
+#endif
 #endif
 
   Memory.SaveSRAM(S9xGetFilename(".srm", SRAM_DIR));
 
+#ifdef PROFILER
+	S9xProfilerSummary();
+	if (!S9xExportProfile(S9xGetFilename(".trace.json", DEFAULT_DIR)))
+		fprintf(stderr, "Couldn't write the profile trace.\n");
+	S9xDeinitProfiler();
+#endif
+
 #ifdef FANCY
 	S9xSaveCheatFile(S9xGetFilename(".cht", CHEAT_DIR));
 	S9xResetSaveTimer(FALSE);
 #endif
 	S9xUnmapAllControls();
 	S9xDeinitDisplay();
+#ifdef SOUND
+	// The audio callback mixes from the APU state S9xDeinitAPU() frees.
+	SDL_CloseAudio();
+#endif
 	Memory.Deinit();
 	S9xDeinitAPU();
 
@@ -558,8 +656,153 @@ static void sigbrkhandler (int)
 	signal(SIGINT, (SIG_PF) sigbrkhandler);
 }
 #endif
-void S9xParseArg (char **argv, int &i, int argc){
-    printf("parse arg\n");
+void S9xParseArg (char **argv, int &i, int argc)
+{
+	if (!strcasecmp(argv[i], "-watchread") || !strcasecmp(argv[i], "-watchwrite"))
+	{
+		if (i + 1 < argc && num_watch_args < MAX_WATCHPOINTS)
+		{
+			char	*end;
+
+			watch_args[num_watch_args].type = !strcasecmp(argv[i], "-watchread") ? WATCH_READ : WATCH_WRITE;
+			watch_args[num_watch_args].address = strtoul(argv[++i], &end, 16) & 0xffffff;
+			watch_args[num_watch_args].size = *end == ':' ? strtoul(end + 1, NULL, 0) : 1;
+			num_watch_args++;
+		}
+		else
+			S9xUsage();
+	}
+	else
+#if defined(NETPLAY_SUPPORT) && defined(USE_THREADS)
+	if (!strcasecmp(argv[i], "-netrelay"))
+	{
+		if (i + 1 < argc)
+			relay_port = atoi(argv[++i]);
+		else
+			S9xUsage();
+	}
+	else
+#endif
+		S9xParseDisplayArg(argv, i, argc);
+}
+
+#ifdef NETPLAY_SUPPORT
+#ifdef USE_THREADS
+static void * RelayThread (void *)
+{
+	S9xNPStartServer(0);
+	return (NULL);
+}
+#endif
+
+// Starts the -netrelay session, then joins the server given by -net, -server
+// and -port, with -rollback's window if set. Needs the ROM loaded first.
+static void StartNetPlay (void)
+{
+	// The core keeps a port given as an option negated.
+	if (Settings.Port < 0)
+		Settings.Port = -Settings.Port;
+	else
+	if (Settings.Port == 0)
+		Settings.Port = NP_DEFAULT_PORT;
+
+#ifdef USE_THREADS
+	if (relay_port && !relay_running)
+	{
+		pthread_t	thread;
+
+		if (!S9xNPAddRelaySession(relay_port) || pthread_create(&thread, NULL, RelayThread, NULL) != 0)
+		{
+			fprintf(stderr, "Failed to start the netplay relay on port %d.\n", relay_port);
+			S9xExit();
+		}
+
+		pthread_detach(thread);
+		relay_running = TRUE;
+	}
+#endif
+
+	if (!Settings.NetPlay)
+		return;
+
+	if (!Settings.ServerName[0])
+		strcpy(Settings.ServerName, "localhost");
+
+	NetPlay.MaxFrameSkip = 10;
+
+	if (!S9xNPConnectToServer(Settings.ServerName, Settings.Port, Memory.ROMName))
+	{
+		fprintf(stderr, "Failed to connect to server %s on port %d.\n", Settings.ServerName, Settings.Port);
+		S9xExit();
+	}
+
+	fprintf(stderr, "Connected to server %s on port %d as player #%d playing %s%s.\n", Settings.ServerName, Settings.Port,
+		NetPlay.Player, Memory.ROMName, NetPlay.Rollback ? " with rollback" : "");
+}
+#endif
+
+static void WatchpointHit (uint32 address, uint8 byte, uint8 type)
+{
+	printf("Watchpoint: %s $%02X:%04X = $%02X at PC $%02X:%04X\n", type == WATCH_READ ? "read" : "write",
+		address >> 16, address & 0xffff, byte, Registers.PB, Registers.PCw);
+}
+
+// Arms the -watchread and -watchwrite watchpoints. They need the ROM loaded
+// to find the memory behind their addresses, and stay armed across reloads.
+static void StartWatchpoints (void)
+{
+	for (int i = 0; i < num_watch_args; i++)
+	{
+		if (S9xAddWatchpoint(watch_args[i].address, watch_args[i].size, watch_args[i].type) < 0)
+			fprintf(stderr, "Too many watchpoints, $%06X not watched.\n", watch_args[i].address);
+	}
+
+	if (num_watch_args && !S9xWatchpointHook)
+		S9xWatchpointHook = WatchpointHit;
+
+	num_watch_args = 0;
+}
+
+// Emulates a frame. A rollback netplay client runs it through the rollback
+// code; a lock-step one first waits for the server's heart-beat, then plays
+// the joypads it sent.
+static void RunFrame (void)
+{
+#ifdef NETPLAY_SUPPORT
+	if (Settings.NetPlay && NetPlay.Rollback)
+	{
+		S9xNPRollbackRunFrame();
+		return;
+	}
+
+	if (Settings.NetPlay)
+	{
+		if (NetPlay.PendingWait4Sync)
+		{
+			if (!S9xNPWaitForHeartBeatDelay(100))
+				return;
+
+			NetPlay.PendingWait4Sync = FALSE;
+			NetPlay.FrameCount++;
+			S9xNPStepJoypadHistory();
+		}
+
+		for (int J = 0; J < 8; J++)
+		{
+			old_joypads[J] = MovieGetJoypad(J);
+			MovieSetJoypad(J, joypads[J]);
+		}
+
+		S9xMainLoop();
+
+		for (int J = 0; J < 8; J++)
+			MovieSetJoypad(J, old_joypads[J]);
+
+		return;
+	}
+#endif
+
+	S9xMainLoop();
 }
 
 
@@ -577,7 +820,7 @@ void toggle_display_framerate(){
 }
 void mainloop(){
     S9xProcessEvents(FALSE);
-    S9xMainLoop();
+    RunFrame();
 }
 void reboot_emulator(char *filename){
   uint32 saved_flags = CPU.Flags;
@@ -606,6 +849,12 @@ void reboot_emulator(char *filename){
 	CPU.Flags = saved_flags;
 	Settings.StopEmulation = FALSE;
 
+	StartWatchpoints();
+
+#ifdef NETPLAY_SUPPORT
+	StartNetPlay();
+#endif
+
 	S9xInitInputDevices('d', 'a', 's', 'w', 13, 1249, 'l', 'k', 'i', 'j', 'm', ';');
 	S9xInitDisplay(NULL, NULL);
 	sprintf(String, "\"%s\" %s: %s", Memory.ROMName, TITLE, VERSION);
@@ -647,6 +896,7 @@ int main (int argc, char **argv)
 	snprintf(default_dir, PATH_MAX + 1, "%s%s%s", getenv("HOME"), SLASH_STR, ".snes9x");
 	s9x_base_dir = default_dir;
 
+#ifdef HTML
 	EM_ASM(
 		console.log('Syncing file system...');
 		FS.mkdir('/home/web_user/.snes9x');
@@ -662,6 +912,7 @@ int main (int argc, char **argv)
 			}
 		});
 	);
+#endif
 
 	ZeroMemory(&Settings, sizeof(Settings));
 	Settings.MouseMaster = TRUE;
@@ -691,6 +942,8 @@ int main (int argc, char **argv)
 	Settings.CartBName[0] = 0;
 	Settings.NoPatch= TRUE;
 	Settings.SoundSync =  FALSE;
+	Settings.DynamicRateControl = TRUE;
+	Settings.DynamicRateLimit = 5;
 	#ifdef SOUND
 		Settings.Mute = FALSE;
 		Settings.SoundPlaybackRate = 22100;
@@ -707,6 +960,9 @@ int main (int argc, char **argv)
 		S9xDeinitAPU();
 		exit(1);
 	}
+#ifdef PROFILER
+	S9xResetProfiler();
+#endif
     sound_buffer_size = 100;
 	S9xInitSound(sound_buffer_size, 0);
 	S9xSetSoundMute(TRUE);
@@ -716,6 +972,12 @@ int main (int argc, char **argv)
 	#ifdef GFX_MULTI_FORMAT
 		S9xSetRenderPixelFormat(RGB565);
 	#endif
+
+	// The core's options, -net, -server, -port and -rollback among them, then
+	// the port's through S9xParseArg. -filterbench needs the pixel format set
+	// above.
+	rom_filename = S9xParseArgs(argv, argc);
+
 	// domaemon: setting the title on the window bar
 
 	#ifdef HTML
@@ -746,6 +1008,12 @@ int main (int argc, char **argv)
 	CPU.Flags = saved_flags;
 	Settings.StopEmulation = FALSE;
 
+	StartWatchpoints();
+
+#ifdef NETPLAY_SUPPORT
+	StartNetPlay();
+#endif
+
 	S9xInitInputDevices('d', 'a', 's', 'w', 13, 1249, 'l', 'k', 'i', 'j', 'm', ';');
 	S9xInitDisplay(argc, argv);
 	sprintf(String, "\"%s\" %s: %s", Memory.ROMName, TITLE, VERSION);
@@ -759,7 +1027,7 @@ int main (int argc, char **argv)
     printf("before start\n");
     printf("registers.pcw=%x\n", Registers.PCw);
 	for (int iters = 0; iters < 5000; iters++){
-        S9xMainLoop();
+        RunFrame();
         S9xProcessEvents(FALSE);
 	}
 
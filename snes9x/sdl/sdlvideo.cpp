@@ -48,16 +48,23 @@
 #include "logger.h"
 #include "conffile.h"
 #include "display.h"
+#include "blit.h"
+#include "pipeline.h"
 
 #include "sdl_snes9x.h"
-//#define GFX2X
 //#define ASCII
-#ifdef GFX2X
-    #define GFX_SCALE 2
-#else
-    #define GFX_SCALE 1
-#endif
-#define BPP 32
+
+// The renderer draws into GUI.snes_buffer, which is uploaded unconverted to a
+// streaming texture of the same layout once per frame. Both are always big
+// enough for hi-res and interlaced frames. IMAGE_TOP_MARGIN lines are kept
+// above GFX.Screen for the filters that peek at the previous line.
+#define TEXTURE_WIDTH    MAX_SNES_WIDTH
+#define TEXTURE_HEIGHT   (MAX_SNES_HEIGHT + 8)
+#define IMAGE_TOP_MARGIN 2
+
+// Room for a 2x filter applied to a hi-res, interlaced frame
+#define FILTER_TEXTURE_WIDTH  (MAX_SNES_WIDTH * 2)
+#define FILTER_TEXTURE_HEIGHT (MAX_SNES_HEIGHT * 2)
 
 #ifdef ASCII
 #include "../../ansi/drawansi.h"
@@ -66,13 +73,15 @@
 struct GUIData
 {
     #ifdef USE_SDL
-		SDL_Surface*  sdl_screen;
 		SDL_Renderer* sdl_renderer;
 		SDL_Window*   sdl_window;
-		uint8*        blit_screen;
-		uint32        blit_screen_pitch;
+		SDL_Texture*  sdl_texture;
+		SDL_Texture*  filter_texture;
     #endif
     uint8*        snes_buffer;
+    uint8*        filter_buffer;
+	struct SFilterPipeline filter;
+	bool8         filtered;			// last frame went through GUI.filter
 	int           video_mode;
     bool8         fullscreen;
 };
@@ -92,6 +101,18 @@ enum
 	VIDEOMODE_HQ2X
 };
 
+// Pipeline stage for each video mode past VIDEOMODE_BLOCKY
+static const int	videoModeFilter[] =
+{
+	FILTER_TV2X2,
+	FILTER_SMOOTH2X2,
+	FILTER_SUPEREAGLE,
+	FILTER_2XSAI,
+	FILTER_SUPER2XSAI,
+	FILTER_EPX,
+	FILTER_HQ2X
+};
+
 static void SetupImage (void);
 static void TakedownImage (void);
 
@@ -108,9 +129,50 @@ void S9xExtraDisplayUsage (void)
 	S9xMessage(S9X_INFO, S9X_USAGE, "-v7                             Video mode: EPX");
 	S9xMessage(S9X_INFO, S9X_USAGE, "-v8                             Video mode: hq2x");
 	S9xMessage(S9X_INFO, S9X_USAGE, "");
+	S9xMessage(S9X_INFO, S9X_USAGE, "-filterbench [frames]           Time every filter and exit (default: 300 frames)");
+	S9xMessage(S9X_INFO, S9X_USAGE, "");
 }
 
-void S9xParseDisplayArg (char** argv, int &i, int argc);
+static void FilterBenchmark (int frames)
+{
+	if (!S9xBlitFilterInit() || !S9xBlit2xSaIFilterInit() || !S9xBlitHQ2xFilterInit() || !S9xBlitNTSCFilterInit())
+	{
+		fprintf(stderr, "Failed to initialise the filters.\n");
+		exit(1);
+	}
+
+	S9xFilterBenchmark(frames);
+
+	S9xBlitNTSCFilterDeinit();
+	S9xBlitHQ2xFilterDeinit();
+	S9xBlit2xSaIFilterDeinit();
+	S9xBlitFilterDeinit();
+}
+
+void S9xParseDisplayArg (char** argv, int &i, int argc)
+{
+	if (!strncasecmp(argv[i], "-v", 2) && isdigit(argv[i][2]))
+	{
+		int	mode = atoi(argv[i] + 2);
+
+		if (mode >= VIDEOMODE_BLOCKY && mode <= VIDEOMODE_HQ2X)
+			GUI.video_mode = mode;
+	}
+	else
+	if (!strcasecmp(argv[i], "-fullscreen"))
+		GUI.fullscreen = TRUE;
+	else
+	if (!strcasecmp(argv[i], "-filterbench"))
+	{
+		int	frames = 300;
+
+		if (i + 1 < argc && isdigit(argv[i + 1][0]))
+			frames = atoi(argv[++i]);
+
+		FilterBenchmark(frames);
+		exit(0);
+	}
+}
 
 const char* S9xParseDisplayConfig (ConfigFile &conf, int pass)
 {
@@ -135,22 +197,14 @@ void S9xInitDisplay (int argc, char** argv)
 		atexit(SDL_Quit);
 
 		SDL_CreateWindowAndRenderer(
-			SNES_WIDTH * GFX_SCALE,
-			SNES_HEIGHT * GFX_SCALE,
+			SNES_WIDTH,
+			SNES_HEIGHT,
 			0,
 			&GUI.sdl_window,
 			&GUI.sdl_renderer
 		);
-		GUI.sdl_screen = SDL_CreateRGBSurface(
-			0,
-			SNES_WIDTH * GFX_SCALE,
-			SNES_HEIGHT * GFX_SCALE,
-			BPP,
-			0, 0, 0, 0
-		);
-		// GUI.sdl_screen = SDL_SetVideoMode(SNES_WIDTH * GFX_SCALE, SNES_HEIGHT * GFX_SCALE, BPP, 0);
 
-		if (GUI.sdl_screen == NULL) {
+		if (GUI.sdl_renderer == NULL) {
 			printf("Unable to set video mode: %s\n", SDL_GetError());
 			exit(1);
 		}
@@ -167,63 +221,218 @@ void S9xDeinitDisplay (void)
 
 }
 
+static void TakedownFilter (void)
+{
+	#ifdef USE_SDL
+		if (GUI.filter_texture)
+		{
+			SDL_DestroyTexture(GUI.filter_texture);
+			GUI.filter_texture = NULL;
+		}
+	#endif
+
+	if (GUI.filter_buffer)
+	{
+		free(GUI.filter_buffer);
+		GUI.filter_buffer = NULL;
+	}
+
+	if (GUI.filter.stages)
+	{
+		S9xFilterPipelineDeinit(&GUI.filter);
+
+		if (GUI.video_mode == VIDEOMODE_HQ2X)
+			S9xBlitHQ2xFilterDeinit();
+		else
+			S9xBlit2xSaIFilterDeinit();
+	}
+}
+
 static void TakedownImage (void)
 {
+	TakedownFilter();
+
+	#ifdef USE_SDL
+		if (GUI.sdl_texture)
+		{
+			SDL_DestroyTexture(GUI.sdl_texture);
+			GUI.sdl_texture = NULL;
+		}
+	#endif
+
 	if (GUI.snes_buffer)
 	{
 		free(GUI.snes_buffer);
 		GUI.snes_buffer = NULL;
 	}
 	S9xGraphicsDeinit();
+	S9xBlitFilterDeinit();
+}
+
+// Runs the -vN video mode through a one-stage filter pipeline into a texture
+// of its own. Leaves the image unfiltered if any of it can't be set up.
+static void SetupFilter (void)
+{
+	int		stage = videoModeFilter[GUI.video_mode - VIDEOMODE_TV];
+	bool8	ok;
+
+	if (!S9xFilterPipelineInit(&GUI.filter, &stage, 1))
+	{
+		fprintf(stderr, "Failed to set up the %s filter.\n", S9xFilterName(stage));
+		return;
+	}
+
+	// The 2xSaI masks are harmless to set up for the simpler filters.
+	if (GUI.video_mode == VIDEOMODE_HQ2X)
+		ok = S9xBlitHQ2xFilterInit();
+	else
+		ok = S9xBlit2xSaIFilterInit();
+
+	if (!ok)
+	{
+		S9xFilterPipelineDeinit(&GUI.filter);
+		fprintf(stderr, "Failed to set up the %s filter.\n", S9xFilterName(stage));
+		return;
+	}
+
+	#ifdef USE_SDL
+		GUI.filter_texture = SDL_CreateTexture(
+			GUI.sdl_renderer,
+			SDL_PIXELFORMAT_RGB565,
+			SDL_TEXTUREACCESS_STREAMING,
+			FILTER_TEXTURE_WIDTH,
+			FILTER_TEXTURE_HEIGHT
+		);
+
+		ok = (GUI.filter_texture != NULL);
+	#endif
+
+	if (ok)
+	{
+		GUI.filter_buffer = (uint8*)calloc(FILTER_TEXTURE_WIDTH * 2 * FILTER_TEXTURE_HEIGHT, 1);
+		ok = (GUI.filter_buffer != NULL);
+	}
+
+	if (!ok)
+	{
+		fprintf(stderr, "Failed to set up the %s filter.\n", S9xFilterName(stage));
+		TakedownFilter();
+	}
+
+	GUI.filtered = FALSE;
 }
 
 static void SetupImage (void)
 {
 	TakedownImage();
 
-	// domaemon: The whole unix code basically assumes output=(original * 2);
-	// This way the code can handle the SNES filters, which does the 2X.
+	GFX.Pitch = TEXTURE_WIDTH * 2;
+
+	#ifdef USE_SDL
+		GUI.sdl_texture = SDL_CreateTexture(
+			GUI.sdl_renderer,
+			SDL_PIXELFORMAT_RGB565,
+			SDL_TEXTUREACCESS_STREAMING,
+			TEXTURE_WIDTH,
+			TEXTURE_HEIGHT
+		);
 
-	GFX.Pitch = SNES_WIDTH * 2 * GFX_SCALE;
+		if (!GUI.sdl_texture)
+			FatalError("Failed to create the screen texture.");
+	#endif
 
-	GUI.snes_buffer = (uint8*)calloc(GFX.Pitch * ((SNES_HEIGHT_EXTENDED + 4) * GFX_SCALE), 1);
+	// GFX.Screen has to stay valid between frames: snapshots, screenshots and
+	// on-screen messages all use it outside of S9xInitUpdate/S9xPutImage.
+	GUI.snes_buffer = (uint8*)calloc(GFX.Pitch * TEXTURE_HEIGHT, 1);
 
 	if (!GUI.snes_buffer)
 		FatalError("Failed to allocate GUI.snes_buffer.");
 
-	// domaemon: Add 2 lines before drawing.
-	GFX.Screen = (uint16*)(GUI.snes_buffer + (GFX.Pitch * 2 * GFX_SCALE));
+	GFX.Screen = (uint16*)(GUI.snes_buffer + GFX.Pitch * IMAGE_TOP_MARGIN);
+
+	// Also starts the filters' strip-thread pool when built with USE_THREADS
+	if (!S9xBlitFilterInit())
+		FatalError("Failed to initialise the filters.");
+
+	S9xGraphicsInit();
+
+	// Lets S9xPutImage upload only the lines the renderer changed
+	GFX.TrackLineChanges = TRUE;
+
+	if (GUI.video_mode > VIDEOMODE_BLOCKY)
+		SetupFilter();
+}
+
+// Uploads only the runs of lines changed since the last S9xDeinitUpdate, since
+// the texture keeps its contents between frames.
+static void UploadChangedLines (int width, int height)
+{
 	#ifdef USE_SDL
-		GUI.blit_screen       = (uint8*)GUI.sdl_screen->pixels;
-		GUI.blit_screen_pitch = SNES_WIDTH * GFX_SCALE * (BPP/8);
+		for (int y = 0; y < height; )
+		{
+			if (y < MAX_SNES_HEIGHT && !GFX.LineChanged[y])
+			{
+				y++;
+				continue;
+			}
+
+			int	first = y;
+			while (y < height && (y >= MAX_SNES_HEIGHT || GFX.LineChanged[y]))
+				y++;
+
+			SDL_Rect	dirty = { 0, IMAGE_TOP_MARGIN + first, width, y - first };
+			SDL_UpdateTexture(GUI.sdl_texture, &dirty, (uint8 *) GFX.Screen + first * GFX.Pitch, GFX.Pitch);
+		}
 	#endif
-	S9xGraphicsInit();
 }
 
 void S9xPutImage (int width, int height)
 {
 	#ifdef USE_SDL
-		SDL_LockSurface(GUI.sdl_screen);
-		SDL_ConvertPixels(
-			width, height,
-			SDL_PIXELFORMAT_RGB565,
-			(uint32*)GFX.Screen,
-			GFX.Pitch,
-			SDL_PIXELFORMAT_RGB888,
-			(uint32*)GUI.blit_screen,
-			GUI.blit_screen_pitch
-		);
-		SDL_UnlockSurface(GUI.sdl_screen);
+		SDL_Texture	*texture = GUI.sdl_texture;
+		SDL_Rect	rect = { 0, IMAGE_TOP_MARGIN, width, height };
+		int			outWidth, outHeight;
+		bool8		filter = FALSE;
+
+		if (GUI.filter.stages)
+		{
+			S9xFilterPipelineOutputSize(&GUI.filter, width, height, &outWidth, &outHeight);
+			filter = (outWidth <= FILTER_TEXTURE_WIDTH && outHeight <= FILTER_TEXTURE_HEIGHT);
+		}
+
+		// The filter's output buffer and the plain texture each only hold
+		// what was last drawn into them, so switching between the two (the
+		// filter can't take every hi-res frame) redraws the whole frame.
+		if (filter)
+		{
+			if (!GUI.filtered)
+				S9xFilterPipelineRedraw(&GUI.filter);
+
+			filter = S9xFilterPipelineRun(&GUI.filter, (uint8 *) GFX.Screen, GFX.Pitch, width, height, GUI.filter_buffer, FILTER_TEXTURE_WIDTH * 2);
+		}
+
+		if (filter)
+		{
+			SDL_Rect	out = { 0, 0, outWidth, outHeight };
+
+			SDL_UpdateTexture(GUI.filter_texture, &out, GUI.filter_buffer, FILTER_TEXTURE_WIDTH * 2);
+			texture = GUI.filter_texture;
+			rect = out;
+		}
+		else
+		if (GUI.filtered)
+			SDL_UpdateTexture(GUI.sdl_texture, &rect, GFX.Screen, GFX.Pitch);
+		else
+			UploadChangedLines(width, height);
+
+		GUI.filtered = filter;
 
-		SDL_Texture* sdl_screen_texture = SDL_CreateTextureFromSurface(GUI.sdl_renderer, GUI.sdl_screen);
 		SDL_RenderClear(GUI.sdl_renderer);
-		SDL_RenderCopy(GUI.sdl_renderer, sdl_screen_texture, NULL, NULL);
+		SDL_RenderCopy(GUI.sdl_renderer, texture, &rect, NULL);
 		SDL_RenderPresent(GUI.sdl_renderer);
-		SDL_DestroyTexture(sdl_screen_texture);
 	#endif
 }
 
-
 void S9xMessage (int type, int number, const char* message)
 {
 	const int	max = 36 * 3;
@@ -207,16 +207,27 @@
 	#include <sys/time.h>
 
 	#include <netdb.h>
+	#include <sys/ioctl.h>
 	#include <sys/socket.h>
 	#include <sys/param.h>
 	#include <netinet/in.h>
+	#include <netinet/tcp.h>
 	#include <arpa/inet.h>
 	#include <signal.h>
 
+	#if defined(__linux) || defined(__linux__)
+		#include <sys/epoll.h>
+		#define NP_USE_EPOLL
+	#endif
+
 	#ifdef __SVR4
 		#include <sys/stropts.h>
 	#endif
 
+	#ifdef USE_THREADS
+		#include <pthread.h>
+	#endif
+
 #endif // !__WIN32__
 
 #include "snes9x.h"
@@ -230,7 +241,53 @@
 #define NP_ONE_CLIENT 0
 #endif
 
-struct SNPServer NPServer;
+// Each session is an independent room with its own listening port, clients
+// and frame counter. Session 0 hosts the game loaded in this process; the
+// others relay input between clients that sync by resetting their own copy
+// of the game. NPServer points at the session being serviced.
+//
+// The server loop and the emulation thread both reach the sessions, so all
+// of it, NPServer and the client send queues included, is only touched with
+// the server lock held. NPServer is only ever pointed away from session 0
+// under the lock and is put back before the lock is released.
+struct SNPServer NPSessions [NP_MAX_SESSIONS];
+struct SNPServer *NPServer = &NPSessions [0];
+
+// How often the loop looks again at a task waiting for the emulation to stop
+#define NP_TASK_POLL_USEC 10000
+
+#ifdef __WIN32__
+static CRITICAL_SECTION NPServerMutex;
+static bool8 NPServerMutexReady = FALSE;
+#elif defined(USE_THREADS)
+static pthread_mutex_t NPServerMutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+static void S9xNPLockServer ()
+{
+#ifdef __WIN32__
+    // First called from S9xNPStartServer or S9xNPAddRelaySession, before
+    // the server thread exists.
+    if (!NPServerMutexReady)
+    {
+        InitializeCriticalSection (&NPServerMutex);
+        NPServerMutexReady = TRUE;
+    }
+    EnterCriticalSection (&NPServerMutex);
+#elif defined(USE_THREADS)
+    pthread_mutex_lock (&NPServerMutex);
+#endif
+}
+
+static void S9xNPUnlockServer ()
+{
+    NPServer = &NPSessions [0];
+#ifdef __WIN32__
+    LeaveCriticalSection (&NPServerMutex);
+#elif defined(USE_THREADS)
+    pthread_mutex_unlock (&NPServerMutex);
+#endif
+}
 
 extern unsigned long START;
 
@@ -239,7 +296,6 @@ bool8 S9xNPLoadFreezeFile (const char *fname, uint8 *&data, uint32 &len);
 void S9xNPSendFreezeFile (int c, uint8 *data, uint32 len);
 void S9xNPNoClientReady (int start_index = NP_ONE_CLIENT);
 void S9xNPRecomputePause ();
-void S9xNPWaitForEmulationToComplete ();
 void S9xNPSendROMImageToAllClients ();
 bool8 S9xNPSendROMImageToClient (int client);
 void S9xNPSendSRAMToClient (int c);
@@ -251,12 +307,13 @@ void S9xNPStopServer ();
 
 void S9xNPShutdownClient (int c, bool8 report_error = FALSE)
 {
-    if (NPServer.Clients [c].Connected)
+    if (NPServer->Clients [c].Connected)
     {
-        NPServer.Clients [c].Connected = FALSE;
-        NPServer.Clients [c].SaidHello = FALSE;
+        NPServer->Clients [c].Connected = FALSE;
+        NPServer->Clients [c].SaidHello = FALSE;
+        NPServer->HeartBeatClients &= ~(1 << c);
 
-        close (NPServer.Clients [c].Socket);
+        close (NPServer->Clients [c].Socket);
 #ifdef NP_DEBUG
         printf ("SERVER: Player %d disconnecting @%ld\n", c + 1, S9xGetMilliTime () - START);
 #endif
@@ -264,176 +321,319 @@ void S9xNPShutdownClient (int c, bool8 report_error = FALSE)
         {
             sprintf (NetPlay.ErrorMsg,
                      "Player %d on '%s' has disconnected.", c + 1,
-                     NPServer.Clients [c].HostName);
+                     NPServer->Clients [c].HostName);
             S9xNPSetWarning  (NetPlay.ErrorMsg);
         }
 
-        if (NPServer.Clients [c].HostName)
+        if (NPServer->Clients [c].HostName)
         {
-            free ((char *) NPServer.Clients [c].HostName);
-            NPServer.Clients [c].HostName = NULL;
+            free ((char *) NPServer->Clients [c].HostName);
+            NPServer->Clients [c].HostName = NULL;
         }
-        if (NPServer.Clients [c].ROMName)
+        if (NPServer->Clients [c].ROMName)
         {
-            free ((char *) NPServer.Clients [c].ROMName);
-            NPServer.Clients [c].ROMName = NULL;
+            free ((char *) NPServer->Clients [c].ROMName);
+            NPServer->Clients [c].ROMName = NULL;
         }
-        if (NPServer.Clients [c].Who)
+        if (NPServer->Clients [c].Who)
         {
-            free ((char *) NPServer.Clients [c].Who);
-            NPServer.Clients [c].Who = NULL;
+            free ((char *) NPServer->Clients [c].Who);
+            NPServer->Clients [c].Who = NULL;
         }
-        NPServer.Joypads [c] = 0;
-        NPServer.NumClients--;
+        free (NPServer->Clients [c].SendQueue);
+        NPServer->Clients [c].SendQueue = NULL;
+        NPServer->Clients [c].SendHead = NPServer->Clients [c].SendTail = 0;
+        NPServer->Clients [c].SendSize = 0;
+        free (NPServer->Clients [c].RecvBuffer);
+        NPServer->Clients [c].RecvBuffer = NULL;
+        NPServer->Clients [c].RecvLen = NPServer->Clients [c].RecvSize = 0;
+        NPServer->Joypads [c] = 0;
+        NPServer->NumClients--;
         S9xNPRecomputePause ();
     }
 }
 
-static bool8 S9xNPSGetData (int socket, uint8 *data, int length)
+#ifdef NP_USE_EPOLL
+static int NPPoll = -1;
+#endif
+
+// Registers a socket for read events. Client -1 is the session's listening
+// socket.
+static void S9xNPPollAdd (int fd, int c)
+{
+#ifdef NP_USE_EPOLL
+    struct epoll_event ev;
+
+    if (NPPoll < 0)
+        NPPoll = epoll_create (NP_MAX_SESSIONS * (NP_MAX_CLIENTS + 1));
+
+    memset (&ev, 0, sizeof (ev));
+    ev.events = EPOLLIN;
+    ev.data.u32 = ((NPServer - NPSessions) << 8) | (c + 1);
+    epoll_ctl (NPPoll, EPOLL_CTL_ADD, fd, &ev);
+#endif
+}
+
+// Asks for write events too while the client has queued data.
+static void S9xNPPollClient (int c, bool8 write_too)
 {
-    int len = length;
-    uint8 *ptr = data;
+    NPServer->Clients [c].WantWrite = write_too;
+#ifdef NP_USE_EPOLL
+    struct epoll_event ev;
+
+    memset (&ev, 0, sizeof (ev));
+    ev.events = write_too ? (EPOLLIN | EPOLLOUT) : EPOLLIN;
+    ev.data.u32 = ((NPServer - NPSessions) << 8) | (c + 1);
+    epoll_ctl (NPPoll, EPOLL_CTL_MOD, NPServer->Clients [c].Socket, &ev);
+#endif
+}
+
+// Outgoing data is queued per client and written whenever the socket will
+// take it, so a slow client never holds up the others.
+static bool8 S9xNPQueueData (int c, const uint8 *data, int length)
+{
+    struct SNPClient *client = &NPServer->Clients [c];
 
-    do
+    if (client->SendTail + length > client->SendSize)
     {
-        int num_bytes = len;
+        uint32 pending = client->SendTail - client->SendHead;
 
-        // Read the data in small chunks, allowing this thread to spot an
-        // abort request from another thread.
-        if (num_bytes > 512)
-            num_bytes = 512;
+        if (client->SendHead)
+        {
+            memmove (client->SendQueue, client->SendQueue + client->SendHead, pending);
+            client->SendHead = 0;
+            client->SendTail = pending;
+        }
 
-        int got = read (socket, (char *) ptr, num_bytes);
-        if (got < 0)
+        if (pending + length > client->SendSize)
+        {
+            uint32 size = client->SendSize ? client->SendSize * 2 : 4096;
+
+            while (size < pending + length)
+                size *= 2;
+
+            if (size > NP_MAX_SEND_QUEUE)
+            {
+                S9xNPSetWarning ("SERVER: Client isn't keeping up with the data sent to it.");
+                return (FALSE);
+            }
+
+            client->SendQueue = (uint8 *) realloc (client->SendQueue, size);
+            client->SendSize = size;
+        }
+    }
+
+    memcpy (client->SendQueue + client->SendTail, data, length);
+    client->SendTail += length;
+
+    return (TRUE);
+}
+
+static void S9xNPFlushClient (int c)
+{
+    struct SNPClient *client = &NPServer->Clients [c];
+
+    while (client->SendHead < client->SendTail)
+    {
+        int sent = write (client->Socket, (char *) client->SendQueue + client->SendHead,
+                          client->SendTail - client->SendHead);
+        if (sent < 0)
         {
-	    if (errno == EINTR
+	    if (errno == EINTR)
+                continue;
+	    if (
 #ifdef EAGAIN
-		|| errno == EAGAIN
+		errno == EAGAIN ||
 #endif
 #ifdef EWOULDBLOCK
-		|| errno == EWOULDBLOCK
+		errno == EWOULDBLOCK ||
 #endif
 #ifdef WSAEWOULDBLOCK
-                || errno == WSAEWOULDBLOCK
+                errno == WSAEWOULDBLOCK ||
 #endif
-		)
-		continue;
-#ifdef WSAEMSGSIZE
-            if (errno != WSAEMSGSIZE)
-                return (FALSE);
-            else
+		FALSE)
             {
-                got = num_bytes;
-#ifdef NP_DEBUG
-                printf ("SERVER: WSAEMSGSIZE, actual bytes %d while receiving data @%d\n", got, S9xGetMilliTime () - START);
-#endif
+                if (!client->WantWrite)
+                    S9xNPPollClient (c, TRUE);
+                return;
             }
-#else
-            return (FALSE);
-#endif
+            S9xNPShutdownClient (c, TRUE);
+            return;
         }
-        else
-        if (got == 0)
-            return (FALSE);
-
-        len -= got;
-        ptr += got;
-    } while (len > 0);
+        client->SendHead += sent;
+    }
 
-    return (TRUE);
+    client->SendHead = client->SendTail = 0;
+    if (client->WantWrite)
+        S9xNPPollClient (c, FALSE);
 }
 
-static bool8 S9xNPSSendData (int fd, const uint8 *data, int length)
+static void S9xNPFlushClients ()
 {
-    int Percent = 0;
-    int len = length;
-    int chunk = length / 50;
-
-    if (chunk < 1024)
-        chunk = 1024;
-
-    do
+    for (int c = 0; c < NP_MAX_CLIENTS; c++)
     {
-        int num_bytes = len;
+        if (NPServer->Clients [c].Connected &&
+            NPServer->Clients [c].SendHead < NPServer->Clients [c].SendTail)
+            S9xNPFlushClient (c);
+    }
+}
 
-        // Write the data in small chunks, allowing this thread to spot an
-        // abort request from another thread.
-        if (num_bytes > chunk)
-            num_bytes = chunk;
+void S9xNPProcessClient (int c, const uint8 *header);
 
-	int sent;
-	sent = write (fd, (char *) data, len);
+// Reads whatever the client has sent and processes each complete message.
+static void S9xNPReadClient (int c)
+{
+    struct SNPClient *client = &NPServer->Clients [c];
 
-	if (sent < 0)
-	{
-	    if (errno == EINTR
+    for (;;)
+    {
+        if (client->RecvLen == client->RecvSize)
+        {
+            client->RecvSize = client->RecvSize ? client->RecvSize * 2 : 512;
+            client->RecvBuffer = (uint8 *) realloc (client->RecvBuffer, client->RecvSize);
+        }
+
+        int got = read (client->Socket, (char *) client->RecvBuffer + client->RecvLen,
+                        client->RecvSize - client->RecvLen);
+        if (got < 0)
+        {
+	    if (errno == EINTR)
+                continue;
+	    if (
 #ifdef EAGAIN
-		|| errno == EAGAIN
+		errno == EAGAIN ||
 #endif
 #ifdef EWOULDBLOCK
-		|| errno == EWOULDBLOCK
+		errno == EWOULDBLOCK ||
 #endif
-		)
-            {
-#ifdef NP_DEBUG
-                printf ("SERVER: EINTR, EAGAIN or EWOULDBLOCK while sending data @%ld\n", S9xGetMilliTime () - START);
+#ifdef WSAEWOULDBLOCK
+                errno == WSAEWOULDBLOCK ||
 #endif
-		continue;
-            }
-	    return (FALSE);
-	}
-	else
-	if (sent == 0)
-	    return (FALSE);
-	len -= sent;
-	data += sent;
-        if (length > 1024)
+		FALSE)
+                return;
+        }
+        if (got <= 0)
         {
-            Percent = (uint8) (((length - len) * 100) / length);
-#ifdef __WIN32__
-            PostMessage (GUI.hWnd, WM_USER, Percent, Percent);
-            Sleep (0);
-#endif
+            S9xNPSetWarning ("SERVER: Failed to get message from client.");
+            S9xNPShutdownClient (c, TRUE);
+            return;
         }
-    } while (len > 0);
+        client->RecvLen += got;
 
-    return (TRUE);
+        uint32 pos = 0, need = 0;
+
+        while (client->RecvLen - pos >= 7)
+        {
+            const uint8 *header = client->RecvBuffer + pos;
+            uint32 len;
+
+            switch (header [2] & 0x3f)
+            {
+                case NP_CLNT_HELLO:
+                    len = READ_LONG (&header [3]);
+                    break;
+                case NP_CLNT_JOYPAD_FRAME:
+                    len = 7 + 4;
+                    break;
+                default:
+                    len = 7;
+                    break;
+            }
+
+            if (len < 7 || len > 0x10000)
+            {
+                S9xNPSetWarning ("SERVER: Client message length error.");
+                S9xNPShutdownClient (c, TRUE);
+                return;
+            }
+            if (client->RecvLen - pos < len)
+            {
+                need = len;
+                break;
+            }
+
+            S9xNPProcessClient (c, header);
+            if (!client->Connected)
+                return;
+            pos += len;
+        }
+
+        client->RecvLen -= pos;
+        memmove (client->RecvBuffer, client->RecvBuffer + pos, client->RecvLen);
+
+        // Make room for the rest of a long message.
+        if (need > client->RecvSize)
+        {
+            client->RecvBuffer = (uint8 *) realloc (client->RecvBuffer, need);
+            client->RecvSize = need;
+        }
+    }
 }
 
 void S9xNPSendHeartBeat ()
 {
     int len = 3;
-    uint8 data [3 + 4 * 5];
+    uint8 data [3 + 4 + 2 + 4 * NP_MAX_CLIENTS];
     uint8 *ptr = data;
+    uint8 listeners = 0;
     int n;
 
     for (n = NP_MAX_CLIENTS - 1; n >= 0; n--)
     {
-        if (NPServer.Clients [n].SaidHello)
+        if (NPServer->Clients [n].SaidHello)
             break;
     }
 
     if (n >= 0)
     {
-        bool8 Paused = NPServer.Paused != 0;
+        bool8 Paused = NPServer->Paused != 0;
+
+        NPServer->FrameCount++;
+
+        // Frame-tagged input that arrived ahead of time is used for the
+        // frame it was meant for.
+        int slot = NPServer->FrameCount % NP_ROLLBACK_FRAMES;
+        for (int c = 0; c < NP_MAX_CLIENTS; c++)
+        {
+            if (NPServer->PendingFrame [c][slot] == NPServer->FrameCount)
+                NPServer->Joypads [c] = NPServer->PendingJoypads [c][slot];
+            if (NPServer->Clients [c].SaidHello)
+                listeners |= 1 << c;
+        }
 
-        NPServer.FrameCount++;
         *ptr++ = NP_SERV_MAGIC;
         *ptr++ = 0; // Individual client sequence number will get placed here
-        *ptr++ = NP_SERV_JOYPAD | (n << 6) | ((Paused != 0) << 5);
+        *ptr++ = NP_SERV_JOYPAD | ((Paused != 0) << 5);
 
-        WRITE_LONG (ptr, NPServer.FrameCount);
+        WRITE_LONG (ptr, NPServer->FrameCount);
         len += 4;
         ptr += 4;
 
+        // Only joypads that changed since the last heart-beat are sent. A
+        // client that has just joined hasn't seen the earlier ones, so then
+        // everything is sent again.
+        bool8 all = listeners != NPServer->HeartBeatClients;
+        uint8 *mask = ptr + 1;
         int i;
 
+        NPServer->HeartBeatClients = listeners;
+        *ptr++ = n + 1;
+        *ptr++ = 0;
+        len += 2;
+
         for (i = 0; i <= n; i++)
         {
-            WRITE_LONG (ptr, NPServer.Joypads [i]);
-            len += 4;
-            ptr += 4;
+            if (all || NPServer->Joypads [i] != NPServer->SentJoypads [i])
+            {
+                *mask |= 1 << i;
+                WRITE_LONG (ptr, NPServer->Joypads [i]);
+                NPServer->SentJoypads [i] = NPServer->Joypads [i];
+                len += 4;
+                ptr += 4;
+            }
         }
+        for (; i < NP_MAX_CLIENTS; i++)
+            NPServer->SentJoypads [i] = 0;
 
         S9xNPSendToAllClients (data, len);
     }
@@ -445,28 +645,22 @@ void S9xNPSendToAllClients (uint8 *data, int len)
 
     for (i = 0; i < NP_MAX_CLIENTS; i++)
     {
-	if (NPServer.Clients [i].SaidHello)
+	if (NPServer->Clients [i].SaidHello)
 	{
-            data [1] = NPServer.Clients [i].SendSequenceNum++;
-	    if (!S9xNPSSendData (NPServer.Clients [i].Socket, data, len))
+            data [1] = NPServer->Clients [i].SendSequenceNum++;
+	    if (!S9xNPQueueData (i, data, len))
 		S9xNPShutdownClient (i, TRUE);
 	}
     }
 }
 
-void S9xNPProcessClient (int c)
+void S9xNPProcessClient (int c, const uint8 *header)
 {
-    uint8 header [7];
+    const uint8 *body = header + 7;
     uint8 *data;
     uint32 len;
     uint8 *ptr;
 
-    if (!S9xNPSGetData (NPServer.Clients [c].Socket, header, 7))
-    {
-        S9xNPSetWarning ("SERVER: Failed to get message header from client.\n");
-        S9xNPShutdownClient (c, TRUE);
-        return;
-    }
     if (header [0] != NP_CLNT_MAGIC)
     {
         S9xNPSetWarning ("SERVER: Bad header magic value received from client.\n");
@@ -474,26 +668,26 @@ void S9xNPProcessClient (int c)
         return;
     }
 
-    if (header [1] != NPServer.Clients [c].ReceiveSequenceNum)
+    if (header [1] != NPServer->Clients [c].ReceiveSequenceNum)
     {
 #ifdef NP_DEBUG
         printf ("SERVER: Messages lost from '%s', expected %d, got %d\n",
-                NPServer.Clients [c].HostName ?
-                NPServer.Clients [c].HostName : "Unknown",
-                NPServer.Clients [c].ReceiveSequenceNum,
+                NPServer->Clients [c].HostName ?
+                NPServer->Clients [c].HostName : "Unknown",
+                NPServer->Clients [c].ReceiveSequenceNum,
                 header [1]);
 #endif
         sprintf (NetPlay.WarningMsg,
                  "SERVER: Messages lost from '%s', expected %d, got %d\n",
-                NPServer.Clients [c].HostName ?
-                NPServer.Clients [c].HostName : "Unknown",
-                NPServer.Clients [c].ReceiveSequenceNum,
+                NPServer->Clients [c].HostName ?
+                NPServer->Clients [c].HostName : "Unknown",
+                NPServer->Clients [c].ReceiveSequenceNum,
                 header [1]);
-        NPServer.Clients [c].ReceiveSequenceNum = header [1] + 1;
+        NPServer->Clients [c].ReceiveSequenceNum = header [1] + 1;
         S9xNPSetWarning (NetPlay.WarningMsg);
     }
     else
-        NPServer.Clients [c].ReceiveSequenceNum++;
+        NPServer->Clients [c].ReceiveSequenceNum++;
 
     len = READ_LONG (&header [3]);
 
@@ -504,43 +698,36 @@ void S9xNPProcessClient (int c)
             printf ("SERVER: Got HELLO from client @%ld\n", S9xGetMilliTime () - START);
 #endif
             S9xNPSetAction ("Got HELLO from client...", TRUE);
-            if (len > 0x10000)
+            if (len < 7 + 4 + 1 || body [len - 7 - 1] != 0)
             {
                 S9xNPSetWarning ("SERVER: Client HELLO message length error.");
                 S9xNPShutdownClient (c, TRUE);
                 return;
             }
-            data = new uint8 [len - 7];
-            if (!S9xNPSGetData (NPServer.Clients [c].Socket, data, len - 7))
-            {
-                S9xNPSetWarning ("SERVER: Failed to get HELLO message content from client.");
-                S9xNPShutdownClient (c, TRUE);
-                return;
-            }
 
-            if (NPServer.NumClients <= NP_ONE_CLIENT)
+            if (NPServer->NumClients <= NP_ONE_CLIENT)
             {
-		NPServer.FrameTime = READ_LONG (data);
-		strncpy (NPServer.ROMName, (char *) &data [4], 29);
-		NPServer.ROMName [29] = 0;
+		NPServer->FrameTime = READ_LONG (body);
+		strncpy (NPServer->ROMName, (char *) &body [4], 29);
+		NPServer->ROMName [29] = 0;
             }
 
-            NPServer.Clients [c].ROMName = strdup ((char *) &data [4]);
+            NPServer->Clients [c].ROMName = strdup ((char *) &body [4]);
+            NPServer->Clients [c].Compress = (header [2] & NP_CLNT_HELLO_ZLIB) != 0;
 #ifdef NP_DEBUG
-            printf ("SERVER: Client is playing: %s, Frame Time: %d @%ld\n", data + 4, READ_LONG (data), S9xGetMilliTime () - START);
+            printf ("SERVER: Client is playing: %s, Frame Time: %d @%ld\n", body + 4, READ_LONG (body), S9xGetMilliTime () - START);
 #endif
 
-            NPServer.Clients [c].SendSequenceNum = 0;
+            NPServer->Clients [c].SendSequenceNum = 0;
 
-            len = 7 + 1 + 1 + 4 + strlen (NPServer.ROMName) + 1;
+            len = 7 + 1 + 1 + 4 + strlen (NPServer->ROMName) + 1;
 
-            delete data;
             ptr = data = new uint8 [len];
             *ptr++ = NP_SERV_MAGIC;
-            *ptr++ = NPServer.Clients [c].SendSequenceNum++;
+            *ptr++ = NPServer->Clients [c].SendSequenceNum++;
 
-            if (NPServer.SendROMImageOnConnect &&
-                NPServer.NumClients > NP_ONE_CLIENT)
+            if (NPServer->SendROMImageOnConnect && !NPServer->Relay &&
+                NPServer->NumClients > NP_ONE_CLIENT)
                 *ptr++ = NP_SERV_HELLO | 0x80;
             else
                 *ptr++ = NP_SERV_HELLO;
@@ -548,15 +735,15 @@ void S9xNPProcessClient (int c)
             ptr += 4;
             *ptr++ = NP_VERSION;
             *ptr++ = c + 1;
-            WRITE_LONG (ptr, NPServer.FrameCount);
+            WRITE_LONG (ptr, NPServer->FrameCount);
             ptr += 4;
-            strcpy ((char *) ptr, NPServer.ROMName);
+            strcpy ((char *) ptr, NPServer->ROMName);
 
 #ifdef NP_DEBUG
             printf ("SERVER: Sending welcome information to client @%ld...\n", S9xGetMilliTime () - START);
 #endif
             S9xNPSetAction ("SERVER: Sending welcome information to new client...", TRUE);
-            if (!S9xNPSSendData (NPServer.Clients [c].Socket, data, len))
+            if (!S9xNPQueueData (c, data, len))
             {
                 S9xNPSetWarning ("SERVER: Failed to send welcome message to client.");
                 S9xNPShutdownClient (c, TRUE);
@@ -573,13 +760,12 @@ void S9xNPProcessClient (int c)
 #ifdef NP_DEBUG
             printf ("SERVER: Client %d loaded requested ROM @%ld...\n", c, S9xGetMilliTime () - START);
 #endif
-            NPServer.Clients [c].SaidHello = TRUE;
-            NPServer.Clients [c].Ready = FALSE;
-            NPServer.Clients [c].Paused = FALSE;
+            NPServer->Clients [c].SaidHello = TRUE;
+            NPServer->Clients [c].Ready = FALSE;
+            NPServer->Clients [c].Paused = FALSE;
             S9xNPRecomputePause ();
-            S9xNPWaitForEmulationToComplete ();
 
-            if (NPServer.SyncByReset)
+            if (NPServer->SyncByReset)
             {
                 S9xNPServerAddTask (NP_SERVER_SEND_SRAM, (void *) c);
                 S9xNPServerAddTask (NP_SERVER_RESET_ALL, 0);
@@ -592,13 +778,12 @@ void S9xNPProcessClient (int c)
 #ifdef NP_DEBUG
             printf ("SERVER: Client %d received ROM image @%ld...\n", c, S9xGetMilliTime () - START);
 #endif
-            NPServer.Clients [c].SaidHello = TRUE;
-            NPServer.Clients [c].Ready = FALSE;
-            NPServer.Clients [c].Paused = FALSE;
+            NPServer->Clients [c].SaidHello = TRUE;
+            NPServer->Clients [c].Ready = FALSE;
+            NPServer->Clients [c].Paused = FALSE;
             S9xNPRecomputePause ();
-            S9xNPWaitForEmulationToComplete ();
 
-            if (NPServer.SyncByReset)
+            if (NPServer->SyncByReset)
             {
                 S9xNPServerAddTask (NP_SERVER_SEND_SRAM, (void *) c);
                 S9xNPServerAddTask (NP_SERVER_RESET_ALL, 0);
@@ -612,9 +797,9 @@ void S9xNPProcessClient (int c)
 #ifdef NP_DEBUG
             printf ("SERVER: Client %d waiting for ROM image @%ld...\n", c, S9xGetMilliTime () - START);
 #endif
-            NPServer.Clients [c].SaidHello = TRUE;
-            NPServer.Clients [c].Ready = FALSE;
-            NPServer.Clients [c].Paused = FALSE;
+            NPServer->Clients [c].SaidHello = TRUE;
+            NPServer->Clients [c].Ready = FALSE;
+            NPServer->Clients [c].Paused = FALSE;
             S9xNPRecomputePause ();
             S9xNPSendROMImageToClient (c);
             break;
@@ -623,27 +808,25 @@ void S9xNPProcessClient (int c)
 #ifdef NP_DEBUG
             printf ("SERVER: Client %d ready @%ld...\n", c, S9xGetMilliTime () - START);
 #endif
-            if (NPServer.Clients [c].SaidHello)
+            if (NPServer->Clients [c].SaidHello)
             {
-                NPServer.Clients [c].Paused = FALSE;
-                NPServer.Clients [c].Ready = TRUE;
+                NPServer->Clients [c].Paused = FALSE;
+                NPServer->Clients [c].Ready = TRUE;
 
                 S9xNPRecomputePause ();
                 break;
             }
-            NPServer.Clients [c].SaidHello = TRUE;
-            NPServer.Clients [c].Ready = TRUE;
-            NPServer.Clients [c].Paused = FALSE;
+            NPServer->Clients [c].SaidHello = TRUE;
+            NPServer->Clients [c].Ready = TRUE;
+            NPServer->Clients [c].Paused = FALSE;
             S9xNPRecomputePause ();
 
-//printf ("SERVER: SaidHello = TRUE, SeqNum = %d @%d\n", NPServer.Clients [c].SendSequenceNum, S9xGetMilliTime () - START);
-            if (NPServer.NumClients > NP_ONE_CLIENT)
+//printf ("SERVER: SaidHello = TRUE, SeqNum = %d @%d\n", NPServer->Clients [c].SendSequenceNum, S9xGetMilliTime () - START);
+            if (NPServer->NumClients > NP_ONE_CLIENT)
             {
-                if (!NPServer.SendROMImageOnConnect)
+                if (!NPServer->SendROMImageOnConnect)
                 {
-                    S9xNPWaitForEmulationToComplete ();
-
-                    if (NPServer.SyncByReset)
+                    if (NPServer->SyncByReset)
                     {
                         S9xNPServerAddTask (NP_SERVER_SEND_SRAM, (void *) c);
                         S9xNPServerAddTask (NP_SERVER_RESET_ALL, 0);
@@ -659,19 +842,34 @@ void S9xNPProcessClient (int c)
             }
             else
             {
-                NPServer.Clients [c].Ready = TRUE;
+                NPServer->Clients [c].Ready = TRUE;
                 S9xNPRecomputePause ();
             }
             break;
         case NP_CLNT_JOYPAD:
-            NPServer.Joypads [c] = len;
+            NPServer->Joypads [c] = len;
             break;
+        case NP_CLNT_JOYPAD_FRAME:
+        {
+            uint32 frame = READ_LONG (body);
+
+            // Input for a frame not yet sent is held back until then, late
+            // input goes into the next heart-beat.
+            if (frame > NPServer->FrameCount && frame - NPServer->FrameCount < NP_ROLLBACK_FRAMES)
+            {
+                NPServer->PendingJoypads [c][frame % NP_ROLLBACK_FRAMES] = len;
+                NPServer->PendingFrame [c][frame % NP_ROLLBACK_FRAMES] = frame;
+            }
+            else
+                NPServer->Joypads [c] = len;
+            break;
+        }
         case NP_CLNT_PAUSE:
 #ifdef NP_DEBUG
             printf ("SERVER: Client %d Paused: %s @%ld\n", c, (header [2] & 0x80) ? "YES" : "NO", S9xGetMilliTime () - START);
 #endif
-            NPServer.Clients [c].Paused = (header [2] & 0x80) != 0;
-            if (NPServer.Clients [c].Paused)
+            NPServer->Clients [c].Paused = (header [2] & 0x80) != 0;
+            if (NPServer->Clients [c].Paused)
                 sprintf (NetPlay.WarningMsg, "SERVER: Client %d has paused.", c + 1);
             else
                 sprintf (NetPlay.WarningMsg, "SERVER: Client %d has resumed.", c + 1);
@@ -685,9 +883,14 @@ void S9xNPAcceptClient (int Listen, bool8 block)
 {
     struct sockaddr_in remote_address;
     struct linger val2;
-    struct hostent *host;
     int new_fd;
     int i;
+    int val = 1;
+#ifdef __WIN32__
+    u_long nonblock = 1;
+#else
+    int nonblock = 1;
+#endif
 
 #ifdef NP_DEBUG
     printf ("SERVER: attempting to accept new client connection @%ld\n", S9xGetMilliTime () - START);
@@ -697,33 +900,43 @@ void S9xNPAcceptClient (int Listen, bool8 block)
     socklen_t len = sizeof (remote_address);
 
     new_fd = accept (Listen, (struct sockaddr *)&remote_address, &len);
+    if (new_fd < 0)
+        return;
 
     S9xNPSetAction ("Setting socket options...", TRUE);
     val2.l_onoff = 1;
     val2.l_linger = 0;
     if (setsockopt (new_fd, SOL_SOCKET, SO_LINGER,
-		    (char *) &val2, sizeof (val2)) < 0)
+		    (char *) &val2, sizeof (val2)) < 0 ||
+        ioctl (new_fd, FIONBIO, &nonblock) < 0)
     {
         S9xNPSetError ("Setting socket options failed.");
 	close (new_fd);
         return;
     }
+    // Heart-beats are small and latency sensitive.
+    setsockopt (new_fd, IPPROTO_TCP, TCP_NODELAY, (char *) &val, sizeof (val));
 
     for (i = 0; i < NP_MAX_CLIENTS; i++)
     {
-	if (!NPServer.Clients [i].Connected)
+	if (!NPServer->Clients [i].Connected)
 	{
-            NPServer.NumClients++;
-	    NPServer.Clients [i].Socket = new_fd;
-            NPServer.Clients [i].SendSequenceNum = 0;
-            NPServer.Clients [i].ReceiveSequenceNum = 0;
-            NPServer.Clients [i].Connected = TRUE;
-            NPServer.Clients [i].SaidHello = FALSE;
-            NPServer.Clients [i].Paused = FALSE;
-            NPServer.Clients [i].Ready = FALSE;
-            NPServer.Clients [i].ROMName = NULL;
-            NPServer.Clients [i].HostName = NULL;
-            NPServer.Clients [i].Who = NULL;
+            NPServer->NumClients++;
+	    NPServer->Clients [i].Socket = new_fd;
+            NPServer->Clients [i].SendSequenceNum = 0;
+            NPServer->Clients [i].ReceiveSequenceNum = 0;
+            NPServer->Clients [i].Connected = TRUE;
+            NPServer->Clients [i].SaidHello = FALSE;
+            NPServer->Clients [i].Paused = FALSE;
+            NPServer->Clients [i].Ready = FALSE;
+            NPServer->Clients [i].ROMName = NULL;
+            NPServer->Clients [i].HostName = NULL;
+            NPServer->Clients [i].Who = NULL;
+            NPServer->Clients [i].SendHead = NPServer->Clients [i].SendTail = 0;
+            NPServer->Clients [i].WantWrite = FALSE;
+            NPServer->Clients [i].RecvLen = 0;
+            NPServer->Joypads [i] = 0;
+            memset (NPServer->PendingFrame [i], 0, sizeof (NPServer->PendingFrame [i]));
 	    break;
 	}
     }
@@ -735,33 +948,16 @@ void S9xNPAcceptClient (int Listen, bool8 block)
 	return;
     }
 
+    S9xNPPollAdd (new_fd, i);
+
+    // No reverse lookup of the client's hostname, it would stall every
+    // other client and session while it waits on the resolver.
     if (remote_address.sin_family == AF_INET)
     {
-#ifdef NP_DEBUG
-        printf ("SERVER: Looking up new client's hostname @%ld\n", S9xGetMilliTime () - START);
-#endif
-        S9xNPSetAction ("SERVER: Looking up new client's hostname...", TRUE);
-	host = gethostbyaddr ((char *) &remote_address.sin_addr,
-			      sizeof (remote_address.sin_addr), AF_INET);
-
-	if (host)
-	{
-#ifdef NP_DEBUG
-            printf ("SERVER: resolved new client's hostname (%s) @%ld\n", host->h_name, S9xGetMilliTime () - START);
-#endif
-	    sprintf (NetPlay.WarningMsg, "SERVER: Player %d on %s has connected.", i + 1, host->h_name);
-	    NPServer.Clients [i].HostName = strdup (host->h_name);
-	}
-        else
-        {
-            char *ip = inet_ntoa (remote_address.sin_addr);
-            if (ip)
-                NPServer.Clients [i].HostName = strdup (ip);
-#ifdef NP_DEBUG
-            printf ("SERVER: couldn't resolve new client's hostname (%s) @%ld\n", ip ? ip : "Unknown", S9xGetMilliTime () - START);
-#endif
-	    sprintf (NetPlay.WarningMsg, "SERVER: Player %d on %s has connected.", i + 1, ip ? ip : "Unknown");
-        }
+        char *ip = inet_ntoa (remote_address.sin_addr);
+        if (ip)
+            NPServer->Clients [i].HostName = strdup (ip);
+	sprintf (NetPlay.WarningMsg, "SERVER: Player %d on %s has connected.", i + 1, ip ? ip : "Unknown");
         S9xNPSetWarning (NetPlay.WarningMsg);
     }
 #ifdef NP_DEBUG
@@ -772,44 +968,57 @@ void S9xNPAcceptClient (int Listen, bool8 block)
 
 static bool8 server_continue = TRUE;
 
-static bool8 S9xNPServerInit (int port)
+static bool8 S9xNPSessionInit (struct SNPServer *session, int port, bool8 relay)
 {
     struct sockaddr_in address;
     int i;
     int val;
 
-    if (!S9xNPInitialise ())
-        return (FALSE);
+    NPServer = session;
 
     for (i = 0; i < NP_MAX_CLIENTS; i++)
     {
-        NPServer.Clients [i].SendSequenceNum = 0;
-        NPServer.Clients [i].ReceiveSequenceNum = 0;
-        NPServer.Clients [i].Connected = FALSE;
-        NPServer.Clients [i].SaidHello = FALSE;
-        NPServer.Clients [i].Paused = FALSE;
-        NPServer.Clients [i].Ready = FALSE;
-        NPServer.Clients [i].Socket = 0;
-        NPServer.Clients [i].ROMName = NULL;
-        NPServer.Clients [i].HostName = NULL;
-        NPServer.Clients [i].Who = NULL;
-        NPServer.Joypads [i] = 0;
+        NPServer->Clients [i].SendSequenceNum = 0;
+        NPServer->Clients [i].ReceiveSequenceNum = 0;
+        NPServer->Clients [i].Connected = FALSE;
+        NPServer->Clients [i].SaidHello = FALSE;
+        NPServer->Clients [i].Paused = FALSE;
+        NPServer->Clients [i].Ready = FALSE;
+        NPServer->Clients [i].Socket = 0;
+        NPServer->Clients [i].ROMName = NULL;
+        NPServer->Clients [i].HostName = NULL;
+        NPServer->Clients [i].Who = NULL;
+        NPServer->Clients [i].SendHead = NPServer->Clients [i].SendTail = 0;
+        NPServer->Clients [i].WantWrite = FALSE;
+        NPServer->Clients [i].RecvLen = 0;
+        NPServer->Joypads [i] = 0;
+        memset (NPServer->PendingFrame [i], 0, sizeof (NPServer->PendingFrame [i]));
     }
 
-    NPServer.NumClients = 0;
-    NPServer.FrameCount = 0;
+    NPServer->NumClients = 0;
+    NPServer->FrameCount = 0;
+    NPServer->NextFrame = 0;
+    NPServer->HeartBeatClients = 0;
+    memset (NPServer->SentJoypads, 0, sizeof (NPServer->SentJoypads));
+    NPServer->Relay = relay;
+    if (relay)
+    {
+        // Nothing to send a freeze file, ROM image or S-RAM from.
+        NPServer->SyncByReset = TRUE;
+        NPServer->SendROMImageOnConnect = FALSE;
+    }
 
 #ifdef NP_DEBUG
     printf ("SERVER: Creating socket @%ld\n", S9xGetMilliTime () - START);
 #endif
-    if ((NPServer.Socket = socket (AF_INET, SOCK_STREAM, 0)) < 0)
+    if ((NPServer->Socket = socket (AF_INET, SOCK_STREAM, 0)) < 0)
     {
 	S9xNPSetError ("NetPlay Server: Can't create listening socket.");
 	return (FALSE);
     }
 
     val = 1;
-    setsockopt (NPServer.Socket, SOL_SOCKET, SO_REUSEADDR,
+    setsockopt (NPServer->Socket, SOL_SOCKET, SO_REUSEADDR,
                 (char *)&val, sizeof (val));
 
     memset (&address, 0, sizeof (address));
@@ -820,21 +1029,26 @@ static bool8 S9xNPServerInit (int port)
 #ifdef NP_DEBUG
     printf ("SERVER: Binding socket to address and port @%ld\n", S9xGetMilliTime () - START);
 #endif
-    if (bind (NPServer.Socket, (struct sockaddr *) &address, sizeof (address)) < 0)
+    if (bind (NPServer->Socket, (struct sockaddr *) &address, sizeof (address)) < 0)
     {
 	S9xNPSetError ("NetPlay Server: Can't bind socket to port number.\nPort already in use?");
+	close (NPServer->Socket);
 	return (FALSE);
     }
 
 #ifdef NP_DEBUG
     printf ("SERVER: Getting socket to listen @%ld\n", S9xGetMilliTime () - START);
 #endif
-    if (listen (NPServer.Socket, NP_MAX_CLIENTS) < 0)
+    if (listen (NPServer->Socket, NP_MAX_CLIENTS) < 0)
     {
 	S9xNPSetError ("NetPlay Server: Can't get new socket to listen.");
+	close (NPServer->Socket);
 	return (FALSE);
     }
 
+    S9xNPPollAdd (NPServer->Socket, -1);
+    NPServer->Active = TRUE;
+
 #ifdef NP_DEBUG
     printf ("SERVER: Init complete @%ld\n", S9xGetMilliTime () - START);
 #endif
@@ -851,187 +1065,284 @@ void S9xNPSendServerPause (bool8 paused)
     *ptr++ = NP_SERV_MAGIC;
     *ptr++ = 0;
     *ptr++ = NP_SERV_PAUSE | (paused ? 0x20 : 0);
-    WRITE_LONG (ptr, NPServer.FrameCount);
+    S9xNPLockServer ();
+    WRITE_LONG (ptr, NPServer->FrameCount);
     S9xNPSendToAllClients (pause, 7);
+    S9xNPUnlockServer ();
 }
 
-void S9xNPServerLoop (void *)
+static int64 S9xNPServerClock ()
 {
-#ifdef __WIN32__
-    BOOL success = FALSE;
-#else
-    bool8 success = FALSE;
-    static struct timeval next1 = {0, 0};
     struct timeval now;
-#endif
 
-	int pausedState = -1, newPausedState = -1;
+    while (gettimeofday (&now, NULL) < 0) ;
 
-    while (server_continue)
+    return ((int64) now.tv_sec * 1000000 + now.tv_usec);
+}
+
+// Sends the session's heart-beat if its next frame is due. Returns the time
+// left until the one after.
+static int64 S9xNPSessionTick (int64 now)
+{
+    int64 frame_time = Settings.FrameTime;
+
+    if (NPServer->Relay && NPServer->FrameTime)
+        frame_time = NPServer->FrameTime;
+
+    if (NPServer->NextFrame == 0)
+        NPServer->NextFrame = now;
+
+    if (now >= NPServer->NextFrame)
     {
-        fd_set read_fds;
-        struct timeval timeout;
-        int res;
-        int i;
+        // More than half a second behind means we were probably stopped,
+        // don't try to make up for it.
+        if (now - NPServer->NextFrame > 500000)
+            NPServer->NextFrame = now;
+        NPServer->NextFrame += frame_time;
+
+        bool8 running = !NPServer->Paused;
+
+        if (!NPServer->Relay)
+            running = running && !(Settings.Paused && !Settings.FrameAdvance) &&
+                      !Settings.StopEmulation && !Settings.ForcedPause;
+        if (running)
+            S9xNPSendHeartBeat ();
+    }
 
-        int max_fd = NPServer.Socket;
+    return (NPServer->NextFrame - now);
+}
 
-#ifdef __WIN32__
-        Sleep (0);
+// Whether the emulation has stopped at a point where the game can be frozen,
+// reset or sent. It gets there once a task's clients are no longer ready and
+// the heart-beats stop.
+static bool8 S9xNPEmulationStopped ()
+{
+    return (NetPlay.PendingWait4Sync || !NetPlay.Connected ||
+            Settings.ForcedPause || Settings.StopEmulation ||
+            (Settings.Paused && !Settings.FrameAdvance));
+}
+
+// Pauses the clients a task is about to resync and reports whether it can
+// run yet. Relay sessions have no game of their own to wait for.
+static bool8 S9xNPTaskReady (uint32 task, void *task_data)
+{
+    switch (task)
+    {
+        case NP_SERVER_SYNC_CLIENT:
+        case NP_SERVER_SEND_SRAM:
+            NPServer->Clients [(pint) task_data].Ready = FALSE;
+            S9xNPRecomputePause ();
+            break;
+        case NP_SERVER_RESET_ALL:
+            S9xNPNoClientReady (0);
+            break;
+        case NP_SERVER_SEND_ROM_IMAGE:
+        case NP_SERVER_SYNC_ALL:
+        case NP_SERVER_SEND_SRAM_ALL:
+            S9xNPNoClientReady ();
+            break;
+        default:
+            return (TRUE);
+    }
+
+    return (NPServer->Relay || S9xNPEmulationStopped ());
+}
+
+// Runs the session's queued tasks in order. Returns TRUE if the one at the
+// head is still waiting for the emulation to stop, in which case the loop
+// comes back to it shortly rather than blocking every session on it.
+static bool8 S9xNPRunTasks ()
+{
+    while (NPServer->TaskHead != NPServer->TaskTail)
+    {
+        uint32 task = NPServer->TaskQueue [NPServer->TaskHead].Task;
+        void *task_data = NPServer->TaskQueue [NPServer->TaskHead].Data;
+
+        if (!S9xNPTaskReady (task, task_data))
+            return (TRUE);
+
+#if defined(NP_DEBUG) && NP_DEBUG == 2
+        printf ("SERVER: task %d @%ld\n", task, S9xGetMilliTime () - START);
 #endif
 
-        if (success && !(Settings.Paused && !Settings.FrameAdvance) && !Settings.StopEmulation &&
-            !Settings.ForcedPause && !NPServer.Paused)
+        switch (task)
         {
-            S9xNPSendHeartBeat ();
-			newPausedState = 0;
-        }
-		else
-		{
-			newPausedState = 1;
-		}
-
-		if(pausedState != newPausedState)
-		{
-			pausedState = newPausedState;
-//			S9xNPSendServerPause(pausedState); // XXX: doesn't seem to work yet...
-		}
-
-        do
-        {
-            FD_ZERO (&read_fds);
-            FD_SET (NPServer.Socket, &read_fds);
-            for (i = 0; i < NP_MAX_CLIENTS; i++)
-            {
-                if (NPServer.Clients [i].Connected)
+            case NP_SERVER_SEND_ROM_IMAGE:
+                S9xNPSendROMImageToAllClients ();
+                break;
+            case NP_SERVER_SYNC_CLIENT:
+                S9xNPSyncClient ((pint) task_data);
+                break;
+            case NP_SERVER_SYNC_ALL:
+                S9xNPSyncClients ();
+                break;
+            case NP_SERVER_SEND_FREEZE_FILE_ALL:
+                S9xNPSendFreezeFileToAllClients ((char *) task_data);
+                free ((char *) task_data);
+                break;
+            case NP_SERVER_SEND_ROM_LOAD_REQUEST_ALL:
+                S9xNPSendROMLoadRequest ((char *) task_data);
+                free ((char *) task_data);
+                break;
+            case NP_SERVER_RESET_ALL:
+                S9xNPSetAction ("SERVER: Sending RESET to all clients...", TRUE);
+#ifdef NP_DEBUG
+                printf ("SERVER: Sending RESET to all clients @%ld\n", S9xGetMilliTime () - START);
+#endif
                 {
-                    FD_SET (NPServer.Clients [i].Socket, &read_fds);
-                    if (NPServer.Clients [i].Socket > max_fd)
-                        max_fd = NPServer.Clients [i].Socket;
+                    uint8 reset [7];
+                    uint8 *ptr;
+
+                    ptr = reset;
+                    *ptr++ = NP_SERV_MAGIC;
+                    *ptr++ = 0;
+                    *ptr++ = NP_SERV_RESET;
+                    WRITE_LONG (ptr, NPServer->FrameCount);
+                    S9xNPSendToAllClients (reset, 7);
                 }
-            }
+                S9xNPSetAction ("", TRUE);
+                break;
+            case NP_SERVER_SEND_SRAM:
+                S9xNPSendSRAMToClient ((pint) task_data);
+                break;
 
-            timeout.tv_sec = 0;
-            timeout.tv_usec = 1000;
-            res = select (max_fd + 1, &read_fds, NULL, NULL, &timeout);
+            case NP_SERVER_SEND_SRAM_ALL:
+                S9xNPSendSRAMToAllClients ();
+                break;
 
-            if (res > 0)
-            {
-                if (FD_ISSET (NPServer.Socket, &read_fds))
-                    S9xNPAcceptClient (NPServer.Socket, FALSE);
+            default:
+                S9xNPSetError ("SERVER: *** Unknown task ***\n");
+                break;
+        }
+        NPServer->TaskHead = (NPServer->TaskHead + 1) % NP_MAX_TASKS;
+    }
 
-                for (i = 0; i < NP_MAX_CLIENTS; i++)
-                {
-                    if (NPServer.Clients [i].Connected &&
-                        FD_ISSET (NPServer.Clients [i].Socket, &read_fds))
-                    {
-                        S9xNPProcessClient (i);
-                    }
-                }
-            }
-        } while (res > 0);
+    return (FALSE);
+}
 
-#ifdef __WIN32__
-        success = WaitForSingleObject (GUI.ServerTimerSemaphore, 200) == WAIT_OBJECT_0;
-#else
-        while (gettimeofday (&now, NULL) < 0) ;
+// Waits up to 'usec' for socket activity on any session and services it.
+static void S9xNPServerWait (int64 usec)
+{
+#ifdef NP_USE_EPOLL
+    struct epoll_event events [64];
+    int n = epoll_wait (NPPoll, events, 64, (int) ((usec + 999) / 1000));
 
-        /* If there is no known "next" frame, initialize it now */
-        if (next1.tv_sec == 0) { next1 = now; ++next1.tv_usec; }
+    S9xNPLockServer ();
+    for (int i = 0; i < n; i++)
+    {
+        struct SNPServer *session = &NPSessions [events [i].data.u32 >> 8];
+        int c = (int) (events [i].data.u32 & 0xff) - 1;
 
-	success=FALSE;
+        if (!session->Active)
+            continue;
 
-	if (timercmp(&next1, &now, >))
+        NPServer = session;
+        if (c < 0)
+            S9xNPAcceptClient (NPServer->Socket, FALSE);
+        else
+        {
+            if ((events [i].events & EPOLLOUT) && NPServer->Clients [c].Connected)
+                S9xNPFlushClient (c);
+            if ((events [i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) && NPServer->Clients [c].Connected)
+                S9xNPReadClient (c);
+        }
+    }
+#else
+    fd_set read_fds, write_fds;
+    struct timeval timeout;
+    int max_fd = 0;
+    int s, c;
+
+    FD_ZERO (&read_fds);
+    FD_ZERO (&write_fds);
+    S9xNPLockServer ();
+    for (s = 0; s < NP_MAX_SESSIONS; s++)
+    {
+        NPServer = &NPSessions [s];
+        if (!NPServer->Active)
+            continue;
+
+        FD_SET (NPServer->Socket, &read_fds);
+        if (NPServer->Socket > max_fd)
+            max_fd = NPServer->Socket;
+        for (c = 0; c < NP_MAX_CLIENTS; c++)
         {
-            /* If we're ahead of time, sleep a while */
-            unsigned timeleft =
-                (next1.tv_sec - now.tv_sec) * 1000000
-                + next1.tv_usec - now.tv_usec;
-	    usleep(timeleft<(200*1000)?timeleft:(200*1000));
+            if (NPServer->Clients [c].Connected)
+            {
+                FD_SET (NPServer->Clients [c].Socket, &read_fds);
+                if (NPServer->Clients [c].SendHead < NPServer->Clients [c].SendTail)
+                    FD_SET (NPServer->Clients [c].Socket, &write_fds);
+                if (NPServer->Clients [c].Socket > max_fd)
+                    max_fd = NPServer->Clients [c].Socket;
+            }
         }
+    }
+
+    S9xNPUnlockServer ();
+
+    timeout.tv_sec = usec / 1000000;
+    timeout.tv_usec = usec % 1000000;
+    int n = select (max_fd + 1, &read_fds, &write_fds, NULL, &timeout);
 
-        if (!timercmp(&next1, &now, >))
+    S9xNPLockServer ();
+    if (n > 0)
+    {
+        for (s = 0; s < NP_MAX_SESSIONS; s++)
         {
+            NPServer = &NPSessions [s];
+            if (!NPServer->Active)
+                continue;
+
+            if (FD_ISSET (NPServer->Socket, &read_fds))
+                S9xNPAcceptClient (NPServer->Socket, FALSE);
 
-            /* Calculate the timestamp of the next frame. */
-            next1.tv_usec += Settings.FrameTime;
-            if (next1.tv_usec >= 1000000)
+            for (c = 0; c < NP_MAX_CLIENTS; c++)
             {
-                next1.tv_sec += next1.tv_usec / 1000000;
-                next1.tv_usec %= 1000000;
+                if (NPServer->Clients [c].Connected &&
+                    FD_ISSET (NPServer->Clients [c].Socket, &write_fds))
+                    S9xNPFlushClient (c);
+                if (NPServer->Clients [c].Connected &&
+                    FD_ISSET (NPServer->Clients [c].Socket, &read_fds))
+                    S9xNPReadClient (c);
             }
-            success=TRUE;
-         }
+        }
+    }
 #endif
+    S9xNPUnlockServer ();
+}
 
-        while (NPServer.TaskHead != NPServer.TaskTail)
-        {
-            void *task_data = NPServer.TaskQueue [NPServer.TaskHead].Data;
+void S9xNPServerLoop (void *)
+{
+    while (server_continue)
+    {
+        int64 now = S9xNPServerClock ();
+        int64 wait = 200000;
 
-#if defined(NP_DEBUG) && NP_DEBUG == 2
-            printf ("SERVER: task %d @%ld\n", NPServer.TaskQueue [NPServer.TaskHead].Task, S9xGetMilliTime () - START);
+#ifdef __WIN32__
+        Sleep (0);
 #endif
 
-            switch (NPServer.TaskQueue [NPServer.TaskHead].Task)
-            {
-                case NP_SERVER_SEND_ROM_IMAGE:
-                    S9xNPSendROMImageToAllClients ();
-                    break;
-                case NP_SERVER_SYNC_CLIENT:
-                    NPServer.Clients [(pint) task_data].Ready = FALSE;
-                    S9xNPRecomputePause ();
-                    S9xNPSyncClient ((pint) task_data);
-                    break;
-                case NP_SERVER_SYNC_ALL:
-                    S9xNPSyncClients ();
-                    break;
-                case NP_SERVER_SEND_FREEZE_FILE_ALL:
-                    S9xNPSendFreezeFileToAllClients ((char *) task_data);
-                    free ((char *) task_data);
-                    break;
-                case NP_SERVER_SEND_ROM_LOAD_REQUEST_ALL:
-                    S9xNPSendROMLoadRequest ((char *) task_data);
-                    free ((char *) task_data);
-                    break;
-                case NP_SERVER_RESET_ALL:
-                    S9xNPNoClientReady (0);
-                    S9xNPWaitForEmulationToComplete ();
-                    S9xNPSetAction ("SERVER: Sending RESET to all clients...", TRUE);
-#ifdef NP_DEBUG
-                    printf ("SERVER: Sending RESET to all clients @%ld\n", S9xGetMilliTime () - START);
-#endif
-                    {
-                        uint8 reset [7];
-                        uint8 *ptr;
-
-                        ptr = reset;
-                        *ptr++ = NP_SERV_MAGIC;
-                        *ptr++ = 0;
-                        *ptr++ = NP_SERV_RESET;
-                        WRITE_LONG (ptr, NPServer.FrameCount);
-                        S9xNPSendToAllClients (reset, 7);
-                    }
-                    S9xNPSetAction ("", TRUE);
-                    break;
-                case NP_SERVER_SEND_SRAM:
-                    NPServer.Clients [(pint) task_data].Ready = FALSE;
-                    S9xNPRecomputePause ();
-                    S9xNPWaitForEmulationToComplete ();
-                    S9xNPSendSRAMToClient ((pint) task_data);
-                    break;
+        // Heart-beats and task output are only queued here, then written to
+        // every client in one pass.
+        S9xNPLockServer ();
+        for (int s = 0; s < NP_MAX_SESSIONS; s++)
+        {
+            if (!NPSessions [s].Active)
+                continue;
 
-                case NP_SERVER_SEND_SRAM_ALL:
-                    S9xNPNoClientReady ();
-                    S9xNPWaitForEmulationToComplete ();
-                    S9xNPSendSRAMToAllClients ();
-                    break;
+            NPServer = &NPSessions [s];
 
-                default:
-                    S9xNPSetError ("SERVER: *** Unknown task ***\n");
-                    break;
-            }
-            NPServer.TaskHead = (NPServer.TaskHead + 1) % NP_MAX_TASKS;
+            int64 left = S9xNPSessionTick (now);
+            if (left < wait)
+                wait = left;
+
+            if (S9xNPRunTasks () && wait > NP_TASK_POLL_USEC)
+                wait = NP_TASK_POLL_USEC;
+            S9xNPFlushClients ();
         }
+        S9xNPUnlockServer ();
+
+        S9xNPServerWait (wait);
     }
 #ifdef NP_DEBUG
     printf ("SERVER: Server thread exiting @%ld\n", S9xGetMilliTime () - START);
@@ -1040,6 +1351,28 @@ void S9xNPServerLoop (void *)
     // S9xNPStopServer ();
 }
 
+bool8 S9xNPAddRelaySession (int port)
+{
+    if (!S9xNPInitialise ())
+        return (FALSE);
+
+    S9xNPLockServer ();
+    for (int s = 1; s < NP_MAX_SESSIONS; s++)
+    {
+        if (!NPSessions [s].Active)
+        {
+            bool8 ok = S9xNPSessionInit (&NPSessions [s], port, TRUE);
+
+            S9xNPUnlockServer ();
+            return (ok);
+        }
+    }
+    S9xNPUnlockServer ();
+
+    S9xNPSetError ("NetPlay Server: No free sessions left.");
+    return (FALSE);
+}
+
 bool8 S9xNPStartServer (int port)
 {
     static int p;
@@ -1049,15 +1382,31 @@ bool8 S9xNPStartServer (int port)
 #endif
     p = port;
     server_continue = TRUE;
-    if (S9xNPServerInit (port))
+
+    if (!S9xNPInitialise ())
+        return (FALSE);
+#ifndef __WIN32__
+    // A client vanishing mid-write must not take the server down with it.
+    signal (SIGPIPE, SIG_IGN);
+#endif
+
+    // A port of 0 runs only the relay sessions already added.
+    if (port > 0)
+    {
+        S9xNPLockServer ();
+        bool8 ok = S9xNPSessionInit (&NPSessions [0], port, FALSE);
+        S9xNPUnlockServer ();
+
+        if (!ok)
+            return (FALSE);
+    }
+
 #ifdef __WIN32__
-        return (_beginthread (S9xNPServerLoop, 0, &p) != (uintptr_t)(~0));
+    return (_beginthread (S9xNPServerLoop, 0, &p) != (uintptr_t)(~0));
 #else
-    	S9xNPServerLoop(NULL);
-	return (TRUE);
+    S9xNPServerLoop (&p);
+    return (TRUE);
 #endif
-
-    return (FALSE);
 }
 
 void S9xNPStopServer ()
@@ -1066,13 +1415,32 @@ void S9xNPStopServer ()
     printf ("SERVER: Stopping server @%ld\n", S9xGetMilliTime () - START);
 #endif
     server_continue = FALSE;
-    close (NPServer.Socket);
 
-    for (int i = 0; i < NP_MAX_CLIENTS; i++)
+    S9xNPLockServer ();
+    for (int s = 0; s < NP_MAX_SESSIONS; s++)
     {
-        if (NPServer.Clients [i].Connected)
-	    S9xNPShutdownClient(i, FALSE);
+        if (!NPSessions [s].Active)
+            continue;
+
+        NPServer = &NPSessions [s];
+        NPServer->Active = FALSE;
+        close (NPServer->Socket);
+
+        for (int i = 0; i < NP_MAX_CLIENTS; i++)
+        {
+            if (NPServer->Clients [i].Connected)
+                S9xNPShutdownClient(i, FALSE);
+        }
     }
+    S9xNPUnlockServer ();
+
+#ifdef NP_USE_EPOLL
+    if (NPPoll >= 0)
+    {
+        close (NPPoll);
+        NPPoll = -1;
+    }
+#endif
 }
 
 #ifdef __WIN32__
@@ -1085,20 +1453,18 @@ void S9xGetTimeOfDay (struct timeval *n)
 }
 #endif
 
+// Only run as a task, once the emulation has stopped.
 void S9xNPSendROMImageToAllClients ()
 {
-    S9xNPNoClientReady ();
-    S9xNPWaitForEmulationToComplete ();
-
     int c;
 
     for (c = NP_ONE_CLIENT; c < NP_MAX_CLIENTS; c++)
     {
-        if (NPServer.Clients [c].SaidHello)
+        if (NPServer->Clients [c].SaidHello)
             S9xNPSendROMImageToClient (c);
     }
 
-    if (NPServer.SyncByReset)
+    if (NPServer->SyncByReset)
     {
         S9xNPServerAddTask (NP_SERVER_SEND_SRAM_ALL, 0);
         S9xNPServerAddTask (NP_SERVER_RESET_ALL, 0);
@@ -1107,8 +1473,24 @@ void S9xNPSendROMImageToAllClients ()
         S9xNPSyncClient (-1);
 }
 
+// Packs data for sending to a client, see S9xNPPackChunks.
+static uint8 *S9xNPPackForClient (int c, const uint8 *data, uint32 len, uint32 &packed_len)
+{
+    uint8 *packed = new uint8 [NP_PACKED_BOUND (len)];
+
+    packed_len = S9xNPPackChunks (data, len, packed, NPServer->Clients [c].Compress);
+    return (packed);
+}
+
 bool8 S9xNPSendROMImageToClient (int c)
 {
+    if (NPServer->Relay)
+    {
+        S9xNPSetWarning ("SERVER: Relay sessions have no ROM image to send.");
+        S9xNPShutdownClient (c, TRUE);
+        return (FALSE);
+    }
+
 #ifdef NP_DEBUG
     printf ("SERVER: Sending ROM image to player %d @%ld\n", c + 1, S9xGetMilliTime () - START);
 #endif
@@ -1117,21 +1499,25 @@ bool8 S9xNPSendROMImageToClient (int c)
 
     uint8 header [7 + 1 + 4];
     uint8 *ptr = header;
-    int len = sizeof (header) + Memory.CalculatedSize +
+    uint32 packed_len;
+    uint8 *packed = S9xNPPackForClient (c, Memory.ROM, Memory.CalculatedSize, packed_len);
+    int len = sizeof (header) + packed_len +
               strlen (Memory.ROMFilename) + 1;
     *ptr++ = NP_SERV_MAGIC;
-    *ptr++ = NPServer.Clients [c].SendSequenceNum++;
+    *ptr++ = NPServer->Clients [c].SendSequenceNum++;
     *ptr++ = NP_SERV_ROM_IMAGE;
     WRITE_LONG (ptr, len);
     ptr += 4;
     *ptr++ = Memory.HiROM;
     WRITE_LONG (ptr, Memory.CalculatedSize);
 
-    if (!S9xNPSSendData (NPServer.Clients [c].Socket, header, sizeof (header)) ||
-        !S9xNPSSendData (NPServer.Clients [c].Socket, Memory.ROM,
-                        Memory.CalculatedSize) ||
-        !S9xNPSSendData (NPServer.Clients [c].Socket, (uint8 *) Memory.ROMFilename,
-                        strlen (Memory.ROMFilename) + 1))
+    bool8 ok = S9xNPQueueData (c, header, sizeof (header)) &&
+               S9xNPQueueData (c, packed, packed_len) &&
+               S9xNPQueueData (c, (uint8 *) Memory.ROMFilename,
+                               strlen (Memory.ROMFilename) + 1);
+    delete [] packed;
+
+    if (!ok)
     {
         S9xNPShutdownClient (c, TRUE);
         return (FALSE);
@@ -1145,8 +1531,12 @@ void S9xNPSyncClients ()
     S9xNPSyncClient (-1);
 }
 
+// Only run from a task, once the emulation has stopped.
 void S9xNPSyncClient (int client)
 {
+    if (NPServer->Relay)
+        return;
+
 #ifdef HAVE_MKSTEMP
     char fname[] = "/tmp/snes9x_fztmpXXXXXX";
     int fd=-1;
@@ -1154,8 +1544,6 @@ void S9xNPSyncClient (int client)
     char fname [L_tmpnam];
 #endif
 
-    S9xNPWaitForEmulationToComplete ();
-
     S9xNPSetAction ("SERVER: Freezing game...", TRUE);
 #ifdef HAVE_MKSTEMP
     if ( ((fd=mkstemp(fname)) >= 0) && S9xFreezeGame(fname) )
@@ -1175,9 +1563,9 @@ void S9xNPSyncClient (int client)
             {
                 for (c = NP_ONE_CLIENT; c < NP_MAX_CLIENTS; c++)
                 {
-                    if (NPServer.Clients [c].SaidHello)
+                    if (NPServer->Clients [c].SaidHello)
                     {
-                        NPServer.Clients [c].Ready = FALSE;
+                        NPServer->Clients [c].Ready = FALSE;
                         S9xNPRecomputePause ();
                         S9xNPSendFreezeFile (c, data, len);
                     }
@@ -1185,7 +1573,7 @@ void S9xNPSyncClient (int client)
             }
             else
             {
-                NPServer.Clients [client].Ready = FALSE;
+                NPServer->Clients [client].Ready = FALSE;
                 S9xNPRecomputePause ();
                 S9xNPSendFreezeFile (client, data, len);
             }
@@ -1226,21 +1614,26 @@ void S9xNPSendFreezeFile (int c, uint8 *data, uint32 len)
 
     sprintf (NetPlay.ActionMsg, "SERVER: Sending freeze-file to player %d...", c + 1);
     S9xNPSetAction (NetPlay.ActionMsg, TRUE);
-    uint8 header [7 + 4];
+    uint8 header [7 + 4 + 4];
     uint8 *ptr = header;
+    uint32 packed_len;
+    uint8 *packed = S9xNPPackForClient (c, data, len, packed_len);
 
     *ptr++ = NP_SERV_MAGIC;
-    *ptr++ = NPServer.Clients [c].SendSequenceNum++;
+    *ptr++ = NPServer->Clients [c].SendSequenceNum++;
     *ptr++ = NP_SERV_FREEZE_FILE;
-    WRITE_LONG (ptr, len + 7 + 4);
+    WRITE_LONG (ptr, packed_len + 7 + 4 + 4);
+    ptr += 4;
+    WRITE_LONG (ptr, NPServer->FrameCount);
     ptr += 4;
-    WRITE_LONG (ptr, NPServer.FrameCount);
+    WRITE_LONG (ptr, len);
 
-    if (!S9xNPSSendData (NPServer.Clients [c].Socket, header, 7 + 4) ||
-        !S9xNPSSendData (NPServer.Clients [c].Socket, data, len))
+    if (!S9xNPQueueData (c, header, sizeof (header)) ||
+        !S9xNPQueueData (c, packed, packed_len))
     {
        S9xNPShutdownClient (c, TRUE);
     }
+    delete [] packed;
     S9xNPSetAction ("", TRUE);
 }
 
@@ -1250,20 +1643,20 @@ void S9xNPRecomputePause ()
 
     for (c = 0; c < NP_MAX_CLIENTS; c++)
     {
-        if (NPServer.Clients [c].SaidHello &&
-            (!NPServer.Clients [c].Ready || NPServer.Clients [c].Paused))
+        if (NPServer->Clients [c].SaidHello &&
+            (!NPServer->Clients [c].Ready || NPServer->Clients [c].Paused))
         {
 #if defined(NP_DEBUG) && NP_DEBUG == 2
-            printf ("SERVER: Paused because of client %d (%d,%d) @%ld\n", c, NPServer.Clients [c].Ready, NPServer.Clients [c].Paused, S9xGetMilliTime () - START);
+            printf ("SERVER: Paused because of client %d (%d,%d) @%ld\n", c, NPServer->Clients [c].Ready, NPServer->Clients [c].Paused, S9xGetMilliTime () - START);
 #endif
-            NPServer.Paused = TRUE;
+            NPServer->Paused = TRUE;
             return;
         }
     }
 #if defined(NP_DEBUG) && NP_DEBUG == 2
     printf ("SERVER: not paused @%ld\n", S9xGetMilliTime () - START);
 #endif
-    NPServer.Paused = FALSE;
+    NPServer->Paused = FALSE;
 }
 
 void S9xNPNoClientReady (int start_index)
@@ -1271,7 +1664,7 @@ void S9xNPNoClientReady (int start_index)
     int c;
 
     for (c = start_index; c < NP_MAX_CLIENTS; c++)
-        NPServer.Clients [c].Ready = FALSE;
+        NPServer->Clients [c].Ready = FALSE;
     S9xNPRecomputePause ();
 }
 
@@ -1291,15 +1684,15 @@ void S9xNPSendROMLoadRequest (const char *filename)
 
     for (int i = NP_ONE_CLIENT; i < NP_MAX_CLIENTS; i++)
     {
-	if (NPServer.Clients [i].SaidHello)
+	if (NPServer->Clients [i].SaidHello)
 	{
 #ifdef NP_DEBUG
             printf ("SERVER: Sending load ROM requesting to player %d @%ld\n", i + 1, S9xGetMilliTime () - START);
 #endif
             sprintf (NetPlay.WarningMsg, "SERVER: sending ROM load request to player %d...", i + 1);
             S9xNPSetAction (NetPlay.WarningMsg, TRUE);
-            data [1] = NPServer.Clients [i].SendSequenceNum++;
-	    if (!S9xNPSSendData (NPServer.Clients [i].Socket, data, len))
+            data [1] = NPServer->Clients [i].SendSequenceNum++;
+	    if (!S9xNPQueueData (i, data, len))
             {
 		S9xNPShutdownClient (i, TRUE);
             }
@@ -1314,39 +1707,45 @@ void S9xNPSendSRAMToAllClients ()
 
     for (i = NP_ONE_CLIENT; i < NP_MAX_CLIENTS; i++)
     {
-        if (NPServer.Clients [i].SaidHello)
+        if (NPServer->Clients [i].SaidHello)
             S9xNPSendSRAMToClient (i);
     }
 }
 
 void S9xNPSendSRAMToClient (int c)
 {
+    if (NPServer->Relay)
+        return;
+
 #ifdef NP_DEBUG
     printf ("SERVER: Sending S-RAM data to player %d @%ld\n", c + 1, S9xGetMilliTime () - START);
 #endif
-    uint8 sram [7];
+    uint8 sram [7 + 4];
     int SRAMSize = Memory.SRAMSize ?
                    (1 << (Memory.SRAMSize + 3)) * 128 : 0;
     if (SRAMSize > 0x10000)
         SRAMSize = 0x10000;
-    int len = 7 + SRAMSize;
+    uint32 packed_len;
+    uint8 *packed = S9xNPPackForClient (c, Memory.SRAM, SRAMSize, packed_len);
+    int len = sizeof (sram) + packed_len;
 
     sprintf (NetPlay.ActionMsg, "SERVER: Sending S-RAM to player %d...", c + 1);
     S9xNPSetAction (NetPlay.ActionMsg, TRUE);
 
     uint8 *ptr = sram;
     *ptr++ = NP_SERV_MAGIC;
-    *ptr++ = NPServer.Clients [c].SendSequenceNum++;
+    *ptr++ = NPServer->Clients [c].SendSequenceNum++;
     *ptr++ = NP_SERV_SRAM_DATA;
     WRITE_LONG (ptr, len);
-    if (!S9xNPSSendData (NPServer.Clients [c].Socket,
-                        sram, sizeof (sram)) ||
-        (len > 7 &&
-         !S9xNPSSendData (NPServer.Clients [c].Socket,
-                         Memory.SRAM, len - 7)))
+    ptr += 4;
+    WRITE_LONG (ptr, SRAMSize);
+    if (!S9xNPQueueData (c, sram, sizeof (sram)) ||
+        (packed_len > 0 &&
+         !S9xNPQueueData (c, packed, packed_len)))
     {
         S9xNPShutdownClient (c, TRUE);
     }
+    delete [] packed;
 }
 
 void S9xNPSendFreezeFileToAllClients (const char *filename)
@@ -1354,96 +1753,88 @@ void S9xNPSendFreezeFileToAllClients (const char *filename)
     uint8 *data;
     uint32 len;
 
-    if (NPServer.NumClients > NP_ONE_CLIENT && S9xNPLoadFreezeFile (filename, data, len))
+    if (NPServer->NumClients > NP_ONE_CLIENT && S9xNPLoadFreezeFile (filename, data, len))
     {
         S9xNPNoClientReady ();
 
         for (int c = NP_ONE_CLIENT; c < NP_MAX_CLIENTS; c++)
         {
-            if (NPServer.Clients [c].SaidHello)
+            if (NPServer->Clients [c].SaidHello)
                 S9xNPSendFreezeFile (c, data, len);
         }
         delete data;
     }
 }
 
+// Called with the server locked.
 void S9xNPServerAddTask (uint32 task, void *data)
 {
-    NPServer.TaskQueue [NPServer.TaskTail].Task = task;
-    NPServer.TaskQueue [NPServer.TaskTail].Data = data;
+    NPServer->TaskQueue [NPServer->TaskTail].Task = task;
+    NPServer->TaskQueue [NPServer->TaskTail].Data = data;
 
-    NPServer.TaskTail = (NPServer.TaskTail + 1) % NP_MAX_TASKS;
+    NPServer->TaskTail = (NPServer->TaskTail + 1) % NP_MAX_TASKS;
 }
 
 void S9xNPReset ()
 {
+    S9xNPLockServer ();
     S9xNPNoClientReady (0);
     S9xNPServerAddTask (NP_SERVER_RESET_ALL, 0);
-}
-
-void S9xNPWaitForEmulationToComplete ()
-{
-#ifdef NP_DEBUG
-    printf ("SERVER: WaitForEmulationToComplete start @%ld\n", S9xGetMilliTime () - START);
-#endif
-
-    while (!NetPlay.PendingWait4Sync && NetPlay.Connected &&
-           !Settings.ForcedPause && !Settings.StopEmulation &&
-           !(Settings.Paused && !Settings.FrameAdvance))
-    {
-#ifdef __WIN32__
-        Sleep (40);
-#endif
-    }
-#ifdef NP_DEBUG
-    printf ("SERVER: WaitForEmulationToComplete end @%ld\n", S9xGetMilliTime () - START);
-#endif
+    S9xNPUnlockServer ();
 }
 
 void S9xNPServerQueueSyncAll ()
 {
+    S9xNPLockServer ();
     if (Settings.NetPlay && Settings.NetPlayServer &&
-        NPServer.NumClients > NP_ONE_CLIENT)
+        NPServer->NumClients > NP_ONE_CLIENT)
     {
         S9xNPNoClientReady ();
         S9xNPDiscardHeartbeats ();
         S9xNPServerAddTask (NP_SERVER_SYNC_ALL, 0);
     }
+    S9xNPUnlockServer ();
 }
 
 void S9xNPServerQueueSendingROMImage ()
 {
+    S9xNPLockServer ();
     if (Settings.NetPlay && Settings.NetPlayServer &&
-        NPServer.NumClients > NP_ONE_CLIENT)
+        NPServer->NumClients > NP_ONE_CLIENT)
     {
         S9xNPNoClientReady ();
         S9xNPDiscardHeartbeats ();
         S9xNPServerAddTask (NP_SERVER_SEND_ROM_IMAGE, 0);
     }
+    S9xNPUnlockServer ();
 }
 
 void S9xNPServerQueueSendingFreezeFile (const char *filename)
 {
+    S9xNPLockServer ();
     if (Settings.NetPlay && Settings.NetPlayServer &&
-        NPServer.NumClients > NP_ONE_CLIENT)
+        NPServer->NumClients > NP_ONE_CLIENT)
     {
         S9xNPNoClientReady ();
         S9xNPDiscardHeartbeats ();
         S9xNPServerAddTask (NP_SERVER_SEND_FREEZE_FILE_ALL,
                             (void *) strdup (filename));
     }
+    S9xNPUnlockServer ();
 }
 
 void S9xNPServerQueueSendingLoadROMRequest (const char *filename)
 {
+    S9xNPLockServer ();
     if (Settings.NetPlay && Settings.NetPlayServer &&
-        NPServer.NumClients > NP_ONE_CLIENT)
+        NPServer->NumClients > NP_ONE_CLIENT)
     {
         S9xNPNoClientReady ();
         S9xNPDiscardHeartbeats ();
         S9xNPServerAddTask (NP_SERVER_SEND_ROM_LOAD_REQUEST_ALL,
                             (void *) strdup (filename));
     }
+    S9xNPUnlockServer ();
 }
 
 #ifndef __WIN32__
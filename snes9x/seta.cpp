@@ -179,8 +179,8 @@
 #include "snes9x.h"
 #include "seta.h"
 
-uint8	(*GetSETA) (uint32)        = &S9xGetST010;
-void	(*SetSETA) (uint32, uint8) = &S9xSetST010;
+CONTEXT_LOCAL uint8	(*GetSETA) (uint32)        = &S9xGetST010;
+CONTEXT_LOCAL void	(*SetSETA) (uint32, uint8) = &S9xSetST010;
 
 
 uint8 S9xGetSetaDSP (uint32 Address)
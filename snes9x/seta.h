@@ -220,9 +220,9 @@ struct SST018
 	uint8	output[512];
 };
 
-extern struct SST010	ST010;
-extern struct SST011	ST011;
-extern struct SST018	ST018;
+extern CONTEXT_LOCAL struct SST010	ST010;
+extern CONTEXT_LOCAL struct SST011	ST011;
+extern CONTEXT_LOCAL struct SST018	ST018;
 
 uint8 S9xGetST010 (uint32);
 void S9xSetST010 (uint32, uint8);
@@ -233,7 +233,7 @@ void S9xSetST018 (uint8, uint32);
 uint8 S9xGetSetaDSP (uint32);
 void S9xSetSetaDSP (uint8, uint32);
 
-extern uint8 (*GetSETA) (uint32);
-extern void (*SetSETA) (uint32, uint8);
+extern CONTEXT_LOCAL uint8 (*GetSETA) (uint32);
+extern CONTEXT_LOCAL void (*SetSETA) (uint32, uint8);
 
 #endif
@@ -341,7 +341,7 @@ struct SnapshotScreenshotInfo
 	uint8	Data[MAX_SNES_WIDTH * MAX_SNES_HEIGHT * 3];
 };
 
-static struct Obsolete
+static CONTEXT_LOCAL struct Obsolete
 {
 	uint8	CPU_IRQActive;
 }	Obsolete;
@@ -1142,18 +1142,37 @@ static FreezeData	SnapMovie[] =
 	INT_ENTRY(6, MovieInputDataSize)
 };
 
-static int UnfreezeBlock (STREAM, const char *, uint8 *, int);
-static int UnfreezeBlockCopy (STREAM, const char *, uint8 **, int);
-static int UnfreezeStruct (STREAM, const char *, void *, FreezeData *, int, int);
-static int UnfreezeStructCopy (STREAM, const char *, uint8 **, FreezeData *, int, int);
+// Snapshots are written either to a STREAM or, when 'file' is NULL, to a
+// caller-supplied memory buffer. Memory snapshots are meant for frequent
+// save/restore (netplay rollback) and skip the screenshot, the sound mute
+// and the screen redraw. With a NULL buffer, writes are only counted.
+struct SnapshotStream
+{
+	STREAM		file;
+	uint8		*data;
+	uint32		size;
+	uint32		pos;
+	bool8		overflow;
+};
+
+static int StreamRead (SnapshotStream *, void *, int);
+static void StreamWrite (SnapshotStream *, const void *, int);
+static long StreamTell (SnapshotStream *);
+static void StreamSeek (SnapshotStream *, long);
+static void FreezeToStream (SnapshotStream *);
+static int UnfreezeFromStream (SnapshotStream *);
+static int UnfreezeBlock (SnapshotStream *, const char *, uint8 *, int);
+static int UnfreezeBlockCopy (SnapshotStream *, const char *, uint8 **, int);
+static int UnfreezeStruct (SnapshotStream *, const char *, void *, FreezeData *, int, int);
+static int UnfreezeStructCopy (SnapshotStream *, const char *, uint8 **, FreezeData *, int, int);
 static void UnfreezeStructFromCopy (void *, FreezeData *, int, uint8 *, int);
-static void FreezeBlock (STREAM, const char *, uint8 *, int);
-static void FreezeStruct (STREAM, const char *, void *, FreezeData *, int);
+static void FreezeBlock (SnapshotStream *, const char *, uint8 *, int);
+static void FreezeStruct (SnapshotStream *, const char *, void *, FreezeData *, int);
 
 
 void S9xResetSaveTimer (bool8 dontsave)
 {
-	static time_t	t = -1;
+	static CONTEXT_LOCAL time_t	t = -1;
 
 	if (!Settings.DontSaveOopsSnapshot && !dontsave && t != -1 && time(NULL) - t > 300)
 	{
@@ -1266,18 +1285,110 @@ bool8 S9xUnfreezeGame (const char *filename)
 	return (FALSE);
 }
 
-void S9xFreezeToStream (STREAM stream)
+void S9xFreezeToStream (STREAM file)
+{
+	SnapshotStream	stream = { file, NULL, 0, 0, FALSE };
+
+	FreezeToStream(&stream);
+}
+
+int S9xUnfreezeFromStream (STREAM file)
+{
+	SnapshotStream	stream = { file, NULL, 0, 0, FALSE };
+
+	return (UnfreezeFromStream(&stream));
+}
+
+uint32 S9xFreezeSize (void)
+{
+	SnapshotStream	stream = { NULL, NULL, 0, 0, FALSE };
+
+	FreezeToStream(&stream);
+
+	return (stream.pos);
+}
+
+bool8 S9xFreezeGameMem (uint8 *buf, uint32 size)
+{
+	SnapshotStream	stream = { NULL, buf, size, 0, FALSE };
+
+	FreezeToStream(&stream);
+
+	return (!stream.overflow);
+}
+
+int S9xUnfreezeGameMem (const uint8 *buf, uint32 size)
+{
+	SnapshotStream	stream = { NULL, (uint8 *) buf, size, 0, FALSE };
+
+	return (UnfreezeFromStream(&stream));
+}
+
+static int StreamRead (SnapshotStream *stream, void *p, int l)
+{
+	if (stream->file)
+		return (READ_STREAM(p, l, stream->file));
+
+	if (l > (int) (stream->size - stream->pos))
+		l = stream->size - stream->pos;
+	memcpy(p, stream->data + stream->pos, l);
+	stream->pos += l;
+
+	return (l);
+}
+
+static void StreamWrite (SnapshotStream *stream, const void *p, int l)
+{
+	if (stream->file)
+	{
+		WRITE_STREAM(p, l, stream->file);
+		return;
+	}
+
+	if (stream->data)
+	{
+		if (stream->pos + l > stream->size)
+		{
+			stream->overflow = TRUE;
+			return;
+		}
+
+		memcpy(stream->data + stream->pos, p, l);
+	}
+
+	stream->pos += l;
+}
+
+static long StreamTell (SnapshotStream *stream)
+{
+	if (stream->file)
+		return (FIND_STREAM(stream->file));
+
+	return (stream->pos);
+}
+
+static void StreamSeek (SnapshotStream *stream, long offset)
+{
+	if (stream->file)
+		REVERT_STREAM(stream->file, offset, 0);
+	else
+		stream->pos = offset;
+}
+
+static void FreezeToStream (SnapshotStream *stream)
 {
 	char	buffer[1024];
 	uint8	*soundsnapshot = new uint8[SPC_SAVE_STATE_BLOCK_SIZE];
+	bool8	quick = stream->file == NULL;
 
-	S9xSetSoundMute(TRUE);
+	if (!quick)
+		S9xSetSoundMute(TRUE);
 
 	sprintf(buffer, "%s:%04d\n", SNAPSHOT_MAGIC, SNAPSHOT_VERSION);
-	WRITE_STREAM(buffer, strlen(buffer), stream);
+	StreamWrite(stream, buffer, strlen(buffer));
 
 	sprintf(buffer, "NAM:%06d:%s%c", (int) strlen(Memory.ROMFilename) + 1, Memory.ROMFilename, 0);
-	WRITE_STREAM(buffer, strlen(buffer) + 1, stream);
+	StreamWrite(stream, buffer, strlen(buffer) + 1);
 
 	FreezeStruct(stream, "CPU", &CPU, SnapCPU, COUNT(SnapCPU));
 
@@ -1359,7 +1470,7 @@ void S9xFreezeToStream (STREAM stream)
 	if (Settings.BS)
 		FreezeStruct(stream, "BSX", &BSX, SnapBSX, COUNT(SnapBSX));
 
-	if (Settings.SnapshotScreenshots)
+	if (Settings.SnapshotScreenshots && !quick)
 	{
 		SnapshotScreenshotInfo	*ssi = new SnapshotScreenshotInfo;
 
@@ -1408,19 +1519,21 @@ void S9xFreezeToStream (STREAM stream)
 		}
 	}
 
-	S9xSetSoundMute(FALSE);
+	if (!quick)
+		S9xSetSoundMute(FALSE);
 
 	delete [] soundsnapshot;
 }
 
-int S9xUnfreezeFromStream (STREAM stream)
+static int UnfreezeFromStream (SnapshotStream *stream)
 {
 	int		result = SUCCESS;
 	int		version, len;
 	char	buffer[PATH_MAX + 1];
+	bool8	quick = stream->file == NULL;
 
 	len = strlen(SNAPSHOT_MAGIC) + 1 + 4 + 1;
-	if (READ_STREAM(buffer, len, stream) != len)
+	if (StreamRead(stream, buffer, len) != len)
 		return (WRONG_FORMAT);
 
 	if (strncmp(buffer, SNAPSHOT_MAGIC, strlen(SNAPSHOT_MAGIC)) != 0)
@@ -1605,7 +1718,10 @@ int S9xUnfreezeFromStream (STREAM stream)
 		uint32 old_flags     = CPU.Flags;
 		uint32 sa1_old_flags = SA1.Flags;
 
-		S9xSetSoundMute(TRUE);
+		if (!quick)
+			S9xSetSoundMute(TRUE);
+		else
+			S9xResetSaveTimer(TRUE); // keep S9xReset() from writing an oops snapshot
 
 		S9xReset();
 
@@ -1713,6 +1829,8 @@ int S9xUnfreezeFromStream (STREAM stream)
 		}
 
 		CPU.Flags |= old_flags & (DEBUG_MODE_FLAG | TRACE_FLAG | SINGLE_STEP_FLAG | FRAME_ADVANCE_FLAG);
+		Memory.UpdateSpeedMap();
+		S9xUpdateIRQPositions(FALSE);
 		ICPU.ShiftedPB = Registers.PB << 16;
 		ICPU.ShiftedDB = Registers.DB << 16;
 		S9xSetPCBase(Registers.PBPC);
@@ -1762,7 +1880,7 @@ int S9xUnfreezeFromStream (STREAM stream)
 		if (local_movie_data)
 		{
 			// restore last displayed pad_read status
-			extern bool8	pad_read, pad_read_last;
+			extern CONTEXT_LOCAL bool8	pad_read, pad_read_last;
 			bool8			pad_read_temp = pad_read;
 
 			pad_read = pad_read_last;
@@ -1823,13 +1941,18 @@ int S9xUnfreezeFromStream (STREAM stream)
 			delete ssi;
 		}
 		else
+		if (!quick)
 		{
 			// couldn't load graphics, so black out the screen instead
 			for (uint32 y = 0; y < (uint32) (IMAGE_HEIGHT); y++)
 				memset(GFX.Screen + y * GFX.RealPPL, 0, GFX.RealPPL * 2);
 		}
 
-		S9xSetSoundMute(FALSE);
+		if (!quick)
+		{
+			S9xMarkLinesChanged(0, MAX_SNES_HEIGHT);
+			S9xSetSoundMute(FALSE);
+		}
 	}
 
 	if (local_cpu)				delete [] local_cpu;
@@ -1880,7 +2003,7 @@ static int FreezeSize (int size, int type)
 	}
 }
 
-static void FreezeStruct (STREAM stream, const char *name, void *base, FreezeData *fields, int num_fields)
+static void FreezeStruct (SnapshotStream *stream, const char *name, void *base, FreezeData *fields, int num_fields)
 {
 	int	len = 0;
 	int	i, j;
@@ -2002,7 +2125,7 @@ static void FreezeStruct (STREAM stream, const char *name, void *base, FreezeDat
 	delete [] block;
 }
 
-static void FreezeBlock (STREAM stream, const char *name, uint8 *block, int size)
+static void FreezeBlock (SnapshotStream *stream, const char *name, uint8 *block, int size)
 {
 	char	buffer[20];
 
@@ -2021,24 +2144,25 @@ static void FreezeBlock (STREAM stream, const char *name, uint8 *block, int size
 
 	buffer[11] = 0;
 
-	WRITE_STREAM(buffer, 11, stream);
-	WRITE_STREAM(block, size, stream);
+	StreamWrite(stream, buffer, 11);
+	StreamWrite(stream, block, size);
 }
 
-static int UnfreezeBlock (STREAM stream, const char *name, uint8 *block, int size)
+static int UnfreezeBlock (SnapshotStream *stream, const char *name, uint8 *block, int size)
 {
 	char	buffer[20];
 	int		len = 0, rem = 0;
-	long	rewind = FIND_STREAM(stream);
+	long	rewind = StreamTell(stream);
 
-	size_t	l = READ_STREAM(buffer, 11, stream);
+	size_t	l = StreamRead(stream, buffer, 11);
 	buffer[l] = 0;
 
 	if (l != 11 || strncmp(buffer, name, 3) != 0 || buffer[3] != ':')
 	{
 	err:
-		fprintf(stdout, "absent: %s(%d); next: '%.11s'\n", name, size, buffer);
-		REVERT_STREAM(stream, FIND_STREAM(stream) - l, 0);
+		if (stream->file)
+			fprintf(stdout, "absent: %s(%d); next: '%.11s'\n", name, size, buffer);
+		StreamSeek(stream, StreamTell(stream) - l);
 		return (WRONG_FORMAT);
 	}
 
@@ -2063,20 +2187,20 @@ static int UnfreezeBlock (STREAM stream, const char *name, uint8 *block, int siz
 
 	ZeroMemory(block, size);
 
-	if (READ_STREAM(block, len, stream) != len)
+	if (StreamRead(stream, block, len) != len)
 	{
-		REVERT_STREAM(stream, rewind, 0);
+		StreamSeek(stream, rewind);
 		return (WRONG_FORMAT);
 	}
 
 	if (rem)
 	{
 		char	*junk = new char[rem];
-		len = READ_STREAM(junk, rem, stream);
+		len = StreamRead(stream, junk, rem);
 		delete [] junk;
 		if (len != rem)
 		{
-			REVERT_STREAM(stream, rewind, 0);
+			StreamSeek(stream, rewind);
 			return (WRONG_FORMAT);
 		}
 	}
@@ -2084,7 +2208,7 @@ static int UnfreezeBlock (STREAM stream, const char *name, uint8 *block, int siz
 	return (SUCCESS);
 }
 
-static int UnfreezeBlockCopy (STREAM stream, const char *name, uint8 **block, int size)
+static int UnfreezeBlockCopy (SnapshotStream *stream, const char *name, uint8 **block, int size)
 {
 	int	result;
 
@@ -2101,7 +2225,7 @@ static int UnfreezeBlockCopy (STREAM stream, const char *name, uint8 **block, in
 	return (SUCCESS);
 }
 
-static int UnfreezeStruct (STREAM stream, const char *name, void *base, FreezeData *fields, int num_fields, int version)
+static int UnfreezeStruct (SnapshotStream *stream, const char *name, void *base, FreezeData *fields, int num_fields, int version)
 {
 	int		result;
 	uint8	*block = NULL;
@@ -2120,7 +2244,7 @@ static int UnfreezeStruct (STREAM stream, const char *name, void *base, FreezeDa
 	return (SUCCESS);
 }
 
-static int UnfreezeStructCopy (STREAM stream, const char *name, uint8 **block, FreezeData *fields, int num_fields, int version)
+static int UnfreezeStructCopy (SnapshotStream *stream, const char *name, uint8 **block, FreezeData *fields, int num_fields, int version)
 {
 	int	len = 0;
 
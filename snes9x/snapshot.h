@@ -195,6 +195,9 @@ bool8 S9xFreezeGame (const char *);
 bool8 S9xUnfreezeGame (const char *);
 void S9xFreezeToStream (STREAM);
 int	 S9xUnfreezeFromStream (STREAM);
+uint32 S9xFreezeSize (void);
+bool8 S9xFreezeGameMem (uint8 *, uint32);
+int	 S9xUnfreezeGameMem (const uint8 *, uint32);
 bool8 S9xSPCDump (const char *);
 
 #endif
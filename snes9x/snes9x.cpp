@@ -409,7 +409,10 @@ void S9xLoadConfigFiles (char **argv, int argc)
 	Settings.ReverseStereo              =  conf.GetBool("Sound::ReverseStereo",                false);
 	Settings.SoundPlaybackRate          =  conf.GetUInt("Sound::Rate",                         32000);
 	Settings.SoundInputRate             =  conf.GetUInt("Sound::InputRate",                    32000);
+	Settings.DynamicRateControl         =  conf.GetBool("Sound::DynamicRateControl",           false);
+	Settings.DynamicRateLimit           =  conf.GetUInt("Sound::DynamicRateLimit",             5);
 	Settings.Mute                       =  conf.GetBool("Sound::Mute",                         false);
+	Settings.FastBRR                    =  conf.GetBool("Sound::FastBRR",                      false);
 
 	// Display
 
@@ -486,6 +489,8 @@ void S9xLoadConfigFiles (char **argv, int argc)
 	Settings.ServerName[0] = '\0';
 	if (conf.Exists("Netplay::Server"))
 		conf.GetString("Netplay::Server", Settings.ServerName, 128);
+
+	Settings.NetPlayRollback = conf.GetUInt("Netplay::RollbackFrames", 0);
 #endif
 
 	// Debug
@@ -499,6 +504,9 @@ void S9xLoadConfigFiles (char **argv, int argc)
 		ENSURE_TRACE_OPEN(trace,"trace.log","wb")
 		CPU.Flags |= TRACE_FLAG;
 	}
+
+	if (conf.GetBool("DEBUG::TraceBinary", false))
+		S9xStartBinaryTrace();
 #endif
 
 	S9xParsePortConfig(conf, 1);
@@ -519,10 +527,13 @@ void S9xUsage (void)
 	S9xMessage(S9X_INFO, S9X_USAGE, "-soundsync                      Synchronize sound as far as possible");
 	S9xMessage(S9X_INFO, S9X_USAGE, "-playbackrate <Hz>              Set sound playback rate");
 	S9xMessage(S9X_INFO, S9X_USAGE, "-inputrate <Hz>                 Set sound input rate");
+	S9xMessage(S9X_INFO, S9X_USAGE, "-dynamicratecontrol             Adjust sound rate slightly to keep the buffer level");
 	S9xMessage(S9X_INFO, S9X_USAGE, "-reversestereo                  Reverse stereo sound output");
 	S9xMessage(S9X_INFO, S9X_USAGE, "-nostereo                       Disable stereo sound output");
 	S9xMessage(S9X_INFO, S9X_USAGE, "-eightbit                       Use 8bit sound instead of 16bit");
 	S9xMessage(S9X_INFO, S9X_USAGE, "-mute                           Mute sound");
+	S9xMessage(S9X_INFO, S9X_USAGE, "-fastbrr                        Decode sound samples a block at a time and skip");
+	S9xMessage(S9X_INFO, S9X_USAGE, "                                silent voices (faster, less accurate)");
 	S9xMessage(S9X_INFO, S9X_USAGE, "");
 
 	// DISPLAY OPTIONS
@@ -580,6 +591,8 @@ void S9xUsage (void)
 	S9xMessage(S9X_INFO, S9X_USAGE, "-port <num>                     Use port <num> for netplay (use with -net)");
 	S9xMessage(S9X_INFO, S9X_USAGE, "-server <string>                Use the specified server for netplay");
 	S9xMessage(S9X_INFO, S9X_USAGE, "                                (use with -net)");
+	S9xMessage(S9X_INFO, S9X_USAGE, "-rollback <num>                 Predict remote input and roll back up to");
+	S9xMessage(S9X_INFO, S9X_USAGE, "                                <num> frames (use with -net)");
 	S9xMessage(S9X_INFO, S9X_USAGE, "");
 #endif
 
@@ -587,6 +600,7 @@ void S9xUsage (void)
 #ifdef DEBUGGER
 	S9xMessage(S9X_INFO, S9X_USAGE, "-debug                          Set the Debugger flag");
 	S9xMessage(S9X_INFO, S9X_USAGE, "-trace                          Begin CPU instruction tracing");
+	S9xMessage(S9X_INFO, S9X_USAGE, "-tracebinary                    Begin binary CPU/SA-1 tracing to trace.bin");
 #endif
 	S9xMessage(S9X_INFO, S9X_USAGE, "-hdmatiming <1-199>             (Not recommended) Changes HDMA transfer timings");
 	S9xMessage(S9X_INFO, S9X_USAGE, "                                event comes");
@@ -649,6 +663,9 @@ char * S9xParseArgs (char **argv, int argc)
 					S9xUsage();
 			}
 			else
+			if (!strcasecmp(argv[i], "-dynamicratecontrol"))
+				Settings.DynamicRateControl = TRUE;
+			else
 			if (!strcasecmp(argv[i], "-reversestereo"))
 				Settings.ReverseStereo = TRUE;
 			else
@@ -661,6 +678,9 @@ char * S9xParseArgs (char **argv, int argc)
 			if (!strcasecmp(argv[i], "-mute"))
 				Settings.Mute = TRUE;
 			else
+			if (!strcasecmp(argv[i], "-fastbrr"))
+				Settings.FastBRR = TRUE;
+			else
 
 			// DISPLAY OPTIONS
 
@@ -835,6 +855,14 @@ char * S9xParseArgs (char **argv, int argc)
 					S9xUsage();
 			}
 			else
+			if (!strcasecmp(argv[i], "-rollback"))
+			{
+				if (i + 1 < argc)
+					Settings.NetPlayRollback = atoi(argv[++i]);
+				else
+					S9xUsage();
+			}
+			else
 		#endif
 
 			// HACKING OR DEBUGGING OPTIONS
@@ -849,6 +877,9 @@ char * S9xParseArgs (char **argv, int argc)
 				CPU.Flags |= TRACE_FLAG;
 			}
 			else
+			if (!strcasecmp(argv[i], "-tracebinary"))
+				S9xStartBinaryTrace();
+			else
 		#endif
 
 			if (!strcasecmp(argv[i], "-hdmatiming"))
@@ -319,6 +319,7 @@ struct STimings
 	int32	HDMAInit;
 	int32	HDMAStart;
 	int32	NMITriggerPos;
+	int32	NextIRQTimer;	// H/V timer IRQ deadline on this scanline, 0x0fffffff if none.
 	int32	IRQTriggerCycles;
 	int32	WRAMRefreshPos;
 	int32	RenderPos;
@@ -376,9 +377,12 @@ struct SSettings
 	bool8	SixteenBitSound;
 	uint32	SoundPlaybackRate;
 	uint32	SoundInputRate;
+	bool8	DynamicRateControl;
+	uint32	DynamicRateLimit;	// Largest rate adjustment, in thousandths.
 	bool8	Stereo;
 	bool8	ReverseStereo;
 	bool8	Mute;
+	bool8	FastBRR;			// Decode BRR blocks whole and skip silent voices.
 
 	bool8	SupportHiRes;
 	bool8	Transparency;
@@ -417,6 +421,7 @@ struct SSettings
 	bool8	NetPlayServer;
 	char	ServerName[128];
 	int		Port;
+	uint32	NetPlayRollback;
 
 	bool8	MovieTruncate;
 	bool8	MovieNotifyIgnored;
@@ -460,10 +465,10 @@ void S9xClearPause(uint32);
 void S9xExit(void);
 void S9xMessage(int, int, const char *);
 }
-extern struct SSettings			Settings;
-extern struct SCPUState			CPU;
-extern struct STimings			Timings;
-extern struct SSNESGameFixes	SNESGameFixes;
-extern char						String[513];
+extern CONTEXT_LOCAL struct SSettings			Settings;
+extern CONTEXT_LOCAL struct SCPUState			CPU;
+extern CONTEXT_LOCAL struct STimings			Timings;
+extern CONTEXT_LOCAL struct SSNESGameFixes	SNESGameFixes;
+extern CONTEXT_LOCAL char						String[513];
 
 #endif
@@ -210,7 +210,7 @@
 #include "spc7110emu.h"
 #include "spc7110emu.cpp"
 
-SPC7110	s7emu;
+CONTEXT_LOCAL_CLASS SPC7110	s7emu;
 
 static void SetSPC7110SRAMMap (uint8);
 
@@ -242,6 +242,8 @@ static void SetSPC7110SRAMMap (uint8 newstate)
 		Memory.Map[0x306] = (uint8 *) Memory.MAP_RONLY_SRAM;
 		Memory.Map[0x307] = (uint8 *) Memory.MAP_RONLY_SRAM;
 	}
+
+	S9xUpdateWatchpoints();
 }
 
 uint8 * S9xGetBasePointerSPC7110 (uint32 address)
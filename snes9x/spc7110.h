@@ -262,7 +262,7 @@ struct SSPC7110Snapshot
 	}	context[32];
 };
 
-extern struct SSPC7110Snapshot	s7snap;
+extern CONTEXT_LOCAL struct SSPC7110Snapshot	s7snap;
 
 void S9xInitSPC7110 (void);
 void S9xResetSPC7110 (void);
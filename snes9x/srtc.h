@@ -191,8 +191,8 @@ struct SSRTCSnapshot
 	int32	rtc_index;	// signed
 };
 
-extern struct SRTCData		RTCData;
-extern struct SSRTCSnapshot	srtcsnap;
+extern CONTEXT_LOCAL struct SRTCData		RTCData;
+extern CONTEXT_LOCAL struct SSRTCSnapshot	srtcsnap;
 
 void S9xInitSRTC (void);
 void S9xResetSRTC (void);
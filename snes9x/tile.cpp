@@ -189,9 +189,9 @@
 #include "ppu.h"
 #include "tile.h"
 
-static uint32	pixbit[8][16];
-static uint8	hrbit_odd[256];
-static uint8	hrbit_even[256];
+static CONTEXT_LOCAL uint32	pixbit[8][16];
+static CONTEXT_LOCAL uint8	hrbit_odd[256];
+static CONTEXT_LOCAL uint8	hrbit_even[256];
 
 
 void S9xInitTileRenderer (void)
@@ -1023,7 +1023,7 @@ void S9xSelectTileConverter (int depth, bool8 hires, bool8 sub, bool8 mosaic)
 
 #define CLIP_10_BIT_SIGNED(a)	(((a) & 0x2000) ? ((a) | ~0x3ff) : ((a) & 0x3ff))
 
-extern struct SLineMatrixData	LineMatrixData[240];
+extern CONTEXT_LOCAL struct SLineMatrixData	LineMatrixData[240];
 
 #define NO_INTERLACE	1
 #define Z1				(D + 7)
@@ -0,0 +1,391 @@
+#!/usr/bin/env python3
+"""Disassemble and filter a binary instruction trace (trace.bin).
+
+The trace is written by a DEBUGGER build of Snes9x when started with
+-tracebinary, DEBUG::TraceBinary, or the debugger's TB command. Each record
+is an STraceRecord from debug.h. Main CPU lines are printed in the same
+layout as trace.log, SA-1 lines are marked and show the SA-1's own cycle
+count, and SPC700 lines follow apu_trace.log. Effective addresses that would
+need a memory read (the indirect modes) are left out. SuperFX code isn't
+traced.
+
+Examples:
+    tracedump.py trace.bin --frames 1200-1210
+    tracedump.py trace.bin --pc 80:8000-80:80ff --op JSR,JSL
+    tracedump.py trace.bin --hot 20
+    tracedump.py trace.bin --spc --op MOV
+"""
+
+import argparse
+import collections
+import struct
+import sys
+
+MAGIC = b"S9XTRACE"
+VERSIONS = (1, 2)
+RECORD = struct.Struct("<BBH4sHHHHHHBBHiI")
+
+SOURCE_CPU = 0
+SOURCE_SA1 = 1
+SOURCE_SPC = 2
+SOURCE_PREFIX = {SOURCE_CPU: "", SOURCE_SA1: "[SA1] ", SOURCE_SPC: "[SPC] "}
+
+MNEMONICS = (
+    "BRK", "ORA", "COP", "ORA", "TSB", "ORA", "ASL", "ORA",
+    "PHP", "ORA", "ASL", "PHD", "TSB", "ORA", "ASL", "ORA",
+    "BPL", "ORA", "ORA", "ORA", "TRB", "ORA", "ASL", "ORA",
+    "CLC", "ORA", "INC", "TCS", "TRB", "ORA", "ASL", "ORA",
+    "JSR", "AND", "JSL", "AND", "BIT", "AND", "ROL", "AND",
+    "PLP", "AND", "ROL", "PLD", "BIT", "AND", "ROL", "AND",
+    "BMI", "AND", "AND", "AND", "BIT", "AND", "ROL", "AND",
+    "SEC", "AND", "DEC", "TSC", "BIT", "AND", "ROL", "AND",
+    "RTI", "EOR", "WDM", "EOR", "MVP", "EOR", "LSR", "EOR",
+    "PHA", "EOR", "LSR", "PHK", "JMP", "EOR", "LSR", "EOR",
+    "BVC", "EOR", "EOR", "EOR", "MVN", "EOR", "LSR", "EOR",
+    "CLI", "EOR", "PHY", "TCD", "JMP", "EOR", "LSR", "EOR",
+    "RTS", "ADC", "PER", "ADC", "STZ", "ADC", "ROR", "ADC",
+    "PLA", "ADC", "ROR", "RTL", "JMP", "ADC", "ROR", "ADC",
+    "BVS", "ADC", "ADC", "ADC", "STZ", "ADC", "ROR", "ADC",
+    "SEI", "ADC", "PLY", "TDC", "JMP", "ADC", "ROR", "ADC",
+    "BRA", "STA", "BRL", "STA", "STY", "STA", "STX", "STA",
+    "DEY", "BIT", "TXA", "PHB", "STY", "STA", "STX", "STA",
+    "BCC", "STA", "STA", "STA", "STY", "STA", "STX", "STA",
+    "TYA", "STA", "TXS", "TXY", "STZ", "STA", "STZ", "STA",
+    "LDY", "LDA", "LDX", "LDA", "LDY", "LDA", "LDX", "LDA",
+    "TAY", "LDA", "TAX", "PLB", "LDY", "LDA", "LDX", "LDA",
+    "BCS", "LDA", "LDA", "LDA", "LDY", "LDA", "LDX", "LDA",
+    "CLV", "LDA", "TSX", "TYX", "LDY", "LDA", "LDX", "LDA",
+    "CPY", "CMP", "REP", "CMP", "CPY", "CMP", "DEC", "CMP",
+    "INY", "CMP", "DEX", "WAI", "CPY", "CMP", "DEC", "CMP",
+    "BNE", "CMP", "CMP", "CMP", "PEI", "CMP", "DEC", "CMP",
+    "CLD", "CMP", "PHX", "STP", "JML", "CMP", "DEC", "CMP",
+    "CPX", "SBC", "SEP", "SBC", "CPX", "SBC", "INC", "SBC",
+    "INX", "SBC", "NOP", "XBA", "CPX", "SBC", "INC", "SBC",
+    "BEQ", "SBC", "SBC", "SBC", "PEA", "SBC", "INC", "SBC",
+    "SED", "SBC", "PLX", "XCE", "JSR", "SBC", "INC", "SBC",
+)
+
+ADDR_MODES = (
+     3, 10,  3, 19,  6,  6,  6, 12,  0,  1, 24,  0, 14, 14, 14, 17,  # 0
+     4, 11,  9, 20,  6,  7,  7, 13,  0, 16, 24,  0, 14, 15, 15, 18,  # 1
+    14, 10, 17, 19,  6,  6,  6, 12,  0,  1, 24,  0, 14, 14, 14, 17,  # 2
+     4, 11,  9, 20,  7,  7,  7, 13,  0, 16, 24,  0, 15, 15, 15, 18,  # 3
+     0, 10,  3, 19, 25,  6,  6, 12,  0,  1, 24,  0, 14, 14, 14, 17,  # 4
+     4, 11,  9, 20, 25,  7,  7, 13,  0, 16,  0,  0, 17, 15, 15, 18,  # 5
+     0, 10,  5, 19,  6,  6,  6, 12,  0,  1, 24,  0, 21, 14, 14, 17,  # 6
+     4, 11,  9, 20,  7,  7,  7, 13,  0, 16,  0,  0, 23, 15, 15, 18,  # 7
+     4, 10,  5, 19,  6,  6,  6, 12,  0,  1,  0,  0, 14, 14, 14, 17,  # 8
+     4, 11,  9, 20,  7,  7,  8, 13,  0, 16,  0,  0, 14, 15, 15, 18,  # 9
+     2, 10,  2, 19,  6,  6,  6, 12,  0,  1,  0,  0, 14, 14, 14, 17,  # A
+     4, 11,  9, 20,  7,  7,  8, 13,  0, 16,  0,  0, 15, 15, 16, 18,  # B
+     2, 10,  3, 19,  6,  6,  6, 12,  0,  1,  0,  0, 14, 14, 14, 17,  # C
+     4, 11,  9,  9, 27,  7,  7, 13,  0, 16,  0,  0, 22, 15, 15, 18,  # D
+     2, 10,  3, 19,  6,  6,  6, 12,  0,  1,  0,  0, 14, 14, 14, 17,  # E
+     4, 11,  9, 20, 26,  7,  7, 13,  0, 16,  0,  0, 23, 15, 15, 18,  # F
+)
+
+SPC_MNEMONICS = (
+    "NOP", "TCALL 0", "SET1 $%02X.0", "BBS $%02X.0,$%04X",
+    "OR A,$%02X", "OR A,!$%04X", "OR A,(X)", "OR A,[$%02X+X]",
+    "OR A,#$%02X", "OR $%02X,$%02X", "OR1 C,$%04X.%d", "ASL $%02X",
+    "MOV !$%04X,Y", "PUSH PSW", "TSET1 !$%04X", "BRK",
+    "BPL $%04X", "TCALL 1", "CLR1 $%02X.0", "BBC $%02X.0,$%04X",
+    "OR A,$%02X+X", "OR A,!$%04X+X", "OR A,!$%04X+Y", "OR A,[$%02X]+Y",
+    "OR $%02X,#$%02X", "OR (X),(Y)", "DECW $%02X", "ASL $%02X+X",
+    "ASL A", "DEC X", "CMP X,!$%04X", "JMP [!$%04X+X]",
+    "CLRP", "TCALL 2", "SET1 $%02X.1", "BBS $%02X.1,$%04X",
+    "AND A,$%02X", "AND A,!$%04X", "AND A,(X)", "AND A,[$%02X+X]",
+    "AND A,#$%02X", "AND $%02X,$%02X", "OR1 C,/$%04X.%d", "ROL $%02X",
+    "ROL !$%04X", "PUSH A", "CBNE $%02X,$%04X", "BRA $%04X",
+    "BMI $%04X", "TCALL 3", "CLR1 $%02X.1", "BBC $%02X.1,$%04X",
+    "AND A,$%02X+X", "AND A,!$%04X+X", "AND A,!$%04X+Y", "AND A,[$%02X]+Y",
+    "AND $%02X,#$%02X", "AND (X),(Y)", "INCW $%02X", "ROL $%02X+X",
+    "ROL A", "INC X", "CMP X,$%02X", "CALL !$%04X",
+    "SETP", "TCALL 4", "SET1 $%02X.2", "BBS $%02X.2,$%04X",
+    "EOR A,$%02X", "EOR A,!$%04X", "EOR A,(X)", "EOR A,[$%02X+X]",
+    "EOR A,#$%02X", "EOR $%02X,$%02X", "AND1 C,$%04X.%d", "LSR $%02X",
+    "LSR !$%04X", "PUSH X", "TCLR1 !$%04X", "PCALL $%02X",
+    "BVC $%04X", "TCALL 5", "CLR1 $%02X.2", "BBC $%02X.2,$%04X",
+    "EOR A,$%02X+X", "EOR A,!$%04X+X", "EOR A,!$%04X+Y", "EOR A,[$%02X]+Y",
+    "EOR $%02X,#$%02X", "EOR (X),(Y)", "CMPW YA,$%02X", "LSR $%02X+X",
+    "LSR A", "MOV X,A", "CMP Y,!$%04X", "JMP !$%04X",
+    "CLRC", "TCALL 6", "SET1 $%02X.3", "BBS $%02X.3,$%04X",
+    "CMP A,$%02X", "CMP A,!$%04X", "CMP A,(X)", "CMP A,[$%02X+X]",
+    "CMP A,#$%02X", "CMP $%02X,$%02X", "AND1 C,/$%04X.%d", "ROR $%02X",
+    "ROR !$%04X", "PUSH Y", "DBNZ $%02X,$%04X", "RET",
+    "BVS $%04X", "TCALL 7", "CLR1 $%02X.3", "BBC $%02X.3,$%04X",
+    "CMP A,$%02X+X", "CMP A,!$%04X+X", "CMP A,!$%04X+Y", "CMP A,[$%02X]+Y",
+    "CMP $%02X,#$%02X", "CMP (X),(Y)", "ADDW YA,$%02X", "ROR $%02X+X",
+    "ROR A", "MOV A,X", "CMP Y,$%02X", "RET1",
+    "SETC", "TCALL 8", "SET1 $%02X.4", "BBS $%02X.4,$%04X",
+    "ADC A,$%02X", "ADC A,!$%04X", "ADC A,(X)", "ADC A,[$%02X+X]",
+    "ADC A,#$%02X", "ADC $%02X,$%02X", "EOR1 C,$%04X.%d", "DEC $%02X",
+    "DEC !$%04X", "MOV Y,#$%02X", "POP PSW", "MOV $%02X,#$%02X",
+    "BCC $%04X", "TCALL 9", "CLR1 $%02X.4", "BBC $%02X.4,$%04X",
+    "ADC A,$%02X+X", "ADC A,!$%04X+X", "ADC A,!$%04X+Y", "ADC A,[$%02X]+Y",
+    "ADC $%02X,#$%02X", "ADC (X),(Y)", "SUBW YA,$%02X", "DEC $%02X+X",
+    "DEC A", "MOV X,SP", "DIV YA,X", "XCN A",
+    "EI", "TCALL 10", "SET1 $%02X.5", "BBS $%02X.5,$%04X",
+    "SBC A,$%02X", "SBC A,!$%04X", "SBC A,(X)", "SBC A,[$%02X+X]",
+    "SBC A,#$%02X", "SBC $%02X,$%02X", "MOV1 C,$%04X.%d", "INC $%02X",
+    "INC !$%04X", "CMP Y,#$%02X", "POP A", "MOV (X)+,A",
+    "BCS $%04X", "TCALL 11", "CLR1 $%02X.5", "BBC $%02X.5,$%04X",
+    "SBC A,$%02X+X", "SBC A,!$%04X+X", "SBC A,!$%04X+Y", "SBC A,[$%02X]+Y",
+    "SBC $%02X,#$%02X", "SBC (X),(Y)", "MOVW YA,$%02X", "INC $%02X+X",
+    "INC A", "MOV SP,X", "DAS A", "MOV A,(X)+",
+    "DI", "TCALL 12", "SET1 $%02X.6", "BBS $%02X.6,$%04X",
+    "MOV $%02X,A", "MOV !$%04X,A", "MOV (X),A", "MOV [$%02X+X],A",
+    "CMP X,#$%02X", "MOV !$%04X,X", "MOV1 $%04X.%d,C", "MOV $%02X,Y",
+    "ASL !$%04X", "MOV X,#$%02X", "POP X", "MUL YA",
+    "BNE $%04X", "TCALL 13", "CLR1 $%02X.6", "BBC $%02X.6,$%04X",
+    "MOV $%02X+X,A", "MOV !$%04X+X,A", "MOV !$%04X+Y,A", "MOV [$%02X]+Y,A",
+    "MOV $%02X,X", "MOV $%02X+Y,X", "MOVW $%02X,YA", "MOV $%02X+X,Y",
+    "DEC Y", "MOV A,Y", "CBNE $%02X+X,$%04X", "DAA A",
+    "CLRV", "TCALL 14", "SET1 $%02X.7", "BBS $%02X.7,$%04X",
+    "MOV A,$%02X", "MOV A,!$%04X", "MOV A,(X)", "MOV A,[$%02X+X]",
+    "MOV A,#$%02X", "MOV X,!$%04X", "NOT1 $%04X.%d", "MOV Y,$%02X",
+    "MOV Y,!$%04X", "NOTC", "POP Y", "SLEEP",
+    "BEQ $%04X", "TCALL 15", "CLR1 $%02X.7", "BBC $%02X.7,$%04X",
+    "MOV A,$%02X+X", "MOV A,!$%04X+X", "MOV A,!$%04X+Y", "MOV A,[$%02X]+Y",
+    "MOV X,$%02X", "MOV X,$%02X+Y", "MOV $%02X,$%02X", "MOV Y,$%02X+X",
+    "INC Y", "MOV Y,A", "DBNZ Y,$%04X", "STOP",
+)
+
+SPC_MODES = (
+    2, 2, 0, 5, 0, 1, 2, 0, 0, 3, 6, 0, 1, 2, 1, 2,  # 0
+    7, 2, 0, 5, 0, 1, 1, 0, 4, 2, 0, 0, 2, 2, 1, 1,  # 1
+    2, 2, 0, 5, 0, 1, 2, 0, 0, 3, 6, 0, 1, 2, 5, 7,  # 2
+    7, 2, 0, 5, 0, 1, 1, 0, 4, 2, 0, 0, 2, 2, 0, 1,  # 3
+    2, 2, 0, 5, 0, 1, 2, 0, 0, 3, 6, 0, 1, 2, 1, 0,  # 4
+    7, 2, 0, 5, 0, 1, 1, 0, 4, 2, 0, 0, 2, 2, 1, 1,  # 5
+    2, 2, 0, 5, 0, 1, 2, 0, 0, 3, 6, 0, 1, 2, 5, 2,  # 6
+    7, 2, 0, 5, 0, 1, 1, 0, 4, 2, 0, 0, 2, 2, 0, 2,  # 7
+    2, 2, 0, 5, 0, 1, 2, 0, 0, 3, 6, 0, 1, 0, 2, 4,  # 8
+    7, 2, 0, 5, 0, 1, 1, 0, 4, 2, 0, 0, 2, 2, 2, 2,  # 9
+    2, 2, 0, 5, 0, 1, 2, 0, 0, 3, 6, 0, 1, 0, 2, 2,  # A
+    7, 2, 0, 5, 0, 1, 1, 0, 4, 2, 0, 0, 2, 2, 2, 2,  # B
+    2, 2, 0, 5, 0, 1, 2, 0, 0, 1, 6, 0, 1, 0, 2, 2,  # C
+    7, 2, 0, 5, 0, 1, 1, 0, 0, 0, 0, 0, 2, 2, 5, 2,  # D
+    2, 2, 0, 5, 0, 1, 2, 0, 0, 1, 6, 0, 1, 2, 2, 2,  # E
+    7, 2, 0, 5, 0, 1, 1, 0, 0, 0, 3, 0, 2, 2, 7, 2,  # F
+)
+
+SPC_MODE_BYTES = (2, 3, 1, 3, 3, 3, 3, 2)
+
+
+def parse_address(text):
+    """Accepts $BB:AAAA, BB:AAAA or a plain 24-bit hex number."""
+    text = text.strip().lstrip("$")
+    if ":" in text:
+        bank, addr = text.split(":", 1)
+        return (int(bank, 16) << 16) | int(addr.lstrip("$"), 16)
+    return int(text, 16)
+
+
+def parse_range(text, parse):
+    if "-" in text:
+        lo, hi = text.split("-", 1)
+        return parse(lo), parse(hi)
+    value = parse(text)
+    return value, value
+
+
+def operand(rec):
+    """Returns the bytes column, operand text and effective address text."""
+    (source, bank, pc, ops, a, x, y, d, s, p, db, irq, vc, cycles, frame) = rec
+    op = ops[0]
+    b0, b1, b2 = ops[1], ops[2], ops[3]
+    word = (b1 << 8) | b0
+    mode = ADDR_MODES[op]
+
+    if mode in (0, 24):
+        return "", "A" if mode == 24 else "", ""
+    if mode == 1 or mode == 2:
+        if not p & (0x20 if mode == 1 else 0x10):
+            return "%02X %02X" % (b0, b1), "#$%04X" % word, ""
+        return "%02X" % b0, "#$%02X" % b0, ""
+    if mode == 3:
+        return "%02X" % b0, "#$%02X" % b0, ""
+    if mode == 4:
+        target = (pc + 2 + (b0 - 256 if b0 & 0x80 else b0)) & 0xffff
+        return "%02X" % b0, "$%02X" % b0, "[$%04X]" % target
+    if mode == 5:
+        target = (pc + 3 + (word - 65536 if word & 0x8000 else word)) & 0xffff
+        return "%02X %02X" % (b0, b1), "$%04X" % word, "[$%04X]" % target
+    if mode in (6, 7, 8):
+        ea = (b0 + d + (x if mode == 7 else y if mode == 8 else 0)) & 0xffff
+        suffix = ("", ",x", ",y")[mode - 6]
+        return "%02X" % b0, "$%02X%s" % (b0, suffix), "[$00:%04X]" % ea
+    if mode in (9, 10, 11, 12, 13, 27):
+        text = {9: "($%02X)", 10: "($%02X,x)", 11: "($%02X),y", 12: "[$%02X]",
+                13: "[$%02X],y", 27: "($%02X)"}[mode] % b0
+        return "%02X" % b0, text, ""
+    if mode in (14, 15, 16):
+        ea = (word + (x if mode == 15 else y if mode == 16 else 0)) & 0xffff
+        suffix = ("", ",x", ",y")[mode - 14]
+        return "%02X %02X" % (b0, b1), "$%04X%s" % (word, suffix), "[$%02X:%04X]" % (db, ea)
+    if mode in (17, 18):
+        ea = (word + (x if mode == 18 else 0)) & 0xffff
+        suffix = ",x" if mode == 18 else ""
+        return ("%02X %02X %02X" % (b0, b1, b2), "$%02X%04X%s" % (b2, word, suffix),
+                "[$%02X:%04X]" % (b2, ea))
+    if mode == 19:
+        return "%02X" % b0, "$%02X,s" % b0, "[$00:%04X]" % ((s + b0) & 0xffff)
+    if mode == 20:
+        return "%02X" % b0, "($%02X,s),y" % b0, ""
+    if mode in (21, 22, 23):
+        text = {21: "($%04X)", 22: "[$%04X]", 23: "($%04X,x)"}[mode] % word
+        return "%02X %02X" % (b0, b1), text, ""
+    if mode == 25:
+        return "%02X %02X" % (b0, b1), "%02X %02X" % (b1, b0), ""
+    if mode == 26:
+        return "%02X %02X" % (b0, b1), "$%04X" % word, ""
+    return "", "", ""
+
+
+def mnemonic(rec):
+    """Returns the instruction name, without operands."""
+    if rec[0] == SOURCE_SPC:
+        return SPC_MNEMONICS[rec[3][0]].split(" ", 1)[0]
+    return MNEMONICS[rec[3][0]]
+
+
+def format_spc_record(rec):
+    (source, bank, pc, ops, a, x, y, d, s, p, db, irq, vc, cycles, frame) = rec
+    d0, d1, d2 = ops[0], ops[1], ops[2]
+    mode = SPC_MODES[d0]
+    size = SPC_MODE_BYTES[mode]
+    text = SPC_MNEMONICS[d0]
+
+    if mode == 0:
+        text = text % d1
+    elif mode == 1:
+        text = text % (d1 | (d2 << 8))
+    elif mode in (3, 4):
+        text = text % (d2, d1)
+    elif mode == 5:
+        text = text % (d1, (pc + 3 + (d2 - 256 if d2 & 0x80 else d2)) & 0xffff)
+    elif mode == 6:
+        text = text % ((d1 | (d2 << 8)) & 0x1fff, d2 >> 5)
+    elif mode == 7:
+        text = text % ((pc + 2 + (d1 - 256 if d1 & 0x80 else d1)) & 0xffff)
+
+    raw = " ".join("%02X" % b for b in ops[:size])
+    flags = "".join(c if p & bit else c.lower() for c, bit in
+                    (("N", 0x80), ("V", 0x40), ("P", 0x20), ("B", 0x10),
+                     ("H", 0x08), ("I", 0x04), ("Z", 0x02), ("C", 0x01)))
+
+    return "[SPC] %04X %-9s%-20s A:%02X X:%02X Y:%02X S:%02X P:%s CYC:%05d VC:%03d FR:%u" % (
+        pc, raw, text, a & 0xff, x & 0xff, y & 0xff, s & 0xff, flags, cycles, vc, frame)
+
+
+def format_record(rec):
+    (source, bank, pc, ops, a, x, y, d, s, p, db, irq, vc, cycles, frame) = rec
+    if source == SOURCE_SPC:
+        return format_spc_record(rec)
+
+    op = ops[0]
+    raw, text, ea = operand(rec)
+
+    line = "$%02X:%04X %02X %-9s%s" % (bank, pc, op, raw, MNEMONICS[op])
+    if text:
+        line += " " + text
+    if ea:
+        line = "%-32s%s" % (line, ea)
+
+    flags = "".join(c if p & bit else c.lower() for c, bit in
+                    (("E", 0x100), ("N", 0x80), ("V", 0x40), ("M", 0x20), ("X", 0x10),
+                     ("D", 0x08), ("I", 0x04), ("Z", 0x02), ("C", 0x01)))
+    irq_bits = (0x100 if irq & 4 else 0) | (0x10 if irq & 2 else 0) | (0x01 if irq & 1 else 0)
+
+    # the SA-1 record holds SA1.Cycles, not the main CPU's H position
+    clock = "CYC:%05d" % cycles if source == SOURCE_SA1 else "HC:%04d" % cycles
+
+    line = "%-44s A:%04X X:%04X Y:%04X D:%04X DB:%02X S:%04X P:%s %s VC:%03d FR:%u %03x" % (
+        line, a, x, y, d, db, s, flags, clock, vc, frame, irq_bits)
+
+    return SOURCE_PREFIX[source] + line
+
+
+def records(fp):
+    header = fp.read(16)
+    if len(header) < 16 or header[:8] != MAGIC:
+        sys.exit("not a Snes9x binary trace")
+
+    version, size = struct.unpack("<II", header[8:])
+    if version not in VERSIONS or size != RECORD.size:
+        sys.exit("unsupported trace version %d (record size %d)" % (version, size))
+
+    while True:
+        chunk = fp.read(RECORD.size * 4096)
+        usable = len(chunk) - len(chunk) % RECORD.size
+        if not usable:
+            break
+        for rec in RECORD.iter_unpack(chunk[:usable]):
+            yield rec
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Disassemble and filter a Snes9x binary trace.")
+    parser.add_argument("trace", help="trace.bin written by -tracebinary")
+    parser.add_argument("--cpu", action="store_true", help="only main CPU instructions")
+    parser.add_argument("--sa1", action="store_true", help="only SA-1 instructions")
+    parser.add_argument("--spc", action="store_true", help="only SPC700 instructions")
+    parser.add_argument("--pc", metavar="FROM[-TO]", help="only these addresses, e.g. 80:8000-80:80ff")
+    parser.add_argument("--op", metavar="MNEMONICS", help="only these instructions, e.g. JSR,JSL")
+    parser.add_argument("--frames", metavar="FROM[-TO]", help="only these emulated frames")
+    parser.add_argument("--start", type=int, default=0, metavar="N", help="skip the first N matching records")
+    parser.add_argument("--count", type=int, metavar="N", help="stop after N matching records")
+    parser.add_argument("--hot", type=int, metavar="N",
+                        help="list the N most executed addresses instead of disassembling")
+    args = parser.parse_args()
+
+    source = SOURCE_CPU if args.cpu else SOURCE_SA1 if args.sa1 else SOURCE_SPC if args.spc else None
+    pc_range = parse_range(args.pc, parse_address) if args.pc else None
+    frames = parse_range(args.frames, int) if args.frames else None
+    ops = None
+    if args.op:
+        ops = set(m.strip().upper() for m in args.op.split(","))
+
+    hot = collections.Counter() if args.hot else None
+    skip = args.start
+    left = args.count
+    out = sys.stdout
+
+    with open(args.trace, "rb") as fp:
+        for rec in records(fp):
+            if source is not None and rec[0] != source:
+                continue
+            if pc_range and not pc_range[0] <= ((rec[1] << 16) | rec[2]) <= pc_range[1]:
+                continue
+            if ops is not None and mnemonic(rec) not in ops:
+                continue
+            if frames and not frames[0] <= rec[14] <= frames[1]:
+                continue
+            if skip:
+                skip -= 1
+                continue
+
+            if hot is not None:
+                hot[(rec[0], rec[1], rec[2], mnemonic(rec))] += 1
+            else:
+                out.write(format_record(rec) + "\n")
+
+            if left is not None:
+                left -= 1
+                if not left:
+                    break
+
+    if hot is not None:
+        total = sum(hot.values()) or 1
+        for (src, bank, pc, name), n in hot.most_common(args.hot):
+            where = "%04X" % pc if src == SOURCE_SPC else "$%02X:%04X" % (bank, pc)
+            out.write("%s%s %-5s %10d %6.2f%%\n" % (
+                SOURCE_PREFIX[src], where, name, n, 100.0 * n / total))
+
+
+if __name__ == "__main__":
+    try:
+        main()
+    except BrokenPipeError:
+        pass